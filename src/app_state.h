@@ -10,6 +10,12 @@
 #include "settings_def.h"
 #include "app_types.h"
 #include "settings_ui_types.h"
+#include "retention.h"
+#include "bg_job.h"
+#include "wardrive_stats.h"
+#include "wardrive_stats_view.h"
+#include "settings_txn.h"
+#include "script_runner.h"
 
 typedef struct {
     bool enabled;  // Master switch for filtering
@@ -36,9 +42,15 @@ struct AppState {
     // UART Context
     UartContext* uart_context;
     FilterConfig* filter_config;
+    Retention* retention;
+    BgJob* bg_job;
+    WardriveStats* wardrive_stats; // Fed by the storage worker during wardrive captures
+    WardriveStatsView* wardrive_stats_view;
+    ScriptRunner* script_runner; // SD command scripts, output goes to the log view
 
     // Settings
     Settings settings;
+    SettingsTxn* settings_txn; // Batches ESP updates and the settings file write
     SettingsUIContext settings_ui_context;
     Submenu* settings_actions_menu;
     
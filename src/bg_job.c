@@ -0,0 +1,256 @@
+#include "bg_job.h"
+#include "progress_view.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BG_JOB_STACK_SIZE      3072
+#define BG_JOB_UPDATE_INTERVAL 100 // ms between view refreshes
+
+typedef enum {
+    BgJobStateIdle,
+    BgJobStateRunning,
+    BgJobStateFinished, // Worker returned, waiting for APP_EVENT_BG_JOB_DONE
+    BgJobStateDone, // Result shown, waiting for the user to dismiss
+} BgJobState;
+
+struct BgJob {
+    ViewDispatcher* view_dispatcher;
+    ProgressView* progress_view;
+    FuriThread* thread;
+    BgJobSpec spec;
+    volatile BgJobState state;
+    volatile bool cancel_requested;
+    bool success;
+
+    uint32_t items_done;
+    uint32_t items_total;
+    uint64_t bytes_done;
+    uint32_t last_update;
+    uint32_t start_tick;
+
+    BgJobCallback dismiss_callback;
+    void* dismiss_context;
+};
+
+void bg_job_format_bytes(char* out, size_t out_size, uint64_t bytes) {
+    if(bytes < 1024) {
+        snprintf(out, out_size, "%lu B", (uint32_t)bytes);
+    } else if(bytes < 1024 * 1024) {
+        uint32_t tenths = (uint32_t)((bytes * 10) / 1024);
+        snprintf(out, out_size, "%lu.%lu KB", tenths / 10, tenths % 10);
+    } else {
+        uint32_t tenths = (uint32_t)((bytes * 10) / (1024 * 1024));
+        snprintf(out, out_size, "%lu.%lu MB", tenths / 10, tenths % 10);
+    }
+}
+
+static void bg_job_refresh_view(BgJob* job) {
+    char line1[32];
+    char line2[32];
+    char bytes[16];
+
+    if(job->items_total) {
+        snprintf(
+            line1,
+            sizeof(line1),
+            "%lu/%lu %s",
+            job->items_done,
+            job->items_total,
+            job->spec.item_label ? job->spec.item_label : "");
+    } else {
+        snprintf(
+            line1,
+            sizeof(line1),
+            "%lu %s",
+            job->items_done,
+            job->spec.item_label ? job->spec.item_label : "");
+    }
+
+    line2[0] = '\0';
+    if(job->spec.bytes_label) {
+        bg_job_format_bytes(bytes, sizeof(bytes), job->bytes_done);
+        snprintf(line2, sizeof(line2), "%s %s", bytes, job->spec.bytes_label);
+    }
+
+    float progress = job->items_total ? (float)job->items_done / (float)job->items_total : -1.0f;
+    progress_view_set_status(job->progress_view, line1, line2, progress);
+}
+
+static void bg_job_view_callback(ProgressViewEvent event, void* context) {
+    UNUSED(event);
+    BgJob* job = context;
+
+    // Either key cancels a running job and dismisses a finished one
+    switch(job->state) {
+    case BgJobStateRunning:
+        if(!job->cancel_requested) {
+            bg_job_cancel(job);
+            progress_view_set_button(job->progress_view, NULL);
+            progress_view_set_header(job->progress_view, "Cancelling...");
+        }
+        break;
+    case BgJobStateDone:
+        job->state = BgJobStateIdle;
+        if(job->dismiss_callback) {
+            job->dismiss_callback(job, job->dismiss_context);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static int32_t bg_job_thread(void* context) {
+    BgJob* job = context;
+
+    job->success = job->spec.worker(job, job->spec.context);
+    job->state = BgJobStateFinished;
+
+    view_dispatcher_send_custom_event(job->view_dispatcher, APP_EVENT_BG_JOB_DONE);
+    return 0;
+}
+
+BgJob* bg_job_alloc(ViewDispatcher* view_dispatcher) {
+    BgJob* job = malloc(sizeof(BgJob));
+    if(!job) return NULL;
+    memset(job, 0, sizeof(BgJob));
+
+    job->progress_view = progress_view_alloc();
+    if(!job->progress_view) {
+        free(job);
+        return NULL;
+    }
+
+    job->view_dispatcher = view_dispatcher;
+    job->state = BgJobStateIdle;
+    progress_view_set_callback(job->progress_view, bg_job_view_callback, job);
+    return job;
+}
+
+void bg_job_free(BgJob* job) {
+    if(!job) return;
+
+    if(job->thread) {
+        job->cancel_requested = true;
+        furi_thread_join(job->thread);
+        furi_thread_free(job->thread);
+    }
+
+    progress_view_free(job->progress_view);
+    free(job);
+}
+
+View* bg_job_get_view(BgJob* job) {
+    return job ? progress_view_get_view(job->progress_view) : NULL;
+}
+
+void bg_job_set_dismiss_callback(BgJob* job, BgJobCallback callback, void* context) {
+    if(!job) return;
+    job->dismiss_callback = callback;
+    job->dismiss_context = context;
+}
+
+bool bg_job_start(BgJob* job, const BgJobSpec* spec) {
+    if(!job || !spec || !spec->worker) return false;
+    if(job->state == BgJobStateRunning || job->state == BgJobStateFinished) {
+        FURI_LOG_W("BgJob", "Job already running, ignoring %s", spec->title);
+        return false;
+    }
+
+    // A previous job's thread has returned already, reap it
+    if(job->thread) {
+        furi_thread_join(job->thread);
+        furi_thread_free(job->thread);
+        job->thread = NULL;
+    }
+
+    job->spec = *spec;
+    job->cancel_requested = false;
+    job->success = false;
+    job->items_done = 0;
+    job->items_total = 0;
+    job->bytes_done = 0;
+    job->last_update = 0;
+    job->start_tick = furi_get_tick();
+    job->state = BgJobStateRunning;
+
+    progress_view_set_header(job->progress_view, spec->title);
+    progress_view_set_button(job->progress_view, "Cancel");
+    bg_job_refresh_view(job);
+
+    job->thread = furi_thread_alloc_ex("BgJob", BG_JOB_STACK_SIZE, bg_job_thread, job);
+    furi_thread_start(job->thread);
+
+    FURI_LOG_I("BgJob", "Started %s", spec->title);
+    return true;
+}
+
+bool bg_job_is_active(BgJob* job) {
+    return job && (job->state == BgJobStateRunning || job->state == BgJobStateFinished);
+}
+
+void bg_job_cancel(BgJob* job) {
+    if(!job) return;
+    job->cancel_requested = true;
+}
+
+bool bg_job_is_cancelled(BgJob* job) {
+    return job->cancel_requested;
+}
+
+void bg_job_report(BgJob* job, uint32_t items_done, uint32_t items_total, uint64_t bytes_done) {
+    job->items_done = items_done;
+    job->items_total = items_total;
+    job->bytes_done = bytes_done;
+
+    uint32_t now = furi_get_tick();
+    if(job->last_update && now - job->last_update < furi_ms_to_ticks(BG_JOB_UPDATE_INTERVAL)) {
+        return;
+    }
+    job->last_update = now;
+    bg_job_refresh_view(job);
+}
+
+void bg_job_set_status(BgJob* job, const char* line1, const char* line2, float progress) {
+    progress_view_set_status(job->progress_view, line1, line2, progress);
+}
+
+void bg_job_get_progress(BgJob* job, BgJobProgress* progress) {
+    progress->items_done = job->items_done;
+    progress->items_total = job->items_total;
+    progress->bytes_done = job->bytes_done;
+    progress->cancelled = job->cancel_requested;
+    progress->success = job->success;
+}
+
+void bg_job_handle_done(BgJob* job) {
+    if(!job || job->state != BgJobStateFinished) return;
+
+    furi_thread_join(job->thread);
+    furi_thread_free(job->thread);
+    job->thread = NULL;
+
+    FURI_LOG_I(
+        "BgJob",
+        "%s finished: %lu items, %lu bytes, %lu ms%s",
+        job->spec.title,
+        job->items_done,
+        (uint32_t)job->bytes_done,
+        furi_get_tick() - job->start_tick,
+        job->cancel_requested ? " (cancelled)" : "");
+
+    if(job->spec.on_done) {
+        job->spec.on_done(job, job->spec.context);
+    }
+
+    // Final counters, never throttled
+    if(job->spec.item_label) bg_job_refresh_view(job);
+    progress_view_set_header(
+        job->progress_view,
+        job->cancel_requested ? "Cancelled" :
+        job->success          ? "Done" :
+                                "Failed");
+    progress_view_set_button(job->progress_view, "OK");
+    job->state = BgJobStateDone;
+}
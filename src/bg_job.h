@@ -0,0 +1,89 @@
+#pragma once
+
+#include "settings_def.h"
+#include <furi.h>
+#include <gui/view_dispatcher.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Background jobs
+ *
+ * Runs one long SD card operation at a time on its own thread while a progress
+ * view shows items/bytes done. OK or Back cancels a running job, the worker polls
+ * bg_job_is_cancelled between steps. When the worker returns the job posts
+ * APP_EVENT_BG_JOB_DONE to the view dispatcher and the GUI thread finishes it
+ * with bg_job_handle_done.
+ */
+
+typedef struct BgJob BgJob;
+
+typedef bool (*BgJobWorker)(BgJob* job, void* context);
+typedef void (*BgJobCallback)(BgJob* job, void* context);
+
+typedef struct {
+    const char* title;
+    const char* item_label; // e.g. "files deleted"
+    const char* bytes_label; // e.g. "freed", NULL hides the byte counter
+    BgJobWorker worker; // Job thread
+    BgJobCallback on_done; // GUI thread, after the worker returned
+    void* context;
+} BgJobSpec;
+
+typedef struct {
+    uint32_t items_done;
+    uint32_t items_total; // 0 when unknown
+    uint64_t bytes_done;
+    bool cancelled;
+    bool success;
+} BgJobProgress;
+
+BgJob* bg_job_alloc(ViewDispatcher* view_dispatcher);
+
+/**
+ * @brief Cancel and join a running job, then free everything
+ */
+void bg_job_free(BgJob* job);
+
+View* bg_job_get_view(BgJob* job);
+
+/**
+ * @brief Called on the GUI thread when the user leaves a finished job's view
+ */
+void bg_job_set_dismiss_callback(BgJob* job, BgJobCallback callback, void* context);
+
+/**
+ * @brief Start a job, the spec is copied
+ * @return false if another job is still active
+ */
+bool bg_job_start(BgJob* job, const BgJobSpec* spec);
+
+bool bg_job_is_active(BgJob* job);
+void bg_job_cancel(BgJob* job);
+
+/**
+ * @brief Worker side: true once the user asked to stop
+ */
+bool bg_job_is_cancelled(BgJob* job);
+
+/**
+ * @brief Worker side: publish counters, the view is refreshed at most every 100 ms
+ */
+void bg_job_report(BgJob* job, uint32_t items_done, uint32_t items_total, uint64_t bytes_done);
+
+/**
+ * @brief Worker side: replace the status lines with custom text
+ */
+void bg_job_set_status(BgJob* job, const char* line1, const char* line2, float progress);
+
+void bg_job_get_progress(BgJob* job, BgJobProgress* progress);
+
+/**
+ * @brief GUI side: handle APP_EVENT_BG_JOB_DONE
+ */
+void bg_job_handle_done(BgJob* job);
+
+/**
+ * @brief Human readable byte count ("512 B", "12.3 KB", "4.0 MB")
+ */
+void bg_job_format_bytes(char* out, size_t out_size, uint64_t bytes);
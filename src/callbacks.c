@@ -8,46 +8,6 @@
 
 
 
-void on_rgb_mode_changed(VariableItem* item) {
-    AppState* app = variable_item_get_context(item);
-    uint8_t index = variable_item_get_current_value_index(item);
-    app->settings.rgb_mode_index = index;
-    variable_item_set_current_value_text(item, SETTING_VALUE_NAMES_RGB_MODE[index]);
-    char command[32];
-    snprintf(command, sizeof(command), "setsetting -i 1 -v %d\n", index + 1);
-    send_uart_command(command, app);
-}
-
-void on_channelswitchdelay_changed(VariableItem* item) {
-    AppState* app = variable_item_get_context(item);
-    uint8_t index = variable_item_get_current_value_index(item);
-    app->settings.channel_hop_delay_index = index;
-    variable_item_set_current_value_text(item, SETTING_VALUE_NAMES_CHANNEL_HOP[index]);
-    char command[32];
-    snprintf(command, sizeof(command), "setsetting -i 2 -v %d\n", index + 1);
-    send_uart_command(command, app);
-}
-
-void on_togglechannelhopping_changed(VariableItem* item) {
-    AppState* app = variable_item_get_context(item);
-    uint8_t index = variable_item_get_current_value_index(item);
-    app->settings.enable_channel_hopping_index = index;
-    variable_item_set_current_value_text(item, SETTING_VALUE_NAMES_BOOL[index]);
-    char command[32];
-    snprintf(command, sizeof(command), "setsetting -i 3 -v %d\n", index + 1);
-    send_uart_command(command, app);
-}
-
-void on_ble_mac_changed(VariableItem* item) {
-    AppState* app = variable_item_get_context(item);
-    uint8_t index = variable_item_get_current_value_index(item);
-    app->settings.enable_random_ble_mac_index = index;
-    variable_item_set_current_value_text(item, SETTING_VALUE_NAMES_BOOL[index]);
-    char command[32];
-    snprintf(command, sizeof(command), "setsetting -i 4 -v %d\n", index + 1);
-    send_uart_command(command, app);
-}
-
 void on_stop_on_back_changed(VariableItem* item) {
     AppState* app = variable_item_get_context(item);
     uint8_t index = variable_item_get_current_value_index(item);
@@ -81,7 +41,6 @@ void logs_clear_confirmed_callback(void* context) {
     uint32_t prev_view = app_state->previous_view;
     
     FURI_LOG_D("ClearLogs", "Previous view: %lu", prev_view);
-    clear_log_files(ctx->state);
     
     // Reset callbacks
     FURI_LOG_D("ClearLogs", "Resetting callbacks");
@@ -95,6 +54,9 @@ void logs_clear_confirmed_callback(void* context) {
     FURI_LOG_D("ClearLogs", "Switching to view: %lu", prev_view);
     view_dispatcher_switch_to_view(app_state->view_dispatcher, prev_view);
     app_state->current_view = prev_view;  // Add this line
+
+    // Deletion runs in the background and switches to the progress view
+    clear_log_files(app_state);
 }
 
 void logs_clear_cancelled_callback(void* context) {
@@ -290,7 +252,6 @@ void wardrive_clear_confirmed_callback(void* context) {
     uint32_t prev_view = app_state->previous_view;
     
     FURI_LOG_D("ClearWardrive", "Previous view: %lu", prev_view);
-    clear_wardrive_files(ctx->state);
     
     // Reset callbacks
     confirmation_view_set_ok_callback(app_state->confirmation_view, NULL, NULL);
@@ -300,6 +261,8 @@ void wardrive_clear_confirmed_callback(void* context) {
     
     view_dispatcher_switch_to_view(app_state->view_dispatcher, prev_view);
     app_state->current_view = prev_view;
+
+    clear_wardrive_files(app_state);
 }
 
 void wardrive_clear_cancelled_callback(void* context) {
@@ -342,7 +305,6 @@ void pcap_clear_confirmed_callback(void* context) {
     uint32_t prev_view = app_state->previous_view;
     
     FURI_LOG_D("ClearPCAP", "Previous view: %lu", prev_view);
-    clear_pcap_files(ctx->state);
     
     confirmation_view_set_ok_callback(app_state->confirmation_view, NULL, NULL);
     confirmation_view_set_cancel_callback(app_state->confirmation_view, NULL, NULL);
@@ -351,6 +313,8 @@ void pcap_clear_confirmed_callback(void* context) {
     
     view_dispatcher_switch_to_view(app_state->view_dispatcher, prev_view);
     app_state->current_view = prev_view;
+
+    clear_pcap_files(app_state);
 }
 
 void pcap_clear_cancelled_callback(void* context) {
@@ -374,6 +338,90 @@ void pcap_clear_cancelled_callback(void* context) {
     app_state->current_view = prev_view;
 }
 
+void wardrive_merge_confirmed_callback(void* context) {
+    SettingsConfirmContext* ctx = context;
+    if(!ctx || !ctx->state) {
+        FURI_LOG_E("WardriveMerge", "Invalid context");
+        free(ctx);
+        return;
+    }
+
+    AppState* app_state = ctx->state;
+    uint32_t prev_view = app_state->previous_view;
+
+    confirmation_view_set_ok_callback(app_state->confirmation_view, NULL, NULL);
+    confirmation_view_set_cancel_callback(app_state->confirmation_view, NULL, NULL);
+
+    free(ctx);
+
+    view_dispatcher_switch_to_view(app_state->view_dispatcher, prev_view);
+    app_state->current_view = prev_view;
+
+    run_wardrive_merge(app_state);
+}
+
+void wardrive_merge_cancelled_callback(void* context) {
+    SettingsConfirmContext* ctx = context;
+    if(!ctx || !ctx->state) {
+        FURI_LOG_E("WardriveMerge", "Invalid context");
+        free(ctx);
+        return;
+    }
+
+    AppState* app_state = ctx->state;
+    uint32_t prev_view = app_state->previous_view;
+
+    confirmation_view_set_ok_callback(app_state->confirmation_view, NULL, NULL);
+    confirmation_view_set_cancel_callback(app_state->confirmation_view, NULL, NULL);
+
+    free(ctx);
+
+    view_dispatcher_switch_to_view(app_state->view_dispatcher, prev_view);
+    app_state->current_view = prev_view;
+}
+
+void storage_bench_confirmed_callback(void* context) {
+    SettingsConfirmContext* ctx = context;
+    if(!ctx || !ctx->state) {
+        FURI_LOG_E("StorageBench", "Invalid context");
+        free(ctx);
+        return;
+    }
+
+    AppState* app_state = ctx->state;
+    uint32_t prev_view = app_state->previous_view;
+
+    confirmation_view_set_ok_callback(app_state->confirmation_view, NULL, NULL);
+    confirmation_view_set_cancel_callback(app_state->confirmation_view, NULL, NULL);
+
+    free(ctx);
+
+    view_dispatcher_switch_to_view(app_state->view_dispatcher, prev_view);
+    app_state->current_view = prev_view;
+
+    run_storage_bench(app_state);
+}
+
+void storage_bench_cancelled_callback(void* context) {
+    SettingsConfirmContext* ctx = context;
+    if(!ctx || !ctx->state) {
+        FURI_LOG_E("StorageBench", "Invalid context");
+        free(ctx);
+        return;
+    }
+
+    AppState* app_state = ctx->state;
+    uint32_t prev_view = app_state->previous_view;
+
+    confirmation_view_set_ok_callback(app_state->confirmation_view, NULL, NULL);
+    confirmation_view_set_cancel_callback(app_state->confirmation_view, NULL, NULL);
+
+    free(ctx);
+
+    view_dispatcher_switch_to_view(app_state->view_dispatcher, prev_view);
+    app_state->current_view = prev_view;
+}
+
 // Add these variable item callbacks
 void on_clear_wardrive_changed(VariableItem* item) {
     AppState* app = variable_item_get_context(item);
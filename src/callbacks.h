@@ -11,10 +11,6 @@
 
 // Function declarations
 void update_settings_and_write(AppState* app, Settings* settings);
-void on_rgb_mode_changed(VariableItem* item);
-void on_channelswitchdelay_changed(VariableItem* item);
-void on_togglechannelhopping_changed(VariableItem* item);
-void on_ble_mac_changed(VariableItem* item);
 void on_stop_on_back_changed(VariableItem* item);
 void on_reboot_esp_changed(VariableItem* item);
 void on_clear_logs_changed(VariableItem* item);
@@ -30,4 +26,8 @@ void wardrive_clear_confirmed_callback(void* context);
 void wardrive_clear_cancelled_callback(void* context);
 void pcap_clear_confirmed_callback(void* context);
 void pcap_clear_cancelled_callback(void* context);
+void wardrive_merge_confirmed_callback(void* context);
+void wardrive_merge_cancelled_callback(void* context);
+void storage_bench_confirmed_callback(void* context);
+void storage_bench_cancelled_callback(void* context);
 void on_disable_esp_check_changed(VariableItem* item);
\ No newline at end of file
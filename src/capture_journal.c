@@ -0,0 +1,193 @@
+#include "capture_journal.h"
+#include "settings_def.h"
+#include "gpx_writer.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPTURE_JOURNAL_FILE    GHOST_ESP_APP_FOLDER "/.capture_journal"
+#define CAPTURE_JOURNAL_MAGIC   0x314A4347 // "GCJ1"
+#define CAPTURE_JOURNAL_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t format;
+    uint8_t active;
+    uint8_t trailer; // CaptureJournalTrailer, 0 in entries from older versions
+    uint32_t synced_offset;
+    uint32_t record_end;
+    uint32_t updates;
+    char path[CAPTURE_JOURNAL_PATH_LEN];
+    uint32_t checksum; // Catches an entry torn by the crash itself
+} CaptureJournalEntry;
+
+struct CaptureJournal {
+    Storage* storage;
+    File* file; // Open while a capture is journaled
+    CaptureJournalEntry entry;
+};
+
+static uint32_t capture_journal_checksum(const CaptureJournalEntry* entry) {
+    const uint8_t* p = (const uint8_t*)entry;
+    uint32_t sum = 0x811C9DC5;
+    for(size_t i = 0; i < offsetof(CaptureJournalEntry, checksum); i++) {
+        sum = (sum ^ p[i]) * 0x01000193;
+    }
+    return sum;
+}
+
+static bool capture_journal_store(CaptureJournal* journal) {
+    if(!journal->file) return false;
+
+    journal->entry.checksum = capture_journal_checksum(&journal->entry);
+    if(!storage_file_seek(journal->file, 0, true)) return false;
+    if(storage_file_write(journal->file, &journal->entry, sizeof(CaptureJournalEntry)) !=
+       sizeof(CaptureJournalEntry)) {
+        FURI_LOG_W("Journal", "Failed to write journal entry");
+        return false;
+    }
+    return storage_file_sync(journal->file);
+}
+
+CaptureJournal* capture_journal_alloc(Storage* storage) {
+    CaptureJournal* journal = malloc(sizeof(CaptureJournal));
+    if(!journal) return NULL;
+    memset(journal, 0, sizeof(CaptureJournal));
+    journal->storage = storage;
+    return journal;
+}
+
+void capture_journal_free(CaptureJournal* journal) {
+    if(!journal) return;
+    if(journal->file) {
+        storage_file_close(journal->file);
+        storage_file_free(journal->file);
+    }
+    free(journal);
+}
+
+static bool capture_journal_append_trailer(File* file, const char* trailer, const char* path) {
+    size_t len = strlen(trailer);
+    if(!storage_file_seek(file, storage_file_size(file), true) ||
+       storage_file_write(file, trailer, len) != len) {
+        FURI_LOG_E("Journal", "Failed to close %s", path);
+        return false;
+    }
+    FURI_LOG_I("Journal", "Closed %s", path);
+    return true;
+}
+
+bool capture_journal_recover(CaptureJournal* journal) {
+    if(!journal) return false;
+
+    CaptureJournalEntry entry;
+    File* file = storage_file_alloc(journal->storage);
+    bool loaded = false;
+    if(storage_file_open(file, CAPTURE_JOURNAL_FILE, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        loaded = storage_file_read(file, &entry, sizeof(entry)) == sizeof(entry);
+    }
+    storage_file_close(file);
+
+    if(!loaded || entry.magic != CAPTURE_JOURNAL_MAGIC || entry.version != CAPTURE_JOURNAL_VERSION ||
+       entry.checksum != capture_journal_checksum(&entry) || !entry.active) {
+        storage_file_free(file);
+        return false;
+    }
+    entry.path[CAPTURE_JOURNAL_PATH_LEN - 1] = '\0';
+
+    FURI_LOG_W(
+        "Journal",
+        "Interrupted capture %s (synced %lu, last record %lu)",
+        entry.path,
+        entry.synced_offset,
+        entry.record_end);
+
+    bool repaired = false;
+    if(storage_file_open(file, entry.path, FSAM_READ_WRITE, FSOM_OPEN_EXISTING)) {
+        uint64_t size = storage_file_size(file);
+        if(size == 0) {
+            // Not even the file header made it, nothing worth keeping
+            storage_file_close(file);
+            storage_simply_remove(journal->storage, entry.path);
+            FURI_LOG_I("Journal", "Removed empty capture %s", entry.path);
+            repaired = true;
+        } else if(entry.record_end == 0) {
+            // Died before the first journal update, there is no known good end to cut back to
+            storage_file_close(file);
+            FURI_LOG_W("Journal", "Kept %s as is, no record end was journaled", entry.path);
+        } else {
+            // A file shorter than the record end lost synced data, it no longer ends on a record
+            bool whole = size >= entry.record_end;
+            if(size > entry.record_end) {
+                whole = storage_file_seek(file, entry.record_end, true) && storage_file_truncate(file);
+                if(whole) {
+                    FURI_LOG_I(
+                        "Journal", "Truncated %s from %lu to %lu bytes", entry.path, (uint32_t)size, entry.record_end);
+                    repaired = true;
+                } else {
+                    FURI_LOG_E("Journal", "Failed to truncate %s", entry.path);
+                }
+            }
+            if(whole && entry.trailer == CaptureJournalTrailerGpx) {
+                repaired |= capture_journal_append_trailer(file, GPX_WRITER_TRAILER, entry.path);
+            }
+            storage_file_close(file);
+        }
+    } else {
+        FURI_LOG_W("Journal", "Interrupted capture no longer exists");
+    }
+
+    storage_file_free(file);
+    storage_simply_remove(journal->storage, CAPTURE_JOURNAL_FILE);
+    return repaired;
+}
+
+bool capture_journal_begin(CaptureJournal* journal, const char* path, uint8_t format) {
+    if(!journal || !path) return false;
+
+    if(!journal->file) {
+        journal->file = storage_file_alloc(journal->storage);
+        if(!storage_file_open(journal->file, CAPTURE_JOURNAL_FILE, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+            FURI_LOG_W("Journal", "Failed to open journal, capture is not crash safe");
+            storage_file_free(journal->file);
+            journal->file = NULL;
+            return false;
+        }
+    }
+
+    memset(&journal->entry, 0, sizeof(CaptureJournalEntry));
+    journal->entry.magic = CAPTURE_JOURNAL_MAGIC;
+    journal->entry.version = CAPTURE_JOURNAL_VERSION;
+    journal->entry.format = format;
+    journal->entry.active = 1;
+    strncpy(journal->entry.path, path, CAPTURE_JOURNAL_PATH_LEN - 1);
+
+    return capture_journal_store(journal);
+}
+
+void capture_journal_set_trailer(CaptureJournal* journal, CaptureJournalTrailer trailer) {
+    if(!journal || !journal->file || !journal->entry.active) return;
+
+    journal->entry.trailer = trailer;
+    capture_journal_store(journal);
+}
+
+void capture_journal_update(CaptureJournal* journal, uint64_t synced_offset, uint64_t record_end) {
+    if(!journal || !journal->file || !journal->entry.active) return;
+
+    journal->entry.synced_offset = (uint32_t)synced_offset;
+    journal->entry.record_end = (uint32_t)record_end;
+    journal->entry.updates++;
+    capture_journal_store(journal);
+}
+
+void capture_journal_end(CaptureJournal* journal) {
+    if(!journal || !journal->file) return;
+
+    journal->entry.active = 0;
+    capture_journal_store(journal);
+    storage_file_close(journal->file);
+    storage_file_free(journal->file);
+    journal->file = NULL;
+}
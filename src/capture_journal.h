@@ -0,0 +1,55 @@
+#pragma once
+
+#include <storage/storage.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Capture journal
+ *
+ * A single fixed-size entry in GHOST_ESP_APP_FOLDER/.capture_journal that
+ * names the capture being written, the last offset known to be synced and the
+ * end of the last complete record at that point. It is rewritten in place
+ * after every capture sync and marked inactive on a clean close. If the app
+ * dies mid-capture the next start finds an active entry and truncates that one
+ * file back to its last complete record. Text formats that need closing
+ * markup (GPX) then get their trailer appended.
+ */
+
+#define CAPTURE_JOURNAL_PATH_LEN 128
+
+typedef enum {
+    CaptureJournalTrailerNone,
+    CaptureJournalTrailerGpx,
+} CaptureJournalTrailer;
+
+typedef struct CaptureJournal CaptureJournal;
+
+CaptureJournal* capture_journal_alloc(Storage* storage);
+void capture_journal_free(CaptureJournal* journal);
+
+/**
+ * @brief Repair the capture left open by a previous session, if any
+ * @return true if a file was repaired
+ */
+bool capture_journal_recover(CaptureJournal* journal);
+
+/**
+ * @brief Start journaling a freshly opened capture
+ */
+bool capture_journal_begin(CaptureJournal* journal, const char* path, uint8_t format);
+
+/**
+ * @brief Closing markup recovery appends after the last complete record
+ */
+void capture_journal_set_trailer(CaptureJournal* journal, CaptureJournalTrailer trailer);
+
+/**
+ * @brief Record progress, call right after the capture file was synced
+ */
+void capture_journal_update(CaptureJournal* journal, uint64_t synced_offset, uint64_t record_end);
+
+/**
+ * @brief Mark the capture as cleanly closed
+ */
+void capture_journal_end(CaptureJournal* journal);
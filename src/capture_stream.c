@@ -0,0 +1,504 @@
+#include "capture_stream.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PCAP_GLOBAL_HEADER_LEN  24
+#define PCAP_RECORD_HEADER_LEN  16
+#define PCAP_MAX_PACKET         262144 // Anything larger means the framing was lost
+
+#define PCAPNG_BLOCK_SHB        0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB        0x00000001
+#define PCAPNG_BLOCK_EPB        0x00000006
+#define PCAPNG_BYTE_ORDER       0x1A2B3C4D
+#define PCAPNG_OPT_ENDOFOPT     0
+#define PCAPNG_OPT_COMMENT      1
+#define PCAPNG_OPT_SHB_USERAPPL 4
+#define PCAPNG_OPT_IF_TSRESOL   9
+#define PCAPNG_EPB_HEADER_LEN   28
+
+#define CAPTURE_STREAM_USERAPPL "Ghost ESP (Flipper Zero)"
+
+typedef enum {
+    CaptureStateGlobalHeader,
+    CaptureStateRecordHeader,
+    CaptureStateRecordData,
+    CaptureStatePassthrough, // Not PCAP, bytes go out unchanged
+    CaptureStateDrop, // PCAPNG framing lost, nothing more can be written safely
+} CaptureState;
+
+struct CaptureStream {
+    File* file;
+    CaptureFormat format;
+    CaptureState state;
+    bool active;
+    bool text; // No PCAP magic, records are lines (wardrive CSV, GPX)
+
+    // From the PCAP global header
+    bool swapped;
+    bool nanosecond;
+    uint32_t linktype;
+    uint32_t snaplen;
+
+    // Current record
+    uint8_t record_header[PCAP_RECORD_HEADER_LEN];
+    uint32_t ts_sec;
+    uint32_t ts_frac;
+    uint32_t orig_len;
+    uint32_t data_len;
+    uint32_t data_remaining;
+    bool holding; // Record data goes to hold until the dedup verdict
+
+    FrameDedup* dedup; // Optional, owned by the caller
+    uint8_t hold[CAPTURE_STREAM_HOLD];
+    uint32_t dropped;
+
+    uint8_t scratch[CAPTURE_STREAM_SCRATCH];
+    size_t scratch_len;
+
+    uint64_t offset;
+    uint64_t record_end;
+    uint32_t packets;
+
+    char comment[CAPTURE_STREAM_COMMENT_LEN];
+    char annotation[CAPTURE_STREAM_COMMENT_LEN];
+    char record_annotation[CAPTURE_STREAM_COMMENT_LEN]; // Frozen when the EPB header is written
+};
+
+static const uint8_t capture_stream_zeros[4] = {0};
+
+static inline void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static inline void put_u32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static inline uint32_t pad4(uint32_t len) {
+    return (4 - (len & 3)) & 3;
+}
+
+static inline uint32_t option_size(size_t len) {
+    return 4 + len + pad4(len);
+}
+
+static uint32_t capture_stream_read_u32(const CaptureStream* stream, const uint8_t* p) {
+    if(stream->swapped) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+static bool capture_stream_emit(CaptureStream* stream, const void* data, size_t len) {
+    if(len == 0) return true;
+    size_t written = storage_file_write(stream->file, data, len);
+    stream->offset += written;
+    return written == len;
+}
+
+static bool capture_stream_emit_option(
+    CaptureStream* stream,
+    uint16_t code,
+    const void* value,
+    uint16_t len) {
+    uint8_t header[4];
+    put_u16(header, code);
+    put_u16(header + 2, len);
+    return capture_stream_emit(stream, header, sizeof(header)) &&
+           capture_stream_emit(stream, value, len) &&
+           capture_stream_emit(stream, capture_stream_zeros, pad4(len));
+}
+
+static bool capture_stream_emit_u32(CaptureStream* stream, uint32_t value) {
+    uint8_t buf[4];
+    put_u32(buf, value);
+    return capture_stream_emit(stream, buf, sizeof(buf));
+}
+
+static bool capture_stream_write_section(CaptureStream* stream) {
+    size_t comment_len = strlen(stream->comment);
+    size_t userappl_len = strlen(CAPTURE_STREAM_USERAPPL);
+
+    // Section Header Block
+    uint32_t total = 28 + option_size(userappl_len) + 4;
+    if(comment_len) total += option_size(comment_len);
+
+    uint8_t* p = stream->scratch;
+    put_u32(p, PCAPNG_BLOCK_SHB);
+    put_u32(p + 4, total);
+    put_u32(p + 8, PCAPNG_BYTE_ORDER);
+    put_u16(p + 12, 1); // Major version
+    put_u16(p + 14, 0); // Minor version
+    memset(p + 16, 0xFF, 8); // Section length unknown
+    bool ok = capture_stream_emit(stream, p, 24);
+    if(comment_len) {
+        ok = ok && capture_stream_emit_option(stream, PCAPNG_OPT_COMMENT, stream->comment, comment_len);
+    }
+    ok = ok && capture_stream_emit_option(
+                   stream, PCAPNG_OPT_SHB_USERAPPL, CAPTURE_STREAM_USERAPPL, userappl_len);
+    ok = ok && capture_stream_emit_u32(stream, PCAPNG_OPT_ENDOFOPT);
+    ok = ok && capture_stream_emit_u32(stream, total);
+
+    // Interface Description Block, microsecond resolution is the default
+    total = 20;
+    if(stream->nanosecond) total += option_size(1) + 4;
+
+    put_u32(p, PCAPNG_BLOCK_IDB);
+    put_u32(p + 4, total);
+    put_u16(p + 8, stream->linktype & 0xFFFF);
+    put_u16(p + 10, 0);
+    put_u32(p + 12, stream->snaplen);
+    ok = ok && capture_stream_emit(stream, p, 16);
+    if(stream->nanosecond) {
+        uint8_t tsresol = 9;
+        ok = ok && capture_stream_emit_option(stream, PCAPNG_OPT_IF_TSRESOL, &tsresol, 1);
+        ok = ok && capture_stream_emit_u32(stream, PCAPNG_OPT_ENDOFOPT);
+    }
+    ok = ok && capture_stream_emit_u32(stream, total);
+
+    return ok;
+}
+
+static uint32_t capture_stream_epb_total(const CaptureStream* stream) {
+    uint32_t total = PCAPNG_EPB_HEADER_LEN + stream->data_len + pad4(stream->data_len) + 4;
+    size_t annotation_len = strlen(stream->record_annotation);
+    if(annotation_len) total += option_size(annotation_len) + 4;
+    return total;
+}
+
+static bool capture_stream_write_epb_header(CaptureStream* stream, uint32_t ts_sec, uint32_t ts_frac, uint32_t orig_len) {
+    uint64_t ts = (uint64_t)ts_sec * (stream->nanosecond ? 1000000000ULL : 1000000ULL) + ts_frac;
+    memcpy(stream->record_annotation, stream->annotation, CAPTURE_STREAM_COMMENT_LEN);
+
+    uint8_t* p = stream->scratch;
+    put_u32(p, PCAPNG_BLOCK_EPB);
+    put_u32(p + 4, capture_stream_epb_total(stream));
+    put_u32(p + 8, 0); // Interface 0
+    put_u32(p + 12, (uint32_t)(ts >> 32));
+    put_u32(p + 16, (uint32_t)ts);
+    put_u32(p + 20, stream->data_len);
+    put_u32(p + 24, orig_len);
+    return capture_stream_emit(stream, p, PCAPNG_EPB_HEADER_LEN);
+}
+
+static bool capture_stream_write_epb_trailer(CaptureStream* stream) {
+    bool ok = capture_stream_emit(stream, capture_stream_zeros, pad4(stream->data_len));
+
+    size_t annotation_len = strlen(stream->record_annotation);
+    if(annotation_len) {
+        ok = ok && capture_stream_emit_option(
+                       stream, PCAPNG_OPT_COMMENT, stream->record_annotation, annotation_len);
+        ok = ok && capture_stream_emit_u32(stream, PCAPNG_OPT_ENDOFOPT);
+    }
+
+    return ok && capture_stream_emit_u32(stream, capture_stream_epb_total(stream));
+}
+
+static bool capture_stream_parse_global_header(CaptureStream* stream) {
+    const uint8_t* h = stream->scratch;
+
+    if(h[0] == 0xD4 && h[1] == 0xC3 && h[2] == 0xB2 && h[3] == 0xA1) {
+        stream->swapped = false;
+        stream->nanosecond = false;
+    } else if(h[0] == 0xA1 && h[1] == 0xB2 && h[2] == 0xC3 && h[3] == 0xD4) {
+        stream->swapped = true;
+        stream->nanosecond = false;
+    } else if(h[0] == 0x4D && h[1] == 0x3C && h[2] == 0xB2 && h[3] == 0xA1) {
+        stream->swapped = false;
+        stream->nanosecond = true;
+    } else if(h[0] == 0xA1 && h[1] == 0xB2 && h[2] == 0x3C && h[3] == 0x4D) {
+        stream->swapped = true;
+        stream->nanosecond = true;
+    } else {
+        return false;
+    }
+
+    stream->snaplen = capture_stream_read_u32(stream, h + 16);
+    stream->linktype = capture_stream_read_u32(stream, h + 20);
+    return true;
+}
+
+CaptureStream* capture_stream_alloc(void) {
+    CaptureStream* stream = malloc(sizeof(CaptureStream));
+    if(!stream) return NULL;
+    memset(stream, 0, sizeof(CaptureStream));
+    return stream;
+}
+
+void capture_stream_free(CaptureStream* stream) {
+    if(!stream) return;
+    free(stream);
+}
+
+void capture_stream_begin(CaptureStream* stream, File* file, CaptureFormat format) {
+    if(!stream) return;
+
+    stream->file = file;
+    stream->format = format;
+    stream->state = CaptureStateGlobalHeader;
+    stream->active = true;
+    stream->text = false;
+    stream->holding = false;
+    stream->dedup = NULL;
+    stream->dropped = 0;
+    stream->scratch_len = 0;
+    stream->data_len = 0;
+    stream->data_remaining = 0;
+    stream->offset = 0;
+    stream->record_end = 0;
+    stream->packets = 0;
+    stream->comment[0] = '\0';
+    stream->annotation[0] = '\0';
+}
+
+void capture_stream_set_comment(CaptureStream* stream, const char* comment) {
+    if(!stream) return;
+    strncpy(stream->comment, comment ? comment : "", CAPTURE_STREAM_COMMENT_LEN - 1);
+    stream->comment[CAPTURE_STREAM_COMMENT_LEN - 1] = '\0';
+
+    // Commands arrive with their newline, keep the comment on one line
+    size_t len = strlen(stream->comment);
+    while(len && (stream->comment[len - 1] == '\n' || stream->comment[len - 1] == '\r')) {
+        stream->comment[--len] = '\0';
+    }
+}
+
+void capture_stream_set_annotation(CaptureStream* stream, const char* annotation) {
+    if(!stream) return;
+    // Applies from the next record, the current EPB length is already on disk
+    strncpy(stream->annotation, annotation ? annotation : "", CAPTURE_STREAM_COMMENT_LEN - 1);
+    stream->annotation[CAPTURE_STREAM_COMMENT_LEN - 1] = '\0';
+}
+
+// Text captures end a record on every newline, end is the file offset after data
+static void capture_stream_mark_lines(
+    CaptureStream* stream,
+    uint64_t end,
+    const uint8_t* data,
+    size_t len) {
+    for(size_t i = len; i > 0; i--) {
+        if(data[i - 1] == '\n') {
+            stream->record_end = end - (len - i);
+            return;
+        }
+    }
+}
+
+static bool capture_stream_write_record_header(CaptureStream* stream) {
+    if(stream->format == CaptureFormatPcapng) {
+        return capture_stream_write_epb_header(
+            stream, stream->ts_sec, stream->ts_frac, stream->orig_len);
+    }
+    return capture_stream_emit(stream, stream->record_header, PCAP_RECORD_HEADER_LEN);
+}
+
+static bool capture_stream_write_record_trailer(CaptureStream* stream) {
+    if(stream->format == CaptureFormatPcapng) return capture_stream_write_epb_trailer(stream);
+    return true;
+}
+
+bool capture_stream_write(CaptureStream* stream, const uint8_t* data, size_t len) {
+    if(!stream || !stream->active || !stream->file) return false;
+
+    bool transcode = stream->format == CaptureFormatPcapng;
+    // Framed output is written record by record from the parser
+    bool framed = transcode || stream->dedup;
+
+    // Plain PCAP goes out untouched, the parser below only tracks record boundaries
+    uint64_t base = stream->offset;
+    if(!framed || stream->state == CaptureStatePassthrough) {
+        if(!capture_stream_emit(stream, data, len)) return false;
+        if(stream->state == CaptureStatePassthrough) {
+            // Unframed PCAP data keeps the last good record as its end
+            if(stream->text) capture_stream_mark_lines(stream, stream->offset, data, len);
+            return true;
+        }
+    }
+
+    size_t pos = 0;
+    bool ok = true;
+    while(pos < len && ok) {
+        switch(stream->state) {
+        case CaptureStateGlobalHeader: {
+            size_t take = MIN(len - pos, PCAP_GLOBAL_HEADER_LEN - stream->scratch_len);
+            memcpy(stream->scratch + stream->scratch_len, data + pos, take);
+            stream->scratch_len += take;
+            pos += take;
+            if(stream->scratch_len < PCAP_GLOBAL_HEADER_LEN) break;
+
+            stream->scratch_len = 0;
+            if(!capture_stream_parse_global_header(stream)) {
+                FURI_LOG_W("CaptureStream", "No PCAP magic, passing data through");
+                stream->state = CaptureStatePassthrough;
+                stream->text = true;
+                uint8_t header[PCAP_GLOBAL_HEADER_LEN];
+                memcpy(header, stream->scratch, sizeof(header));
+                if(framed) {
+                    // Nothing was written yet, replay the header bytes
+                    ok = capture_stream_emit(stream, header, sizeof(header)) &&
+                         capture_stream_emit(stream, data + pos, len - pos);
+                }
+                capture_stream_mark_lines(
+                    stream, stream->offset - (len - pos), header, sizeof(header));
+                capture_stream_mark_lines(stream, stream->offset, data + pos, len - pos);
+                pos = len;
+                break;
+            }
+
+            FURI_LOG_I(
+                "CaptureStream",
+                "PCAP linktype %lu snaplen %lu%s",
+                stream->linktype,
+                stream->snaplen,
+                stream->nanosecond ? " (ns)" : "");
+            if(transcode) {
+                ok = capture_stream_write_section(stream);
+            } else if(framed) {
+                ok = capture_stream_emit(stream, stream->scratch, PCAP_GLOBAL_HEADER_LEN);
+            }
+            stream->record_end = framed ? stream->offset : base + pos;
+            stream->state = CaptureStateRecordHeader;
+            break;
+        }
+
+        case CaptureStateRecordHeader: {
+            size_t take = MIN(len - pos, PCAP_RECORD_HEADER_LEN - stream->scratch_len);
+            memcpy(stream->scratch + stream->scratch_len, data + pos, take);
+            stream->scratch_len += take;
+            pos += take;
+            if(stream->scratch_len < PCAP_RECORD_HEADER_LEN) break;
+
+            stream->scratch_len = 0;
+            memcpy(stream->record_header, stream->scratch, PCAP_RECORD_HEADER_LEN);
+            stream->ts_sec = capture_stream_read_u32(stream, stream->scratch);
+            stream->ts_frac = capture_stream_read_u32(stream, stream->scratch + 4);
+            uint32_t incl_len = capture_stream_read_u32(stream, stream->scratch + 8);
+            stream->orig_len = capture_stream_read_u32(stream, stream->scratch + 12);
+
+            if(incl_len > PCAP_MAX_PACKET) {
+                FURI_LOG_E("CaptureStream", "Bad record length %lu, framing lost", incl_len);
+                // Raw files keep every byte, PCAPNG cannot embed unframed data
+                if(transcode) {
+                    stream->state = CaptureStateDrop;
+                } else {
+                    stream->state = CaptureStatePassthrough;
+                    if(framed) {
+                        ok = capture_stream_emit(stream, stream->record_header, PCAP_RECORD_HEADER_LEN) &&
+                             capture_stream_emit(stream, data + pos, len - pos);
+                    }
+                }
+                pos = len;
+                break;
+            }
+
+            stream->data_len = incl_len;
+            stream->data_remaining = incl_len;
+            // Frames small enough to hold wait for the dedup verdict before anything is written
+            stream->holding = stream->dedup && incl_len <= CAPTURE_STREAM_HOLD;
+            if(framed && !stream->holding) ok = capture_stream_write_record_header(stream);
+            stream->state = CaptureStateRecordData;
+            // Zero length records complete immediately
+            if(incl_len) break;
+        }
+        // fall through
+        case CaptureStateRecordData: {
+            size_t take = MIN(len - pos, stream->data_remaining);
+            if(stream->holding) {
+                memcpy(stream->hold + (stream->data_len - stream->data_remaining), data + pos, take);
+            } else if(framed) {
+                ok = capture_stream_emit(stream, data + pos, take);
+            }
+            pos += take;
+            stream->data_remaining -= take;
+            if(stream->data_remaining) break;
+
+            stream->state = CaptureStateRecordHeader;
+            if(stream->holding) {
+                stream->holding = false;
+                if(!frame_dedup_check(
+                       stream->dedup, stream->linktype, stream->hold, stream->data_len, stream->ts_sec)) {
+                    stream->dropped++;
+                    break;
+                }
+                ok = ok && capture_stream_write_record_header(stream) &&
+                     capture_stream_emit(stream, stream->hold, stream->data_len);
+            }
+            if(framed) ok = ok && capture_stream_write_record_trailer(stream);
+            stream->packets++;
+            stream->record_end = framed ? stream->offset : base + pos;
+            break;
+        }
+
+        case CaptureStatePassthrough:
+        case CaptureStateDrop:
+            pos = len;
+            break;
+        }
+    }
+
+    return ok;
+}
+
+void capture_stream_finish(CaptureStream* stream) {
+    if(!stream || !stream->active) return;
+
+    // A PCAPNG block whose length is already on disk must be completed, a held frame never was
+    if(stream->format == CaptureFormatPcapng && stream->state == CaptureStateRecordData &&
+       !stream->holding) {
+        FURI_LOG_W("CaptureStream", "Padding truncated packet (%lu bytes missing)", stream->data_remaining);
+        while(stream->data_remaining) {
+            uint32_t chunk = MIN(stream->data_remaining, sizeof(capture_stream_zeros));
+            if(!capture_stream_emit(stream, capture_stream_zeros, chunk)) break;
+            stream->data_remaining -= chunk;
+        }
+        if(capture_stream_write_epb_trailer(stream)) {
+            stream->packets++;
+            stream->record_end = stream->offset;
+        }
+    }
+
+    FURI_LOG_I(
+        "CaptureStream",
+        "Capture closed: %lu packets, %lu duplicates dropped, %lu bytes",
+        stream->packets,
+        stream->dropped,
+        (uint32_t)stream->offset);
+    stream->active = false;
+    stream->holding = false;
+    stream->file = NULL;
+    stream->dedup = NULL;
+}
+
+void capture_stream_set_dedup(CaptureStream* stream, FrameDedup* dedup) {
+    if(!stream) return;
+    stream->dedup = dedup;
+}
+
+uint32_t capture_stream_get_dropped_count(const CaptureStream* stream) {
+    return stream ? stream->dropped : 0;
+}
+
+bool capture_stream_is_active(const CaptureStream* stream) {
+    return stream && stream->active;
+}
+
+CaptureFormat capture_stream_get_format(const CaptureStream* stream) {
+    return stream->format;
+}
+
+uint64_t capture_stream_get_offset(const CaptureStream* stream) {
+    return stream->offset;
+}
+
+uint64_t capture_stream_get_record_end(const CaptureStream* stream) {
+    return stream->record_end;
+}
+
+uint32_t capture_stream_get_packet_count(const CaptureStream* stream) {
+    return stream->packets;
+}
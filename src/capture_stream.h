@@ -0,0 +1,92 @@
+#pragma once
+
+#include <storage/storage.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "frame_dedup.h"
+
+/*
+ * Capture stream
+ *
+ * Sits between the [BUF/BEGIN] data coming off the ESP and the capture file.
+ * It follows the classic PCAP record framing incrementally and either passes
+ * the bytes through unchanged or transcodes them on the fly to PCAPNG:
+ *
+ *   global header  -> Section Header Block (capture command as comment)
+ *                     + Interface Description Block (link type, snaplen)
+ *   record header  -> Enhanced Packet Block header
+ *   packet bytes   -> written straight from the UART buffer
+ *   end of record  -> padding, options, trailing block length
+ *
+ * Only block headers go through the fixed scratch buffer, packet data is never
+ * copied, so RAM use does not grow with packet size. Data that does not start
+ * with a PCAP magic (wardrive CSV, GPX) is always passed through.
+ *
+ * With a FrameDedup attached, records up to CAPTURE_STREAM_HOLD bytes are held
+ * until they are complete and only written if the dedup stage keeps them, in
+ * both output formats.
+ */
+
+#define CAPTURE_STREAM_COMMENT_LEN 96
+#define CAPTURE_STREAM_SCRATCH     64
+#define CAPTURE_STREAM_HOLD        768 // Largest frame that can be deduplicated
+
+typedef enum {
+    CaptureFormatPcap,
+    CaptureFormatPcapng,
+} CaptureFormat;
+
+typedef struct CaptureStream CaptureStream;
+
+CaptureStream* capture_stream_alloc(void);
+void capture_stream_free(CaptureStream* stream);
+
+/**
+ * @brief Attach a freshly opened capture file
+ */
+void capture_stream_begin(CaptureStream* stream, File* file, CaptureFormat format);
+
+/**
+ * @brief Remember the command that started the capture, stored in the SHB comment
+ */
+void capture_stream_set_comment(CaptureStream* stream, const char* comment);
+
+/**
+ * @brief Text attached to following packets as an EPB comment (e.g. GPS fix), NULL clears
+ */
+void capture_stream_set_annotation(CaptureStream* stream, const char* annotation);
+
+/**
+ * @brief Drop repeated beacons/probes through dedup, NULL writes every frame
+ *
+ * Call after capture_stream_begin, which detaches any previous stage.
+ */
+void capture_stream_set_dedup(CaptureStream* stream, FrameDedup* dedup);
+
+/**
+ * @brief Consume bytes from the ESP
+ * @return false if the file write failed
+ */
+bool capture_stream_write(CaptureStream* stream, const uint8_t* data, size_t len);
+
+/**
+ * @brief Close any half-written PCAPNG block so the file stays readable
+ */
+void capture_stream_finish(CaptureStream* stream);
+
+bool capture_stream_is_active(const CaptureStream* stream);
+CaptureFormat capture_stream_get_format(const CaptureStream* stream);
+
+/**
+ * @brief Bytes written to the file so far
+ */
+uint64_t capture_stream_get_offset(const CaptureStream* stream);
+
+/**
+ * @brief File offset right after the last complete record
+ */
+uint64_t capture_stream_get_record_end(const CaptureStream* stream);
+
+uint32_t capture_stream_get_packet_count(const CaptureStream* stream);
+uint32_t capture_stream_get_dropped_count(const CaptureStream* stream);
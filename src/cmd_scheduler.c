@@ -0,0 +1,438 @@
+#include "cmd_scheduler.h"
+#include "uart_utils.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    CmdScheduler* owner;
+    bool used;
+    bool armed; // Has a deadline, one-shot jobs lose it once they fired
+    bool sending; // A run is in the TX queue
+    uint32_t id;
+    char command[CMD_SCHEDULER_COMMAND_MAX + 1]; // With its line ending
+    size_t len;
+    uint32_t period_ms;
+    uint32_t due_tick;
+    uint32_t sent_due_tick; // Deadline of the run in the TX queue
+    uint32_t runs;
+    uint32_t missed;
+    uint32_t jitter_last_ms;
+    uint32_t jitter_max_ms;
+    uint32_t jitter_sum_ms;
+} CmdSchedulerJob;
+
+struct CmdScheduler {
+    UartContext* uart;
+    FuriMutex* mutex;
+    FuriTimer* timer;
+    bool stopped; // The TX queue is going away, nothing is sent anymore
+    uint32_t next_id;
+    CmdSchedulerJob jobs[CMD_SCHEDULER_JOBS];
+};
+
+typedef struct {
+    CmdSchedulerJob* job;
+    uint32_t id;
+} CmdSchedulerDue;
+
+// Under the mutex, one timer for every job
+static void cmd_scheduler_arm(CmdScheduler* scheduler, uint32_t now) {
+    bool any = false;
+    int32_t wait = 0;
+    for(size_t i = 0; i < CMD_SCHEDULER_JOBS; i++) {
+        const CmdSchedulerJob* job = &scheduler->jobs[i];
+        if(!job->used || !job->armed) continue;
+        int32_t left = (int32_t)(job->due_tick - now);
+        if(!any || left < wait) wait = left;
+        any = true;
+    }
+    // Without jobs the one-shot timer just stays idle
+    if(any && !scheduler->stopped) furi_timer_start(scheduler->timer, wait > 0 ? furi_ms_to_ticks(wait) : 1);
+}
+
+// Under the mutex, a finished one-shot job frees its slot
+static void cmd_scheduler_settle(CmdSchedulerJob* job) {
+    job->sending = false;
+    if(!job->armed) job->used = false;
+}
+
+static void cmd_scheduler_sent(const UartTxResult* result, void* context) {
+    UNUSED(result);
+    CmdSchedulerJob* job = context;
+    CmdScheduler* scheduler = job->owner;
+    uint32_t now = furi_get_tick();
+
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    if(job->used && job->sending) {
+        uint32_t jitter = now - job->sent_due_tick;
+        job->runs++;
+        job->jitter_last_ms = jitter;
+        job->jitter_sum_ms += jitter;
+        if(jitter > job->jitter_max_ms) job->jitter_max_ms = jitter;
+        cmd_scheduler_settle(job);
+    }
+    furi_mutex_release(scheduler->mutex);
+}
+
+// Timer thread
+static void cmd_scheduler_fire(void* context) {
+    CmdScheduler* scheduler = context;
+    CmdSchedulerDue due[CMD_SCHEDULER_JOBS];
+    size_t count = 0;
+    uint32_t now = furi_get_tick();
+
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    for(size_t i = 0; i < CMD_SCHEDULER_JOBS; i++) {
+        CmdSchedulerJob* job = &scheduler->jobs[i];
+        if(!job->used || !job->armed || (int32_t)(job->due_tick - now) > 0) continue;
+
+        if(job->sending) {
+            // The last run is still queued, a second copy would only pile up
+            job->missed++;
+        } else {
+            job->sending = true;
+            job->sent_due_tick = job->due_tick;
+            due[count].job = job;
+            due[count].id = job->id;
+            count++;
+        }
+
+        if(job->period_ms) {
+            // Same phase as before, whole periods that already passed are skipped
+            job->due_tick += job->period_ms;
+            while((int32_t)(job->due_tick - now) <= 0) {
+                job->due_tick += job->period_ms;
+                job->missed++;
+            }
+        } else {
+            job->armed = false;
+            if(!job->sending) job->used = false;
+        }
+    }
+    cmd_scheduler_arm(scheduler, now);
+    furi_mutex_release(scheduler->mutex);
+
+    // Not under the mutex, the TX thread may be waiting on it. The command is
+    // copied under it, the job may be removed and its slot reused meanwhile
+    for(size_t i = 0; i < count; i++) {
+        CmdSchedulerJob* job = due[i].job;
+        char command[CMD_SCHEDULER_COMMAND_MAX + 1];
+        size_t len = 0;
+        furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+        bool live = !scheduler->stopped && job->used && job->id == due[i].id && job->sending;
+        if(live) {
+            len = job->len;
+            memcpy(command, job->command, len);
+        }
+        furi_mutex_release(scheduler->mutex);
+        if(!live) continue;
+
+        uint32_t tx_id = uart_send_ex(
+            scheduler->uart, (const uint8_t*)command, len, UartTxPriorityNormal, cmd_scheduler_sent, job);
+        if(tx_id) continue;
+
+        furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+        if(job->used && job->id == due[i].id && job->sending) {
+            job->missed++;
+            cmd_scheduler_settle(job);
+        }
+        furi_mutex_release(scheduler->mutex);
+    }
+}
+
+CmdScheduler* cmd_scheduler_alloc(struct UartContext* uart) {
+    CmdScheduler* scheduler = malloc(sizeof(CmdScheduler));
+    if(!scheduler) return NULL;
+    memset(scheduler, 0, sizeof(CmdScheduler));
+    scheduler->uart = uart;
+    for(size_t i = 0; i < CMD_SCHEDULER_JOBS; i++) {
+        scheduler->jobs[i].owner = scheduler;
+    }
+
+    scheduler->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    scheduler->timer = furi_timer_alloc(cmd_scheduler_fire, FuriTimerTypeOnce, scheduler);
+    if(!scheduler->mutex || !scheduler->timer) {
+        cmd_scheduler_free(scheduler);
+        return NULL;
+    }
+    return scheduler;
+}
+
+void cmd_scheduler_stop(CmdScheduler* scheduler) {
+    if(!scheduler) return;
+
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    scheduler->stopped = true;
+    for(size_t i = 0; i < CMD_SCHEDULER_JOBS; i++) {
+        scheduler->jobs[i].armed = false;
+    }
+    furi_mutex_release(scheduler->mutex);
+
+    // furi_timer_stop does not wait for a run already on the timer thread, the
+    // flush does: the run that may still have seen stopped unset has returned
+    furi_timer_stop(scheduler->timer);
+    furi_timer_flush();
+}
+
+void cmd_scheduler_free(CmdScheduler* scheduler) {
+    if(!scheduler) return;
+    if(scheduler->timer) {
+        furi_timer_stop(scheduler->timer);
+        furi_timer_free(scheduler->timer);
+    }
+    if(scheduler->mutex) furi_mutex_free(scheduler->mutex);
+    free(scheduler);
+}
+
+uint32_t cmd_scheduler_add(
+    CmdScheduler* scheduler,
+    const char* command,
+    uint32_t delay_ms,
+    uint32_t period_ms) {
+    if(!scheduler || !command) return 0;
+
+    size_t len = strlen(command);
+    while(len && (command[len - 1] == '\n' || command[len - 1] == '\r')) len--;
+    if(!len || len >= CMD_SCHEDULER_COMMAND_MAX) return 0;
+    if(period_ms && period_ms < CMD_SCHEDULER_MIN_PERIOD_MS) return 0;
+
+    uint32_t now = furi_get_tick();
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    if(scheduler->stopped) {
+        furi_mutex_release(scheduler->mutex);
+        return 0;
+    }
+    CmdSchedulerJob* job = NULL;
+    for(size_t i = 0; i < CMD_SCHEDULER_JOBS && !job; i++) {
+        if(!scheduler->jobs[i].used) job = &scheduler->jobs[i];
+    }
+    if(!job) {
+        furi_mutex_release(scheduler->mutex);
+        FURI_LOG_W("CmdScheduler", "All %d jobs in use", CMD_SCHEDULER_JOBS);
+        return 0;
+    }
+
+    memset(job, 0, sizeof(CmdSchedulerJob));
+    job->owner = scheduler;
+    job->used = true;
+    job->armed = true;
+    job->id = ++scheduler->next_id;
+    if(!job->id) job->id = ++scheduler->next_id;
+    memcpy(job->command, command, len);
+    job->command[len] = '\n';
+    job->len = len + 1;
+    job->period_ms = period_ms;
+    job->due_tick = now + delay_ms;
+    uint32_t id = job->id;
+    cmd_scheduler_arm(scheduler, now);
+    furi_mutex_release(scheduler->mutex);
+
+    FURI_LOG_I(
+        "CmdScheduler",
+        "Job %lu: \"%.*s\" %s %lu ms",
+        id,
+        (int)len,
+        command,
+        period_ms ? "every" : "once after",
+        period_ms ? period_ms : delay_ms);
+    return id;
+}
+
+bool cmd_scheduler_remove(CmdScheduler* scheduler, uint32_t id) {
+    if(!scheduler || !id) return false;
+
+    bool found = false;
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    for(size_t i = 0; i < CMD_SCHEDULER_JOBS && !found; i++) {
+        CmdSchedulerJob* job = &scheduler->jobs[i];
+        if(!job->used || job->id != id) continue;
+        // A queued run still completes, its callback finds the slot unused
+        job->used = false;
+        found = true;
+    }
+    furi_mutex_release(scheduler->mutex);
+    return found;
+}
+
+static void cmd_scheduler_fill_stats(const CmdSchedulerJob* job, CmdSchedulerStats* stats) {
+    memset(stats, 0, sizeof(CmdSchedulerStats));
+    stats->id = job->id;
+    memcpy(stats->command, job->command, job->len - 1);
+    stats->period_ms = job->period_ms;
+    stats->runs = job->runs;
+    stats->missed = job->missed;
+    stats->jitter_last_ms = job->jitter_last_ms;
+    stats->jitter_avg_ms = job->runs ? job->jitter_sum_ms / job->runs : 0;
+    stats->jitter_max_ms = job->jitter_max_ms;
+}
+
+size_t cmd_scheduler_get_stats(CmdScheduler* scheduler, CmdSchedulerStats* stats, size_t max) {
+    if(!scheduler || !stats) return 0;
+
+    size_t count = 0;
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    for(size_t i = 0; i < CMD_SCHEDULER_JOBS && count < max; i++) {
+        const CmdSchedulerJob* job = &scheduler->jobs[i];
+        if(job->used) cmd_scheduler_fill_stats(job, &stats[count++]);
+    }
+    furi_mutex_release(scheduler->mutex);
+    return count;
+}
+
+void cmd_scheduler_clear(CmdScheduler* scheduler) {
+    if(!scheduler) return;
+
+    CmdSchedulerStats stats[CMD_SCHEDULER_JOBS];
+    size_t count = 0;
+    furi_mutex_acquire(scheduler->mutex, FuriWaitForever);
+    for(size_t i = 0; i < CMD_SCHEDULER_JOBS; i++) {
+        CmdSchedulerJob* job = &scheduler->jobs[i];
+        if(!job->used) continue;
+        cmd_scheduler_fill_stats(job, &stats[count++]);
+        job->used = false;
+    }
+    furi_mutex_release(scheduler->mutex);
+
+    for(size_t i = 0; i < count; i++) {
+        char line[128];
+        snprintf(
+            line,
+            sizeof(line),
+            "[schedule] %s: %lu runs, %lu missed, jitter avg %lu max %lu ms",
+            stats[i].command,
+            stats[i].runs,
+            stats[i].missed,
+            stats[i].jitter_avg_ms,
+            stats[i].jitter_max_ms);
+        FURI_LOG_I("CmdScheduler", "%s", line);
+        uart_append_log(scheduler->uart, line);
+        uart_append_log(scheduler->uart, "\n");
+    }
+}
+
+typedef struct {
+    uint32_t delay_ms;
+    uint32_t period_ms;
+    const char* command;
+    size_t len;
+} CmdSchedulerEntry;
+
+static bool cmd_scheduler_number(const char* p, size_t len, uint32_t* value) {
+    if(!len || len > 9) return false;
+    uint32_t n = 0;
+    for(size_t i = 0; i < len; i++) {
+        if(p[i] < '0' || p[i] > '9') return false;
+        n = n * 10 + (uint32_t)(p[i] - '0');
+    }
+    *value = n;
+    return true;
+}
+
+static const char* cmd_scheduler_parse_line(const char* p, const char* end, CmdSchedulerEntry* entry) {
+    const char* word = p;
+    while(p < end && *p != ' ' && *p != '\t') p++;
+    size_t word_len = p - word;
+    bool every = word_len == 5 && memcmp(word, "every", 5) == 0;
+    bool after = word_len == 5 && memcmp(word, "after", 5) == 0;
+    if(!every && !after) return "unknown statement";
+
+    while(p < end && (*p == ' ' || *p == '\t')) p++;
+    const char* number = p;
+    while(p < end && *p != ' ' && *p != '\t') p++;
+    uint32_t ms;
+    if(!cmd_scheduler_number(number, p - number, &ms)) return "expected milliseconds";
+    while(p < end && (*p == ' ' || *p == '\t')) p++;
+
+    if(p == end) return "missing command";
+    if((size_t)(end - p) >= CMD_SCHEDULER_COMMAND_MAX) return "command too long";
+    if(every && ms < CMD_SCHEDULER_MIN_PERIOD_MS) return "period under 500 ms";
+
+    // Periodic jobs first run after one period
+    entry->delay_ms = ms;
+    entry->period_ms = every ? ms : 0;
+    entry->command = p;
+    entry->len = end - p;
+    return NULL;
+}
+
+size_t cmd_scheduler_load(CmdScheduler* scheduler, const char* path, char* error, size_t error_size) {
+    if(!scheduler || !path) return 0;
+
+    char* source = malloc(CMD_SCHEDULER_FILE_MAX + 1);
+    if(!source) {
+        if(error && error_size) snprintf(error, error_size, "out of memory");
+        return 0;
+    }
+    size_t len = 0;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    bool opened = storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING);
+    if(opened) len = storage_file_read(file, source, CMD_SCHEDULER_FILE_MAX + 1);
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+
+    // Checked as a whole first, a bad line schedules nothing
+    CmdSchedulerEntry entries[CMD_SCHEDULER_JOBS];
+    size_t count = 0;
+    uint32_t line_no = 0;
+    const char* fail = NULL;
+    if(!opened) {
+        fail = "cannot open the file";
+    } else if(len > CMD_SCHEDULER_FILE_MAX) {
+        fail = "file too long";
+    }
+
+    const char* p = source;
+    const char* source_end = source + len;
+    while(!fail && p < source_end) {
+        const char* eol = memchr(p, '\n', source_end - p);
+        const char* line_end = eol ? eol : source_end;
+        const char* next = eol ? eol + 1 : source_end;
+        line_no++;
+
+        while(line_end > p && (line_end[-1] == '\r' || line_end[-1] == ' ' || line_end[-1] == '\t')) {
+            line_end--;
+        }
+        while(p < line_end && (*p == ' ' || *p == '\t')) p++;
+        if(p < line_end && *p != '#') {
+            if(count == CMD_SCHEDULER_JOBS) {
+                fail = "too many jobs";
+            } else {
+                fail = cmd_scheduler_parse_line(p, line_end, &entries[count]);
+                if(!fail) count++;
+            }
+        }
+        p = next;
+    }
+    if(!fail && !count) {
+        fail = "no jobs";
+        line_no = 0;
+    }
+
+    size_t added = 0;
+    for(size_t i = 0; !fail && i < count; i++) {
+        char command[CMD_SCHEDULER_COMMAND_MAX];
+        memcpy(command, entries[i].command, entries[i].len);
+        command[entries[i].len] = '\0';
+        if(cmd_scheduler_add(scheduler, command, entries[i].delay_ms, entries[i].period_ms)) {
+            added++;
+        } else {
+            fail = "no free job slot";
+            line_no = 0;
+        }
+    }
+    free(source);
+
+    if(fail && error && error_size) {
+        if(line_no && !added) {
+            snprintf(error, error_size, "line %lu: %s", (unsigned long)line_no, fail);
+        } else {
+            snprintf(error, error_size, "%s", fail);
+        }
+    }
+    return added;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Command scheduler
+ *
+ * Sends ESP commands at fixed intervals (a rescan every 30 s while walking a
+ * site) or once after a delay. Every job's next deadline is kept and a single
+ * one-shot timer is armed for the earliest one, so idle jobs cost nothing
+ * between runs. Due commands go straight into the TX queue, without the menu
+ * path's probe or any GUI work.
+ *
+ * Periodic jobs keep their phase: a late run does not push the following
+ * ones back, and periods that passed entirely are counted as missed instead
+ * of being sent in a burst. Jitter is measured from the deadline to the TX
+ * completion.
+ *
+ * Jobs can be loaded from a file, one per line:
+ *
+ *   every <ms> <command>
+ *   after <ms> <command>
+ *   # comment
+ */
+
+#define CMD_SCHEDULER_FILE          GHOST_ESP_APP_FOLDER "/schedule.txt"
+#define CMD_SCHEDULER_JOBS          8
+#define CMD_SCHEDULER_COMMAND_MAX   64
+#define CMD_SCHEDULER_MIN_PERIOD_MS 500
+#define CMD_SCHEDULER_FILE_MAX      1024
+
+struct UartContext;
+typedef struct CmdScheduler CmdScheduler;
+
+typedef struct {
+    uint32_t id;
+    char command[CMD_SCHEDULER_COMMAND_MAX]; // Without its line ending
+    uint32_t period_ms; // 0 for a one-shot job
+    uint32_t runs;
+    uint32_t missed; // Periods skipped because a run came too late, or dropped sends
+    uint32_t jitter_last_ms;
+    uint32_t jitter_avg_ms;
+    uint32_t jitter_max_ms;
+} CmdSchedulerStats;
+
+CmdScheduler* cmd_scheduler_alloc(struct UartContext* uart);
+
+/**
+ * @brief Stop sending for good, before the TX queue goes away
+ */
+void cmd_scheduler_stop(CmdScheduler* scheduler);
+
+/**
+ * @brief Free after the TX queue, a queued run's completion still points here
+ */
+void cmd_scheduler_free(CmdScheduler* scheduler);
+
+/**
+ * @brief Schedule a command, a line ending is added
+ * @param delay_ms Until the first run
+ * @param period_ms Between runs, 0 runs once
+ * @return Job id, 0 if every slot is taken or the period is too short
+ */
+uint32_t cmd_scheduler_add(
+    CmdScheduler* scheduler,
+    const char* command,
+    uint32_t delay_ms,
+    uint32_t period_ms);
+
+bool cmd_scheduler_remove(CmdScheduler* scheduler, uint32_t id);
+
+/**
+ * @brief Drop every job, their stats go to the log first
+ */
+void cmd_scheduler_clear(CmdScheduler* scheduler);
+
+/**
+ * @brief Load jobs from a schedule file, in addition to the scheduled ones
+ * @param error Optional, receives "line N: ..." when nothing was scheduled
+ * @return Number of jobs added
+ */
+size_t cmd_scheduler_load(CmdScheduler* scheduler, const char* path, char* error, size_t error_size);
+
+/**
+ * @brief Copy the stats of the scheduled jobs
+ * @return Number of jobs copied
+ */
+size_t cmd_scheduler_get_stats(CmdScheduler* scheduler, CmdSchedulerStats* stats, size_t max);
@@ -0,0 +1,200 @@
+#include "cuckoo_filter.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct CuckooFilter {
+    uint8_t* table; // Buckets of CUCKOO_FILTER_BUCKET_SLOTS fingerprints, 0 = empty
+    uint32_t bucket_mask; // Bucket count - 1, the count is a power of two
+    uint8_t fingerprint_bits;
+    uint8_t fingerprint_size; // Bytes per slot
+    uint32_t rng; // Picks the entry to kick
+    CuckooFilterStats stats;
+};
+
+static uint32_t cuckoo_filter_hash(const void* key, size_t len) {
+    const uint8_t* p = key;
+    uint32_t hash = 0x811C9DC5;
+    for(size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 0x01000193;
+    }
+    // Finalizer so the index (low bits) and fingerprint (high bits) are independent
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6B;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static inline uint32_t cuckoo_filter_alt_index(
+    const CuckooFilter* filter,
+    uint32_t index,
+    uint16_t fingerprint) {
+    return (index ^ (fingerprint * 0x5BD1E995)) & filter->bucket_mask;
+}
+
+static inline uint16_t cuckoo_filter_get(const CuckooFilter* filter, uint32_t bucket, uint8_t slot) {
+    size_t at = ((size_t)bucket * CUCKOO_FILTER_BUCKET_SLOTS + slot) * filter->fingerprint_size;
+    if(filter->fingerprint_size == 1) return filter->table[at];
+    return filter->table[at] | (filter->table[at + 1] << 8);
+}
+
+static inline void cuckoo_filter_set(
+    CuckooFilter* filter,
+    uint32_t bucket,
+    uint8_t slot,
+    uint16_t fingerprint) {
+    size_t at = ((size_t)bucket * CUCKOO_FILTER_BUCKET_SLOTS + slot) * filter->fingerprint_size;
+    filter->table[at] = fingerprint & 0xFF;
+    if(filter->fingerprint_size == 2) filter->table[at + 1] = fingerprint >> 8;
+}
+
+static void cuckoo_filter_locate(
+    const CuckooFilter* filter,
+    const void* key,
+    size_t len,
+    uint32_t* index,
+    uint16_t* fingerprint) {
+    uint32_t hash = cuckoo_filter_hash(key, len);
+    uint16_t fp = hash >> (32 - filter->fingerprint_bits);
+    *fingerprint = fp ? fp : 1;
+    *index = hash & filter->bucket_mask;
+}
+
+static bool cuckoo_filter_bucket_has(const CuckooFilter* filter, uint32_t bucket, uint16_t fp) {
+    for(uint8_t slot = 0; slot < CUCKOO_FILTER_BUCKET_SLOTS; slot++) {
+        if(cuckoo_filter_get(filter, bucket, slot) == fp) return true;
+    }
+    return false;
+}
+
+static bool cuckoo_filter_bucket_put(CuckooFilter* filter, uint32_t bucket, uint16_t fp) {
+    for(uint8_t slot = 0; slot < CUCKOO_FILTER_BUCKET_SLOTS; slot++) {
+        if(cuckoo_filter_get(filter, bucket, slot) == 0) {
+            cuckoo_filter_set(filter, bucket, slot, fp);
+            return true;
+        }
+    }
+    return false;
+}
+
+CuckooFilter* cuckoo_filter_alloc(size_t budget, uint8_t fingerprint_bits) {
+    if(fingerprint_bits != 8 && fingerprint_bits != 16) return NULL;
+
+    uint8_t size = fingerprint_bits / 8;
+    size_t bucket_bytes = CUCKOO_FILTER_BUCKET_SLOTS * size;
+    uint32_t buckets = 1;
+    while((size_t)buckets * 2 * bucket_bytes <= budget) {
+        buckets *= 2;
+    }
+    if((size_t)buckets * bucket_bytes > budget) return NULL;
+
+    CuckooFilter* filter = malloc(sizeof(CuckooFilter));
+    if(!filter) return NULL;
+    memset(filter, 0, sizeof(CuckooFilter));
+
+    filter->table = malloc(buckets * bucket_bytes);
+    if(!filter->table) {
+        free(filter);
+        return NULL;
+    }
+    filter->bucket_mask = buckets - 1;
+    filter->fingerprint_bits = fingerprint_bits;
+    filter->fingerprint_size = size;
+    filter->stats.capacity = buckets * CUCKOO_FILTER_BUCKET_SLOTS;
+    cuckoo_filter_reset(filter);
+    return filter;
+}
+
+void cuckoo_filter_free(CuckooFilter* filter) {
+    if(!filter) return;
+    free(filter->table);
+    free(filter);
+}
+
+void cuckoo_filter_reset(CuckooFilter* filter) {
+    if(!filter) return;
+    memset(
+        filter->table,
+        0,
+        (size_t)(filter->bucket_mask + 1) * CUCKOO_FILTER_BUCKET_SLOTS * filter->fingerprint_size);
+    filter->stats.count = 0;
+    filter->stats.evictions = 0;
+    filter->rng = 0x9E3779B9;
+}
+
+bool cuckoo_filter_contains(const CuckooFilter* filter, const void* key, size_t len) {
+    if(!filter || !key) return false;
+
+    uint32_t index;
+    uint16_t fp;
+    cuckoo_filter_locate(filter, key, len, &index, &fp);
+    return cuckoo_filter_bucket_has(filter, index, fp) ||
+           cuckoo_filter_bucket_has(filter, cuckoo_filter_alt_index(filter, index, fp), fp);
+}
+
+bool cuckoo_filter_add(CuckooFilter* filter, const void* key, size_t len) {
+    if(!filter || !key) return false;
+
+    uint32_t index;
+    uint16_t fp;
+    cuckoo_filter_locate(filter, key, len, &index, &fp);
+    uint32_t alt = cuckoo_filter_alt_index(filter, index, fp);
+    if(cuckoo_filter_bucket_has(filter, index, fp) || cuckoo_filter_bucket_has(filter, alt, fp)) {
+        return false;
+    }
+
+    filter->stats.count++;
+    if(cuckoo_filter_bucket_put(filter, index, fp) || cuckoo_filter_bucket_put(filter, alt, fp)) {
+        return true;
+    }
+
+    // Both buckets full, move entries along their alternate buckets until one has room
+    uint32_t bucket = (filter->rng & 1) ? alt : index;
+    for(uint8_t kick = 0; kick < CUCKOO_FILTER_MAX_KICKS; kick++) {
+        filter->rng ^= filter->rng << 13;
+        filter->rng ^= filter->rng >> 17;
+        filter->rng ^= filter->rng << 5;
+        uint8_t slot = filter->rng % CUCKOO_FILTER_BUCKET_SLOTS;
+
+        uint16_t victim = cuckoo_filter_get(filter, bucket, slot);
+        cuckoo_filter_set(filter, bucket, slot, fp);
+        fp = victim;
+        bucket = cuckoo_filter_alt_index(filter, bucket, fp);
+        if(cuckoo_filter_bucket_put(filter, bucket, fp)) return true;
+    }
+
+    // Full, the fingerprint in hand is forgotten
+    filter->stats.count--;
+    filter->stats.evictions++;
+    return true;
+}
+
+bool cuckoo_filter_remove(CuckooFilter* filter, const void* key, size_t len) {
+    if(!filter || !key) return false;
+
+    uint32_t index;
+    uint16_t fp;
+    cuckoo_filter_locate(filter, key, len, &index, &fp);
+    uint32_t buckets[2] = {index, cuckoo_filter_alt_index(filter, index, fp)};
+    for(size_t i = 0; i < COUNT_OF(buckets); i++) {
+        for(uint8_t slot = 0; slot < CUCKOO_FILTER_BUCKET_SLOTS; slot++) {
+            if(cuckoo_filter_get(filter, buckets[i], slot) == fp) {
+                cuckoo_filter_set(filter, buckets[i], slot, 0);
+                filter->stats.count--;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void cuckoo_filter_get_stats(const CuckooFilter* filter, CuckooFilterStats* stats) {
+    if(!filter || !stats) return;
+    *stats = filter->stats;
+}
+
+uint8_t cuckoo_filter_get_fingerprint_bits(const CuckooFilter* filter) {
+    return filter ? filter->fingerprint_bits : 0;
+}
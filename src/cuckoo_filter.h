@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Cuckoo filter
+ *
+ * Approximate set membership in a fixed RAM budget. Each key is stored as a
+ * small fingerprint in one of two 4-slot buckets; a full bucket kicks an
+ * entry over to its alternate bucket. Keys are never reported missing once
+ * added, other keys test positive with a probability of about
+ * 8 / 2^fingerprint_bits (8-bit: ~3%, 16-bit: ~0.01%). Smaller fingerprints
+ * hold twice as many keys in the same RAM.
+ *
+ * Unlike a Bloom filter keys can be removed again. When no slot can be found
+ * within CUCKOO_FILTER_MAX_KICKS moves, the last fingerprint moved is
+ * forgotten instead, so a full filter ages out random old keys rather than
+ * refusing new ones.
+ */
+
+#define CUCKOO_FILTER_BUCKET_SLOTS 4
+#define CUCKOO_FILTER_MAX_KICKS    64
+
+typedef struct CuckooFilter CuckooFilter;
+
+typedef struct {
+    uint32_t count; // Fingerprints stored
+    uint32_t capacity; // Slots
+    uint32_t evictions; // Fingerprints forgotten because the filter was full
+} CuckooFilterStats;
+
+/**
+ * @brief Allocate a filter using at most budget bytes for its table
+ * @param fingerprint_bits 8 or 16
+ */
+CuckooFilter* cuckoo_filter_alloc(size_t budget, uint8_t fingerprint_bits);
+void cuckoo_filter_free(CuckooFilter* filter);
+
+void cuckoo_filter_reset(CuckooFilter* filter);
+
+bool cuckoo_filter_contains(const CuckooFilter* filter, const void* key, size_t len);
+
+/**
+ * @brief Add a key unless it already tests positive
+ * @return true if the key was new
+ */
+bool cuckoo_filter_add(CuckooFilter* filter, const void* key, size_t len);
+
+/**
+ * @brief Remove a key added before, removing anything else may drop another key
+ */
+bool cuckoo_filter_remove(CuckooFilter* filter, const void* key, size_t len);
+
+void cuckoo_filter_get_stats(const CuckooFilter* filter, CuckooFilterStats* stats);
+
+uint8_t cuckoo_filter_get_fingerprint_bits(const CuckooFilter* filter);
@@ -0,0 +1,325 @@
+#include "dir_catalog.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIR_CATALOG_SLOTS      4
+#define DIR_CATALOG_DIR_LEN    64
+#define DIR_CATALOG_GROUPS     8
+#define DIR_CATALOG_PREFIX_LEN 24
+#define DIR_CATALOG_EXT_LEN    8
+#define DIR_CATALOG_NAME_LEN   256
+
+// Files named prefix_N.extension, one entry per prefix/extension pair
+typedef struct {
+    char prefix[DIR_CATALOG_PREFIX_LEN];
+    char extension[DIR_CATALOG_EXT_LEN];
+    uint32_t match_count;
+    int32_t min_index;
+    int32_t max_index;
+} DirCatalogGroup;
+
+// Unfiltered snapshot of one directory
+typedef struct {
+    char dir[DIR_CATALOG_DIR_LEN];
+    uint32_t last_used;
+    uint32_t file_count;
+    uint64_t total_bytes;
+    uint8_t group_count;
+    bool overflow; // Some numbered files did not fit in groups
+    DirCatalogGroup groups[DIR_CATALOG_GROUPS];
+} DirCatalogSlot;
+
+static DirCatalogSlot catalog_slots[DIR_CATALOG_SLOTS];
+static uint32_t catalog_clock = 0;
+static FuriMutex* catalog_mutex = NULL;
+
+static bool dir_catalog_lock(void) {
+    return catalog_mutex && furi_mutex_acquire(catalog_mutex, FuriWaitForever) == FuriStatusOk;
+}
+
+static void dir_catalog_unlock(void) {
+    furi_mutex_release(catalog_mutex);
+}
+
+void dir_catalog_init(void) {
+    if(!catalog_mutex) {
+        catalog_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+        memset(catalog_slots, 0, sizeof(catalog_slots));
+    }
+}
+
+void dir_catalog_deinit(void) {
+    if(catalog_mutex) {
+        furi_mutex_free(catalog_mutex);
+        catalog_mutex = NULL;
+    }
+}
+
+bool dir_catalog_parse_index(
+    const char* filename,
+    const char* prefix,
+    const char* extension,
+    int32_t* index) {
+    size_t prefix_len = strlen(prefix);
+    size_t extension_len = strlen(extension);
+    size_t filename_len = strlen(filename);
+
+    // Shortest valid name is prefix + "_0." + extension
+    if(filename_len < prefix_len + extension_len + 3) return false;
+    if(strncmp(filename, prefix, prefix_len) != 0 || filename[prefix_len] != '_') return false;
+
+    const char* dot = filename + filename_len - extension_len - 1;
+    if(*dot != '.' || strcmp(dot + 1, extension) != 0) return false;
+
+    // Digits only between '_' and '.', parsed in place
+    const char* p = filename + prefix_len + 1;
+    if(p == dot) return false;
+    int32_t value = 0;
+    for(; p < dot; p++) {
+        if(*p < '0' || *p > '9') return false;
+        if(value > (INT32_MAX - 9) / 10) return false;
+        value = value * 10 + (*p - '0');
+    }
+
+    *index = value;
+    return true;
+}
+
+// Split "prefix_N.extension" without knowing the prefix
+static bool dir_catalog_split(
+    const char* filename,
+    size_t* prefix_len,
+    const char** extension,
+    int32_t* index) {
+    const char* dot = strrchr(filename, '.');
+    if(!dot || !dot[1]) return false;
+
+    const char* digits = dot;
+    while(digits > filename && digits[-1] >= '0' && digits[-1] <= '9') digits--;
+    if(digits == dot || digits - filename < 2 || digits[-1] != '_') return false;
+
+    int32_t value = 0;
+    for(const char* p = digits; p < dot; p++) {
+        if(value > (INT32_MAX - 9) / 10) return false;
+        value = value * 10 + (*p - '0');
+    }
+
+    *prefix_len = digits - filename - 1;
+    *extension = dot + 1;
+    *index = value;
+    return true;
+}
+
+static DirCatalogGroup* dir_catalog_find_group(
+    DirCatalogSlot* slot,
+    const char* prefix,
+    size_t prefix_len,
+    const char* extension) {
+    for(uint8_t i = 0; i < slot->group_count; i++) {
+        DirCatalogGroup* group = &slot->groups[i];
+        if(strlen(group->prefix) == prefix_len && strncmp(group->prefix, prefix, prefix_len) == 0 &&
+           strcmp(group->extension, extension) == 0) {
+            return group;
+        }
+    }
+    return NULL;
+}
+
+static void dir_catalog_add_file(DirCatalogSlot* slot, const char* filename) {
+    size_t prefix_len;
+    const char* extension;
+    int32_t index;
+    if(!dir_catalog_split(filename, &prefix_len, &extension, &index)) return;
+
+    DirCatalogGroup* group = dir_catalog_find_group(slot, filename, prefix_len, extension);
+    if(!group) {
+        if(slot->group_count == DIR_CATALOG_GROUPS || prefix_len >= DIR_CATALOG_PREFIX_LEN ||
+           strlen(extension) >= DIR_CATALOG_EXT_LEN) {
+            slot->overflow = true;
+            return;
+        }
+        group = &slot->groups[slot->group_count++];
+        memcpy(group->prefix, filename, prefix_len);
+        group->prefix[prefix_len] = '\0';
+        strcpy(group->extension, extension);
+        group->min_index = index;
+        group->max_index = index;
+    }
+
+    group->match_count++;
+    if(index < group->min_index) group->min_index = index;
+    if(index > group->max_index) group->max_index = index;
+}
+
+// Filtered walks are for pairs that did not fit in a snapshot
+static bool dir_catalog_walk(
+    Storage* storage,
+    const char* dir,
+    const char* prefix,
+    const char* extension,
+    DirCatalogSlot* slot,
+    DirCatalogStats* stats) {
+    File* dir_handle = storage_file_alloc(storage);
+    if(!dir_handle) return false;
+    if(!storage_dir_open(dir_handle, dir)) {
+        FURI_LOG_E("DirCatalog", "Failed to open directory: %s", dir);
+        storage_dir_close(dir_handle);
+        storage_file_free(dir_handle);
+        return false;
+    }
+
+    FileInfo file_info;
+    char* filename = malloc(DIR_CATALOG_NAME_LEN);
+    int32_t index;
+
+    while(filename && storage_dir_read(dir_handle, &file_info, filename, DIR_CATALOG_NAME_LEN)) {
+        if(file_info.flags & FSF_DIRECTORY) continue;
+        if(filename[0] == '.') continue;
+
+        if(slot) {
+            slot->file_count++;
+            slot->total_bytes += file_info.size;
+            dir_catalog_add_file(slot, filename);
+        } else {
+            stats->file_count++;
+            stats->total_bytes += file_info.size;
+            if(!dir_catalog_parse_index(filename, prefix, extension, &index)) continue;
+            stats->match_count++;
+            if(stats->min_index < 0 || index < stats->min_index) stats->min_index = index;
+            if(index > stats->max_index) stats->max_index = index;
+        }
+    }
+
+    bool ok = filename != NULL;
+    free(filename);
+    storage_dir_close(dir_handle);
+    storage_file_free(dir_handle);
+    return ok;
+}
+
+static void dir_catalog_stats_reset(DirCatalogStats* stats) {
+    memset(stats, 0, sizeof(DirCatalogStats));
+    stats->min_index = -1;
+    stats->max_index = -1;
+}
+
+// Under the lock, false if the pair is not in the snapshot
+static bool dir_catalog_derive(
+    DirCatalogSlot* slot,
+    const char* prefix,
+    const char* extension,
+    DirCatalogStats* stats) {
+    dir_catalog_stats_reset(stats);
+    stats->file_count = slot->file_count;
+    stats->total_bytes = slot->total_bytes;
+    if(!prefix || !extension) return true;
+
+    DirCatalogGroup* group = dir_catalog_find_group(slot, prefix, strlen(prefix), extension);
+    if(group) {
+        stats->match_count = group->match_count;
+        stats->min_index = group->min_index;
+        stats->max_index = group->max_index;
+        return true;
+    }
+    return !slot->overflow;
+}
+
+static DirCatalogSlot* dir_catalog_find(const char* dir) {
+    for(size_t i = 0; i < DIR_CATALOG_SLOTS; i++) {
+        if(catalog_slots[i].last_used && strcmp(catalog_slots[i].dir, dir) == 0) {
+            catalog_slots[i].last_used = ++catalog_clock;
+            return &catalog_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static void dir_catalog_store(const DirCatalogSlot* snapshot) {
+    DirCatalogSlot* slot = NULL;
+    for(size_t i = 0; i < DIR_CATALOG_SLOTS; i++) {
+        if(catalog_slots[i].last_used && strcmp(catalog_slots[i].dir, snapshot->dir) == 0) {
+            slot = &catalog_slots[i];
+            break;
+        }
+        // Empty slots have last_used 0 and win the least-recently-used pick
+        if(!slot || catalog_slots[i].last_used < slot->last_used) slot = &catalog_slots[i];
+    }
+
+    *slot = *snapshot;
+    slot->last_used = ++catalog_clock;
+}
+
+bool dir_catalog_scan(
+    Storage* storage,
+    const char* dir,
+    const char* prefix,
+    const char* extension,
+    DirCatalogStats* stats) {
+    if(!storage || !dir || !stats) return false;
+
+    DirCatalogSlot* snapshot = malloc(sizeof(DirCatalogSlot));
+    if(!snapshot) return false;
+    memset(snapshot, 0, sizeof(DirCatalogSlot));
+
+    uint32_t start = furi_get_tick();
+    if(!dir_catalog_walk(storage, dir, NULL, NULL, snapshot, NULL)) {
+        free(snapshot);
+        return false;
+    }
+    FURI_LOG_D(
+        "DirCatalog",
+        "Scanned %s: %lu files, %u numbered groups (%lu ms)",
+        dir,
+        snapshot->file_count,
+        snapshot->group_count,
+        furi_get_tick() - start);
+
+    bool derived = dir_catalog_derive(snapshot, prefix, extension, stats);
+    if(strlen(dir) < DIR_CATALOG_DIR_LEN && dir_catalog_lock()) {
+        strcpy(snapshot->dir, dir);
+        dir_catalog_store(snapshot);
+        dir_catalog_unlock();
+    }
+    free(snapshot);
+
+    if(derived) return true;
+    dir_catalog_stats_reset(stats);
+    return dir_catalog_walk(storage, dir, prefix, extension, NULL, stats);
+}
+
+bool dir_catalog_get(
+    Storage* storage,
+    const char* dir,
+    const char* prefix,
+    const char* extension,
+    DirCatalogStats* stats) {
+    if(!storage || !dir || !stats) return false;
+
+    if(dir_catalog_lock()) {
+        DirCatalogSlot* slot = dir_catalog_find(dir);
+        bool derived = slot && dir_catalog_derive(slot, prefix, extension, stats);
+        dir_catalog_unlock();
+        if(derived) return true;
+        if(slot) {
+            // Too many numbered series in this folder to keep them all
+            dir_catalog_stats_reset(stats);
+            return dir_catalog_walk(storage, dir, prefix, extension, NULL, stats);
+        }
+    }
+
+    return dir_catalog_scan(storage, dir, prefix, extension, stats);
+}
+
+void dir_catalog_invalidate(const char* dir) {
+    if(!dir || !dir_catalog_lock()) return;
+
+    for(size_t i = 0; i < DIR_CATALOG_SLOTS; i++) {
+        DirCatalogSlot* slot = &catalog_slots[i];
+        if(slot->last_used && strcmp(slot->dir, dir) == 0) {
+            memset(slot, 0, sizeof(DirCatalogSlot));
+        }
+    }
+
+    dir_catalog_unlock();
+}
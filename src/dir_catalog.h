@@ -0,0 +1,63 @@
+#pragma once
+
+#include <storage/storage.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Directory catalog
+ *
+ * Streams a folder once and keeps aggregate stats, no per-entry allocation.
+ * One unfiltered snapshot is cached per directory: file and byte totals plus
+ * the index range of every prefix_N.extension series found in it. Every
+ * prefix/extension query for that folder is answered from the same snapshot
+ * until something in it is created or deleted.
+ */
+
+typedef struct {
+    uint32_t file_count; // Regular files, dot files excluded
+    uint64_t total_bytes;
+    uint32_t match_count; // Files named prefix_N.extension
+    int32_t min_index; // -1 when nothing matched
+    int32_t max_index;
+} DirCatalogStats;
+
+void dir_catalog_init(void);
+void dir_catalog_deinit(void);
+
+/**
+ * @brief Parse N out of "prefix_N.extension"
+ * @return false if the name does not follow the pattern
+ */
+bool dir_catalog_parse_index(
+    const char* filename,
+    const char* prefix,
+    const char* extension,
+    int32_t* index);
+
+/**
+ * @brief Walk the directory now and refresh its cached snapshot
+ *
+ * prefix/extension may be NULL, then only the file and byte totals are filled.
+ */
+bool dir_catalog_scan(
+    Storage* storage,
+    const char* dir,
+    const char* prefix,
+    const char* extension,
+    DirCatalogStats* stats);
+
+/**
+ * @brief Same as dir_catalog_scan but served from the snapshot when it is still valid
+ */
+bool dir_catalog_get(
+    Storage* storage,
+    const char* dir,
+    const char* prefix,
+    const char* extension,
+    DirCatalogStats* stats);
+
+/**
+ * @brief Drop snapshots for a directory after files were created or removed there
+ */
+void dir_catalog_invalidate(const char* dir);
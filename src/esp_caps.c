@@ -0,0 +1,294 @@
+#include "esp_caps.h"
+#include "uart_utils.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ESP_CAPS_MAGIC  0x53504143 // "CAPS"
+#define ESP_CAPS_FORMAT 2
+
+// Every Ghost ESP build has these, a list without them is not a help output
+static const char* const esp_caps_baseline[] = {
+    "scanap",
+    "stopscan",
+    "attack",
+};
+
+typedef struct {
+    uint32_t magic;
+    uint8_t format;
+    uint8_t count;
+    char firmware[ESP_CAPS_VERSION_MAX];
+    char commands[ESP_CAPS_MAX_COMMANDS][ESP_CAPS_NAME_MAX];
+} EspCapsCatalog;
+
+struct EspCaps {
+    UartContext* uart;
+    FuriThread* thread;
+    FuriSemaphore* listed; // The help output ended
+    FuriMutex* mutex; // Guards ready and catalog, read by the menus while the worker publishes
+    volatile bool stopping;
+    bool ready; // catalog is complete and in use
+
+    // Help output, collected on the RX worker one line at a time
+    volatile uint32_t list_id;
+    uint32_t list_start;
+    bool truncated; // Commands were dropped or the list was cut off
+    EspCapsCatalog found;
+
+    EspCapsCatalog catalog;
+};
+
+bool esp_caps_parse_line(const char* line, char* name, size_t name_size) {
+    if(!line || !name || !name_size) return false;
+
+    const char* p = line;
+    while(*p == ' ' || *p == '\t') p++;
+    bool indented = p != line;
+
+    if(strncmp(p, "Usage:", 6) == 0) {
+        p += 6;
+        while(*p == ' ') p++;
+    } else if(indented) {
+        // Descriptions and option lists
+        return false;
+    }
+
+    size_t len = 0;
+    while(islower((unsigned char)p[len]) || isdigit((unsigned char)p[len]) || p[len] == '_') {
+        len++;
+    }
+    char next = p[len];
+    if(len < 2 || !islower((unsigned char)p[0])) return false;
+    if(next != '\0' && next != ' ' && next != ':' && next != '\t') return false;
+
+    len = MIN(len, name_size - 1);
+    memcpy(name, p, len);
+    name[len] = '\0';
+    return true;
+}
+
+// false if the catalog is full
+static bool esp_caps_add(EspCapsCatalog* catalog, const char* name) {
+    for(uint8_t i = 0; i < catalog->count; i++) {
+        if(strcmp(catalog->commands[i], name) == 0) return true;
+    }
+    if(catalog->count >= ESP_CAPS_MAX_COMMANDS) return false;
+    strncpy(catalog->commands[catalog->count], name, ESP_CAPS_NAME_MAX - 1);
+    catalog->count++;
+    return true;
+}
+
+// "Firmware Version: 1.4.2" -> "1.4.2"
+static void esp_caps_version_from(const char* line, char* version, size_t size) {
+    const char* colon = strrchr(line, ':');
+    const char* p = colon ? colon + 1 : line;
+    while(*p == ' ') p++;
+    strncpy(version, p, size - 1);
+    version[size - 1] = '\0';
+    size_t len = strlen(version);
+    while(len && version[len - 1] == ' ') version[--len] = '\0';
+}
+
+static bool esp_caps_has(const EspCapsCatalog* catalog, const char* name, size_t len) {
+    for(uint8_t i = 0; i < catalog->count; i++) {
+        const char* command = catalog->commands[i];
+        if(strlen(command) == len && strncmp(command, name, len) == 0) return true;
+    }
+    return false;
+}
+
+// Whatever the parser picked out of a garbled or foreign answer must not hide the menus
+static bool esp_caps_plausible(const EspCapsCatalog* catalog) {
+    if(catalog->count < ESP_CAPS_MIN_COMMANDS) return false;
+    for(size_t i = 0; i < COUNT_OF(esp_caps_baseline); i++) {
+        if(!esp_caps_has(catalog, esp_caps_baseline[i], strlen(esp_caps_baseline[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void esp_caps_publish(EspCaps* caps, const EspCapsCatalog* catalog) {
+    furi_mutex_acquire(caps->mutex, FuriWaitForever);
+    caps->catalog = *catalog;
+    caps->ready = true;
+    furi_mutex_release(caps->mutex);
+}
+
+static bool esp_caps_load(Storage* storage, EspCapsCatalog* catalog) {
+    File* file = storage_file_alloc(storage);
+    bool ok = storage_file_open(file, ESP_CAPS_FILE, FSAM_READ, FSOM_OPEN_EXISTING) &&
+              storage_file_read(file, catalog, sizeof(EspCapsCatalog)) == sizeof(EspCapsCatalog) &&
+              catalog->magic == ESP_CAPS_MAGIC && catalog->format == ESP_CAPS_FORMAT &&
+              catalog->count <= ESP_CAPS_MAX_COMMANDS;
+    storage_file_close(file);
+    storage_file_free(file);
+    if(ok) catalog->firmware[ESP_CAPS_VERSION_MAX - 1] = '\0';
+    return ok;
+}
+
+static bool esp_caps_save(Storage* storage, const EspCapsCatalog* catalog) {
+    File* file = storage_file_alloc(storage);
+    bool ok = storage_file_open(file, ESP_CAPS_FILE, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+              storage_file_write(file, catalog, sizeof(EspCapsCatalog)) == sizeof(EspCapsCatalog);
+    storage_file_close(file);
+    storage_file_free(file);
+    return ok;
+}
+
+// RX worker or timer thread, each line queues the wait for the next one, so
+// none is missed between them
+static void esp_caps_list_line(const EspResponseResult* result, void* context) {
+    EspCaps* caps = context;
+    bool expired = furi_get_tick() - caps->list_start >= ESP_CAPS_LIST_MAX_MS;
+    bool done = result->status != EspResponseOk || caps->stopping || expired;
+
+    if(result->line) {
+        char name[ESP_CAPS_NAME_MAX];
+        if(esp_caps_parse_line(result->line, name, sizeof(name)) &&
+           !esp_caps_add(&caps->found, name)) {
+            caps->truncated = true;
+        }
+    }
+    // Only a quiet ESP ends the list, anything else may have cut it short
+    if(done && result->status != EspResponseTimeout) caps->truncated = true;
+
+    if(!done) {
+        EspRequest next = {
+            .timeout_ms = ESP_CAPS_QUIET_MS,
+            .callback = esp_caps_list_line,
+            .context = caps,
+        };
+        caps->list_id = esp_response_request(caps->uart->responses, &next);
+        done = !caps->list_id;
+        if(done) caps->truncated = true;
+    }
+    if(done) {
+        caps->list_id = 0;
+        furi_semaphore_release(caps->listed);
+    }
+}
+
+static bool esp_caps_query_list(EspCaps* caps) {
+    memset(&caps->found, 0, sizeof(EspCapsCatalog));
+    caps->list_start = furi_get_tick();
+    caps->truncated = false;
+
+    EspRequest request = {
+        .command = ESP_CAPS_LIST_COMMAND,
+        .timeout_ms = ESP_CAPS_ANSWER_MS,
+        .callback = esp_caps_list_line,
+        .context = caps,
+    };
+    caps->list_id = esp_response_request(caps->uart->responses, &request);
+    if(!caps->list_id) return false;
+
+    // The chain always ends, at the latest ESP_CAPS_QUIET_MS after the last line
+    furi_semaphore_acquire(caps->listed, FuriWaitForever);
+    if(caps->truncated) {
+        FURI_LOG_W("EspCaps", "Command list incomplete after %u commands", caps->found.count);
+        return false;
+    }
+    if(!esp_caps_plausible(&caps->found)) {
+        FURI_LOG_W("EspCaps", "Command list of %u commands lacks the basics", caps->found.count);
+        return false;
+    }
+    return true;
+}
+
+static int32_t esp_caps_worker(void* context) {
+    EspCaps* caps = context;
+
+    char line[ESP_RESPONSE_LINE_MAX + 1];
+    EspRequest version_request = {
+        .command = ESP_CAPS_VERSION_COMMAND,
+        .expect = ESP_CAPS_VERSION_PATTERN,
+        .timeout_ms = ESP_CAPS_ANSWER_MS,
+    };
+    if(esp_response_wait(caps->uart->responses, &version_request, line, sizeof(line)) !=
+       EspResponseOk) {
+        FURI_LOG_W("EspCaps", "No firmware version, keeping every command");
+        return 0;
+    }
+
+    char version[ESP_CAPS_VERSION_MAX];
+    esp_caps_version_from(line, version, sizeof(version));
+
+    // Built in found, the menus only ever see a finished catalog
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    if(esp_caps_load(storage, &caps->found) && strcmp(caps->found.firmware, version) == 0 &&
+       esp_caps_plausible(&caps->found)) {
+        esp_caps_publish(caps, &caps->found);
+        FURI_LOG_I("EspCaps", "%u commands cached for %s", caps->found.count, version);
+    } else if(!caps->stopping && esp_caps_query_list(caps)) {
+        caps->found.magic = ESP_CAPS_MAGIC;
+        caps->found.format = ESP_CAPS_FORMAT;
+        strncpy(caps->found.firmware, version, ESP_CAPS_VERSION_MAX - 1);
+        esp_caps_publish(caps, &caps->found);
+        if(!esp_caps_save(storage, &caps->found)) {
+            FURI_LOG_W("EspCaps", "Failed to save %s", ESP_CAPS_FILE);
+        }
+        FURI_LOG_I("EspCaps", "%u commands listed by %s", caps->found.count, version);
+    } else {
+        FURI_LOG_W("EspCaps", "No command list from %s, keeping every command", version);
+    }
+    furi_record_close(RECORD_STORAGE);
+    return 0;
+}
+
+EspCaps* esp_caps_alloc(struct UartContext* uart) {
+    EspCaps* caps = malloc(sizeof(EspCaps));
+    if(!caps) return NULL;
+    memset(caps, 0, sizeof(EspCaps));
+    caps->uart = uart;
+
+    caps->listed = furi_semaphore_alloc(1, 0);
+    caps->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    caps->thread = furi_thread_alloc_ex("EspCaps", 2048, esp_caps_worker, caps);
+    if(!caps->listed || !caps->mutex || !caps->thread) {
+        esp_caps_free(caps);
+        return NULL;
+    }
+    return caps;
+}
+
+void esp_caps_free(EspCaps* caps) {
+    if(!caps) return;
+    if(caps->thread) {
+        caps->stopping = true;
+        uint32_t id = caps->list_id;
+        if(id) esp_response_cancel(caps->uart->responses, id);
+        if(furi_thread_get_state(caps->thread) != FuriThreadStateStopped) {
+            furi_thread_join(caps->thread);
+        }
+        furi_thread_free(caps->thread);
+    }
+    if(caps->listed) furi_semaphore_free(caps->listed);
+    if(caps->mutex) furi_mutex_free(caps->mutex);
+    free(caps);
+}
+
+void esp_caps_start(EspCaps* caps) {
+    if(!caps || furi_thread_get_state(caps->thread) != FuriThreadStateStopped) return;
+    furi_thread_start(caps->thread);
+}
+
+bool esp_caps_is_ready(EspCaps* caps) {
+    if(!caps) return false;
+    furi_mutex_acquire(caps->mutex, FuriWaitForever);
+    bool ready = caps->ready;
+    furi_mutex_release(caps->mutex);
+    return ready;
+}
+
+bool esp_caps_supports(EspCaps* caps, const char* command) {
+    if(!caps || !command) return true;
+
+    furi_mutex_acquire(caps->mutex, FuriWaitForever);
+    bool supported = !caps->ready || esp_caps_has(&caps->catalog, command, strcspn(command, " \r\n"));
+    furi_mutex_release(caps->mutex);
+    return supported;
+}
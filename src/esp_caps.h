@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * ESP capability catalog
+ *
+ * Once per app start a worker asks the ESP for its firmware version and, if
+ * the catalog on the SD card was written for another version, for its
+ * command list (the help output). Menus then only offer commands the
+ * attached build knows. Until the catalog is ready, or when the ESP did not
+ * answer, every command counts as supported, so an old or silent firmware
+ * keeps the full menus. A list that did not fit or did not end in time, or
+ * that is short of ESP_CAPS_MIN_COMMANDS or of the basic scan and attack
+ * commands, is neither used nor cached; hiding a command the ESP has is
+ * worse than offering one it lacks.
+ */
+
+#define ESP_CAPS_FILE            GHOST_ESP_APP_FOLDER "/esp_caps.bin"
+#define ESP_CAPS_VERSION_COMMAND "chipinfo\n"
+#define ESP_CAPS_VERSION_PATTERN "*ersion*"
+#define ESP_CAPS_LIST_COMMAND    "help\n"
+#define ESP_CAPS_ANSWER_MS       1000 // First line of an answer
+#define ESP_CAPS_QUIET_MS        300 // The help output ended
+#define ESP_CAPS_LIST_MAX_MS     8000 // A list still running then is incomplete
+#define ESP_CAPS_MAX_COMMANDS    128 // A list that does not fit is not used
+#define ESP_CAPS_MIN_COMMANDS    8 // Neither is a shorter one
+#define ESP_CAPS_NAME_MAX        16
+#define ESP_CAPS_VERSION_MAX     32
+
+struct UartContext;
+typedef struct EspCaps EspCaps;
+
+EspCaps* esp_caps_alloc(struct UartContext* uart);
+
+/**
+ * @brief Stop a discovery still running and free, before the TX queue and the response tracker
+ */
+void esp_caps_free(EspCaps* caps);
+
+/**
+ * @brief Start the discovery worker, once the rx path is feeding responses
+ */
+void esp_caps_start(EspCaps* caps);
+
+bool esp_caps_is_ready(EspCaps* caps);
+
+/**
+ * @brief Whether the ESP knows the first word of command, true while unknown
+ */
+bool esp_caps_supports(EspCaps* caps, const char* command);
+
+/**
+ * @brief Command name from a line of help output, e.g. "scanap" or "Usage: scanap [-x]"
+ * @return false if the line names no command
+ */
+bool esp_caps_parse_line(const char* line, char* name, size_t name_size);
@@ -0,0 +1,214 @@
+#include "esp_health.h"
+#include "uart_utils.h"
+#include "app_state.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ESP_HEALTH_LOG_VIEW 5 // Text box
+
+struct EspHealth {
+    UartContext* uart;
+    FuriMutex* mutex;
+    FuriTimer* timer;
+
+    EspHealthState state;
+    bool heard; // Any byte since the start
+    uint32_t last_rx_tick;
+    uint32_t change_tick;
+    uint32_t heartbeat_id; // In flight, cleared by its callback
+    uint32_t heartbeat_tick;
+    uint32_t probe_event; // Posted once the heartbeat in flight settles, 0 for none
+    FuriSemaphore* settled; // Released by the heartbeat callback while freeing
+    bool freeing;
+    uint8_t misses;
+    uint32_t heartbeats;
+    uint32_t missed;
+};
+
+// Caller holds the mutex
+static void esp_health_set_state(EspHealth* health, EspHealthState state) {
+    if(health->state == state) return;
+    health->state = state;
+    health->change_tick = furi_get_tick();
+    FURI_LOG_I(
+        "EspHealth",
+        "ESP %s",
+        state == EspHealthConnected ? "connected" :
+        state == EspHealthDisconnected ? "disconnected" : "unknown");
+}
+
+static void esp_health_post_probe(EspHealth* health, uint32_t event) {
+    if(event && health->uart->state) {
+        view_dispatcher_send_custom_event(health->uart->state->view_dispatcher, event);
+    }
+}
+
+// RX worker or timer thread
+static void esp_health_heartbeat_done(const EspResponseResult* result, void* context) {
+    EspHealth* health = context;
+    furi_mutex_acquire(health->mutex, FuriWaitForever);
+    if(result->status == EspResponseTimeout) {
+        health->missed++;
+        // A probe asked for an answer now, one miss is enough
+        if(++health->misses >= ESP_HEALTH_MISSES || health->probe_event) {
+            esp_health_set_state(health, EspHealthDisconnected);
+        }
+    }
+    // An answer already counted as rx
+    health->heartbeat_id = 0;
+    bool freeing = health->freeing;
+    uint32_t event = health->probe_event;
+    health->probe_event = 0;
+    furi_mutex_release(health->mutex);
+
+    if(freeing) {
+        // Last touch of health, esp_health_free may go ahead from here
+        furi_semaphore_release(health->settled);
+    } else {
+        esp_health_post_probe(health, event);
+    }
+}
+
+static void esp_health_send_heartbeat(EspHealth* health) {
+    EspRequest heartbeat = {
+        .command = ESP_HEALTH_HEARTBEAT,
+        .timeout_ms = ESP_HEALTH_HEARTBEAT_MS,
+        .callback = esp_health_heartbeat_done,
+        .context = health,
+    };
+    // Marked in flight first, the answer may arrive before the request returns
+    furi_mutex_acquire(health->mutex, FuriWaitForever);
+    health->heartbeat_id = UINT32_MAX;
+    health->heartbeat_tick = furi_get_tick();
+    health->heartbeats++;
+    furi_mutex_release(health->mutex);
+
+    uint32_t id = esp_response_request(health->uart->responses, &heartbeat);
+
+    uint32_t event = 0;
+    furi_mutex_acquire(health->mutex, FuriWaitForever);
+    if(!id) {
+        // Never sent, a waiting probe learns the state as it is
+        health->heartbeat_id = 0;
+        event = health->probe_event;
+        health->probe_event = 0;
+    } else if(health->heartbeat_id) {
+        health->heartbeat_id = id;
+    }
+    furi_mutex_release(health->mutex);
+    esp_health_post_probe(health, event);
+}
+
+// Timer thread
+static void esp_health_poll(void* context) {
+    EspHealth* health = context;
+    UartContext* uart = health->uart;
+
+    furi_mutex_acquire(health->mutex, FuriWaitForever);
+    uint32_t now = furi_get_tick();
+    bool idle = !health->heard || now - health->last_rx_tick >= ESP_HEALTH_IDLE_MS;
+    // Same spacing while disconnected, a missing ESP is not polled every second
+    bool due = idle && !health->heartbeat_id &&
+               (!health->heartbeats || now - health->heartbeat_tick >= ESP_HEALTH_IDLE_MS);
+    furi_mutex_release(health->mutex);
+
+    if(!due || (uart->state && uart->state->current_view == ESP_HEALTH_LOG_VIEW)) return;
+    if(stop_all_is_pending(uart->stop_all)) return;
+
+    esp_health_send_heartbeat(health);
+}
+
+EspHealth* esp_health_alloc(struct UartContext* uart) {
+    EspHealth* health = malloc(sizeof(EspHealth));
+    if(!health) return NULL;
+    memset(health, 0, sizeof(EspHealth));
+    health->uart = uart;
+    health->state = EspHealthUnknown;
+    health->change_tick = furi_get_tick();
+
+    health->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    health->settled = furi_semaphore_alloc(1, 0);
+    health->timer = furi_timer_alloc(esp_health_poll, FuriTimerTypePeriodic, health);
+    if(!health->mutex || !health->settled || !health->timer) {
+        esp_health_free(health);
+        return NULL;
+    }
+    furi_timer_start(health->timer, furi_ms_to_ticks(ESP_HEALTH_POLL_MS));
+    return health;
+}
+
+void esp_health_free(EspHealth* health) {
+    if(!health) return;
+    if(health->timer) {
+        furi_timer_stop(health->timer);
+        furi_timer_free(health->timer);
+    }
+    if(health->mutex && health->settled) {
+        furi_mutex_acquire(health->mutex, FuriWaitForever);
+        health->freeing = true;
+        uint32_t id = health->heartbeat_id;
+        furi_mutex_release(health->mutex);
+
+        // Cancelling runs the callback unless a timeout or answer is delivering it right now
+        if(id) {
+            esp_response_cancel(health->uart->responses, id);
+            if(furi_semaphore_acquire(health->settled, furi_ms_to_ticks(ESP_HEALTH_HEARTBEAT_MS)) !=
+               FuriStatusOk) {
+                // Its callback still needs the memory, leaking it is the safe way out
+                FURI_LOG_E("EspHealth", "Heartbeat %lu never settled", id);
+                return;
+            }
+        }
+    }
+    if(health->mutex) furi_mutex_free(health->mutex);
+    if(health->settled) furi_semaphore_free(health->settled);
+    free(health);
+}
+
+void esp_health_on_rx(EspHealth* health) {
+    if(!health) return;
+    furi_mutex_acquire(health->mutex, FuriWaitForever);
+    health->heard = true;
+    health->last_rx_tick = furi_get_tick();
+    health->misses = 0;
+    esp_health_set_state(health, EspHealthConnected);
+    furi_mutex_release(health->mutex);
+}
+
+void esp_health_get_status(EspHealth* health, EspHealthStatus* status) {
+    if(!health || !status) return;
+    uint32_t now = furi_get_tick();
+    furi_mutex_acquire(health->mutex, FuriWaitForever);
+    status->state = health->state;
+    status->since_rx_ms = health->heard ? now - health->last_rx_tick : UINT32_MAX;
+    status->since_change_ms = now - health->change_tick;
+    status->heartbeats = health->heartbeats;
+    status->missed = health->missed;
+    furi_mutex_release(health->mutex);
+}
+
+bool esp_health_is_connected(EspHealth* health) {
+    if(!health) return false;
+    if(health->uart->state && health->uart->state->settings.disable_esp_check_index) return true;
+
+    furi_mutex_acquire(health->mutex, FuriWaitForever);
+    bool connected = health->state == EspHealthConnected;
+    furi_mutex_release(health->mutex);
+    return connected;
+}
+
+bool esp_health_check(EspHealth* health, uint32_t event) {
+    if(!health) return false;
+    if(esp_health_is_connected(health)) return true;
+
+    // Unknown or gone quiet, ask now; an answer marks it connected again
+    furi_mutex_acquire(health->mutex, FuriWaitForever);
+    FURI_LOG_D("EspHealth", "Probing, state %d", health->state);
+    health->probe_event = event;
+    bool in_flight = health->heartbeat_id != 0;
+    furi_mutex_release(health->mutex);
+
+    if(!in_flight) esp_health_send_heartbeat(health);
+    return false;
+}
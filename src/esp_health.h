@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * ESP link health
+ *
+ * Every byte from the ESP, log text or capture data, marks the link alive,
+ * so launching a command while the ESP is talking costs nothing. Only after
+ * ESP_HEALTH_IDLE_MS of silence does the monitor send a heartbeat (a command
+ * the ESP answers with one line and no side effects); ESP_HEALTH_MISSES
+ * unanswered heartbeats in a row mark it disconnected. Heartbeats wait while
+ * the log view is open so they never show up in it.
+ *
+ * Commands only probe the ESP themselves while the state is not known to be
+ * connected, see esp_health_check. The probe is a heartbeat sent right away,
+ * its result comes back as a custom event so the GUI never waits on it.
+ */
+
+#define ESP_HEALTH_POLL_MS       1000
+#define ESP_HEALTH_IDLE_MS       5000
+#define ESP_HEALTH_HEARTBEAT_MS  500 // Answer timeout
+#define ESP_HEALTH_MISSES        2
+#define ESP_HEALTH_HEARTBEAT     "AT\r\n"
+
+struct UartContext;
+typedef struct EspHealth EspHealth;
+
+typedef enum {
+    EspHealthUnknown, // Nothing heard since the app started
+    EspHealthConnected,
+    EspHealthDisconnected,
+} EspHealthState;
+
+typedef struct {
+    EspHealthState state;
+    uint32_t since_rx_ms; // Since the last byte, UINT32_MAX if none yet
+    uint32_t since_change_ms; // Time in the current state
+    uint32_t heartbeats;
+    uint32_t missed;
+} EspHealthStatus;
+
+EspHealth* esp_health_alloc(struct UartContext* uart);
+
+/**
+ * @brief Free before the TX queue and the response tracker, cancels a heartbeat in flight
+ *        and waits up to ESP_HEALTH_HEARTBEAT_MS for its callback
+ */
+void esp_health_free(EspHealth* health);
+
+/**
+ * @brief RX worker: bytes arrived from the ESP
+ */
+void esp_health_on_rx(EspHealth* health);
+
+void esp_health_get_status(EspHealth* health, EspHealthStatus* status);
+
+/**
+ * @brief Connected, or the ESP check is disabled in the settings
+ */
+bool esp_health_is_connected(EspHealth* health);
+
+/**
+ * @brief Before launching a command: true while the ESP is known to be connected. Otherwise
+ *        it is probed and event is posted once the answer came or timed out, the handler
+ *        then asks esp_health_is_connected
+ * @return false if the caller has to wait for event
+ */
+bool esp_health_check(EspHealth* health, uint32_t event);
@@ -0,0 +1,359 @@
+#include "esp_response.h"
+#include "uart_utils.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ESP_RESPONSE_TX_PENDING UINT32_MAX // uart_send_ex has not returned yet
+
+typedef struct {
+    bool used;
+    bool has_command;
+    uint32_t id;
+    uint32_t tx_id; // Identifies this request's TX completion
+    uint32_t sent_tx_id;
+    uint32_t sent_tick;
+    uint32_t timeout_ms;
+    char expect[ESP_RESPONSE_PATTERN_MAX];
+    char error[ESP_RESPONSE_PATTERN_MAX];
+    EspResponseCallback callback;
+    void* context;
+} EspResponseSlot;
+
+struct EspResponse {
+    UartContext* uart;
+    FuriMutex* mutex;
+    FuriTimer* timer;
+    bool timer_running; // Only while a request is in flight
+    uint32_t next_id;
+    EspResponseSlot slots[ESP_RESPONSE_SLOTS];
+
+    // TX completions that arrived before uart_send_ex returned their id
+    uint32_t early_tx_id[ESP_RESPONSE_SLOTS];
+    uint32_t early_tick[ESP_RESPONSE_SLOTS];
+    size_t early_next;
+
+    // RX worker only
+    char line[ESP_RESPONSE_LINE_MAX + 1];
+    size_t line_len;
+    bool line_taken; // The start of the line already answered a request
+};
+
+typedef struct {
+    FuriSemaphore* done;
+    EspResponseStatus status;
+    char* line;
+    size_t line_size;
+} EspResponseWait;
+
+bool esp_response_glob(const char* pattern, const char* text) {
+    const char* star = NULL;
+    const char* resume = NULL;
+    while(*text) {
+        if(*pattern == '*') {
+            star = pattern++;
+            resume = text;
+        } else if(*pattern == '?' || *pattern == *text) {
+            pattern++;
+            text++;
+        } else if(star) {
+            pattern = star + 1;
+            text = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while(*pattern == '*') pattern++;
+    return !*pattern;
+}
+
+static bool esp_response_sent(const EspResponseSlot* slot) {
+    return !slot->has_command || slot->sent_tx_id == slot->tx_id;
+}
+
+// Oldest first, ids only wrap after billions of requests
+static bool esp_response_older(const EspResponseSlot* a, const EspResponseSlot* b) {
+    return !b || (int32_t)(a->id - b->id) < 0;
+}
+
+static void esp_response_deliver(
+    EspResponseSlot* slot,
+    EspResponseStatus status,
+    const char* line,
+    uint32_t now) {
+    EspResponseResult result = {
+        .id = slot->id,
+        .status = status,
+        .line = line,
+        .elapsed_ms = esp_response_sent(slot) ? now - slot->sent_tick : 0,
+    };
+    if(slot->callback) slot->callback(&result, slot->context);
+}
+
+// Matched by TX id, a late completion of a slot's previous request finds nothing
+static void esp_response_tx_done(const UartTxResult* result, void* context) {
+    EspResponse* responses = context;
+    uint32_t now = furi_get_tick();
+
+    furi_mutex_acquire(responses->mutex, FuriWaitForever);
+    EspResponseSlot* slot = NULL;
+    for(size_t i = 0; i < ESP_RESPONSE_SLOTS && !slot; i++) {
+        EspResponseSlot* candidate = &responses->slots[i];
+        if(candidate->used && candidate->has_command && candidate->tx_id == result->id) {
+            slot = candidate;
+        }
+    }
+    if(slot) {
+        slot->sent_tick = now;
+        slot->sent_tx_id = result->id;
+    } else {
+        responses->early_tx_id[responses->early_next] = result->id;
+        responses->early_tick[responses->early_next] = now;
+        responses->early_next = (responses->early_next + 1) % ESP_RESPONSE_SLOTS;
+    }
+    furi_mutex_release(responses->mutex);
+}
+
+// Called with the mutex held, the poll stops the timer once nothing is in flight
+static void esp_response_timer_update(EspResponse* responses) {
+    bool busy = false;
+    for(size_t i = 0; i < ESP_RESPONSE_SLOTS && !busy; i++) {
+        busy = responses->slots[i].used;
+    }
+    if(busy == responses->timer_running) return;
+
+    responses->timer_running = busy;
+    if(busy) {
+        furi_timer_start(responses->timer, furi_ms_to_ticks(ESP_RESPONSE_POLL_MS));
+    } else {
+        furi_timer_stop(responses->timer);
+    }
+}
+
+// Timer thread
+static void esp_response_poll(void* context) {
+    EspResponse* responses = context;
+    EspResponseSlot expired[ESP_RESPONSE_SLOTS];
+    size_t count = 0;
+    uint32_t now = furi_get_tick();
+
+    furi_mutex_acquire(responses->mutex, FuriWaitForever);
+    for(size_t i = 0; i < ESP_RESPONSE_SLOTS; i++) {
+        EspResponseSlot* slot = &responses->slots[i];
+        if(!slot->used || !esp_response_sent(slot)) continue;
+        if(now - slot->sent_tick < slot->timeout_ms) continue;
+        expired[count++] = *slot;
+        slot->used = false;
+    }
+    esp_response_timer_update(responses);
+    furi_mutex_release(responses->mutex);
+
+    for(size_t i = 0; i < count; i++) {
+        FURI_LOG_D("EspResponse", "Request %lu timed out", expired[i].id);
+        esp_response_deliver(&expired[i], EspResponseTimeout, NULL, now);
+    }
+}
+
+EspResponse* esp_response_alloc(struct UartContext* uart) {
+    EspResponse* responses = malloc(sizeof(EspResponse));
+    if(!responses) return NULL;
+    memset(responses, 0, sizeof(EspResponse));
+    responses->uart = uart;
+
+    responses->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    responses->timer = furi_timer_alloc(esp_response_poll, FuriTimerTypePeriodic, responses);
+    if(!responses->mutex || !responses->timer) {
+        esp_response_free(responses);
+        return NULL;
+    }
+    return responses;
+}
+
+void esp_response_free(EspResponse* responses) {
+    if(!responses) return;
+    if(responses->timer) {
+        furi_timer_stop(responses->timer);
+        furi_timer_free(responses->timer);
+    }
+    if(responses->mutex) {
+        uint32_t now = furi_get_tick();
+        for(size_t i = 0; i < ESP_RESPONSE_SLOTS; i++) {
+            if(!responses->slots[i].used) continue;
+            responses->slots[i].used = false;
+            esp_response_deliver(&responses->slots[i], EspResponseCancelled, NULL, now);
+        }
+        furi_mutex_free(responses->mutex);
+    }
+    free(responses);
+}
+
+uint32_t esp_response_request(EspResponse* responses, const EspRequest* request) {
+    if(!responses || !request) return 0;
+
+    bool has_command = request->command != NULL;
+    furi_mutex_acquire(responses->mutex, FuriWaitForever);
+    EspResponseSlot* slot = NULL;
+    for(size_t i = 0; i < ESP_RESPONSE_SLOTS && !slot; i++) {
+        if(!responses->slots[i].used) slot = &responses->slots[i];
+    }
+    if(!slot) {
+        furi_mutex_release(responses->mutex);
+        FURI_LOG_W("EspResponse", "All %d slots in flight", ESP_RESPONSE_SLOTS);
+        return 0;
+    }
+
+    memset(slot, 0, sizeof(EspResponseSlot));
+    slot->used = true;
+    slot->id = ++responses->next_id;
+    if(!slot->id) slot->id = ++responses->next_id;
+    slot->has_command = has_command;
+    slot->tx_id = ESP_RESPONSE_TX_PENDING;
+    slot->sent_tick = furi_get_tick();
+    slot->timeout_ms = request->timeout_ms;
+    if(request->expect) strncpy(slot->expect, request->expect, sizeof(slot->expect) - 1);
+    if(request->error) strncpy(slot->error, request->error, sizeof(slot->error) - 1);
+    slot->callback = request->callback;
+    slot->context = request->context;
+    uint32_t id = slot->id;
+    esp_response_timer_update(responses);
+    furi_mutex_release(responses->mutex);
+
+    // The slot may already be answered and reused from here on
+    if(!has_command) return id;
+
+    // Not under the mutex, the TX thread may be waiting on it
+    uint32_t tx_id = uart_send_ex(
+        responses->uart,
+        (const uint8_t*)request->command,
+        strlen(request->command),
+        UartTxPriorityNormal,
+        esp_response_tx_done,
+        responses);
+
+    furi_mutex_acquire(responses->mutex, FuriWaitForever);
+    bool dropped = !tx_id && slot->used && slot->id == id;
+    if(dropped) {
+        slot->used = false;
+    } else if(slot->used && slot->id == id) {
+        slot->tx_id = tx_id;
+        for(size_t i = 0; i < ESP_RESPONSE_SLOTS; i++) {
+            if(responses->early_tx_id[i] != tx_id) continue;
+            slot->sent_tick = responses->early_tick[i];
+            slot->sent_tx_id = tx_id;
+            responses->early_tx_id[i] = 0;
+        }
+    }
+    furi_mutex_release(responses->mutex);
+    return dropped ? 0 : id;
+}
+
+static void esp_response_wait_done(const EspResponseResult* result, void* context) {
+    EspResponseWait* wait = context;
+    wait->status = result->status;
+    if(wait->line && wait->line_size) {
+        strncpy(wait->line, result->line ? result->line : "", wait->line_size - 1);
+        wait->line[wait->line_size - 1] = '\0';
+    }
+    furi_semaphore_release(wait->done);
+}
+
+EspResponseStatus esp_response_wait(
+    EspResponse* responses,
+    const EspRequest* request,
+    char* line,
+    size_t line_size) {
+    if(!responses || !request) return EspResponseCancelled;
+
+    EspResponseWait wait = {
+        .done = furi_semaphore_alloc(1, 0),
+        .status = EspResponseCancelled,
+        .line = line,
+        .line_size = line_size,
+    };
+    if(!wait.done) return EspResponseCancelled;
+
+    EspRequest blocking = *request;
+    blocking.callback = esp_response_wait_done;
+    blocking.context = &wait;
+    // Every accepted request ends in exactly one callback
+    if(esp_response_request(responses, &blocking)) {
+        furi_semaphore_acquire(wait.done, FuriWaitForever);
+    }
+    furi_semaphore_free(wait.done);
+    return wait.status;
+}
+
+void esp_response_cancel(EspResponse* responses, uint32_t id) {
+    if(!responses || !id) return;
+
+    EspResponseSlot cancelled;
+    bool found = false;
+    furi_mutex_acquire(responses->mutex, FuriWaitForever);
+    for(size_t i = 0; i < ESP_RESPONSE_SLOTS && !found; i++) {
+        EspResponseSlot* slot = &responses->slots[i];
+        if(!slot->used || slot->id != id) continue;
+        cancelled = *slot;
+        slot->used = false;
+        found = true;
+    }
+    furi_mutex_release(responses->mutex);
+
+    if(found) esp_response_deliver(&cancelled, EspResponseCancelled, NULL, furi_get_tick());
+}
+
+// Partial lines only answer requests with an explicit pattern, e.g. a prompt
+static bool esp_response_match(EspResponse* responses, bool complete) {
+    const char* line = responses->line;
+    EspResponseSlot* best = NULL;
+    EspResponseStatus status = EspResponseOk;
+
+    furi_mutex_acquire(responses->mutex, FuriWaitForever);
+    for(size_t i = 0; i < ESP_RESPONSE_SLOTS; i++) {
+        EspResponseSlot* slot = &responses->slots[i];
+        if(!slot->used || !esp_response_sent(slot) || !esp_response_older(slot, best)) continue;
+        if(slot->error[0] && esp_response_glob(slot->error, line)) {
+            best = slot;
+            status = EspResponseError;
+        } else if(slot->expect[0] ? esp_response_glob(slot->expect, line) : complete) {
+            best = slot;
+            status = EspResponseOk;
+        }
+    }
+    EspResponseSlot matched;
+    if(best) {
+        matched = *best;
+        best->used = false;
+    }
+    furi_mutex_release(responses->mutex);
+
+    if(!best) return false;
+    esp_response_deliver(&matched, status, line, furi_get_tick());
+    return true;
+}
+
+void esp_response_feed(EspResponse* responses, const uint8_t* data, size_t len) {
+    if(!responses || !data) return;
+
+    for(size_t i = 0; i < len; i++) {
+        char c = (char)data[i];
+        if(c == '\r') continue;
+        if(c != '\n') {
+            if(responses->line_len < ESP_RESPONSE_LINE_MAX) {
+                responses->line[responses->line_len++] = c;
+            }
+            continue;
+        }
+
+        responses->line[responses->line_len] = '\0';
+        if(responses->line_len && !responses->line_taken) {
+            esp_response_match(responses, true);
+        }
+        responses->line_len = 0;
+        responses->line_taken = false;
+    }
+
+    if(responses->line_len && !responses->line_taken) {
+        responses->line[responses->line_len] = '\0';
+        responses->line_taken = esp_response_match(responses, false);
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * ESP command responses
+ *
+ * Tracks commands waiting for an answer and matches every line the ESP
+ * prints against them, so callers get a result instead of sleeping and
+ * peeking at the log. A request carries a pattern for the expected line and
+ * optionally one for a failure line ('*' matches any run of characters, '?'
+ * a single one, the whole line has to match). Its deadline only starts once
+ * the command actually left the TX queue, and lines printed before that are
+ * never taken as its answer. A line completes the oldest request it matches,
+ * so several commands can be in flight at once.
+ *
+ * Results are delivered on the RX worker (matches) or the timer thread
+ * (timeouts); callbacks should be short and may queue the next command.
+ */
+
+#define ESP_RESPONSE_SLOTS       8
+#define ESP_RESPONSE_LINE_MAX    128 // Longer lines are matched on their start
+#define ESP_RESPONSE_PATTERN_MAX 48
+#define ESP_RESPONSE_POLL_MS     50 // Timeout checks, only while a request is in flight
+
+struct UartContext;
+typedef struct EspResponse EspResponse;
+
+typedef enum {
+    EspResponseOk, // A line matched expect
+    EspResponseError, // A line matched error
+    EspResponseTimeout,
+    EspResponseCancelled, // Cancelled, or the tracker was freed
+} EspResponseStatus;
+
+typedef struct {
+    uint32_t id;
+    EspResponseStatus status;
+    const char* line; // Matching line without its line ending, NULL without one
+    uint32_t elapsed_ms; // Since the command was sent
+} EspResponseResult;
+
+typedef void (*EspResponseCallback)(const EspResponseResult* result, void* context);
+
+typedef struct {
+    const char* command; // Sent through the TX queue, NULL to only wait for a line
+    const char* expect; // NULL takes any line
+    const char* error; // Optional
+    uint32_t timeout_ms;
+    EspResponseCallback callback;
+    void* context;
+} EspRequest;
+
+EspResponse* esp_response_alloc(struct UartContext* uart);
+
+/**
+ * @brief Cancel everything in flight and free, after the TX queue is gone
+ */
+void esp_response_free(EspResponse* responses);
+
+/**
+ * @brief Send a command and track its answer, the patterns are copied
+ * @return Request id, 0 if every slot is taken or the command was dropped
+ */
+uint32_t esp_response_request(EspResponse* responses, const EspRequest* request);
+
+/**
+ * @brief Blocking request for worker threads, request->callback is ignored
+ * @param line Optional, receives the matching line
+ */
+EspResponseStatus esp_response_wait(
+    EspResponse* responses,
+    const EspRequest* request,
+    char* line,
+    size_t line_size);
+
+/**
+ * @brief Finish a request as cancelled, its callback still runs
+ */
+void esp_response_cancel(EspResponse* responses, uint32_t id);
+
+/**
+ * @brief RX worker: text printed by the ESP
+ */
+void esp_response_feed(EspResponse* responses, const uint8_t* data, size_t len);
+
+/**
+ * @brief Whole-string match, '*' any run of characters, '?' one character
+ */
+bool esp_response_glob(const char* pattern, const char* text);
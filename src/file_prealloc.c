@@ -0,0 +1,143 @@
+#include "file_prealloc.h"
+#include <furi.h>
+#include <furi_hal.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Extend once less than this fraction of an extent is left ahead of the pointer
+#define FILE_PREALLOC_LOW_WATER_DIV 8
+
+static const uint32_t file_prealloc_extents[] = {0, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+
+struct FilePrealloc {
+    File* file;
+    uint32_t extent;
+    uint64_t alloc_end; // File size reserved so far
+    bool active;
+    FilePreallocStats stats;
+};
+
+static inline uint32_t file_prealloc_cycles(void) {
+    return furi_hal_cortex_timer_get(0).start;
+}
+
+FilePrealloc* file_prealloc_alloc(void) {
+    FilePrealloc* prealloc = malloc(sizeof(FilePrealloc));
+    if(!prealloc) return NULL;
+    memset(prealloc, 0, sizeof(FilePrealloc));
+    return prealloc;
+}
+
+void file_prealloc_free(FilePrealloc* prealloc) {
+    if(!prealloc) return;
+    free(prealloc);
+}
+
+void file_prealloc_begin(FilePrealloc* prealloc, File* file, uint32_t extent) {
+    if(!prealloc) return;
+    memset(&prealloc->stats, 0, sizeof(FilePreallocStats));
+    prealloc->file = file;
+    prealloc->extent = extent;
+    prealloc->alloc_end = 0;
+    prealloc->active = file != NULL;
+}
+
+bool file_prealloc_reserve(FilePrealloc* prealloc, size_t len) {
+    if(!prealloc || !prealloc->active || !prealloc->extent) return true;
+
+    uint64_t pos = storage_file_tell(prealloc->file);
+    uint64_t low_water = prealloc->extent / FILE_PREALLOC_LOW_WATER_DIV;
+    if(pos + len + low_water <= prealloc->alloc_end) return true;
+
+    uint64_t target = prealloc->alloc_end + prealloc->extent;
+    while(target < pos + len + low_water) {
+        target += prealloc->extent;
+    }
+
+    // An empty file can get one contiguous run, later extents just grow the chain early
+    bool reserved = false;
+    if(prealloc->alloc_end == 0 && pos == 0) {
+        reserved = storage_file_expand(prealloc->file, target) &&
+                   storage_file_size(prealloc->file) >= target;
+    }
+    if(!reserved) {
+        reserved = storage_file_seek(prealloc->file, target, true) &&
+                   storage_file_tell(prealloc->file) == target;
+        if(!storage_file_seek(prealloc->file, pos, true)) {
+            FURI_LOG_E("Prealloc", "Lost write position, preallocation disabled");
+            prealloc->extent = 0;
+            return false;
+        }
+    }
+
+    if(!reserved) {
+        // Most likely out of space, keep writing without reserving
+        FURI_LOG_W("Prealloc", "Could not reserve %lu bytes, preallocation disabled", (uint32_t)target);
+        prealloc->alloc_end = storage_file_size(prealloc->file);
+        prealloc->extent = 0;
+        return false;
+    }
+
+    prealloc->alloc_end = target;
+    prealloc->stats.extents++;
+    FURI_LOG_D("Prealloc", "Reserved up to %lu bytes", (uint32_t)target);
+    return true;
+}
+
+void file_prealloc_note_write(FilePrealloc* prealloc, size_t len, uint32_t us) {
+    if(!prealloc || !prealloc->active) return;
+    prealloc->stats.writes++;
+    prealloc->stats.bytes += len;
+    prealloc->stats.total_us += us;
+    if(us > prealloc->stats.max_us) prealloc->stats.max_us = us;
+}
+
+size_t file_prealloc_write(FilePrealloc* prealloc, const void* data, size_t len) {
+    if(!prealloc || !prealloc->active) return 0;
+
+    file_prealloc_reserve(prealloc, len);
+    uint32_t start = file_prealloc_cycles();
+    size_t written = storage_file_write(prealloc->file, data, len);
+    uint32_t us = (file_prealloc_cycles() - start) / furi_hal_cortex_instructions_per_microsecond();
+    file_prealloc_note_write(prealloc, written, us);
+    return written;
+}
+
+void file_prealloc_finish(FilePrealloc* prealloc) {
+    if(!prealloc || !prealloc->active) return;
+
+    if(prealloc->alloc_end) {
+        uint64_t pos = storage_file_tell(prealloc->file);
+        if(storage_file_size(prealloc->file) > pos && !storage_file_truncate(prealloc->file)) {
+            FURI_LOG_E("Prealloc", "Failed to trim reserved tail at %lu", (uint32_t)pos);
+        }
+    }
+
+    if(prealloc->stats.writes) {
+        FURI_LOG_I(
+            "Prealloc",
+            "%lu writes, %lu KB, %lu extents, latency avg %lu us max %lu us",
+            prealloc->stats.writes,
+            (uint32_t)(prealloc->stats.bytes / 1024),
+            prealloc->stats.extents,
+            (uint32_t)(prealloc->stats.total_us / prealloc->stats.writes),
+            prealloc->stats.max_us);
+    }
+
+    prealloc->active = false;
+    prealloc->file = NULL;
+}
+
+bool file_prealloc_is_active(const FilePrealloc* prealloc) {
+    return prealloc && prealloc->active;
+}
+
+void file_prealloc_get_stats(const FilePrealloc* prealloc, FilePreallocStats* stats) {
+    if(!prealloc || !stats) return;
+    *stats = prealloc->stats;
+}
+
+uint32_t file_prealloc_extent_for_index(uint8_t index) {
+    if(index >= COUNT_OF(file_prealloc_extents)) return 0;
+    return file_prealloc_extents[index];
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <storage/storage.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * File preallocation
+ *
+ * Reserves clusters for a file being written in large extents ahead of the
+ * write pointer so FAT does not have to grow the chain cluster by cluster in
+ * the middle of a capture. The first extent is requested contiguous
+ * (storage_file_expand), later ones by seeking past EOF. The unused tail is
+ * trimmed when the file is finished.
+ *
+ * Write latency is tracked for every write that goes through
+ * file_prealloc_write so the effect can be seen in the log.
+ */
+
+typedef struct FilePrealloc FilePrealloc;
+
+typedef struct {
+    uint32_t writes;
+    uint32_t extents;
+    uint64_t bytes;
+    uint64_t total_us;
+    uint32_t max_us;
+} FilePreallocStats;
+
+FilePrealloc* file_prealloc_alloc(void);
+void file_prealloc_free(FilePrealloc* prealloc);
+
+/**
+ * @brief Attach an empty, freshly opened file
+ * @param extent bytes reserved at a time, 0 only records write latency
+ */
+void file_prealloc_begin(FilePrealloc* prealloc, File* file, uint32_t extent);
+
+/**
+ * @brief Make sure at least len bytes past the write pointer are allocated
+ */
+bool file_prealloc_reserve(FilePrealloc* prealloc, size_t len);
+
+/**
+ * @brief Reserve and write, timing the write
+ */
+size_t file_prealloc_write(FilePrealloc* prealloc, const void* data, size_t len);
+
+/**
+ * @brief Account for a write done elsewhere (e.g. by the capture stream)
+ */
+void file_prealloc_note_write(FilePrealloc* prealloc, size_t len, uint32_t us);
+
+/**
+ * @brief Trim the reserved tail at the write pointer and detach
+ */
+void file_prealloc_finish(FilePrealloc* prealloc);
+
+bool file_prealloc_is_active(const FilePrealloc* prealloc);
+void file_prealloc_get_stats(const FilePrealloc* prealloc, FilePreallocStats* stats);
+
+/**
+ * @brief Extent size for a SETTING_PREALLOCATE index, 0 when off
+ */
+uint32_t file_prealloc_extent_for_index(uint8_t index);
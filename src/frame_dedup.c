@@ -0,0 +1,225 @@
+#include "frame_dedup.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINKTYPE_IEEE802_11          105
+#define LINKTYPE_IEEE802_11_RADIOTAP 127
+
+#define RADIOTAP_PRESENT_TSFT  (1u << 0)
+#define RADIOTAP_PRESENT_FLAGS (1u << 1)
+#define RADIOTAP_PRESENT_EXT   (1u << 31)
+#define RADIOTAP_FLAG_FCS      0x10
+
+#define WLAN_SUBTYPE_PROBE_REQ  4
+#define WLAN_SUBTYPE_PROBE_RESP 5
+#define WLAN_SUBTYPE_BEACON     8
+#define WLAN_HEADER_LEN         24
+#define WLAN_FIXED_PARAMS_LEN   12 // Timestamp, interval, capabilities
+
+#define FNV_OFFSET 0x811C9DC5
+#define FNV_PRIME  0x01000193
+
+typedef struct {
+    uint32_t key;
+    uint32_t content;
+    uint32_t last_written;
+    uint32_t last_seen;
+    uint32_t frames;
+    uint16_t suppressed; // Dropped since the last write
+    uint8_t bssid[6];
+    uint8_t subtype;
+    bool used;
+} FrameDedupEntry;
+
+struct FrameDedup {
+    FrameDedupEntry entries[FRAME_DEDUP_SLOTS];
+    uint32_t window_s;
+    FrameDedupStats stats;
+};
+
+static const uint32_t frame_dedup_windows[] = {0, 10, 60, 300};
+
+static inline uint32_t fnv_update(uint32_t hash, const uint8_t* data, size_t len) {
+    for(size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Elements that describe the network, TIM/BSS load change on every beacon
+static bool frame_dedup_element_tracked(uint8_t id) {
+    switch(id) {
+    case 1: // Supported rates
+    case 3: // DS parameter set (channel)
+    case 48: // RSN
+    case 50: // Extended rates
+    case 221: // Vendor (WPA, WPS)
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Strip the radiotap header (and FCS if flagged), returns false if malformed
+static bool frame_dedup_strip_radiotap(const uint8_t** frame, size_t* len) {
+    const uint8_t* p = *frame;
+    if(*len < 8 || p[0] != 0) return false;
+
+    size_t it_len = p[2] | (p[3] << 8);
+    if(it_len < 8 || it_len > *len) return false;
+
+    uint32_t present = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+    size_t offset = 8;
+    uint32_t word = present;
+    while(word & RADIOTAP_PRESENT_EXT) {
+        if(offset + 4 > it_len) return false;
+        word = p[offset] | (p[offset + 1] << 8) | (p[offset + 2] << 16) |
+               ((uint32_t)p[offset + 3] << 24);
+        offset += 4;
+    }
+
+    bool fcs = false;
+    if(present & RADIOTAP_PRESENT_TSFT) offset = ((offset + 7) & ~(size_t)7) + 8;
+    if((present & RADIOTAP_PRESENT_FLAGS) && offset < it_len) {
+        fcs = p[offset] & RADIOTAP_FLAG_FCS;
+    }
+
+    *frame = p + it_len;
+    *len -= it_len;
+    if(fcs) {
+        if(*len < 4) return false;
+        *len -= 4;
+    }
+    return true;
+}
+
+FrameDedup* frame_dedup_alloc(void) {
+    FrameDedup* dedup = malloc(sizeof(FrameDedup));
+    if(!dedup) return NULL;
+    memset(dedup, 0, sizeof(FrameDedup));
+    return dedup;
+}
+
+void frame_dedup_free(FrameDedup* dedup) {
+    if(!dedup) return;
+    free(dedup);
+}
+
+void frame_dedup_reset(FrameDedup* dedup, uint32_t window_s) {
+    if(!dedup) return;
+    memset(dedup->entries, 0, sizeof(dedup->entries));
+    memset(&dedup->stats, 0, sizeof(FrameDedupStats));
+    dedup->window_s = window_s;
+}
+
+bool frame_dedup_check(
+    FrameDedup* dedup,
+    uint32_t linktype,
+    const uint8_t* frame,
+    size_t len,
+    uint32_t now_s) {
+    if(!dedup || !frame) return true;
+
+    if(linktype == LINKTYPE_IEEE802_11_RADIOTAP) {
+        if(!frame_dedup_strip_radiotap(&frame, &len)) return true;
+    } else if(linktype != LINKTYPE_IEEE802_11) {
+        return true;
+    }
+
+    if(len < WLAN_HEADER_LEN) return true;
+    uint8_t type = (frame[0] >> 2) & 0x3;
+    uint8_t subtype = frame[0] >> 4;
+    if(type != 0) return true;
+    if(subtype != WLAN_SUBTYPE_BEACON && subtype != WLAN_SUBTYPE_PROBE_RESP &&
+       subtype != WLAN_SUBTYPE_PROBE_REQ) {
+        return true;
+    }
+
+    // Probe requests go to broadcast, key them by the sender instead
+    const uint8_t* bssid = subtype == WLAN_SUBTYPE_PROBE_REQ ? frame + 10 : frame + 16;
+    size_t body = WLAN_HEADER_LEN;
+    uint32_t content = FNV_OFFSET;
+    if(subtype != WLAN_SUBTYPE_PROBE_REQ) {
+        if(len < WLAN_HEADER_LEN + WLAN_FIXED_PARAMS_LEN) return true;
+        content = fnv_update(content, frame + WLAN_HEADER_LEN + 10, 2); // Capabilities
+        body += WLAN_FIXED_PARAMS_LEN;
+    }
+
+    uint32_t key = fnv_update(FNV_OFFSET, &subtype, 1);
+    key = fnv_update(key, bssid, 6);
+    for(size_t pos = body; pos + 2 <= len;) {
+        uint8_t id = frame[pos];
+        uint8_t elen = frame[pos + 1];
+        if(pos + 2 + elen > len) break;
+        if(id == 0) {
+            key = fnv_update(key, frame + pos + 1, elen + 1); // Length keeps "" apart from hidden
+        } else if(frame_dedup_element_tracked(id)) {
+            content = fnv_update(content, frame + pos, elen + 2);
+        }
+        pos += 2 + elen;
+    }
+
+    dedup->stats.frames++;
+
+    uint32_t mask = FRAME_DEDUP_SLOTS - 1;
+    FrameDedupEntry* entry = NULL;
+    FrameDedupEntry* victim = NULL;
+    for(uint32_t i = 0; i < FRAME_DEDUP_PROBE; i++) {
+        FrameDedupEntry* slot = &dedup->entries[(key + i) & mask];
+        if(!slot->used) {
+            if(!victim || victim->used) victim = slot;
+            continue;
+        }
+        if(slot->key == key && slot->subtype == subtype && memcmp(slot->bssid, bssid, 6) == 0) {
+            entry = slot;
+            break;
+        }
+        if(!victim || (victim->used && slot->last_seen < victim->last_seen)) victim = slot;
+    }
+
+    if(!entry) {
+        // New key, take a free slot or the least recently seen one in the probe window
+        if(victim->used) {
+            dedup->stats.evictions++;
+        } else {
+            dedup->stats.keys++;
+        }
+        victim->key = key;
+        victim->content = content;
+        victim->last_written = now_s;
+        victim->last_seen = now_s;
+        victim->frames = 1;
+        victim->suppressed = 0;
+        memcpy(victim->bssid, bssid, 6);
+        victim->subtype = subtype;
+        victim->used = true;
+        dedup->stats.written++;
+        return true;
+    }
+
+    entry->frames++;
+    entry->last_seen = now_s;
+    bool expired = now_s < entry->last_written || now_s - entry->last_written >= dedup->window_s;
+    if(entry->content != content || expired) {
+        entry->content = content;
+        entry->last_written = now_s;
+        entry->suppressed = 0;
+        dedup->stats.written++;
+        return true;
+    }
+
+    if(entry->suppressed < UINT16_MAX) entry->suppressed++;
+    dedup->stats.dropped++;
+    return false;
+}
+
+void frame_dedup_get_stats(const FrameDedup* dedup, FrameDedupStats* stats) {
+    if(!dedup || !stats) return;
+    *stats = dedup->stats;
+}
+
+uint32_t frame_dedup_window_for_index(uint8_t index) {
+    if(index >= COUNT_OF(frame_dedup_windows)) return 0;
+    return frame_dedup_windows[index];
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Beacon/probe deduplication
+ *
+ * Looks at each captured 802.11 frame (raw or radiotap link type) and keys
+ * beacons, probe requests and probe responses by (transmitter/BSSID, SSID,
+ * subtype) in a fixed-size open addressing table. A frame is written when its
+ * key is new, when the interesting parts of its body (capabilities, rates,
+ * channel, security elements) changed, or when the key was last written more
+ * than the expiry window ago. Everything else is counted and dropped.
+ * Frames that are not beacons or probes are always written.
+ */
+
+#define FRAME_DEDUP_SLOTS 256 // Power of two
+#define FRAME_DEDUP_PROBE 8
+
+typedef struct FrameDedup FrameDedup;
+
+typedef struct {
+    uint32_t frames; // Beacons/probes looked at
+    uint32_t written;
+    uint32_t dropped;
+    uint32_t keys; // Occupied slots
+    uint32_t evictions;
+} FrameDedupStats;
+
+FrameDedup* frame_dedup_alloc(void);
+void frame_dedup_free(FrameDedup* dedup);
+
+/**
+ * @brief Forget all keys and counters, start a new capture
+ * @param window_s a key is written again after this many seconds
+ */
+void frame_dedup_reset(FrameDedup* dedup, uint32_t window_s);
+
+/**
+ * @brief Decide whether a captured frame should go to the file
+ * @param linktype PCAP link type of the capture
+ * @param now_s record timestamp in seconds
+ */
+bool frame_dedup_check(
+    FrameDedup* dedup,
+    uint32_t linktype,
+    const uint8_t* frame,
+    size_t len,
+    uint32_t now_s);
+
+void frame_dedup_get_stats(const FrameDedup* dedup, FrameDedupStats* stats);
+
+/**
+ * @brief Expiry window for a SETTING_CAPTURE_DEDUP index, 0 when off
+ */
+uint32_t frame_dedup_window_for_index(uint8_t index);
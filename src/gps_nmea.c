@@ -0,0 +1,365 @@
+#include "gps_nmea.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GPS_NMEA_MAX_FIELDS 20
+
+typedef enum {
+    GpsNmeaStateIdle,
+    GpsNmeaStateBody,
+    GpsNmeaStateChecksumHigh,
+    GpsNmeaStateChecksumLow,
+} GpsNmeaState;
+
+struct GpsNmea {
+    GpsNmeaState state;
+    char sentence[GPS_NMEA_SENTENCE_MAX + 1];
+    size_t len;
+    uint8_t checksum;
+    uint8_t expected;
+
+    GpsFix work; // Only touched by the writer
+    int32_t date_days; // Last RMC date, -1 until one arrived
+
+    volatile uint32_t sequence; // Odd while published is being written
+    GpsFix published;
+
+    GpsNmeaStats stats;
+};
+
+static int8_t gps_nmea_hex(uint8_t c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static bool gps_nmea_parse_uint(const char* s, uint32_t* out) {
+    if(!*s) return false;
+    uint32_t value = 0;
+    for(; *s && *s != '.'; s++) {
+        if(*s < '0' || *s > '9' || value > 100000000) return false;
+        value = value * 10 + (*s - '0');
+    }
+    *out = value;
+    return true;
+}
+
+// Decimal text to fixed point with the given number of fraction digits, extra digits are cut
+static bool gps_nmea_parse_fixed(const char* s, uint8_t digits, int64_t* out) {
+    bool negative = *s == '-';
+    if(negative) s++;
+    if(!*s) return false;
+
+    int64_t value = 0;
+    uint8_t fraction = 0;
+    bool dot = false;
+    for(; *s; s++) {
+        if(*s == '.' && !dot) {
+            dot = true;
+            continue;
+        }
+        if(*s < '0' || *s > '9' || value > INT64_MAX / 100) return false;
+        if(dot) {
+            if(fraction == digits) continue;
+            fraction++;
+        }
+        value = value * 10 + (*s - '0');
+    }
+    for(; fraction < digits; fraction++) {
+        value *= 10;
+    }
+    *out = negative ? -value : value;
+    return true;
+}
+
+// ddmm.mmmm / dddmm.mmmm plus hemisphere to 1e-7 degrees
+static bool gps_nmea_parse_coord(const char* s, const char* hemisphere, int32_t* out) {
+    int64_t value;
+    if(!gps_nmea_parse_fixed(s, 7, &value) || value < 0) return false;
+    int64_t degrees = value / 1000000000LL;
+    int64_t minutes_e7 = value % 1000000000LL;
+    if(degrees > 180 || minutes_e7 >= 600000000LL) return false;
+
+    int32_t coord = (int32_t)(degrees * 10000000LL + minutes_e7 / 60);
+    if(hemisphere[0] == 'S' || hemisphere[0] == 'W') {
+        coord = -coord;
+    } else if(hemisphere[0] != 'N' && hemisphere[0] != 'E') {
+        return false;
+    }
+    *out = coord;
+    return true;
+}
+
+// hhmmss(.sss) to seconds of the day
+static bool gps_nmea_parse_time(const char* s, uint32_t* out) {
+    uint32_t hhmmss;
+    if(strlen(s) < 6 || !gps_nmea_parse_uint(s, &hhmmss)) return false;
+    uint32_t hours = hhmmss / 10000;
+    uint32_t minutes = (hhmmss / 100) % 100;
+    uint32_t seconds = hhmmss % 100;
+    if(hours > 23 || minutes > 59 || seconds > 60) return false;
+    *out = hours * 3600 + minutes * 60 + seconds;
+    return true;
+}
+
+// ddmmyy to days since 1970-01-01
+static bool gps_nmea_parse_date(const char* s, int32_t* out) {
+    uint32_t ddmmyy;
+    if(strlen(s) != 6 || !gps_nmea_parse_uint(s, &ddmmyy)) return false;
+    int32_t day = ddmmyy / 10000;
+    int32_t month = (ddmmyy / 100) % 100;
+    int32_t year = ddmmyy % 100 < 80 ? 2000 + ddmmyy % 100 : 1900 + ddmmyy % 100;
+    if(day < 1 || day > 31 || month < 1 || month > 12) return false;
+
+    int32_t y = year - (month <= 2);
+    int32_t era = y / 400;
+    int32_t yoe = y - era * 400;
+    int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    *out = era * 146097 + doe - 719468;
+    return true;
+}
+
+static void gps_nmea_publish(GpsNmea* gps) {
+    gps->work.updated_tick = furi_get_tick();
+
+    uint32_t sequence = gps->sequence;
+    __atomic_store_n(&gps->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&gps->published, &gps->work, sizeof(GpsFix));
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&gps->sequence, sequence + 2, __ATOMIC_RELAXED);
+}
+
+// $xxRMC,time,status,lat,N/S,lon,E/W,knots,course,date,...
+static void gps_nmea_handle_rmc(GpsNmea* gps, char** fields, size_t count) {
+    if(count < 10) return;
+    GpsFix* fix = &gps->work;
+
+    fix->valid = fields[2][0] == 'A';
+    if(fix->valid) {
+        int32_t lat, lon;
+        if(gps_nmea_parse_coord(fields[3], fields[4], &lat) &&
+           gps_nmea_parse_coord(fields[5], fields[6], &lon)) {
+            fix->lat_e7 = lat;
+            fix->lon_e7 = lon;
+        }
+        int64_t value;
+        // 1 knot = 514.444 mm/s
+        if(gps_nmea_parse_fixed(fields[7], 3, &value)) {
+            fix->speed_mms = (uint32_t)(value * 514444 / 1000000);
+        }
+        if(gps_nmea_parse_fixed(fields[8], 2, &value) && value >= 0 && value < 36000) {
+            fix->course_cdeg = (uint16_t)value;
+        }
+    }
+
+    uint32_t seconds;
+    int32_t days;
+    if(gps_nmea_parse_time(fields[1], &seconds) && gps_nmea_parse_date(fields[9], &days)) {
+        gps->date_days = days;
+        fix->timestamp = (uint32_t)days * 86400 + seconds;
+    }
+    gps_nmea_publish(gps);
+}
+
+// $xxGGA,time,lat,N/S,lon,E/W,quality,satellites,hdop,altitude,M,...
+static void gps_nmea_handle_gga(GpsNmea* gps, char** fields, size_t count) {
+    if(count < 10) return;
+    GpsFix* fix = &gps->work;
+
+    uint32_t quality = 0;
+    gps_nmea_parse_uint(fields[6], &quality);
+    fix->valid = quality > 0;
+    if(fix->valid) {
+        int32_t lat, lon;
+        if(gps_nmea_parse_coord(fields[2], fields[3], &lat) &&
+           gps_nmea_parse_coord(fields[4], fields[5], &lon)) {
+            fix->lat_e7 = lat;
+            fix->lon_e7 = lon;
+        }
+        int64_t value;
+        if(gps_nmea_parse_fixed(fields[9], 1, &value) && value > INT32_MIN && value < INT32_MAX) {
+            fix->alt_dm = (int32_t)value;
+        }
+    }
+
+    uint32_t satellites;
+    if(gps_nmea_parse_uint(fields[7], &satellites)) fix->satellites = (uint8_t)MIN(satellites, 255u);
+    int64_t hdop;
+    if(gps_nmea_parse_fixed(fields[8], 2, &hdop) && hdop >= 0) {
+        fix->hdop_c = (uint16_t)MIN(hdop, (int64_t)UINT16_MAX);
+    }
+
+    // GGA has no date, it can only move the time within the last RMC's day
+    uint32_t seconds;
+    if(gps->date_days >= 0 && gps_nmea_parse_time(fields[1], &seconds)) {
+        fix->timestamp = (uint32_t)gps->date_days * 86400 + seconds;
+    }
+    gps_nmea_publish(gps);
+}
+
+// $xxGSA,mode,fix,prn x12,pdop,hdop,vdop
+static void gps_nmea_handle_gsa(GpsNmea* gps, char** fields, size_t count) {
+    if(count < 17) return;
+    GpsFix* fix = &gps->work;
+
+    uint32_t fix_type;
+    if(gps_nmea_parse_uint(fields[2], &fix_type) && fix_type <= 3) fix->fix_type = (uint8_t)fix_type;
+    int64_t hdop;
+    if(gps_nmea_parse_fixed(fields[16], 2, &hdop) && hdop >= 0) {
+        fix->hdop_c = (uint16_t)MIN(hdop, (int64_t)UINT16_MAX);
+    }
+    gps_nmea_publish(gps);
+}
+
+static void gps_nmea_handle_sentence(GpsNmea* gps) {
+    char* fields[GPS_NMEA_MAX_FIELDS];
+    size_t count = 0;
+    char* p = gps->sentence;
+    fields[count++] = p;
+    for(; *p && count < GPS_NMEA_MAX_FIELDS; p++) {
+        if(*p == ',') {
+            *p = '\0';
+            fields[count++] = p + 1;
+        }
+    }
+
+    // Any talker (GP, GN, GL, GA, BD), the type is the last three characters
+    const char* type = fields[0];
+    if(strlen(type) != 5) {
+        gps->stats.ignored++;
+        return;
+    }
+    type += 2;
+
+    if(strcmp(type, "RMC") == 0) {
+        gps_nmea_handle_rmc(gps, fields, count);
+    } else if(strcmp(type, "GGA") == 0) {
+        gps_nmea_handle_gga(gps, fields, count);
+    } else if(strcmp(type, "GSA") == 0) {
+        gps_nmea_handle_gsa(gps, fields, count);
+    } else {
+        gps->stats.ignored++;
+        return;
+    }
+    gps->stats.sentences++;
+}
+
+GpsNmea* gps_nmea_alloc(void) {
+    GpsNmea* gps = malloc(sizeof(GpsNmea));
+    if(!gps) return NULL;
+    memset(gps, 0, sizeof(GpsNmea));
+    gps->date_days = -1;
+    return gps;
+}
+
+void gps_nmea_free(GpsNmea* gps) {
+    if(!gps) return;
+    free(gps);
+}
+
+void gps_nmea_reset(GpsNmea* gps) {
+    if(!gps) return;
+    gps->state = GpsNmeaStateIdle;
+    gps->len = 0;
+    gps->date_days = -1;
+    memset(&gps->work, 0, sizeof(GpsFix));
+    memset(&gps->stats, 0, sizeof(GpsNmeaStats));
+    gps_nmea_publish(gps);
+}
+
+void gps_nmea_feed(GpsNmea* gps, const uint8_t* data, size_t len) {
+    if(!gps || !data) return;
+
+    for(size_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+        // A '$' always starts over, a sentence cut short by noise is simply lost
+        if(c == '$') {
+            gps->state = GpsNmeaStateBody;
+            gps->len = 0;
+            gps->checksum = 0;
+            continue;
+        }
+
+        switch(gps->state) {
+        case GpsNmeaStateIdle:
+            break;
+
+        case GpsNmeaStateBody:
+            if(c == '*') {
+                gps->sentence[gps->len] = '\0';
+                gps->state = GpsNmeaStateChecksumHigh;
+            } else if(c == '\r' || c == '\n') {
+                // Checksums are optional in NMEA 0183 but every module sends one
+                gps->state = GpsNmeaStateIdle;
+            } else if(gps->len == GPS_NMEA_SENTENCE_MAX) {
+                gps->stats.overflows++;
+                gps->state = GpsNmeaStateIdle;
+            } else {
+                gps->sentence[gps->len++] = (char)c;
+                gps->checksum ^= c;
+            }
+            break;
+
+        case GpsNmeaStateChecksumHigh: {
+            int8_t high = gps_nmea_hex(c);
+            if(high < 0) {
+                gps->stats.checksum_errors++;
+                gps->state = GpsNmeaStateIdle;
+            } else {
+                gps->expected = (uint8_t)(high << 4);
+                gps->state = GpsNmeaStateChecksumLow;
+            }
+            break;
+        }
+
+        case GpsNmeaStateChecksumLow: {
+            int8_t low = gps_nmea_hex(c);
+            gps->state = GpsNmeaStateIdle;
+            if(low < 0 || (gps->expected | low) != gps->checksum) {
+                gps->stats.checksum_errors++;
+            } else {
+                gps_nmea_handle_sentence(gps);
+            }
+            break;
+        }
+        }
+    }
+}
+
+uint32_t gps_nmea_get_fix(const GpsNmea* gps, GpsFix* fix) {
+    if(!gps || !fix) return 0;
+
+    for(;;) {
+        uint32_t before = __atomic_load_n(&gps->sequence, __ATOMIC_ACQUIRE);
+        if(!(before & 1)) {
+            memcpy(fix, (const void*)&gps->published, sizeof(GpsFix));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if(__atomic_load_n(&gps->sequence, __ATOMIC_RELAXED) == before) return before;
+        }
+        // The writer was preempted mid-copy, let it finish even if it has a lower priority
+        furi_delay_tick(1);
+    }
+}
+
+uint32_t gps_nmea_get_sequence(const GpsNmea* gps) {
+    return gps ? __atomic_load_n(&gps->sequence, __ATOMIC_ACQUIRE) & ~1UL : 0;
+}
+
+bool gps_nmea_fix_is_fresh(const GpsFix* fix) {
+    return fix && fix->valid && fix->updated_tick &&
+           furi_get_tick() - fix->updated_tick < furi_ms_to_ticks(GPS_NMEA_STALE_MS);
+}
+
+void gps_nmea_get_stats(const GpsNmea* gps, GpsNmeaStats* stats) {
+    if(!gps || !stats) return;
+    *stats = gps->stats;
+}
+
+uint32_t gps_nmea_baud_for_index(uint8_t index) {
+    static const uint32_t bauds[] = {0, 9600, 38400, 115200};
+    return index < COUNT_OF(bauds) ? bauds[index] : 0;
+}
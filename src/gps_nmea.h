@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * NMEA parser for a GPS module wired to the Flipper's GPS UART
+ *
+ * Bytes are fed as they arrive; sentences are assembled in a fixed buffer,
+ * checksum-verified and RMC/GGA/GSA are decoded into fixed-point values.
+ * Nothing is allocated after gps_nmea_alloc.
+ *
+ * The latest fix is published through a sequence lock: the single writer
+ * (the GPS RX thread) bumps the sequence to odd, copies the fix and bumps it
+ * to even again; readers copy the fix and retry if the sequence was odd or
+ * changed meanwhile. Readers never block the writer or each other.
+ */
+
+#define GPS_NMEA_SENTENCE_MAX 82 // Per NMEA 0183, '$' to checksum
+#define GPS_NMEA_STALE_MS     3000 // A fix older than this is not used
+
+typedef struct GpsNmea GpsNmea;
+
+typedef struct {
+    bool valid; // RMC status A or GGA quality > 0
+    uint8_t fix_type; // GSA: 1 none, 2 = 2D, 3 = 3D, 0 unknown
+    uint8_t satellites; // Used in the solution (GGA)
+    uint16_t hdop_c; // Horizontal dilution of precision x100, 0 unknown
+    int32_t lat_e7; // 1e-7 degrees
+    int32_t lon_e7;
+    int32_t alt_dm; // Above mean sea level, decimeters
+    uint32_t speed_mms; // Ground speed, mm/s
+    uint16_t course_cdeg; // True course, 1/100 degree
+    uint32_t timestamp; // Unix time of the fix, 0 until RMC supplied a date
+    uint32_t updated_tick; // furi_get_tick() when the fix was published
+} GpsFix;
+
+typedef struct {
+    uint32_t sentences; // Valid sentences decoded
+    uint32_t checksum_errors;
+    uint32_t overflows; // Sentences longer than GPS_NMEA_SENTENCE_MAX
+    uint32_t ignored; // Valid sentences of other types
+} GpsNmeaStats;
+
+GpsNmea* gps_nmea_alloc(void);
+void gps_nmea_free(GpsNmea* gps);
+
+/**
+ * @brief Forget the current fix and parser state
+ */
+void gps_nmea_reset(GpsNmea* gps);
+
+/**
+ * @brief Consume bytes from the GPS module, single writer only
+ */
+void gps_nmea_feed(GpsNmea* gps, const uint8_t* data, size_t len);
+
+/**
+ * @brief Copy the latest published fix, safe from any thread
+ * @return Sequence of the copy, changes every time a new fix is published
+ */
+uint32_t gps_nmea_get_fix(const GpsNmea* gps, GpsFix* fix);
+
+/**
+ * @brief Sequence of the latest published fix without copying it
+ */
+uint32_t gps_nmea_get_sequence(const GpsNmea* gps);
+
+/**
+ * @brief Valid and published less than GPS_NMEA_STALE_MS ago
+ */
+bool gps_nmea_fix_is_fresh(const GpsFix* fix);
+
+void gps_nmea_get_stats(const GpsNmea* gps, GpsNmeaStats* stats);
+
+/**
+ * @brief Baud rate for the Flipper GPS setting, 0 = off
+ */
+uint32_t gps_nmea_baud_for_index(uint8_t index);
@@ -0,0 +1,295 @@
+#include "gpx_writer.h"
+#include "wardrive_row.h"
+#include <furi.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GPX_WRITER_M_PER_E7   0.0111319491f // Meters per 1e-7 degree of latitude
+#define GPX_WRITER_E7_TO_RAD  1.745329252e-9f
+#define GPX_WRITER_POINT_OPEN "<trkpt"
+#define GPX_WRITER_POINT_END  "</trkpt>"
+
+#define GPX_WRITER_HEADER                                                                    \
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"                                         \
+    "<gpx version=\"1.1\" creator=\"Ghost ESP\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n" \
+    "<trk>\n<name>Ghost ESP track</name>\n<trkseg>\n"
+
+static const uint32_t gpx_writer_tolerances[] = {0, 2, 5, 10, 25};
+
+typedef enum {
+    GpxWriterStateIdle, // Between points
+    GpxWriterStateTag, // Inside a tag that may turn out to be <trkpt
+    GpxWriterStatePoint, // Inside a <trkpt> element
+    GpxWriterStateSkip, // Rest of an element too long to keep
+} GpxWriterState;
+
+typedef struct {
+    int32_t lat_e7;
+    int32_t lon_e7;
+} GpxWriterPoint;
+
+struct GpxWriter {
+    File* file;
+    bool active;
+    uint32_t tolerance_m;
+
+    GpxWriterState state;
+    bool point_open; // Still inside the <trkpt ...> start tag
+    char element[GPX_WRITER_ELEMENT_MAX];
+    size_t element_len;
+    uint8_t skip_match; // Characters of "</trkpt>" matched while skipping
+    char skip_prev;
+
+    // Opening window, the newest point's text waits in pending until it is kept or replaced
+    bool anchored;
+    GpxWriterPoint anchor;
+    GpxWriterPoint window[GPX_WRITER_WINDOW];
+    size_t window_len;
+    char pending[GPX_WRITER_ELEMENT_MAX];
+    size_t pending_len;
+
+    uint64_t offset; // Bytes on disk
+    GpxWriterStats stats;
+};
+
+static bool gpx_writer_emit(GpxWriter* writer, const char* text, size_t len) {
+    if(storage_file_write(writer->file, text, len) != len) {
+        FURI_LOG_E("GpxWriter", "Failed to write %u bytes", (unsigned)len);
+        return false;
+    }
+    writer->offset += len;
+    writer->stats.bytes_out += len;
+    return true;
+}
+
+static bool gpx_writer_keep(GpxWriter* writer, const char* text, size_t len) {
+    writer->stats.kept++;
+    return gpx_writer_emit(writer, text, len);
+}
+
+// Value of a lat="..." / lon='...' attribute in the start tag
+static bool gpx_writer_attribute(const char* tag, size_t len, const char* name, int32_t* out) {
+    size_t name_len = strlen(name);
+    for(size_t i = 1; i + name_len + 2 < len; i++) {
+        char before = tag[i - 1];
+        if((before != ' ' && before != '\t' && before != '\n' && before != '\r') ||
+           memcmp(tag + i, name, name_len) != 0 || tag[i + name_len] != '=') {
+            continue;
+        }
+        char quote = tag[i + name_len + 1];
+        if(quote != '"' && quote != '\'') return false;
+        const char* value = tag + i + name_len + 2;
+        const char* end = memchr(value, quote, len - (value - tag));
+        if(!end) return false;
+        return wardrive_parse_fixed(value, end - value, WARDRIVE_COORD_DIGITS, out);
+    }
+    return false;
+}
+
+// Distance of q from the segment origin -> p, both in meters relative to the anchor
+static float gpx_writer_segment_distance(float px, float py, float qx, float qy) {
+    float length = px * px + py * py;
+    float t = length > 0.0f ? (qx * px + qy * py) / length : 0.0f;
+    t = CLAMP(t, 1.0f, 0.0f);
+    float dx = qx - t * px;
+    float dy = qy - t * py;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+static bool gpx_writer_window_fits(const GpxWriter* writer, const GpxWriterPoint* point) {
+    float scale_x = GPX_WRITER_M_PER_E7 * cosf((float)writer->anchor.lat_e7 * GPX_WRITER_E7_TO_RAD);
+    float px = (float)(point->lon_e7 - writer->anchor.lon_e7) * scale_x;
+    float py = (float)(point->lat_e7 - writer->anchor.lat_e7) * GPX_WRITER_M_PER_E7;
+    float tolerance = (float)writer->tolerance_m;
+
+    for(size_t i = 0; i < writer->window_len; i++) {
+        float qx = (float)(writer->window[i].lon_e7 - writer->anchor.lon_e7) * scale_x;
+        float qy = (float)(writer->window[i].lat_e7 - writer->anchor.lat_e7) * GPX_WRITER_M_PER_E7;
+        if(gpx_writer_segment_distance(px, py, qx, qy) > tolerance) return false;
+    }
+    return true;
+}
+
+static bool gpx_writer_handle_point(GpxWriter* writer) {
+    size_t len = writer->element_len;
+    writer->element_len = 0;
+    writer->stats.points++;
+
+    // Coordinates are only taken from the start tag
+    const char* tag_end = memchr(writer->element, '>', len);
+    size_t tag_len = tag_end ? (size_t)(tag_end - writer->element) : len;
+    GpxWriterPoint point;
+    if(!gpx_writer_attribute(writer->element, tag_len, "lat", &point.lat_e7) ||
+       !gpx_writer_attribute(writer->element, tag_len, "lon", &point.lon_e7)) {
+        writer->stats.dropped++;
+        return true;
+    }
+    writer->element[len++] = '\n';
+
+    if(!writer->tolerance_m || !writer->anchored) {
+        writer->anchored = true;
+        writer->anchor = point;
+        return gpx_writer_keep(writer, writer->element, len);
+    }
+
+    bool ok = true;
+    if(writer->window_len &&
+       (writer->window_len == GPX_WRITER_WINDOW || !gpx_writer_window_fits(writer, &point))) {
+        // The newest point breaks the line, the one before it is significant
+        ok = gpx_writer_keep(writer, writer->pending, writer->pending_len);
+        writer->anchor = writer->window[writer->window_len - 1];
+        writer->window_len = 0;
+    }
+    writer->window[writer->window_len++] = point;
+    memcpy(writer->pending, writer->element, len);
+    writer->pending_len = len;
+    return ok;
+}
+
+static bool gpx_writer_feed(GpxWriter* writer, char c) {
+    switch(writer->state) {
+    case GpxWriterStateIdle:
+        if(c == '<') {
+            writer->element[0] = c;
+            writer->element_len = 1;
+            writer->state = GpxWriterStateTag;
+        }
+        return true;
+
+    case GpxWriterStateTag:
+        if(c == '<') {
+            writer->element_len = 0;
+        } else if(writer->element_len == strlen(GPX_WRITER_POINT_OPEN)) {
+            // "<trkpt" must be followed by whitespace or the end of the tag
+            bool point = memcmp(writer->element, GPX_WRITER_POINT_OPEN, writer->element_len) == 0 &&
+                         (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '>' || c == '/');
+            if(!point) {
+                writer->state = GpxWriterStateIdle;
+                writer->element_len = 0;
+                return true;
+            }
+            writer->state = GpxWriterStatePoint;
+            writer->point_open = true;
+        }
+        break;
+
+    case GpxWriterStatePoint:
+        break;
+
+    case GpxWriterStateSkip:
+        // Wait for the end of the dropped point, "</trkpt>" has a single '<' so no backtracking
+        if(writer->point_open && c == '>') {
+            writer->point_open = false;
+            if(writer->skip_prev == '/') writer->state = GpxWriterStateIdle;
+        } else if(c == GPX_WRITER_POINT_END[writer->skip_match]) {
+            if(++writer->skip_match == strlen(GPX_WRITER_POINT_END)) {
+                writer->state = GpxWriterStateIdle;
+            }
+        } else {
+            writer->skip_match = c == '<' ? 1 : 0;
+        }
+        writer->skip_prev = c;
+        return true;
+    }
+
+    // Leave room for the newline added when the point is kept
+    if(writer->element_len >= GPX_WRITER_ELEMENT_MAX - 1) {
+        writer->stats.dropped++;
+        writer->skip_prev = writer->element[writer->element_len - 1];
+        writer->skip_match = 0;
+        writer->element_len = 0;
+        writer->state = GpxWriterStateSkip;
+        return gpx_writer_feed(writer, c);
+    }
+    writer->element[writer->element_len++] = c;
+
+    if(writer->state != GpxWriterStatePoint || c != '>') return true;
+
+    size_t end_len = strlen(GPX_WRITER_POINT_END);
+    bool complete = false;
+    if(writer->point_open) {
+        writer->point_open = false;
+        complete = writer->element[writer->element_len - 2] == '/'; // <trkpt ... />
+    } else if(writer->element_len >= end_len) {
+        complete = memcmp(
+                       writer->element + writer->element_len - end_len,
+                       GPX_WRITER_POINT_END,
+                       end_len) == 0;
+    }
+    if(!complete) return true;
+
+    writer->state = GpxWriterStateIdle;
+    return gpx_writer_handle_point(writer);
+}
+
+GpxWriter* gpx_writer_alloc(void) {
+    GpxWriter* writer = malloc(sizeof(GpxWriter));
+    if(!writer) return NULL;
+    memset(writer, 0, sizeof(GpxWriter));
+    return writer;
+}
+
+void gpx_writer_free(GpxWriter* writer) {
+    if(!writer) return;
+    free(writer);
+}
+
+bool gpx_writer_begin(GpxWriter* writer, File* file, uint32_t tolerance_m) {
+    if(!writer) return false;
+    memset(writer, 0, sizeof(GpxWriter));
+    writer->file = file;
+    writer->tolerance_m = tolerance_m;
+
+    writer->active = file != NULL &&
+                     gpx_writer_emit(writer, GPX_WRITER_HEADER, strlen(GPX_WRITER_HEADER));
+    return writer->active;
+}
+
+bool gpx_writer_write(GpxWriter* writer, const uint8_t* data, size_t len) {
+    if(!writer || !writer->active) return false;
+
+    bool ok = true;
+    for(size_t i = 0; i < len && ok; i++) {
+        ok = gpx_writer_feed(writer, (char)data[i]);
+    }
+    return ok;
+}
+
+void gpx_writer_finish(GpxWriter* writer) {
+    if(!writer || !writer->active) return;
+
+    if(writer->window_len && !gpx_writer_keep(writer, writer->pending, writer->pending_len)) {
+        FURI_LOG_W("GpxWriter", "Failed to write last point");
+    }
+    uint64_t record_end = writer->offset;
+    gpx_writer_emit(writer, GPX_WRITER_TRAILER, strlen(GPX_WRITER_TRAILER));
+    writer->offset = record_end;
+
+    FURI_LOG_I(
+        "GpxWriter",
+        "%lu points, %lu kept at %lu m, %lu dropped",
+        writer->stats.points,
+        writer->stats.kept,
+        writer->tolerance_m,
+        writer->stats.dropped);
+    writer->active = false;
+    writer->file = NULL;
+}
+
+bool gpx_writer_is_active(const GpxWriter* writer) {
+    return writer && writer->active;
+}
+
+uint64_t gpx_writer_get_record_end(const GpxWriter* writer) {
+    return writer ? writer->offset : 0;
+}
+
+void gpx_writer_get_stats(const GpxWriter* writer, GpxWriterStats* stats) {
+    if(!writer || !stats) return;
+    *stats = writer->stats;
+}
+
+uint32_t gpx_writer_tolerance_for_index(uint8_t index) {
+    return index < COUNT_OF(gpx_writer_tolerances) ? gpx_writer_tolerances[index] : 0;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <storage/storage.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * GPX writer
+ *
+ * Rewrites the ESP's GPX track as it arrives. Every <trkpt> element is picked
+ * out of the stream (attributes and children kept verbatim) and written into
+ * a single track segment under our own header, everything else the ESP sends
+ * is dropped. The file ends on a whole point after every write, so a capture
+ * cut short only lacks GPX_WRITER_TRAILER, which the capture journal appends
+ * on recovery.
+ *
+ * With a tolerance set, points are simplified with a bounded opening window:
+ * from the last kept point (the anchor) the window grows while every point in
+ * it lies within the tolerance of the line anchor -> newest point. When one
+ * does not, the point before the newest is kept and becomes the anchor. The
+ * window holds at most GPX_WRITER_WINDOW points, so a long straight line still
+ * gets a point every so often and each update costs a bounded amount of work.
+ * The first and last points are always kept.
+ */
+
+#define GPX_WRITER_ELEMENT_MAX 384 // Longest <trkpt> element kept, newline included
+#define GPX_WRITER_WINDOW      32
+
+#define GPX_WRITER_TRAILER "</trkseg>\n</trk>\n</gpx>\n"
+
+typedef struct GpxWriter GpxWriter;
+
+typedef struct {
+    uint32_t points; // <trkpt> elements seen
+    uint32_t kept; // Points written
+    uint32_t dropped; // Elements too long or without coordinates
+    uint64_t bytes_out;
+} GpxWriterStats;
+
+GpxWriter* gpx_writer_alloc(void);
+void gpx_writer_free(GpxWriter* writer);
+
+/**
+ * @brief Attach a freshly opened file and write the GPX header
+ * @param tolerance_m Simplification tolerance, 0 keeps every point
+ */
+bool gpx_writer_begin(GpxWriter* writer, File* file, uint32_t tolerance_m);
+
+/**
+ * @brief Consume GPX bytes from the ESP
+ * @return false if a file write failed
+ */
+bool gpx_writer_write(GpxWriter* writer, const uint8_t* data, size_t len);
+
+/**
+ * @brief Write the last pending point and the trailer, then detach
+ */
+void gpx_writer_finish(GpxWriter* writer);
+
+bool gpx_writer_is_active(const GpxWriter* writer);
+
+/**
+ * @brief Bytes on disk, always ending on a whole point
+ */
+uint64_t gpx_writer_get_record_end(const GpxWriter* writer);
+
+void gpx_writer_get_stats(const GpxWriter* writer, GpxWriterStats* stats);
+
+/**
+ * @brief Tolerance in meters for the GPX Simplify setting
+ */
+uint32_t gpx_writer_tolerance_for_index(uint8_t index);
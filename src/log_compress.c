@@ -0,0 +1,233 @@
+#include "log_compress.h"
+#include <furi.h>
+#include <furi_hal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (LZ_MIN_MATCH + 63)
+#define LZ_HASH_SIZE 256
+#define LZ_MAX_CHAIN 8 // Bounded search keeps the per-frame cost predictable
+#define LZ_NIL       0xFFFF
+
+struct LogCompressor {
+    File* file;
+    uint8_t* in_buf;
+    uint8_t* out_buf;
+    uint16_t* head;
+    uint16_t* chain;
+    size_t in_len;
+    LogCompressStats stats;
+};
+
+static inline uint8_t lz_hash(const uint8_t* p) {
+    return (uint8_t)((p[0] << 4) ^ (p[1] << 2) ^ p[2] ^ (p[0] >> 4));
+}
+
+static inline uint32_t lz_cycles(void) {
+    return furi_hal_cortex_timer_get(0).start;
+}
+
+static inline void lz_put_u16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+LogCompressor* log_compressor_alloc(void) {
+    LogCompressor* compressor = malloc(sizeof(LogCompressor));
+    if(!compressor) return NULL;
+    memset(compressor, 0, sizeof(LogCompressor));
+
+    compressor->in_buf = malloc(LOG_COMPRESS_FRAME_SIZE);
+    compressor->out_buf = malloc(LOG_COMPRESS_FRAME_BOUND);
+    compressor->head = malloc(LZ_HASH_SIZE * sizeof(uint16_t));
+    compressor->chain = malloc(LOG_COMPRESS_FRAME_SIZE * sizeof(uint16_t));
+
+    if(!compressor->in_buf || !compressor->out_buf || !compressor->head || !compressor->chain) {
+        FURI_LOG_E("LogCompress", "Failed to allocate compressor buffers");
+        log_compressor_free(compressor);
+        return NULL;
+    }
+
+    return compressor;
+}
+
+void log_compressor_free(LogCompressor* compressor) {
+    if(!compressor) return;
+    free(compressor->in_buf);
+    free(compressor->out_buf);
+    free(compressor->head);
+    free(compressor->chain);
+    free(compressor);
+}
+
+bool log_compressor_begin(LogCompressor* compressor, File* file) {
+    if(!compressor || !file) return false;
+
+    compressor->file = file;
+    compressor->in_len = 0;
+    memset(&compressor->stats, 0, sizeof(LogCompressStats));
+
+    uint8_t header[LOG_COMPRESS_FILE_HEADER];
+    memcpy(header, LOG_COMPRESS_MAGIC, 4);
+    lz_put_u16(&header[4], LOG_COMPRESS_FRAME_SIZE);
+    lz_put_u16(&header[6], 0);
+
+    if(storage_file_write(file, header, sizeof(header)) != sizeof(header)) {
+        FURI_LOG_E("LogCompress", "Failed to write file header");
+        compressor->file = NULL;
+        return false;
+    }
+    compressor->stats.compressed_bytes = sizeof(header);
+    return true;
+}
+
+static inline void lz_insert(LogCompressor* compressor, const uint8_t* in, size_t pos, size_t len) {
+    if(pos + LZ_MIN_MATCH > len) return;
+    uint8_t h = lz_hash(&in[pos]);
+    compressor->chain[pos] = compressor->head[h];
+    compressor->head[h] = (uint16_t)pos;
+}
+
+size_t log_compress_frame(LogCompressor* compressor, const uint8_t* in, size_t len, uint8_t* out) {
+    if(!compressor || !in || !out || len == 0 || len > LOG_COMPRESS_FRAME_SIZE) return 0;
+
+    memset(compressor->head, 0xFF, LZ_HASH_SIZE * sizeof(uint16_t));
+
+    size_t ip = 0;
+    size_t op = 0;
+    size_t flag_pos = 0;
+    uint8_t flag_bit = 8;
+
+    while(ip < len) {
+        if(flag_bit == 8) {
+            flag_pos = op++;
+            out[flag_pos] = 0;
+            flag_bit = 0;
+        }
+
+        size_t best_len = 0;
+        size_t best_off = 0;
+        if(ip + LZ_MIN_MATCH <= len) {
+            size_t max_len = len - ip;
+            if(max_len > LZ_MAX_MATCH) max_len = LZ_MAX_MATCH;
+
+            uint16_t candidate = compressor->head[lz_hash(&in[ip])];
+            for(uint8_t depth = 0; candidate != LZ_NIL && depth < LZ_MAX_CHAIN; depth++) {
+                size_t match = 0;
+                while(match < max_len && in[candidate + match] == in[ip + match]) {
+                    match++;
+                }
+                if(match > best_len) {
+                    best_len = match;
+                    best_off = ip - candidate;
+                    if(match == max_len) break;
+                }
+                candidate = compressor->chain[candidate];
+            }
+        }
+
+        if(best_len >= LZ_MIN_MATCH) {
+            out[flag_pos] |= (uint8_t)(1 << flag_bit);
+            lz_put_u16(&out[op], (uint16_t)(((best_off - 1) << 6) | (best_len - LZ_MIN_MATCH)));
+            op += 2;
+            for(size_t i = 0; i < best_len; i++) {
+                lz_insert(compressor, in, ip + i, len);
+            }
+            ip += best_len;
+        } else {
+            out[op++] = in[ip];
+            lz_insert(compressor, in, ip, len);
+            ip++;
+        }
+        flag_bit++;
+
+        // Not worth it, caller stores the frame raw
+        if(op >= len) return 0;
+    }
+
+    return op;
+}
+
+static bool log_compressor_emit(LogCompressor* compressor) {
+    if(compressor->in_len == 0) return true;
+
+    uint32_t start = lz_cycles();
+    size_t comp_len = log_compress_frame(
+        compressor, compressor->in_buf, compressor->in_len, compressor->out_buf);
+    uint32_t cycles = lz_cycles() - start;
+    compressor->stats.cpu_us += cycles / furi_hal_cortex_instructions_per_microsecond();
+
+    const uint8_t* payload = compressor->out_buf;
+    uint16_t comp_field = (uint16_t)comp_len;
+    if(comp_len == 0) {
+        payload = compressor->in_buf;
+        comp_len = compressor->in_len;
+        comp_field = (uint16_t)(comp_len | LOG_COMPRESS_STORED_FLAG);
+    }
+
+    uint8_t header[LOG_COMPRESS_FRAME_HEADER];
+    lz_put_u16(&header[0], (uint16_t)compressor->in_len);
+    lz_put_u16(&header[2], comp_field);
+
+    if(storage_file_write(compressor->file, header, sizeof(header)) != sizeof(header) ||
+       storage_file_write(compressor->file, payload, comp_len) != comp_len) {
+        FURI_LOG_E("LogCompress", "Failed to write frame");
+        return false;
+    }
+
+    compressor->stats.raw_bytes += compressor->in_len;
+    compressor->stats.compressed_bytes += sizeof(header) + comp_len;
+    compressor->stats.frames++;
+    compressor->in_len = 0;
+    return true;
+}
+
+size_t log_compressor_write(LogCompressor* compressor, const uint8_t* data, size_t len) {
+    if(!compressor || !compressor->file || !data) return 0;
+
+    size_t accepted = 0;
+    while(accepted < len) {
+        size_t space = LOG_COMPRESS_FRAME_SIZE - compressor->in_len;
+        size_t chunk = len - accepted;
+        if(chunk > space) chunk = space;
+
+        memcpy(&compressor->in_buf[compressor->in_len], &data[accepted], chunk);
+        compressor->in_len += chunk;
+        accepted += chunk;
+
+        if(compressor->in_len == LOG_COMPRESS_FRAME_SIZE) {
+            if(!log_compressor_emit(compressor)) {
+                compressor->in_len = 0;
+                return accepted - chunk;
+            }
+            // A synced frame is the unit of loss on power failure
+            storage_file_sync(compressor->file);
+        }
+    }
+
+    return accepted;
+}
+
+bool log_compressor_flush(LogCompressor* compressor) {
+    if(!compressor || !compressor->file || !storage_file_is_open(compressor->file)) return false;
+
+    bool success = log_compressor_emit(compressor);
+    storage_file_sync(compressor->file);
+
+    if(compressor->stats.raw_bytes > 0) {
+        FURI_LOG_I(
+            "LogCompress",
+            "%lu frames, %lu -> %lu bytes, %lu us",
+            compressor->stats.frames,
+            (uint32_t)compressor->stats.raw_bytes,
+            (uint32_t)compressor->stats.compressed_bytes,
+            compressor->stats.cpu_us);
+    }
+    return success;
+}
+
+void log_compressor_get_stats(const LogCompressor* compressor, LogCompressStats* stats) {
+    if(!compressor || !stats) return;
+    *stats = compressor->stats;
+}
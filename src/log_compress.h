@@ -0,0 +1,71 @@
+#pragma once
+
+#include <storage/storage.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Compressed session logs (.glz)
+ *
+ * File layout:
+ *   header: "GLZ1" | u16 frame_size | u16 reserved
+ *   frames: u16 raw_len | u16 comp_len | payload
+ *
+ * Every frame is an independent LZSS block (the match window never crosses a
+ * frame boundary), so a reader can resync after a torn write and a crash loses
+ * at most the frame that was being built. If bit 15 of comp_len is set the
+ * payload is stored uncompressed.
+ *
+ * Payload: a flag byte precedes every 8 items, bit N set means item N is a
+ * match encoded as u16 LE ((offset - 1) << 6 | (length - 3)), otherwise the
+ * item is a single literal byte.
+ *
+ * The app only writes these files, tools/ghost_log.py decodes them on a PC.
+ */
+
+#define LOG_COMPRESS_MAGIC          "GLZ1"
+#define LOG_COMPRESS_EXTENSION      "glz"
+#define LOG_COMPRESS_FILE_HEADER    8
+#define LOG_COMPRESS_FRAME_HEADER   4
+#define LOG_COMPRESS_FRAME_SIZE     1024 // Same cadence as the plain text log sync
+#define LOG_COMPRESS_FRAME_BOUND    (LOG_COMPRESS_FRAME_SIZE + (LOG_COMPRESS_FRAME_SIZE / 8) + 1)
+#define LOG_COMPRESS_STORED_FLAG    0x8000
+
+typedef struct LogCompressor LogCompressor;
+
+typedef struct {
+    uint64_t raw_bytes;
+    uint64_t compressed_bytes;
+    uint32_t frames;
+    uint32_t cpu_us; // Time spent inside the compressor
+} LogCompressStats;
+
+LogCompressor* log_compressor_alloc(void);
+void log_compressor_free(LogCompressor* compressor);
+
+/**
+ * @brief Attach an open, empty file and write the .glz header
+ */
+bool log_compressor_begin(LogCompressor* compressor, File* file);
+
+/**
+ * @brief Buffer log data, emitting and syncing a frame every LOG_COMPRESS_FRAME_SIZE bytes
+ * @return number of bytes accepted (len unless a frame write failed)
+ */
+size_t log_compressor_write(LogCompressor* compressor, const uint8_t* data, size_t len);
+
+/**
+ * @brief Emit the pending partial frame and sync the file
+ */
+bool log_compressor_flush(LogCompressor* compressor);
+
+void log_compressor_get_stats(const LogCompressor* compressor, LogCompressStats* stats);
+
+/**
+ * @brief Compress one frame into out (at least LOG_COMPRESS_FRAME_BOUND bytes)
+ *
+ * Uses the compressor's match tables as workspace, the attached file is not touched.
+ * @return compressed size, or 0 if the data did not shrink
+ */
+size_t log_compress_frame(LogCompressor* compressor, const uint8_t* in, size_t len, uint8_t* out);
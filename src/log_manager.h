@@ -7,7 +7,7 @@
 #define MAX_FILENAME_LEN 256
 
 /**
- * @brief Get the path to the latest log file
+ * @brief Get the path to the latest log file, plain (.txt) or compressed (.glz)
  * 
  * @param storage Storage instance
  * @param dir Directory to search in
@@ -23,6 +23,8 @@
 #include "callbacks.h"
 #include "confirmation_view.h"
 #include "utils.h"
+#include "retention.h"
+#include "bg_job.h"
 
 // Include the header where settings_custom_event_callback is declared
 #include "settings_ui.h"
@@ -109,6 +111,9 @@ int32_t ghost_esp_app(void* p) {
    state->text_input = text_input_alloc();
    state->confirmation_view = confirmation_view_alloc();
    state->settings_actions_menu = submenu_alloc();
+   state->bg_job = bg_job_alloc(state->view_dispatcher);
+   state->wardrive_stats = wardrive_stats_alloc();
+   state->wardrive_stats_view = wardrive_stats_view_alloc(state->wardrive_stats);
 
    // Set headers - only for successfully allocated components
    if(state->main_menu) main_menu_set_header(state->main_menu, "Select a Utility");
@@ -126,6 +131,10 @@ int32_t ghost_esp_app(void* p) {
        settings_storage_save(&state->settings, GHOST_ESP_APP_SETTINGS_FILE);
    }
 
+   state->settings_txn =
+       settings_txn_alloc(
+           &state->settings, state->view_dispatcher, send_uart_command, settings_apply, state);
+
    // Initialize filter config
    state->filter_config = malloc(sizeof(FilterConfig));
    if(state->filter_config) {
@@ -145,6 +154,8 @@ int32_t ghost_esp_app(void* p) {
    state->settings_ui_context.show_confirmation_view = show_confirmation_view_wrapper;
    state->settings_ui_context.context = state;
 
+   if(state->bg_job) bg_job_set_dismiss_callback(state->bg_job, settings_bg_job_dismissed, state);
+
    // Initialize settings menu
    settings_setup_gui(state->settings_menu, &state->settings_ui_context);
 
@@ -172,6 +183,12 @@ int32_t ghost_esp_app(void* p) {
        furi_thread_join(uart_init_thread);
    }
 
+   // The rx path feeds responses from here on, ask the ESP what it supports
+   if(state->uart_context) {
+       esp_caps_start(state->uart_context->caps);
+   }
+   state->script_runner = script_runner_alloc(state);
+
    // Add views to dispatcher - check each component before adding
    if(state->view_dispatcher) {
        if(state->main_menu) view_dispatcher_add_view(state->view_dispatcher, 0, main_menu_get_view(state->main_menu));
@@ -183,6 +200,8 @@ int32_t ghost_esp_app(void* p) {
        if(state->text_input) view_dispatcher_add_view(state->view_dispatcher, 6, text_input_get_view(state->text_input));
        if(state->confirmation_view) view_dispatcher_add_view(state->view_dispatcher, 7, confirmation_view_get_view(state->confirmation_view));
        if(state->settings_actions_menu) view_dispatcher_add_view(state->view_dispatcher, 8, submenu_get_view(state->settings_actions_menu));
+       if(state->bg_job) view_dispatcher_add_view(state->view_dispatcher, 9, bg_job_get_view(state->bg_job));
+       if(state->wardrive_stats_view) view_dispatcher_add_view(state->view_dispatcher, 10, wardrive_stats_view_get_view(state->wardrive_stats_view));
 
        view_dispatcher_set_custom_event_callback(state->view_dispatcher, settings_custom_event_callback);
    }
@@ -195,6 +214,9 @@ int32_t ghost_esp_app(void* p) {
    // Show main menu immediately
    show_main_menu(state);
 
+   // Old logs/captures are pruned in the background once the UI is up
+   state->retention = retention_start((RetentionMode)state->settings.auto_cleanup_index);
+
    // Set up and run GUI
    Gui* gui = furi_record_open("gui");
    if(gui && state->view_dispatcher) {
@@ -207,7 +229,7 @@ int32_t ghost_esp_app(void* p) {
 
    // Start cleanup - first remove views
    if(state->view_dispatcher) {
-       for(size_t i = 0; i <= 8; i++) {
+       for(size_t i = 0; i <= 10; i++) {
            view_dispatcher_remove_view(state->view_dispatcher, i);
        }
    }
@@ -218,12 +240,46 @@ int32_t ghost_esp_app(void* p) {
        confirmation_view_set_cancel_callback(state->confirmation_view, NULL, NULL);
    }
 
+   // Stop any cleanup still running before the SD card users go away
+   retention_stop(state->retention);
+   state->retention = NULL;
+
+   // A running script still sends through the UART
+   if(state->script_runner) {
+       script_runner_free(state->script_runner);
+       state->script_runner = NULL;
+   }
+
+   // Pending ESP settings still need the UART, the file write the storage
+   if(state->settings_txn) {
+       settings_txn_free(state->settings_txn);
+       state->settings_txn = NULL;
+   }
+
+   // Finish any background SD job while storage is still up
+   if(state->bg_job) {
+       bg_job_free(state->bg_job);
+       state->bg_job = NULL;
+   }
+
+   // Stop the stats refresh timer before anything it reads goes away
+   if(state->wardrive_stats_view) {
+       wardrive_stats_view_free(state->wardrive_stats_view);
+       state->wardrive_stats_view = NULL;
+   }
+
    // Clean up UART first
    if(state->uart_context) {
        uart_free(state->uart_context);
        state->uart_context = NULL;
    }
 
+   // The storage worker is gone, nothing feeds the stats anymore
+   if(state->wardrive_stats) {
+       wardrive_stats_free(state->wardrive_stats);
+       state->wardrive_stats = NULL;
+   }
+
    // Cleanup UI components in reverse order
    if(state->confirmation_view) {
        confirmation_view_free(state->confirmation_view);
@@ -53,6 +53,7 @@ static void confirmation_cancel_callback(void* context);
 static void app_info_ok_callback(void* context);
 static void execute_menu_command(AppState* state, const MenuCommand* command);
 static void error_callback(void* context);
+static bool menu_command_available(AppState* state, const MenuCommand* command);
 
 // Sniff command definitions
 static const SniffCommandDef sniff_commands[] = {
@@ -92,6 +93,11 @@ static const BeaconSpamDef rgbmode_commands[] = {
 };
 
 static size_t current_sniff_index = 0;
+
+// Command waiting for the ESP health probe, and where it was picked
+static const MenuCommand* probe_command = NULL;
+static uint8_t probe_view = 0;
+static uint32_t probe_index = 0;
 static size_t current_beacon_index = 0;
 
 // WiFi menu command definitions
@@ -594,6 +600,26 @@ static const MenuCommand gps_commands[] = {
                         "mapping software.\n"
                         "Saves to .gpx file.\n",
     },
+    // Opens the live statistics view, nothing is sent to the ESP
+    {
+        .label = "Wardrive Stats",
+        .command = NULL,
+        .capture_prefix = NULL,
+        .file_ext = NULL,
+        .folder = NULL,
+        .needs_input = false,
+        .input_text = NULL,
+        .needs_confirmation = false,
+        .confirm_header = NULL,
+        .confirm_text = NULL,
+        .details_header = "Wardrive Stats",
+        .details_text = "Live numbers for the\n"
+                        "running wardrive:\n"
+                        "- Unique APs & BLE\n"
+                        "- New networks/min\n"
+                        "- Distance, encryption\n"
+                        "Left/Right: channels\n",
+    },
     // Unified Stop Command for GPS Operations
     {
         .label = "Stop All GPS",
@@ -660,6 +686,8 @@ static void confirmation_ok_callback(void* context) {
             }
 
             // Send capture command
+            uart_storage_set_capture_info(
+                cmd_ctx->state->uart_context->storageContext, cmd_ctx->command->command);
             send_uart_command(cmd_ctx->command->command, cmd_ctx->state);
             FURI_LOG_I("Capture", "Capture command sent to firmware.");
         } else {
@@ -744,22 +772,33 @@ static void text_input_result_callback(void* context) {
         input_state->uart_context, input_state->view_dispatcher, input_state, "", "", "");
 }
 
+static void show_connection_error(AppState* state) {
+    // Save current view
+    state->previous_view = state->current_view;
+
+    confirmation_view_set_header(state->confirmation_view, "Connection Error");
+    confirmation_view_set_text(
+        state->confirmation_view,
+        "ESP Not Connected!\nTry Rebooting ESP.\nRestarting the app.\nCheck UART Pins.\nReflash if issues persist.\n");
+    confirmation_view_set_ok_callback(state->confirmation_view, error_callback, state);
+    confirmation_view_set_cancel_callback(state->confirmation_view, error_callback, state);
+
+    view_dispatcher_switch_to_view(state->view_dispatcher, 7);
+    state->current_view = 7;
+}
+
 static void execute_menu_command(AppState* state, const MenuCommand* command) {
-    // Check ESP connection first
-    if(!uart_is_esp_connected(state->uart_context)) {
-        // Save current view
-        state->previous_view = state->current_view;
-
-        // Show error and return
-        confirmation_view_set_header(state->confirmation_view, "Connection Error");
-        confirmation_view_set_text(
-            state->confirmation_view,
-            "ESP Not Connected!\nTry Rebooting ESP.\nRestarting the app.\nCheck UART Pins.\nReflash if issues persist.\n");
-        confirmation_view_set_ok_callback(state->confirmation_view, error_callback, state);
-        confirmation_view_set_cancel_callback(state->confirmation_view, error_callback, state);
+    // Entries without a command open a local view, no ESP and no capture involved
+    if(!command->command) {
+        show_wardrive_stats(state);
+        return;
+    }
 
-        view_dispatcher_switch_to_view(state->view_dispatcher, 7);
-        state->current_view = 7;
+    // Free while the ESP was heard from recently, probes in the background otherwise
+    if(!esp_health_check(state->uart_context->health, APP_EVENT_MENU_PROBED)) {
+        probe_command = command;
+        probe_view = state->current_view;
+        probe_index = state->current_index;
         return;
     }
 
@@ -808,14 +847,13 @@ static void execute_menu_command(AppState* state, const MenuCommand* command) {
                 return;
             }
 
-            furi_delay_ms(10);
+            uart_storage_set_capture_info(state->uart_context->storageContext, current_sniff->command);
             send_uart_command(current_sniff->command, state);
             return;
         }
 
         uart_receive_data(state->uart_context, state->view_dispatcher, state, "", "", "");
 
-        furi_delay_ms(5);
         send_uart_command(current_sniff->command, state);
         return;
     }
@@ -837,7 +875,6 @@ static void execute_menu_command(AppState* state, const MenuCommand* command) {
 
         // For other modes, send command directly
         uart_receive_data(state->uart_context, state->view_dispatcher, state, "", "", "");
-        furi_delay_ms(5);
         send_uart_command(current_beacon->command, state);
         return;
     }
@@ -846,7 +883,6 @@ static void execute_menu_command(AppState* state, const MenuCommand* command) {
     if(state->current_view == 1 && state->current_index == 17) {
         const BeaconSpamDef* current_rgb = &rgbmode_commands[current_rgb_index];
         uart_receive_data(state->uart_context, state->view_dispatcher, state, "", "", "");
-        furi_delay_ms(5);
         send_uart_command(current_rgb->command, state);
         return;
     }
@@ -866,18 +902,30 @@ static void execute_menu_command(AppState* state, const MenuCommand* command) {
             return;
         }
 
-        furi_delay_ms(10);
+        uart_storage_set_capture_info(state->uart_context->storageContext, command->command);
         send_uart_command(command->command, state);
         return;
     }
 
     uart_receive_data(state->uart_context, state->view_dispatcher, state, "", "", "");
 
-    furi_delay_ms(5);
     send_uart_command(command->command, state);
 }
 
 // Menu display function implementation
+void menu_probe_done(AppState* state) {
+    const MenuCommand* command = probe_command;
+    probe_command = NULL;
+    // The user moved on while the ESP was probed
+    if(!command || state->current_view != probe_view || state->current_index != probe_index) return;
+
+    if(esp_health_is_connected(state->uart_context->health)) {
+        execute_menu_command(state, command);
+    } else {
+        show_connection_error(state);
+    }
+}
+
 static void show_menu(
     AppState* state,
     const MenuCommand* commands,
@@ -888,7 +936,9 @@ static void show_menu(
     submenu_reset(menu);
     submenu_set_header(menu, header);
 
+    // Item ids stay the table index, entries the ESP does not know are left out
     for(size_t i = 0; i < command_count; i++) {
+        if(!menu_command_available(state, &commands[i])) continue;
         submenu_add_item(menu, commands[i].label, i, submenu_callback, state);
     }
 
@@ -910,7 +960,7 @@ static void show_menu(
         last_index = state->last_gps_index;
         break;
     }
-    if(last_index < command_count) {
+    if(last_index < command_count && menu_command_available(state, &commands[last_index])) {
         submenu_set_selected_item(menu, last_index);
     }
 
@@ -919,6 +969,26 @@ static void show_menu(
     state->previous_view = view_id;
 }
 
+// Entries without an ESP command (wardrive stats) are always there
+static bool menu_command_available(AppState* state, const MenuCommand* command) {
+    if(!command->command || !state->uart_context) return true;
+    return esp_caps_supports(state->uart_context->caps, command->command);
+}
+
+// Next listed entry before or after index, wrapping around
+static uint32_t menu_step(
+    AppState* state,
+    const MenuCommand* commands,
+    size_t command_count,
+    uint32_t index,
+    bool forward) {
+    for(size_t n = 0; n < command_count; n++) {
+        index = forward ? (index + 1) % command_count : (index + command_count - 1) % command_count;
+        if(menu_command_available(state, &commands[index])) break;
+    }
+    return index;
+}
+
 // Menu display functions
 void show_wifi_menu(AppState* state) {
     show_menu(
@@ -933,6 +1003,12 @@ void show_gps_menu(AppState* state) {
     show_menu(state, gps_commands, COUNT_OF(gps_commands), "GPS Commands:", state->gps_menu, 3);
 }
 
+void show_wardrive_stats(AppState* state) {
+    if(!state->wardrive_stats_view) return;
+    view_dispatcher_switch_to_view(state->view_dispatcher, 10);
+    state->current_view = 10;
+}
+
 // Menu command handlers
 void handle_wifi_menu(AppState* state, uint32_t index) {
     if(index < COUNT_OF(wifi_commands)) {
@@ -951,6 +1027,10 @@ void handle_ble_menu(AppState* state, uint32_t index) {
 void handle_gps_menu(AppState* state, uint32_t index) {
     if(index < COUNT_OF(gps_commands)) {
         state->last_gps_index = index; // Save the selection
+        if(!gps_commands[index].command) {
+            show_wardrive_stats(state);
+            return;
+        }
         execute_menu_command(state, &gps_commands[index]);
     }
 }
@@ -1048,6 +1128,11 @@ bool back_event_callback(void* context) {
         return false;
     }
 
+    // Background job progress, the view cancels/dismisses on its own
+    if(current_view == 9) {
+        return true;
+    }
+
     // Handle text box view (view 5)
     if(current_view == 5) {
         FURI_LOG_D("Ghost ESP", "Handling text box view exit");
@@ -1062,56 +1147,19 @@ bool back_event_callback(void* context) {
             state->buffer_length = 0;
         }
 
-        // Send stop commands if enabled in settings
-        if(state->settings.stop_on_back_index) {
-            FURI_LOG_D("Ghost ESP", "Stopping active operations");
-
-            // First stop any packet captures to ensure proper file saving
-            send_uart_command("capture -stop\n", state);
-
-            // Give more time for PCAP stop command to process
-            furi_delay_ms(200);
-
-            // Wait for any pending PCAP data
-            if(state->uart_context->pcap) {
-                // Wait for pcap buffer to empty
-                for(uint8_t i = 0; i < 10; i++) { // Try up to 10 times
-                    if(state->uart_context->pcap_buf_len > 0) {
-                        furi_delay_ms(50);
-                    } else {
-                        break;
-                    }
-                }
-
-                // Now safe to reset PCAP state
-                state->uart_context->pcap = false;
-                furi_stream_buffer_reset(state->uart_context->pcap_stream);
-            }
+        // A script or scheduled job would keep sending, stop them before what they started
+        script_runner_stop(state->script_runner);
+        if(state->uart_context) cmd_scheduler_clear(state->uart_context->scheduler);
 
-            // Stop operations in a logical order
-            const char* stop_commands[] = {
-                "capture -stop\n", // Stop any WiFi packet captures
-                "capture -blestop\n", // Stop any BLE captures
-                "stopscan\n", // Stop WiFi scanning
-                "stopspam\n", // Stop beacon spam attacks
-                "stopdeauth\n", // Stop deauth attacks
-                "stopportal\n", // Stop evil portal
-                "blescan -s\n", // Stop BLE scanning
-                "gpsinfo -s\n", // Stop GPS info updates
-                "startwd -s\n", // Stop wardriving
-                "blewardriving -s\n", // Stop BLE wardriving
-                "stop\n", // General stop command
-                "rgbmode off\n" // Stop LED effects
-            };
-
-            for(size_t i = 0; i < COUNT_OF(stop_commands); i++) {
-                send_uart_command(stop_commands[i], state);
-                furi_delay_ms(50);
-            }
+        // Stop what was started, the ESP is waited for in the background
+        bool stopping = false;
+        if(state->settings.stop_on_back_index && state->uart_context) {
+            FURI_LOG_D("Ghost ESP", "Stopping active operations");
+            stopping = stop_all_start(state->uart_context->stop_all);
         }
 
-        // Clean up files using the safe cleanup
-        if(state->uart_context && state->uart_context->storageContext) {
+        // Otherwise clean up files right away, a stop does it once the capture has ended
+        if(!stopping && state->uart_context && state->uart_context->storageContext) {
             uart_storage_safe_cleanup(state->uart_context->storageContext);
             FURI_LOG_D("Ghost ESP", "Performed safe storage cleanup");
         }
@@ -1139,6 +1187,11 @@ bool back_event_callback(void* context) {
         }
         state->current_view = state->previous_view;
     }
+    // Wardrive stats (view 10) come from the GPS menu
+    else if(current_view == 10) {
+        show_gps_menu(state);
+        submenu_set_selected_item(state->gps_menu, state->last_gps_index);
+    }
     // Handle settings menu (view 8)
     else if(current_view == 8) {
         show_main_menu(state);
@@ -1146,6 +1199,7 @@ bool back_event_callback(void* context) {
     }
     // Handle settings submenu (view 4)
     else if(current_view == 4) {
+        settings_txn_commit(state->settings_txn);
         view_dispatcher_switch_to_view(state->view_dispatcher, 8);
         state->current_view = 8;
     }
@@ -1238,29 +1292,25 @@ static bool menu_input_handler(InputEvent* event, void* context) {
     case InputTypeShort:
         switch(event->key) {
         case InputKeyUp:
-            if(current_index > 0) {
-                submenu_set_selected_item(current_menu, current_index - 1);
-            } else {
-                // Wrap to bottom
-                submenu_set_selected_item(current_menu, commands_count - 1);
-            }
-            consumed = true;
-            break;
-
         case InputKeyDown:
-            if(current_index < commands_count - 1) {
-                submenu_set_selected_item(current_menu, current_index + 1);
-            } else {
-                // Wrap to top
-                submenu_set_selected_item(current_menu, 0);
-            }
+            // Wraps around, skipping entries hidden for this firmware
+            submenu_set_selected_item(
+                current_menu,
+                menu_step(
+                    state, commands, commands_count, current_index, event->key == InputKeyDown));
             consumed = true;
             break;
 
         case InputKeyOk:
             if(current_index < commands_count) {
                 state->current_index = current_index;
-                execute_menu_command(state, &commands[current_index]);
+                if(!commands[current_index].command) {
+                    // Back from the stats view returns to this entry
+                    if(state->current_view == 3) state->last_gps_index = current_index;
+                    show_wardrive_stats(state);
+                } else {
+                    execute_menu_command(state, &commands[current_index]);
+                }
                 consumed = true;
             }
             break;
@@ -29,5 +29,11 @@ void handle_gps_menu(AppState* state, uint32_t index);
 void show_wifi_menu(AppState* state);
 void show_ble_menu(AppState* state);
 void show_gps_menu(AppState* state);
+void show_wardrive_stats(AppState* state);
+
+/**
+ * @brief Handle APP_EVENT_MENU_PROBED, runs the command that waited for the ESP probe
+ */
+void menu_probe_done(AppState* state);
 
 // 6675636B796F7564656B69
\ No newline at end of file
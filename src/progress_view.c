@@ -0,0 +1,155 @@
+#include "progress_view.h"
+#include <gui/elements.h>
+#include <furi.h>
+#include <string.h>
+
+#define PROGRESS_VIEW_LINE_LEN 32
+
+struct ProgressView {
+    View* view;
+    ProgressViewCallback callback;
+    void* callback_context;
+};
+
+typedef struct {
+    const char* header;
+    const char* button;
+    char line1[PROGRESS_VIEW_LINE_LEN];
+    char line2[PROGRESS_VIEW_LINE_LEN];
+    float progress;
+} ProgressViewModel;
+
+static void progress_view_draw_callback(Canvas* canvas, void* _model) {
+    if(!canvas || !_model) return;
+
+    ProgressViewModel* model = (ProgressViewModel*)_model;
+
+    canvas_draw_rframe(canvas, 0, 0, 128, 64, 2);
+
+    if(model->header) {
+        canvas_set_font(canvas, FontPrimary);
+        elements_multiline_text_aligned(canvas, 64, 5, AlignCenter, AlignTop, model->header);
+    }
+
+    canvas_set_font(canvas, FontSecondary);
+    elements_multiline_text_aligned(canvas, 64, 18, AlignCenter, AlignTop, model->line1);
+    elements_multiline_text_aligned(canvas, 64, 28, AlignCenter, AlignTop, model->line2);
+
+    if(model->progress >= 0.0f) {
+        elements_progress_bar(canvas, 8, 39, 112, model->progress);
+    }
+
+    if(model->button) {
+        elements_button_center(canvas, model->button);
+    }
+}
+
+static bool progress_view_input_callback(InputEvent* event, void* context) {
+    if(!event || !context) return false;
+
+    ProgressView* instance = (ProgressView*)context;
+
+    // Swallow every OK/Back event so a long press cannot leave the view behind the job's back
+    if(event->key == InputKeyOk || event->key == InputKeyBack) {
+        if(event->type == InputTypeShort && instance->callback) {
+            instance->callback(
+                event->key == InputKeyOk ? ProgressViewEventOk : ProgressViewEventBack,
+                instance->callback_context);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+ProgressView* progress_view_alloc(void) {
+    ProgressView* instance = malloc(sizeof(ProgressView));
+    if(!instance) return NULL;
+    memset(instance, 0, sizeof(ProgressView));
+
+    instance->view = view_alloc();
+    if(!instance->view) {
+        free(instance);
+        return NULL;
+    }
+
+    view_set_context(instance->view, instance);
+    view_set_draw_callback(instance->view, progress_view_draw_callback);
+    view_set_input_callback(instance->view, progress_view_input_callback);
+
+    view_allocate_model(instance->view, ViewModelTypeLocking, sizeof(ProgressViewModel));
+
+    with_view_model(
+        instance->view,
+        ProgressViewModel* model,
+        {
+            model->header = NULL;
+            model->button = NULL;
+            model->line1[0] = '\0';
+            model->line2[0] = '\0';
+            model->progress = -1.0f;
+        },
+        true);
+
+    return instance;
+}
+
+void progress_view_free(ProgressView* instance) {
+    if(!instance) return;
+    if(instance->view) view_free(instance->view);
+    free(instance);
+}
+
+View* progress_view_get_view(ProgressView* instance) {
+    return instance ? instance->view : NULL;
+}
+
+void progress_view_set_header(ProgressView* instance, const char* text) {
+    if(!instance || !instance->view) return;
+    with_view_model(
+        instance->view,
+        ProgressViewModel* model,
+        {
+            model->header = text;
+        },
+        true);
+}
+
+void progress_view_set_status(
+    ProgressView* instance,
+    const char* line1,
+    const char* line2,
+    float progress) {
+    if(!instance || !instance->view) return;
+    with_view_model(
+        instance->view,
+        ProgressViewModel* model,
+        {
+            strncpy(model->line1, line1 ? line1 : "", PROGRESS_VIEW_LINE_LEN - 1);
+            model->line1[PROGRESS_VIEW_LINE_LEN - 1] = '\0';
+            strncpy(model->line2, line2 ? line2 : "", PROGRESS_VIEW_LINE_LEN - 1);
+            model->line2[PROGRESS_VIEW_LINE_LEN - 1] = '\0';
+            model->progress = progress > 1.0f ? 1.0f : progress;
+        },
+        true);
+}
+
+void progress_view_set_button(ProgressView* instance, const char* label) {
+    if(!instance || !instance->view) return;
+    with_view_model(
+        instance->view,
+        ProgressViewModel* model,
+        {
+            model->button = label;
+        },
+        true);
+}
+
+void progress_view_set_callback(
+    ProgressView* instance,
+    ProgressViewCallback callback,
+    void* context) {
+    if(!instance) return;
+    instance->callback = callback;
+    instance->callback_context = context;
+}
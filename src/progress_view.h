@@ -0,0 +1,33 @@
+#pragma once
+
+#include <gui/view.h>
+
+typedef struct ProgressView ProgressView;
+
+typedef enum {
+    ProgressViewEventOk,
+    ProgressViewEventBack,
+} ProgressViewEvent;
+
+typedef void (*ProgressViewCallback)(ProgressViewEvent event, void* context);
+
+ProgressView* progress_view_alloc(void);
+void progress_view_free(ProgressView* instance);
+View* progress_view_get_view(ProgressView* instance);
+
+void progress_view_set_header(ProgressView* instance, const char* text);
+
+/**
+ * @brief Update both status lines and the bar (progress < 0 hides the bar)
+ */
+void progress_view_set_status(
+    ProgressView* instance,
+    const char* line1,
+    const char* line2,
+    float progress);
+
+void progress_view_set_button(ProgressView* instance, const char* label);
+void progress_view_set_callback(
+    ProgressView* instance,
+    ProgressViewCallback callback,
+    void* context);
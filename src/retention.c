@@ -0,0 +1,238 @@
+#include "retention.h"
+#include "log_manager.h"
+#include "dir_catalog.h"
+#include "settings_def.h"
+#include <furi_hal.h>
+#include <storage/storage.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RETENTION_STACK_SIZE     2048
+#define RETENTION_START_DELAY_MS 3000
+#define RETENTION_MAX_CANDIDATES 24
+#define RETENTION_MAX_PASSES     8
+#define RETENTION_NAME_LEN       64
+#define RETENTION_EVT_STOP       (1 << 0)
+
+#define RETENTION_DAY_S (24UL * 60UL * 60UL)
+
+typedef struct {
+    const char* dir;
+    uint32_t max_files; // 0 = unlimited
+    uint64_t max_bytes; // 0 = unlimited
+    uint32_t max_age_s; // 0 = unlimited
+    bool logs; // Enforced in RETENTION_MODE_LOGS too
+} RetentionPolicy;
+
+static const RetentionPolicy RETENTION_POLICIES[] = {
+    {GHOST_ESP_APP_FOLDER_LOGS, MAX_LOGS_TO_KEEP, 0, 0, true},
+    {GHOST_ESP_APP_FOLDER_PCAPS, 200, 64ULL * 1024 * 1024, 30 * RETENTION_DAY_S, false},
+    {GHOST_ESP_APP_FOLDER_WARDRIVE, 200, 32ULL * 1024 * 1024, 90 * RETENTION_DAY_S, false},
+};
+
+typedef struct {
+    uint32_t timestamp;
+    uint64_t size;
+    char name[RETENTION_NAME_LEN];
+} RetentionCandidate;
+
+struct Retention {
+    FuriThread* thread;
+    RetentionMode mode;
+    Storage* storage;
+    // Bounded heap of the oldest files seen so far, root is the newest of them
+    RetentionCandidate heap[RETENTION_MAX_CANDIDATES];
+    size_t heap_count;
+    char newest[RETENTION_NAME_LEN];
+    char filename[MAX_FILENAME_LEN];
+    char path[MAX_FILENAME_LEN];
+};
+
+static bool retention_should_stop(void) {
+    return (furi_thread_flags_get() & RETENTION_EVT_STOP) != 0;
+}
+
+static void retention_heap_swap(RetentionCandidate* a, RetentionCandidate* b) {
+    RetentionCandidate tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void retention_heap_sift_down(RetentionCandidate* heap, size_t count, size_t i) {
+    while(true) {
+        size_t largest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if(left < count && heap[left].timestamp > heap[largest].timestamp) largest = left;
+        if(right < count && heap[right].timestamp > heap[largest].timestamp) largest = right;
+        if(largest == i) return;
+        retention_heap_swap(&heap[i], &heap[largest]);
+        i = largest;
+    }
+}
+
+static void retention_heap_offer(Retention* ctx, const RetentionCandidate* candidate) {
+    if(ctx->heap_count < RETENTION_MAX_CANDIDATES) {
+        size_t i = ctx->heap_count++;
+        ctx->heap[i] = *candidate;
+        while(i > 0) {
+            size_t parent = (i - 1) / 2;
+            if(ctx->heap[parent].timestamp >= ctx->heap[i].timestamp) break;
+            retention_heap_swap(&ctx->heap[parent], &ctx->heap[i]);
+            i = parent;
+        }
+    } else if(candidate->timestamp < ctx->heap[0].timestamp) {
+        ctx->heap[0] = *candidate;
+        retention_heap_sift_down(ctx->heap, ctx->heap_count, 0);
+    }
+}
+
+// Heap sort in place, leaves the candidates oldest first
+static void retention_heap_sort(Retention* ctx) {
+    for(size_t end = ctx->heap_count; end > 1; end--) {
+        retention_heap_swap(&ctx->heap[0], &ctx->heap[end - 1]);
+        retention_heap_sift_down(ctx->heap, end - 1, 0);
+    }
+}
+
+// One pass over the directory, then delete from the oldest candidates.
+// Returns true if the folder is still over its limits and another pass is needed.
+static bool retention_sweep(Retention* ctx, const RetentionPolicy* policy, uint32_t* deleted) {
+    File* dir = storage_file_alloc(ctx->storage);
+    if(!storage_dir_open(dir, policy->dir)) {
+        storage_dir_close(dir);
+        storage_file_free(dir);
+        return false;
+    }
+
+    ctx->heap_count = 0;
+    ctx->newest[0] = '\0';
+    uint32_t newest_timestamp = 0;
+    uint32_t file_count = 0;
+    uint64_t total_bytes = 0;
+    FileInfo file_info;
+    RetentionCandidate candidate;
+
+    while(storage_dir_read(dir, &file_info, ctx->filename, sizeof(ctx->filename))) {
+        if(retention_should_stop()) break;
+        if(file_info.flags & FSF_DIRECTORY) continue;
+        if(ctx->filename[0] == '.') continue;
+
+        file_count++;
+        total_bytes += file_info.size;
+
+        // Names that do not fit a candidate slot are counted but never deleted
+        if(strlen(ctx->filename) >= RETENTION_NAME_LEN) continue;
+
+        snprintf(ctx->path, sizeof(ctx->path), "%s/%s", policy->dir, ctx->filename);
+        candidate.timestamp = 0;
+        storage_common_timestamp(ctx->storage, ctx->path, &candidate.timestamp);
+        candidate.size = file_info.size;
+        strcpy(candidate.name, ctx->filename);
+
+        if(ctx->newest[0] == '\0' || candidate.timestamp >= newest_timestamp) {
+            newest_timestamp = candidate.timestamp;
+            strcpy(ctx->newest, candidate.name);
+        }
+
+        retention_heap_offer(ctx, &candidate);
+    }
+
+    storage_dir_close(dir);
+    storage_file_free(dir);
+
+    if(retention_should_stop()) return false;
+
+    retention_heap_sort(ctx);
+
+    uint32_t now = furi_hal_rtc_get_timestamp();
+    size_t removed = 0;
+    for(size_t i = 0; i < ctx->heap_count; i++) {
+        const RetentionCandidate* c = &ctx->heap[i];
+
+        // Never touch the newest file, it may be the one being written
+        if(strcmp(c->name, ctx->newest) == 0) continue;
+
+        bool over_count = policy->max_files && file_count > policy->max_files;
+        bool over_bytes = policy->max_bytes && total_bytes > policy->max_bytes;
+        bool expired = policy->max_age_s && c->timestamp && now > c->timestamp + policy->max_age_s;
+        if(!over_count && !over_bytes && !expired) break;
+        if(retention_should_stop()) return false;
+
+        snprintf(ctx->path, sizeof(ctx->path), "%s/%s", policy->dir, c->name);
+        if(storage_simply_remove(ctx->storage, ctx->path)) {
+            FURI_LOG_D("Retention", "Removed %s", ctx->path);
+            file_count--;
+            total_bytes -= c->size;
+            (*deleted)++;
+        }
+        removed++;
+    }
+
+    // Every candidate went and the folder may still be over, look again
+    return removed == ctx->heap_count && ctx->heap_count == RETENTION_MAX_CANDIDATES &&
+           ((policy->max_files && file_count > policy->max_files) ||
+            (policy->max_bytes && total_bytes > policy->max_bytes) || policy->max_age_s);
+}
+
+static int32_t retention_thread(void* context) {
+    Retention* ctx = context;
+
+    // Stay off the SD card while the app is starting up
+    uint32_t flags = furi_thread_flags_wait(RETENTION_EVT_STOP, FuriFlagWaitAny, RETENTION_START_DELAY_MS);
+    if(!(flags & FuriFlagError) && (flags & RETENTION_EVT_STOP)) return 0;
+
+    ctx->storage = furi_record_open(RECORD_STORAGE);
+    uint32_t start = furi_get_tick();
+    uint32_t deleted = 0;
+
+    for(size_t i = 0; i < COUNT_OF(RETENTION_POLICIES); i++) {
+        const RetentionPolicy* policy = &RETENTION_POLICIES[i];
+        if(ctx->mode == RETENTION_MODE_LOGS && !policy->logs) continue;
+
+        // The shared snapshot answers "nothing to do" without stat-ing every file
+        DirCatalogStats stats;
+        if(!policy->max_age_s && dir_catalog_get(ctx->storage, policy->dir, NULL, NULL, &stats) &&
+           (!policy->max_files || stats.file_count <= policy->max_files) &&
+           (!policy->max_bytes || stats.total_bytes <= policy->max_bytes)) {
+            continue;
+        }
+
+        uint32_t deleted_before = deleted;
+        for(size_t pass = 0; pass < RETENTION_MAX_PASSES; pass++) {
+            if(!retention_sweep(ctx, policy, &deleted)) break;
+        }
+        if(deleted != deleted_before) dir_catalog_invalidate(policy->dir);
+        if(retention_should_stop()) break;
+    }
+
+    furi_record_close(RECORD_STORAGE);
+    FURI_LOG_I("Retention", "Removed %lu files in %lu ms", deleted, furi_get_tick() - start);
+    return 0;
+}
+
+Retention* retention_start(RetentionMode mode) {
+    if(mode >= RETENTION_MODE_OFF) return NULL;
+
+    Retention* ctx = malloc(sizeof(Retention));
+    if(!ctx) return NULL;
+    memset(ctx, 0, sizeof(Retention));
+    ctx->mode = mode;
+
+    ctx->thread = furi_thread_alloc_ex("Retention", RETENTION_STACK_SIZE, retention_thread, ctx);
+    furi_thread_set_priority(ctx->thread, FuriThreadPriorityLow);
+    furi_thread_start(ctx->thread);
+    return ctx;
+}
+
+void retention_stop(Retention* ctx) {
+    if(!ctx) return;
+
+    if(furi_thread_get_state(ctx->thread) != FuriThreadStateStopped) {
+        furi_thread_flags_set(furi_thread_get_id(ctx->thread), RETENTION_EVT_STOP);
+    }
+    furi_thread_join(ctx->thread);
+    furi_thread_free(ctx->thread);
+    free(ctx);
+}
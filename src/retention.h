@@ -0,0 +1,28 @@
+#pragma once
+
+#include <furi.h>
+#include <stdint.h>
+
+// Matches the "Auto Cleanup" setting values
+typedef enum {
+    RETENTION_MODE_LOGS, // Only enforce MAX_LOGS_TO_KEEP
+    RETENTION_MODE_ALL, // Logs, PCAPs and wardrives
+    RETENTION_MODE_OFF,
+    RETENTION_MODE_COUNT
+} RetentionMode;
+
+typedef struct Retention Retention;
+
+/**
+ * @brief Start the low priority retention thread
+ *
+ * The thread waits a few seconds before touching the SD card so the first
+ * screen is never delayed, does one cleanup sweep and exits.
+ * @return handle to pass to retention_stop, NULL if mode is off
+ */
+Retention* retention_start(RetentionMode mode);
+
+/**
+ * @brief Cancel a running sweep (if any), join and free the thread
+ */
+void retention_stop(Retention* retention);
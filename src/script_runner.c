@@ -0,0 +1,455 @@
+#include "script_runner.h"
+#include "uart_utils.h"
+#include "app_state.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(SCRIPT_COMMAND_MAX + 2 <= ESP_RESPONSE_LINE_MAX, "send buffer too small");
+
+typedef enum {
+    ScriptEvtStop = (1 << 0),
+    ScriptEvtSent = (1 << 1),
+    ScriptEvtAnswer = (1 << 2),
+} ScriptEvtFlags;
+
+typedef struct {
+    uint16_t start; // Index of the ScriptOpRepeat
+    uint32_t left; // 0 repeats until stopped
+} ScriptLoop;
+
+struct ScriptRunner {
+    AppState* app;
+    FuriThread* thread;
+    Script* script;
+    char name[64];
+    volatile bool stopping;
+
+    // Set from TX and response callbacks, signalled by thread flags
+    uint32_t sent_id;
+    uint32_t sent_tick;
+    EspResponseStatus answer;
+    uint32_t answer_tick;
+};
+
+static const char* script_skip_space(const char* p, const char* end) {
+    while(p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+static bool script_word_is(const char* word, size_t len, const char* keyword) {
+    return len == strlen(keyword) && memcmp(word, keyword, len) == 0;
+}
+
+static bool script_number(const char* p, size_t len, uint32_t* value) {
+    if(!len || len > 9) return false;
+    uint32_t n = 0;
+    for(size_t i = 0; i < len; i++) {
+        if(p[i] < '0' || p[i] > '9') return false;
+        n = n * 10 + (uint32_t)(p[i] - '0');
+    }
+    *value = n;
+    return true;
+}
+
+// Copies text into the pool, terminated
+static bool script_add_string(Script* script, const char* text, size_t len, uint16_t* offset) {
+    if(script->strings_len + len + 1 > SCRIPT_STRINGS_MAX) return false;
+    *offset = script->strings_len;
+    memcpy(script->strings + script->strings_len, text, len);
+    script->strings[script->strings_len + len] = '\0';
+    script->strings_len += len + 1;
+    return true;
+}
+
+bool script_compile(const char* source, size_t len, Script* script, char* error, size_t error_size) {
+    if(!source || !script) return false;
+    memset(script, 0, sizeof(Script));
+
+    uint16_t open[SCRIPT_LOOP_DEPTH];
+    uint8_t depth = 0;
+    uint32_t line_no = 0;
+    const char* fail = NULL;
+
+    const char* p = source;
+    const char* source_end = source + len;
+    while(p < source_end && !fail) {
+        const char* eol = memchr(p, '\n', source_end - p);
+        const char* line_end = eol ? eol : source_end;
+        const char* next = eol ? eol + 1 : source_end;
+        line_no++;
+
+        while(line_end > p && (line_end[-1] == '\r' || line_end[-1] == ' ' || line_end[-1] == '\t')) {
+            line_end--;
+        }
+        p = script_skip_space(p, line_end);
+        if(p == line_end || *p == '#') {
+            p = next;
+            continue;
+        }
+
+        const char* word = p;
+        while(p < line_end && *p != ' ' && *p != '\t') p++;
+        size_t word_len = p - word;
+        const char* args = script_skip_space(p, line_end);
+        size_t args_len = line_end - args;
+
+        // First token of the arguments, for numbers
+        const char* arg_end = args;
+        while(arg_end < line_end && *arg_end != ' ' && *arg_end != '\t') arg_end++;
+
+        if(script->op_count >= SCRIPT_MAX_OPS) {
+            fail = "too many statements";
+            break;
+        }
+        ScriptOp* op = &script->ops[script->op_count];
+
+        if(script_word_is(word, word_len, "send")) {
+            op->code = ScriptOpSend;
+            if(!args_len) fail = "send needs a command";
+            else if(args_len > SCRIPT_COMMAND_MAX) fail = "command too long";
+            else if(!script_add_string(script, args, args_len, &op->text)) fail = "script too long";
+        } else if(script_word_is(word, word_len, "expect")) {
+            op->code = ScriptOpExpect;
+            op->value = SCRIPT_EXPECT_DEFAULT_MS;
+            if(arg_end < line_end && script_number(args, arg_end - args, &op->value)) {
+                args = script_skip_space(arg_end, line_end);
+                args_len = line_end - args;
+            }
+            if(!args_len) fail = "expect needs a pattern";
+            else if(args_len >= ESP_RESPONSE_PATTERN_MAX) fail = "pattern too long";
+            else if(!script_add_string(script, args, args_len, &op->text)) fail = "script too long";
+        } else if(script_word_is(word, word_len, "delay") || script_word_is(word, word_len, "wait")) {
+            op->code = ScriptOpDelay;
+            if(arg_end != line_end || !script_number(args, args_len, &op->value)) {
+                fail = "delay needs milliseconds";
+            }
+        } else if(script_word_is(word, word_len, "repeat")) {
+            op->code = ScriptOpRepeat;
+            if(arg_end != line_end || !script_number(args, args_len, &op->value)) {
+                fail = "repeat needs a count";
+            } else if(depth >= SCRIPT_LOOP_DEPTH) {
+                fail = "repeat nested too deep";
+            } else {
+                open[depth++] = script->op_count;
+            }
+        } else if(script_word_is(word, word_len, "end")) {
+            op->code = ScriptOpEnd;
+            if(args_len) fail = "end takes no arguments";
+            else if(!depth) fail = "end without repeat";
+            else if(open[depth - 1] + 1 == script->op_count) fail = "empty repeat";
+            else op->value = open[--depth];
+        } else {
+            fail = "unknown statement";
+        }
+
+        if(!fail) script->op_count++;
+        p = next;
+    }
+
+    if(!fail && depth) {
+        fail = "repeat without end";
+        line_no = 0;
+    }
+    if(fail) {
+        if(error && error_size) {
+            if(line_no) {
+                snprintf(error, error_size, "line %lu: %s", (unsigned long)line_no, fail);
+            } else {
+                snprintf(error, error_size, "%s", fail);
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+static void script_runner_log(ScriptRunner* runner, const char* format, ...) {
+    char text[96];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+
+    FURI_LOG_I("Script", "%s", text);
+    UartContext* uart = runner->app->uart_context;
+    if(!uart) return;
+    uart_append_log(uart, "[script] ");
+    uart_append_log(uart, text);
+    uart_append_log(uart, "\n");
+}
+
+static void script_runner_sent(const UartTxResult* result, void* context) {
+    ScriptRunner* runner = context;
+    runner->sent_tick = furi_get_tick();
+    runner->sent_id = result->id;
+    furi_thread_flags_set(furi_thread_get_id(runner->thread), ScriptEvtSent);
+}
+
+static void script_runner_answered(const EspResponseResult* result, void* context) {
+    ScriptRunner* runner = context;
+    runner->answer = result->status;
+    runner->answer_tick = furi_get_tick();
+    furi_thread_flags_set(furi_thread_get_id(runner->thread), ScriptEvtAnswer);
+}
+
+// false once a stop was requested
+static bool script_runner_wait(uint32_t flag, uint32_t timeout_ms) {
+    uint32_t flags = furi_thread_flags_wait(flag | ScriptEvtStop, FuriFlagWaitAny, timeout_ms);
+    if(flags & FuriFlagError) return true;
+    return !(flags & ScriptEvtStop);
+}
+
+static bool script_runner_send(ScriptRunner* runner, const char* text, uint32_t* mark) {
+    char command[ESP_RESPONSE_LINE_MAX];
+    snprintf(command, sizeof(command), "%s\n", text);
+
+    runner->sent_id = 0;
+    uint32_t id = uart_send_ex(
+        runner->app->uart_context,
+        (const uint8_t*)command,
+        strlen(command),
+        UartTxPriorityNormal,
+        script_runner_sent,
+        runner);
+    if(!id) {
+        script_runner_log(runner, "send failed: %s", text);
+        return false;
+    }
+
+    uint32_t start = furi_get_tick();
+    while(runner->sent_id != id) {
+        uint32_t waited = furi_get_tick() - start;
+        if(waited >= SCRIPT_SEND_TIMEOUT_MS) {
+            // Queued but slow, carry on from now
+            *mark = furi_get_tick();
+            return true;
+        }
+        if(!script_runner_wait(ScriptEvtSent, SCRIPT_SEND_TIMEOUT_MS - waited)) return false;
+    }
+    *mark = runner->sent_tick;
+    return true;
+}
+
+static bool script_runner_expect(
+    ScriptRunner* runner,
+    const char* command_text,
+    const char* pattern,
+    uint32_t timeout_ms,
+    uint32_t* mark) {
+    char command[ESP_RESPONSE_LINE_MAX];
+    if(command_text) snprintf(command, sizeof(command), "%s\n", command_text);
+
+    EspRequest request = {
+        .command = command_text ? command : NULL,
+        .expect = pattern,
+        .timeout_ms = timeout_ms,
+        .callback = script_runner_answered,
+        .context = runner,
+    };
+    EspResponse* responses = runner->app->uart_context->responses;
+    uint32_t id = esp_response_request(responses, &request);
+    if(!id) {
+        script_runner_log(runner, "no free request slot");
+        return false;
+    }
+
+    // Every accepted request is answered once, a stop cancels it
+    bool stopped = false;
+    while(true) {
+        uint32_t flags = furi_thread_flags_wait(
+            ScriptEvtAnswer | ScriptEvtStop, FuriFlagWaitAny, FuriWaitForever);
+        if(flags & FuriFlagError) continue;
+        if(flags & ScriptEvtStop) {
+            stopped = true;
+            esp_response_cancel(responses, id);
+        }
+        if(flags & ScriptEvtAnswer) break;
+    }
+    if(stopped) return false;
+
+    if(runner->answer != EspResponseOk) {
+        script_runner_log(runner, "no \"%s\" within %lu ms", pattern, (unsigned long)timeout_ms);
+        return false;
+    }
+    *mark = runner->answer_tick;
+    return true;
+}
+
+static int32_t script_runner_worker(void* context) {
+    ScriptRunner* runner = context;
+    const Script* script = runner->script;
+    ScriptLoop loops[SCRIPT_LOOP_DEPTH];
+    uint8_t depth = 0;
+    uint32_t mark = furi_get_tick();
+    uint16_t pc = 0;
+    bool ok = true;
+
+    script_runner_log(runner, "%s started", runner->name);
+    while(ok && pc < script->op_count && !runner->stopping) {
+        const ScriptOp* op = &script->ops[pc];
+        const char* text = script->strings + op->text;
+
+        switch(op->code) {
+        case ScriptOpSend:
+            if(pc + 1 < script->op_count && script->ops[pc + 1].code == ScriptOpExpect) {
+                // One tracked request, the answer may come before a separate wait would start
+                const ScriptOp* expect = &script->ops[pc + 1];
+                ok = script_runner_expect(
+                    runner, text, script->strings + expect->text, expect->value, &mark);
+                pc += 2;
+            } else {
+                ok = script_runner_send(runner, text, &mark);
+                pc++;
+            }
+            break;
+
+        case ScriptOpExpect:
+            ok = script_runner_expect(runner, NULL, text, op->value, &mark);
+            pc++;
+            break;
+
+        case ScriptOpDelay: {
+            // Absolute, so the time taken by the steps in a loop does not add up
+            uint32_t target = mark + op->value;
+            int32_t remaining = (int32_t)(target - furi_get_tick());
+            if(remaining > 0) ok = script_runner_wait(0, furi_ms_to_ticks(remaining));
+            mark = target;
+            pc++;
+            break;
+        }
+
+        case ScriptOpRepeat:
+            loops[depth].start = pc;
+            loops[depth].left = op->value;
+            depth++;
+            pc++;
+            break;
+
+        case ScriptOpEnd: {
+            ScriptLoop* loop = &loops[depth - 1];
+            bool forever = script->ops[loop->start].value == 0;
+            if(forever || --loop->left > 0) {
+                pc = loop->start + 1;
+            } else {
+                depth--;
+                pc++;
+            }
+            break;
+        }
+
+        default:
+            ok = false;
+            break;
+        }
+    }
+
+    if(runner->stopping || !ok) {
+        script_runner_log(runner, "%s stopped", runner->name);
+    } else {
+        script_runner_log(runner, "%s done", runner->name);
+    }
+    return 0;
+}
+
+ScriptRunner* script_runner_alloc(AppState* app) {
+    ScriptRunner* runner = malloc(sizeof(ScriptRunner));
+    if(!runner) return NULL;
+    memset(runner, 0, sizeof(ScriptRunner));
+    runner->app = app;
+
+    runner->thread = furi_thread_alloc_ex("Script", 2048, script_runner_worker, runner);
+    if(!runner->thread) {
+        free(runner);
+        return NULL;
+    }
+    return runner;
+}
+
+void script_runner_free(ScriptRunner* runner) {
+    if(!runner) return;
+    script_runner_stop(runner);
+    furi_thread_free(runner->thread);
+    free(runner);
+}
+
+bool script_runner_is_running(ScriptRunner* runner) {
+    return runner && furi_thread_get_state(runner->thread) != FuriThreadStateStopped;
+}
+
+void script_runner_stop(ScriptRunner* runner) {
+    if(!runner) return;
+    if(script_runner_is_running(runner)) {
+        runner->stopping = true;
+        furi_thread_flags_set(furi_thread_get_id(runner->thread), ScriptEvtStop);
+        furi_thread_join(runner->thread);
+    }
+    free(runner->script);
+    runner->script = NULL;
+}
+
+static bool script_runner_read(const char* path, char* source, size_t* len) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    bool ok = storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING);
+    if(ok) {
+        // One byte over the limit tells a long script from one that just fits
+        *len = storage_file_read(file, source, SCRIPT_SOURCE_MAX + 1);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return ok;
+}
+
+bool script_runner_load(ScriptRunner* runner, const char* path, char* error, size_t error_size) {
+    if(!runner || !path) return false;
+    if(script_runner_is_running(runner)) {
+        snprintf(error, error_size, "a script is already running");
+        return false;
+    }
+    if(!runner->app->uart_context) {
+        snprintf(error, error_size, "ESP not connected");
+        return false;
+    }
+    // The thread has ended on its own, its script is no longer needed
+    script_runner_stop(runner);
+
+    char* source = malloc(SCRIPT_SOURCE_MAX + 1);
+    Script* script = malloc(sizeof(Script));
+    size_t len = 0;
+    bool ok = source && script;
+    if(!ok) {
+        snprintf(error, error_size, "out of memory");
+    } else if(!script_runner_read(path, source, &len)) {
+        snprintf(error, error_size, "cannot open the file");
+        ok = false;
+    } else if(len > SCRIPT_SOURCE_MAX) {
+        snprintf(error, error_size, "script over %d bytes", SCRIPT_SOURCE_MAX);
+        ok = false;
+    } else {
+        ok = script_compile(source, len, script, error, error_size);
+    }
+    free(source);
+    if(!ok) {
+        free(script);
+        return false;
+    }
+
+    const char* name = strrchr(path, '/');
+    strncpy(runner->name, name ? name + 1 : path, sizeof(runner->name) - 1);
+    runner->name[sizeof(runner->name) - 1] = '\0';
+    runner->script = script;
+    FURI_LOG_I("Script", "%s: %u ops, %u bytes of strings", runner->name, script->op_count, script->strings_len);
+    return true;
+}
+
+bool script_runner_start(ScriptRunner* runner) {
+    if(!runner || !runner->script || script_runner_is_running(runner)) return false;
+    runner->stopping = false;
+    furi_thread_start(runner->thread);
+    return true;
+}
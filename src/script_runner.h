@@ -0,0 +1,90 @@
+#pragma once
+
+#include "app_types.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Script runner
+ *
+ * Runs command scripts from the SD card, one statement per line:
+ *
+ *   send <command>        queue a command for the ESP, up to SCRIPT_COMMAND_MAX characters
+ *   expect [ms] <pattern> wait for an ESP line matching pattern ('*', '?'),
+ *                         default SCRIPT_EXPECT_DEFAULT_MS, a miss ends the script
+ *   delay <ms>            wait, counted from when the previous step finished
+ *   repeat <n> ... end    run the block n times, 0 repeats until stopped
+ *   # comment
+ *
+ * A script is compiled once into fixed 8-byte ops plus a string pool, then
+ * executed on its own thread. A send followed by an expect goes out as one
+ * tracked request, so the answer can not slip in between; delays run on
+ * absolute ticks from the TX completion or the matched line, so loops do not
+ * drift. Progress lines are added to the log view.
+ */
+
+#define SCRIPT_RUNNER_FOLDER      GHOST_ESP_APP_FOLDER "/scripts"
+#define SCRIPT_RUNNER_EXTENSION   ".txt"
+#define SCRIPT_SOURCE_MAX         4096
+#define SCRIPT_MAX_OPS            128
+#define SCRIPT_STRINGS_MAX        2048
+#define SCRIPT_LOOP_DEPTH         4
+#define SCRIPT_COMMAND_MAX        126 // A send with its line ending fits ESP_RESPONSE_LINE_MAX
+#define SCRIPT_EXPECT_DEFAULT_MS  5000
+#define SCRIPT_SEND_TIMEOUT_MS    1000 // TX completion, the queue is drained well before
+
+typedef enum {
+    ScriptOpSend,
+    ScriptOpExpect,
+    ScriptOpDelay,
+    ScriptOpRepeat, // value: count, 0 forever
+    ScriptOpEnd, // value: index of its ScriptOpRepeat
+} ScriptOpCode;
+
+typedef struct {
+    uint8_t code;
+    uint8_t reserved;
+    uint16_t text; // Offset into the string pool
+    uint32_t value;
+} ScriptOp;
+
+typedef struct {
+    ScriptOp ops[SCRIPT_MAX_OPS];
+    uint16_t op_count;
+    uint16_t strings_len;
+    char strings[SCRIPT_STRINGS_MAX];
+} Script;
+
+typedef struct ScriptRunner ScriptRunner;
+
+/**
+ * @brief Compile script source
+ * @param error Receives "line N: ..." when compiling fails
+ */
+bool script_compile(const char* source, size_t len, Script* script, char* error, size_t error_size);
+
+ScriptRunner* script_runner_alloc(AppState* app);
+
+/**
+ * @brief Stop a running script and free, before the UART goes away
+ */
+void script_runner_free(ScriptRunner* runner);
+
+/**
+ * @brief Load and compile the script at path, replacing one that has ended
+ * @param error Receives why nothing was loaded
+ */
+bool script_runner_load(ScriptRunner* runner, const char* path, char* error, size_t error_size);
+
+/**
+ * @brief Run the loaded script, once its output has somewhere to go
+ */
+bool script_runner_start(ScriptRunner* runner);
+
+/**
+ * @brief Stop after the current step, waits for the thread
+ */
+void script_runner_stop(ScriptRunner* runner);
+
+bool script_runner_is_running(ScriptRunner* runner);
@@ -0,0 +1,124 @@
+#include "seen_devices.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SEEN_DEVICES_MAC_CHARS 17
+
+static const uint8_t seen_devices_fingerprint_bits[] = {0, 8, 16};
+
+struct SeenDevices {
+    CuckooFilter* filter;
+    uint8_t index;
+
+    uint8_t mac[6];
+    uint8_t mac_pos; // Characters of the current candidate matched
+    char prev; // Character before the current one
+    bool line_has_mac;
+    bool line_new;
+    bool resume; // The next character is the line ending already reported
+};
+
+static int8_t seen_devices_hex(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void seen_devices_put_nibble(SeenDevices* seen, uint8_t pos, int8_t value) {
+    uint8_t byte = pos / 3;
+    if(pos % 3 == 0) {
+        seen->mac[byte] = value << 4;
+    } else {
+        seen->mac[byte] |= value;
+    }
+}
+
+// Follows "hh:hh:hh:hh:hh:hh", restarting on anything else
+static void seen_devices_match(SeenDevices* seen, char c) {
+    int8_t value = seen_devices_hex(c);
+    bool colon_expected = seen->mac_pos % 3 == 2;
+
+    if(colon_expected ? c == ':' : value >= 0) {
+        if(!colon_expected) seen_devices_put_nibble(seen, seen->mac_pos, value);
+        seen->mac_pos++;
+    } else if(colon_expected && value >= 0) {
+        // Three hex digits in a row, the last two may still start a MAC
+        seen_devices_put_nibble(seen, 0, seen_devices_hex(seen->prev));
+        seen_devices_put_nibble(seen, 1, value);
+        seen->mac_pos = 2;
+    } else {
+        seen->mac_pos = 0;
+    }
+
+    if(seen->mac_pos == SEEN_DEVICES_MAC_CHARS) {
+        seen->mac_pos = 0;
+        if(!seen->line_has_mac) {
+            seen->line_has_mac = true;
+            seen->line_new = cuckoo_filter_add(seen->filter, seen->mac, sizeof(seen->mac));
+        }
+    }
+}
+
+SeenDevices* seen_devices_alloc(uint8_t index) {
+    if(index == 0 || index >= COUNT_OF(seen_devices_fingerprint_bits)) return NULL;
+
+    SeenDevices* seen = malloc(sizeof(SeenDevices));
+    if(!seen) return NULL;
+    memset(seen, 0, sizeof(SeenDevices));
+
+    seen->filter = cuckoo_filter_alloc(SEEN_DEVICES_BUDGET, seen_devices_fingerprint_bits[index]);
+    if(!seen->filter) {
+        FURI_LOG_W("SeenDevices", "No memory for the device filter");
+        free(seen);
+        return NULL;
+    }
+    seen->index = index;
+    return seen;
+}
+
+void seen_devices_free(SeenDevices* seen) {
+    if(!seen) return;
+    cuckoo_filter_free(seen->filter);
+    free(seen);
+}
+
+uint8_t seen_devices_get_index(const SeenDevices* seen) {
+    return seen ? seen->index : 0;
+}
+
+size_t seen_devices_scan(SeenDevices* seen, const uint8_t* data, size_t len) {
+    if(!seen) return len;
+
+    size_t i = 0;
+    if(seen->resume && len) {
+        seen->resume = false;
+        seen->prev = (char)data[0];
+        i = 1;
+    }
+
+    for(; i < len; i++) {
+        char c = (char)data[i];
+        if(c == '\n' || c == '\r') {
+            bool report = seen->line_new;
+            seen->mac_pos = 0;
+            seen->line_has_mac = false;
+            seen->line_new = false;
+            seen->prev = c;
+            if(report) {
+                seen->resume = true;
+                return i;
+            }
+            continue;
+        }
+        seen_devices_match(seen, c);
+        seen->prev = c;
+    }
+    return len;
+}
+
+void seen_devices_get_stats(const SeenDevices* seen, CuckooFilterStats* stats) {
+    if(!seen) return;
+    cuckoo_filter_get_stats(seen->filter, stats);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "cuckoo_filter.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Seen devices
+ *
+ * Watches the ESP's text output for MAC addresses (aa:bb:cc:dd:ee:ff) so
+ * scan results for devices not seen before in this session can be marked.
+ * The first MAC of each line is looked up in a cuckoo filter of
+ * SEEN_DEVICES_BUDGET bytes, so the cost stays the same however many
+ * devices a scan turns up. Matching is done a character at a time without
+ * buffering lines.
+ */
+
+#define SEEN_DEVICES_BUDGET (16 * 1024)
+#define SEEN_DEVICES_MARK   " [NEW]"
+
+typedef struct SeenDevices SeenDevices;
+
+/**
+ * @brief Allocate for a SETTING_MARK_NEW_DEVICES index, NULL when off
+ */
+SeenDevices* seen_devices_alloc(uint8_t index);
+void seen_devices_free(SeenDevices* seen);
+
+/**
+ * @brief Index the instance was allocated for
+ */
+uint8_t seen_devices_get_index(const SeenDevices* seen);
+
+/**
+ * @brief Scan text up to the end of the next line whose first MAC is new
+ * @return Bytes up to, not including, the line ending of that line, or len
+ *         if no such line ends in data. The line ending is consumed by the
+ *         scan, continue the next call at the returned offset.
+ */
+size_t seen_devices_scan(SeenDevices* seen, const uint8_t* data, size_t len);
+
+void seen_devices_get_stats(const SeenDevices* seen, CuckooFilterStats* stats);
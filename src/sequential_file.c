@@ -4,87 +4,216 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include "settings_def.h"
+#include "dir_catalog.h"
 
+#define SEQUENTIAL_FILE_INDEX_PATH    GHOST_ESP_APP_FOLDER "/.seq_index"
+#define SEQUENTIAL_FILE_INDEX_MAGIC   0x31515347 // "GSQ1"
+#define SEQUENTIAL_FILE_CACHE_ENTRIES 16
+#define SEQUENTIAL_FILE_CACHE_KEY_LEN 92
 
-char* sequential_file_resolve_path(
-    Storage* storage,
+// One counter per dir/prefix.ext, next_index is the first unused sequence number
+typedef struct {
+    char key[SEQUENTIAL_FILE_CACHE_KEY_LEN];
+    int32_t next_index;
+} SequentialFileCacheEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+} SequentialFileIndexHeader;
+
+
+static SequentialFileCacheEntry seq_cache[SEQUENTIAL_FILE_CACHE_ENTRIES];
+static size_t seq_cache_count = 0;
+static bool seq_cache_loaded = false;
+static FuriMutex* seq_cache_mutex = NULL;
+
+static void sequential_file_cache_key(
+    char* key,
+    size_t key_size,
     const char* dir,
     const char* prefix,
     const char* extension) {
-    if(storage == NULL || dir == NULL || prefix == NULL || extension == NULL) {
-        FURI_LOG_E("SequentialFile", "Invalid parameters passed to resolve_path");
-        return NULL;
+    snprintf(key, key_size, "%s/%s.%s", dir, prefix, extension);
+}
+
+static void sequential_file_cache_load(Storage* storage) {
+    seq_cache_loaded = true;
+    seq_cache_count = 0;
+
+    File* file = storage_file_alloc(storage);
+    if(!storage_file_open(file, SEQUENTIAL_FILE_INDEX_PATH, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        storage_file_free(file);
+        return;
     }
 
-    // Allocate a file handle for directory operations
-    File* dir_handle = storage_file_alloc(storage);
-    if(!dir_handle) {
-        FURI_LOG_E("SequentialFile", "Failed to allocate file handle for directory");
-        return NULL;
+    SequentialFileIndexHeader header;
+    if(storage_file_read(file, &header, sizeof(header)) == sizeof(header) &&
+       header.magic == SEQUENTIAL_FILE_INDEX_MAGIC && header.count <= SEQUENTIAL_FILE_CACHE_ENTRIES) {
+        size_t bytes = header.count * sizeof(SequentialFileCacheEntry);
+        if(storage_file_read(file, seq_cache, bytes) == bytes) {
+            seq_cache_count = header.count;
+            for(size_t i = 0; i < seq_cache_count; i++) {
+                seq_cache[i].key[SEQUENTIAL_FILE_CACHE_KEY_LEN - 1] = '\0';
+            }
+        }
+    } else {
+        FURI_LOG_W("SequentialFile", "Ignoring invalid index file");
     }
 
-    // Open the directory
-    if(!storage_dir_open(dir_handle, dir)) {
-        FURI_LOG_E("SequentialFile", "Failed to open directory: %s", dir);
-        storage_file_free(dir_handle);
-        return NULL;
+    storage_file_close(file);
+    storage_file_free(file);
+    FURI_LOG_D("SequentialFile", "Loaded %zu cached counters", seq_cache_count);
+}
+
+static void sequential_file_cache_save(Storage* storage) {
+    File* file = storage_file_alloc(storage);
+    if(!storage_file_open(file, SEQUENTIAL_FILE_INDEX_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        FURI_LOG_W("SequentialFile", "Failed to write index file");
+        storage_file_free(file);
+        return;
     }
 
-    FileInfo file_info;
-    char filename[256];
-    int highest_index = -1;
-    size_t prefix_len = strlen(prefix);
-    size_t extension_len = strlen(extension);
+    SequentialFileIndexHeader header = {
+        .magic = SEQUENTIAL_FILE_INDEX_MAGIC,
+        .count = seq_cache_count,
+    };
+    storage_file_write(file, &header, sizeof(header));
+    storage_file_write(file, seq_cache, seq_cache_count * sizeof(SequentialFileCacheEntry));
 
-    // Iterate over files in the directory
-    while(storage_dir_read(dir_handle, &file_info, filename, sizeof(filename))) {
-        // Skip directories
-        if(file_info.flags & FSF_DIRECTORY) continue;
+    storage_file_close(file);
+    storage_file_free(file);
+}
 
-        // Check if filename matches the expected pattern
-        if(strncmp(filename, prefix, prefix_len) != 0) continue;
-        size_t filename_len = strlen(filename);
+static SequentialFileCacheEntry* sequential_file_cache_find(const char* key) {
+    for(size_t i = 0; i < seq_cache_count; i++) {
+        if(strcmp(seq_cache[i].key, key) == 0) return &seq_cache[i];
+    }
+    return NULL;
+}
 
-        // Verify extension
-        if(filename_len <= extension_len + 1) continue; // +1 for '.'
-        if(strcmp(&filename[filename_len - extension_len], extension) != 0) continue;
-        if(filename[filename_len - extension_len - 1] != '.') continue;
+static SequentialFileCacheEntry* sequential_file_cache_insert(const char* key) {
+    if(seq_cache_count == SEQUENTIAL_FILE_CACHE_ENTRIES) {
+        // Full, recycle the oldest slot
+        memmove(&seq_cache[0], &seq_cache[1], (SEQUENTIAL_FILE_CACHE_ENTRIES - 1) * sizeof(SequentialFileCacheEntry));
+        seq_cache_count--;
+    }
+    SequentialFileCacheEntry* entry = &seq_cache[seq_cache_count++];
+    strncpy(entry->key, key, SEQUENTIAL_FILE_CACHE_KEY_LEN - 1);
+    entry->key[SEQUENTIAL_FILE_CACHE_KEY_LEN - 1] = '\0';
+    entry->next_index = 0;
+    return entry;
+}
 
-        // Extract the index part of the filename
-        const char* index_start = filename + prefix_len;
-        if(*index_start != '_') continue;
-        index_start++; // Skip the '_'
+void sequential_file_cache_init(void) {
+    if(!seq_cache_mutex) {
+        seq_cache_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    }
+}
 
-        // Calculate the length of the index string
-        size_t index_len = filename_len - prefix_len - extension_len - 2; // -2 for '_' and '.'
+void sequential_file_cache_deinit(void) {
+    if(seq_cache_mutex) {
+        furi_mutex_free(seq_cache_mutex);
+        seq_cache_mutex = NULL;
+    }
+    seq_cache_loaded = false;
+    seq_cache_count = 0;
+}
 
-        // Copy the index string
-        char index_str[32];
-        if(index_len >= sizeof(index_str)) continue; // Prevent buffer overflow
-        strncpy(index_str, index_start, index_len);
-        index_str[index_len] = '\0';
+void sequential_file_cache_invalidate(Storage* storage, const char* dir) {
+    if(!storage || !dir || !seq_cache_mutex) return;
+    if(furi_mutex_acquire(seq_cache_mutex, FuriWaitForever) != FuriStatusOk) return;
 
-        // Convert index string to integer
-        char* endptr;
-        long index = strtol(index_str, &endptr, 10);
-        if(*endptr != '\0' || index < 0) continue; // Ensure full conversion and non-negative index
+    if(!seq_cache_loaded) sequential_file_cache_load(storage);
 
-        if(index > highest_index) {
-            highest_index = (int)index;
+    size_t dir_len = strlen(dir);
+    size_t kept = 0;
+    for(size_t i = 0; i < seq_cache_count; i++) {
+        bool in_dir = strncmp(seq_cache[i].key, dir, dir_len) == 0 && seq_cache[i].key[dir_len] == '/';
+        if(!in_dir) {
+            if(kept != i) seq_cache[kept] = seq_cache[i];
+            kept++;
         }
     }
 
-    storage_dir_close(dir_handle);
-    storage_file_free(dir_handle);
+    if(kept != seq_cache_count) {
+        seq_cache_count = kept;
+        sequential_file_cache_save(storage);
+        FURI_LOG_I("SequentialFile", "Invalidated counters for %s", dir);
+    }
 
-    // Determine the new index
-    int new_index = highest_index + 1;
+    furi_mutex_release(seq_cache_mutex);
+}
 
-    // Construct the new file path
-    char file_path[256];
-    int snprintf_result = snprintf(file_path, sizeof(file_path), "%s/%s_%d.%s", dir, prefix, new_index, extension);
-    if(snprintf_result < 0 || (size_t)snprintf_result >= sizeof(file_path)) {
+static bool sequential_file_format_path(
+    char* file_path,
+    size_t size,
+    const char* dir,
+    const char* prefix,
+    int index,
+    const char* extension) {
+    int snprintf_result = snprintf(file_path, size, "%s/%s_%d.%s", dir, prefix, index, extension);
+    if(snprintf_result < 0 || (size_t)snprintf_result >= size) {
         FURI_LOG_E("SequentialFile", "snprintf failed or output truncated in resolve_path");
+        return false;
+    }
+    return true;
+}
+
+char* sequential_file_resolve_path(
+    Storage* storage,
+    const char* dir,
+    const char* prefix,
+    const char* extension) {
+    if(storage == NULL || dir == NULL || prefix == NULL || extension == NULL) {
+        FURI_LOG_E("SequentialFile", "Invalid parameters passed to resolve_path");
+        return NULL;
+    }
+
+    char file_path[256];
+    bool cached = seq_cache_mutex &&
+                  furi_mutex_acquire(seq_cache_mutex, FuriWaitForever) == FuriStatusOk;
+
+    SequentialFileCacheEntry* entry = NULL;
+    int new_index = -1;
+
+    if(cached) {
+        if(!seq_cache_loaded) sequential_file_cache_load(storage);
+
+        char key[SEQUENTIAL_FILE_CACHE_KEY_LEN];
+        sequential_file_cache_key(key, sizeof(key), dir, prefix, extension);
+        entry = sequential_file_cache_find(key);
+
+        // Fast path: the cached slot is still free, no directory walk needed
+        if(entry && sequential_file_format_path(
+                        file_path, sizeof(file_path), dir, prefix, entry->next_index, extension) &&
+           !storage_file_exists(storage, file_path)) {
+            new_index = entry->next_index;
+        } else if(!entry) {
+            entry = sequential_file_cache_insert(key);
+        }
+    }
+
+    if(new_index < 0) {
+        // Cache miss or stale counter, fall back to the full scan
+        DirCatalogStats stats;
+        if(!dir_catalog_scan(storage, dir, prefix, extension, &stats)) {
+            if(cached) furi_mutex_release(seq_cache_mutex);
+            return NULL;
+        }
+        new_index = stats.max_index + 1;
+        FURI_LOG_D("SequentialFile", "Scanned %s for %s, next index %d", dir, prefix, new_index);
+    }
+
+    if(cached) {
+        entry->next_index = new_index + 1;
+        sequential_file_cache_save(storage);
+        furi_mutex_release(seq_cache_mutex);
+    }
+
+    // Construct the new file path
+    if(!sequential_file_format_path(file_path, sizeof(file_path), dir, prefix, new_index, extension)) {
         return NULL;
     }
 
@@ -100,6 +229,17 @@ bool sequential_file_open(
     const char* dir,
     const char* prefix,
     const char* extension) {
+    return sequential_file_open_ex(storage, file, dir, prefix, extension, NULL, 0);
+}
+
+bool sequential_file_open_ex(
+    Storage* storage,
+    File* file,
+    const char* dir,
+    const char* prefix,
+    const char* extension,
+    char* out_path,
+    size_t out_path_size) {
     if(storage == NULL || file == NULL || dir == NULL || prefix == NULL || extension == NULL) {
         FURI_LOG_E("SequentialFile", "Invalid parameters passed to open");
         return false;
@@ -114,6 +254,11 @@ bool sequential_file_open(
     // Open the file with the resolved path
     bool success = storage_file_open(file, file_path, FSAM_WRITE, FSOM_CREATE_ALWAYS);
     if(success) {
+        dir_catalog_invalidate(dir);
+        if(out_path && out_path_size) {
+            strncpy(out_path, file_path, out_path_size - 1);
+            out_path[out_path_size - 1] = '\0';
+        }
         FURI_LOG_I("SequentialFile", "Opened log file: %s", file_path);
     } else {
         FURI_LOG_E("SequentialFile", "Failed to open log file: %s", file_path);
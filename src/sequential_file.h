@@ -2,6 +2,19 @@
 
 #include <storage/storage.h>
 
+/**
+ * @brief Enable the persistent sequence counter cache (GHOST_ESP_APP_FOLDER/.seq_index)
+ *
+ * Without it every resolve walks the target directory.
+ */
+void sequential_file_cache_init(void);
+void sequential_file_cache_deinit(void);
+
+/**
+ * @brief Forget cached counters for a directory, e.g. after its files were cleared
+ */
+void sequential_file_cache_invalidate(Storage* storage, const char* dir);
+
 char* sequential_file_resolve_path(
     Storage* storage,
     const char* dir,
@@ -12,4 +25,16 @@ bool sequential_file_open(
     File* file,
     const char* dir,
     const char* prefix,
-    const char* extension);
\ No newline at end of file
+    const char* extension);
+
+/**
+ * @brief sequential_file_open that also returns the path it opened
+ */
+bool sequential_file_open_ex(
+    Storage* storage,
+    File* file,
+    const char* dir,
+    const char* prefix,
+    const char* extension,
+    char* out_path,
+    size_t out_path_size);
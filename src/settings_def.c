@@ -7,6 +7,14 @@ const char* const SETTING_VALUE_NAMES_CHANNEL_HOP[] = {"500ms", "1000ms", "2000m
 const char* const SETTING_VALUE_NAMES_BOOL[] = {"False", "True"};
 const char* const SETTING_VALUE_NAMES_ACTION[] = {"Press OK", "Press OK"};
 const char* const SETTING_VALUE_NAMES_LOG_VIEW[] = {"End", "Start"};
+const char* const SETTING_VALUE_NAMES_AUTO_CLEANUP[] = {"Logs Only", "All Folders", "Off"};
+const char* const SETTING_VALUE_NAMES_CAPTURE_FORMAT[] = {"PCAP", "PCAPNG"};
+const char* const SETTING_VALUE_NAMES_PREALLOCATE[] = {"Off", "256KB", "1MB", "4MB"};
+const char* const SETTING_VALUE_NAMES_CAPTURE_DEDUP[] = {"Off", "10s", "60s", "5min"};
+const char* const SETTING_VALUE_NAMES_WARDRIVE_FORMAT[] = {"CSV", "Binary"};
+const char* const SETTING_VALUE_NAMES_FLIPPER_GPS[] = {"Off", "9600", "38400", "115200"};
+const char* const SETTING_VALUE_NAMES_GPX_SIMPLIFY[] = {"Off", "2 m", "5 m", "10 m", "25 m"};
+const char* const SETTING_VALUE_NAMES_MARK_NEW_DEVICES[] = {"Off", "~3% FP", "~0.01% FP"};
 
 #include "settings_ui.h"
 
@@ -136,6 +144,132 @@ const SettingMetadata SETTING_METADATA[SETTINGS_COUNT] = {
             .uart_command = NULL
         },
         .is_action = false
+    },
+    [SETTING_COMPRESS_LOGS] = {
+        .name = "Compress Logs",
+        .data.setting = {
+            .max_value = 1,
+            .value_names = SETTING_VALUE_NAMES_BOOL,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_AUTO_CLEANUP] = {
+        .name = "Auto Cleanup",
+        .data.setting = {
+            .max_value = 2,
+            .value_names = SETTING_VALUE_NAMES_AUTO_CLEANUP,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_CAPTURE_FORMAT] = {
+        .name = "Capture Format",
+        .data.setting = {
+            .max_value = 1,
+            .value_names = SETTING_VALUE_NAMES_CAPTURE_FORMAT,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_PREALLOCATE] = {
+        .name = "Preallocate",
+        .data.setting = {
+            .max_value = 3,
+            .value_names = SETTING_VALUE_NAMES_PREALLOCATE,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_CAPTURE_DEDUP] = {
+        .name = "Dedup Beacons",
+        .data.setting = {
+            .max_value = 3,
+            .value_names = SETTING_VALUE_NAMES_CAPTURE_DEDUP,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_WARDRIVE_DEDUP] = {
+        .name = "Wardrive Dedup",
+        .data.setting = {
+            .max_value = 1,
+            .value_names = SETTING_VALUE_NAMES_BOOL,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_WARDRIVE_FORMAT] = {
+        .name = "Wardrive Format",
+        .data.setting = {
+            .max_value = 1,
+            .value_names = SETTING_VALUE_NAMES_WARDRIVE_FORMAT,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_FLIPPER_GPS] = {
+        .name = "Flipper GPS",
+        .data.setting = {
+            .max_value = 3,
+            .value_names = SETTING_VALUE_NAMES_FLIPPER_GPS,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_GPX_SIMPLIFY] = {
+        .name = "GPX Simplify",
+        .data.setting = {
+            .max_value = 4,
+            .value_names = SETTING_VALUE_NAMES_GPX_SIMPLIFY,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_MARK_NEW_DEVICES] = {
+        .name = "Mark New Devices",
+        .data.setting = {
+            .max_value = 2,
+            .value_names = SETTING_VALUE_NAMES_MARK_NEW_DEVICES,
+            .uart_command = NULL
+        },
+        .is_action = false
+    },
+    [SETTING_WARDRIVE_MERGE] = {
+        .name = "Merge Wardrives",
+        .data.action = {
+            .name = "Merge Wardrives",
+            .command = NULL,
+            .callback = &run_wardrive_merge
+        },
+        .is_action = true
+    },
+    [SETTING_RUN_SCRIPT] = {
+        .name = "Run Script",
+        .data.action = {
+            .name = "Run Script",
+            .command = NULL,
+            .callback = &run_script
+        },
+        .is_action = true
+    },
+    [SETTING_RUN_SCHEDULE] = {
+        .name = "Run Schedule",
+        .data.action = {
+            .name = "Run Schedule",
+            .command = NULL,
+            .callback = &run_schedule
+        },
+        .is_action = true
+    },
+    [SETTING_STORAGE_BENCH] = {
+        .name = "Storage Benchmark",
+        .data.action = {
+            .name = "Storage Benchmark",
+            .command = NULL,
+            .callback = &run_storage_bench
+        },
+        .is_action = true
     }
 };
 
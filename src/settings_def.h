@@ -19,9 +19,33 @@ typedef enum {
     SETTING_CLEAR_PCAPS,
     SETTING_CLEAR_WARDRIVE,
     SETTING_DISABLE_ESP_CHECK,
+    SETTING_COMPRESS_LOGS,
+    SETTING_AUTO_CLEANUP,
+    SETTING_CAPTURE_FORMAT,
+    SETTING_PREALLOCATE,
+    SETTING_CAPTURE_DEDUP,
+    SETTING_WARDRIVE_DEDUP,
+    SETTING_WARDRIVE_FORMAT,
+    SETTING_FLIPPER_GPS,
+    SETTING_GPX_SIMPLIFY,
+    SETTING_MARK_NEW_DEVICES,
+    SETTING_WARDRIVE_MERGE,
+    SETTING_RUN_SCRIPT,
+    SETTING_RUN_SCHEDULE,
+    SETTING_STORAGE_BENCH,
     SETTINGS_COUNT
 } SettingKey;
 
+// Other custom events of the settings view, past every SettingKey
+typedef enum {
+    APP_EVENT_BG_JOB_DONE = 0x100,
+    APP_EVENT_STOP_ALL_DONE,
+    APP_EVENT_SETTINGS_TXN_FLUSH,
+    APP_EVENT_MENU_PROBED, // ESP health probes, see esp_health_check
+    APP_EVENT_SCRIPT_PROBED,
+    APP_EVENT_SCHEDULE_PROBED,
+} AppEvent;
+
 
 // Settings operations result
 typedef enum {
@@ -48,6 +72,7 @@ typedef enum {
     CHANNEL_HOP_COUNT
 } ChannelHopDelay;
 
+// Stored as is after SettingsHeader, new fields only go at the end
 typedef struct {
     uint8_t rgb_mode_index;
     uint8_t channel_hop_delay_index;
@@ -60,6 +85,16 @@ typedef struct {
     uint8_t clear_logs_index;
     uint8_t clear_nvs_index;
     uint8_t disable_esp_check_index;
+    uint8_t compress_logs_index;
+    uint8_t auto_cleanup_index;
+    uint8_t capture_format_index;
+    uint8_t preallocate_index;
+    uint8_t capture_dedup_index;
+    uint8_t wardrive_dedup_index;
+    uint8_t wardrive_format_index;
+    uint8_t flipper_gps_index;
+    uint8_t gpx_simplify_index;
+    uint8_t mark_new_devices_index;
 } Settings;
 
 // Add this to settings_def.h
@@ -89,6 +124,14 @@ extern const char* const SETTING_VALUE_NAMES_RGB_MODE[];
 extern const char* const SETTING_VALUE_NAMES_CHANNEL_HOP[];
 extern const char* const SETTING_VALUE_NAMES_BOOL[];
 extern const char* const SETTING_VALUE_NAMES_ACTION[];
+extern const char* const SETTING_VALUE_NAMES_AUTO_CLEANUP[];
+extern const char* const SETTING_VALUE_NAMES_CAPTURE_FORMAT[];
+extern const char* const SETTING_VALUE_NAMES_PREALLOCATE[];
+extern const char* const SETTING_VALUE_NAMES_CAPTURE_DEDUP[];
+extern const char* const SETTING_VALUE_NAMES_WARDRIVE_FORMAT[];
+extern const char* const SETTING_VALUE_NAMES_FLIPPER_GPS[];
+extern const char* const SETTING_VALUE_NAMES_GPX_SIMPLIFY[];
+extern const char* const SETTING_VALUE_NAMES_MARK_NEW_DEVICES[];
 
 // Function declarations
 const SettingMetadata* settings_get_metadata(SettingKey key);
@@ -7,7 +7,7 @@ static Storage* storage = NULL;
 
 // Forward declarations of static functions
 static bool write_header(File* file);
-static bool verify_header(File* file);
+static bool verify_header(File* file, uint16_t* settings_count);
 
 bool settings_storage_init() {
     uint32_t start_time = furi_get_tick();
@@ -55,14 +55,16 @@ static bool write_header(File* file) {
     return storage_file_write(file, &header, sizeof(header)) == sizeof(header);
 }
 
-static bool verify_header(File* file) {
+// Files from older versions have fewer settings, they are read as a prefix of Settings
+static bool verify_header(File* file, uint16_t* settings_count) {
     SettingsHeader header;
     if(storage_file_read(file, &header, sizeof(header)) != sizeof(header)) {
         return false;
     }
+    *settings_count = header.settings_count;
     return header.magic == SETTINGS_HEADER_MAGIC &&
            header.version == SETTINGS_FILE_VERSION &&
-           header.settings_count == SETTINGS_COUNT;
+           header.settings_count <= SETTINGS_COUNT;
 }
 
 SettingsResult settings_storage_save(Settings* settings, const char* path) {
@@ -114,7 +116,8 @@ SettingsResult settings_storage_load(Settings* settings, const char* path) {
         return settings_storage_save(settings, path);
     }
 
-    bool success = verify_header(file);
+    uint16_t settings_count = 0;
+    bool success = verify_header(file, &settings_count);
     if(!success) {
         FURI_LOG_E("SettingsStorage", "Invalid header in settings file");
         storage_file_close(file);
@@ -122,7 +125,19 @@ SettingsResult settings_storage_load(Settings* settings, const char* path) {
         return SETTINGS_PARSE_ERROR;
     }
 
-    success = storage_file_read(file, settings, sizeof(Settings)) == sizeof(Settings);
+    // Settings added since the file was written keep their defaults
+    memset(settings, 0, sizeof(Settings));
+    size_t bytes_read = storage_file_read(file, settings, sizeof(Settings));
+    if(settings_count == SETTINGS_COUNT) {
+        success = bytes_read == sizeof(Settings);
+    } else {
+        success = bytes_read > 0;
+        FURI_LOG_I(
+            "SettingsStorage",
+            "Upgraded settings file from %u to %u settings",
+            settings_count,
+            SETTINGS_COUNT);
+    }
     if(!success) {
         FURI_LOG_E("SettingsStorage", "Failed to read settings data");
     }
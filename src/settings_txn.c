@@ -0,0 +1,114 @@
+#include "settings_txn.h"
+#include "settings_ui.h"
+#include "settings_storage.h"
+#include <furi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct SettingsTxn {
+    Settings* settings;
+    ViewDispatcher* view_dispatcher;
+    SettingsTxnSendCallback send;
+    SettingsTxnApplyCallback apply;
+    void* context;
+    FuriTimer* timer;
+
+    bool dirty[SETTINGS_COUNT]; // Changed since the last flush
+    bool any_dirty;
+    uint8_t applied[SETTINGS_COUNT]; // What the ESP was last sent, or the app last applied
+    Settings saved; // What the settings file holds
+};
+
+// Timer thread, the flush itself runs on the GUI thread
+static void settings_txn_timer(void* context) {
+    SettingsTxn* txn = context;
+    view_dispatcher_send_custom_event(txn->view_dispatcher, APP_EVENT_SETTINGS_TXN_FLUSH);
+}
+
+SettingsTxn* settings_txn_alloc(
+    Settings* settings,
+    ViewDispatcher* view_dispatcher,
+    SettingsTxnSendCallback send,
+    SettingsTxnApplyCallback apply,
+    void* context) {
+    if(!settings || !view_dispatcher) return NULL;
+
+    SettingsTxn* txn = malloc(sizeof(SettingsTxn));
+    if(!txn) return NULL;
+    memset(txn, 0, sizeof(SettingsTxn));
+    txn->settings = settings;
+    txn->view_dispatcher = view_dispatcher;
+    txn->send = send;
+    txn->apply = apply;
+    txn->context = context;
+    txn->saved = *settings;
+    for(SettingKey key = 0; key < SETTINGS_COUNT; key++) {
+        txn->applied[key] = settings_get(settings, key);
+    }
+
+    txn->timer = furi_timer_alloc(settings_txn_timer, FuriTimerTypeOnce, txn);
+    if(!txn->timer) {
+        free(txn);
+        return NULL;
+    }
+    return txn;
+}
+
+void settings_txn_free(SettingsTxn* txn) {
+    if(!txn) return;
+    furi_timer_stop(txn->timer);
+    settings_txn_commit(txn);
+    furi_timer_free(txn->timer);
+    free(txn);
+}
+
+void settings_txn_changed(SettingsTxn* txn, SettingKey key) {
+    if(!txn || key >= SETTINGS_COUNT) return;
+    txn->dirty[key] = true;
+    txn->any_dirty = true;
+    furi_timer_start(txn->timer, furi_ms_to_ticks(SETTINGS_TXN_DEBOUNCE_MS));
+}
+
+void settings_txn_flush(SettingsTxn* txn) {
+    if(!txn || !txn->any_dirty) return;
+
+    uint8_t sent = 0;
+    for(SettingKey key = 0; key < SETTINGS_COUNT; key++) {
+        if(!txn->dirty[key]) continue;
+        txn->dirty[key] = false;
+
+        const SettingMetadata* metadata = settings_get_metadata(key);
+        if(!metadata || metadata->is_action) continue;
+
+        uint8_t value = settings_get(txn->settings, key);
+        if(value == txn->applied[key]) continue;
+        txn->applied[key] = value;
+
+        if(!metadata->data.setting.uart_command) {
+            if(txn->apply) txn->apply(key, value, txn->context);
+            continue;
+        }
+
+        char command[64];
+        snprintf(command, sizeof(command), "%s %d\n", metadata->data.setting.uart_command, value + 1);
+        if(txn->send) txn->send(command, txn->context);
+        sent++;
+    }
+    txn->any_dirty = false;
+    if(sent) FURI_LOG_I("SettingsTxn", "Sent %u settings to the ESP", sent);
+}
+
+void settings_txn_commit(SettingsTxn* txn) {
+    if(!txn) return;
+    furi_timer_stop(txn->timer);
+    settings_txn_flush(txn);
+
+    if(memcmp(&txn->saved, txn->settings, sizeof(Settings)) == 0) return;
+    if(settings_storage_save(txn->settings, GHOST_ESP_APP_SETTINGS_FILE) == SETTINGS_OK) {
+        txn->saved = *txn->settings;
+        FURI_LOG_I("SettingsTxn", "Settings saved");
+    } else {
+        FURI_LOG_E("SettingsTxn", "Failed to save settings");
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "settings_def.h"
+#include <gui/view_dispatcher.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Settings transaction
+ *
+ * Changes in the settings list only touch the in-memory Settings. ESP-side
+ * settings are pushed, and app-side ones that restart something (e.g. the
+ * Flipper GPS UART) applied, once the values stopped changing for
+ * SETTINGS_TXN_DEBOUNCE_MS, and the settings file is written once when the
+ * settings view is left (or the app exits). Both compare against what was
+ * last sent, applied or saved, so scrolling a value away and back sends and
+ * writes nothing.
+ */
+
+#define SETTINGS_TXN_DEBOUNCE_MS 1000
+
+typedef struct SettingsTxn SettingsTxn;
+
+typedef void (*SettingsTxnSendCallback)(const char* command, void* context);
+
+/**
+ * @brief A setting without an ESP command settled on a new value
+ */
+typedef void (*SettingsTxnApplyCallback)(SettingKey key, uint8_t value, void* context);
+
+/**
+ * @brief Takes the current settings as what the ESP and the file already have
+ */
+SettingsTxn* settings_txn_alloc(
+    Settings* settings,
+    ViewDispatcher* view_dispatcher,
+    SettingsTxnSendCallback send,
+    SettingsTxnApplyCallback apply,
+    void* context);
+
+/**
+ * @brief Commit what is still pending and free
+ */
+void settings_txn_free(SettingsTxn* txn);
+
+/**
+ * @brief GUI thread: key was changed, restarts the debounce
+ */
+void settings_txn_changed(SettingsTxn* txn, SettingKey key);
+
+/**
+ * @brief GUI thread: handle APP_EVENT_SETTINGS_TXN_FLUSH, send or apply the settings that differ
+ */
+void settings_txn_flush(SettingsTxn* txn);
+
+/**
+ * @brief GUI thread: flush and save the settings file if anything differs from it
+ */
+void settings_txn_commit(SettingsTxn* txn);
@@ -3,10 +3,16 @@
 #include "settings_def.h"
 #include "app_state.h"
 #include "sequential_file.h"
+#include "dir_catalog.h"
+#include "bg_job.h"
+#include "storage_bench.h"
+#include "wardrive_merge.h"
+#include "script_runner.h"
 #include "uart_utils.h"
 #include <furi.h>
 #include <gui/modules/variable_item_list.h>
 #include <storage/storage.h>
+#include <dialogs/dialogs.h>
 #include "settings_storage.h"
 #include "utils.h"
 #include "callbacks.h"
@@ -16,154 +22,327 @@ typedef struct {
     SettingKey key;
 } VariableItemContext;
 
-#define MAX_FILENAME_LEN 256
-#define MAX_PATH_LEN     512
+#define MAX_FILENAME_LEN     256
+#define MAX_PATH_LEN         512
+#define CLEAR_BATCH_SIZE     16
+#define CLEAR_BATCH_NAME_LEN 128
 
 static inline void close_current_log(AppState* app) {
     if(app && app->uart_context && app->uart_context->storageContext &&
        app->uart_context->storageContext->log_file) {
-        storage_file_close(app->uart_context->storageContext->log_file);
+        UartStorageContext* storage = app->uart_context->storageContext;
+        // Waits for a log write in progress, the RX worker skips the file until it is reopened
+        furi_mutex_acquire(storage->mutex, FuriWaitForever);
+        storage->log_paused = true;
+        if(storage->log_compressor) {
+            log_compressor_flush(storage->log_compressor);
+        }
+        storage_file_close(storage->log_file);
+        furi_mutex_release(storage->mutex);
     }
 }
 
 static inline void create_new_log(AppState* app) {
     if(app && app->uart_context && app->uart_context->storageContext) {
-        sequential_file_open(
-            app->uart_context->storageContext->storage_api,
-            app->uart_context->storageContext->log_file,
-            GHOST_ESP_APP_FOLDER_LOGS,
-            "ghost_logs",
-            "txt");
+        UartStorageContext* storage = app->uart_context->storageContext;
+        // Logging stays off if the new file could not be opened
+        furi_mutex_acquire(storage->mutex, FuriWaitForever);
+        storage->log_paused = !uart_storage_open_log(storage);
+        furi_mutex_release(storage->mutex);
     }
 }
 
-void clear_log_files(void* context) {
-    AppState* app = (AppState*)context;
-    if(!app) return;
+typedef struct {
+    AppState* app;
+    const char* dir;
+    const char* tag;
+    bool reopen_log;
+} ClearFilesJob;
 
-    // Close current log file
-    close_current_log(app);
+// Only one background job runs at a time
+static ClearFilesJob clear_files_job;
+
+static bool clear_files_worker(BgJob* job, void* context) {
+    ClearFilesJob* clear = context;
 
     // Stack allocation for better performance
     char filename[MAX_FILENAME_LEN];
     char full_path[MAX_PATH_LEN];
     FileInfo file_info;
-    int deleted_count = 0;
+    uint32_t deleted_count = 0;
+    uint32_t total_count = 0;
+    uint64_t freed_bytes = 0;
+
+    // Names and sizes of one batch, removed together between progress updates
+    char (*batch)[CLEAR_BATCH_NAME_LEN] = malloc(CLEAR_BATCH_SIZE * CLEAR_BATCH_NAME_LEN);
+    uint64_t batch_sizes[CLEAR_BATCH_SIZE];
+    if(!batch) return false;
 
     // Open storage once
     Storage* storage = furi_record_open(RECORD_STORAGE);
     File* dir = storage_file_alloc(storage);
 
-    if(!storage_dir_open(dir, GHOST_ESP_APP_FOLDER_LOGS)) {
-        FURI_LOG_E("ClearLogs", "Failed to open logs directory");
-        goto cleanup;
+    DirCatalogStats stats;
+    if(dir_catalog_get(storage, clear->dir, NULL, NULL, &stats)) {
+        total_count = stats.file_count;
     }
+    bg_job_report(job, 0, total_count, 0);
 
-    // Batch process files
-    while(storage_dir_read(dir, &file_info, filename, MAX_FILENAME_LEN)) {
-        if(file_info.flags & FSF_DIRECTORY) continue;
+    bool success = storage_dir_open(dir, clear->dir);
+    if(!success) {
+        FURI_LOG_E(clear->tag, "Failed to open directory %s", clear->dir);
+    }
 
-        // Construct path only for files
-        snprintf(full_path, MAX_PATH_LEN, "%s/%s", GHOST_ESP_APP_FOLDER_LOGS, filename);
+    bool more = success;
+    while(more && !bg_job_is_cancelled(job)) {
+        size_t batch_count = 0;
+        while(batch_count < CLEAR_BATCH_SIZE) {
+            if(!storage_dir_read(dir, &file_info, filename, MAX_FILENAME_LEN)) {
+                more = false;
+                break;
+            }
+            if(file_info.flags & FSF_DIRECTORY) continue;
+            if(strlen(filename) >= CLEAR_BATCH_NAME_LEN) continue;
 
-        // Remove file directly without extra existence check
-        if(storage_simply_remove(storage, full_path)) {
-            deleted_count++;
+            strcpy(batch[batch_count], filename);
+            batch_sizes[batch_count] = file_info.size;
+            batch_count++;
         }
+
+        for(size_t i = 0; i < batch_count; i++) {
+            snprintf(full_path, MAX_PATH_LEN, "%s/%s", clear->dir, batch[i]);
+
+            // Remove file directly without extra existence check
+            if(storage_simply_remove(storage, full_path)) {
+                deleted_count++;
+                freed_bytes += batch_sizes[i];
+            }
+        }
+
+        bg_job_report(job, deleted_count, total_count, freed_bytes);
+
+        // Let the UART and GUI threads get at the card between batches
+        furi_thread_yield();
     }
 
-    FURI_LOG_I("ClearLogs", "Deleted %d files", deleted_count);
+    FURI_LOG_I(clear->tag, "Deleted %lu files", deleted_count);
+    sequential_file_cache_invalidate(storage, clear->dir);
+    dir_catalog_invalidate(clear->dir);
 
-cleanup:
     // Cleanup resources
     storage_dir_close(dir);
     storage_file_free(dir);
     furi_record_close(RECORD_STORAGE);
+    free(batch);
+
+    return success;
+}
+
+static void clear_files_done(BgJob* job, void* context) {
+    UNUSED(job);
+    ClearFilesJob* clear = context;
 
     // Create new log file
-    create_new_log(app);
+    if(clear->reopen_log) {
+        create_new_log(clear->app);
+    }
+}
+
+// Check before closing files for a job, a refused job must leave them open
+static bool bg_job_busy(AppState* app, const char* tag) {
+    if(app->bg_job && !bg_job_is_active(app->bg_job)) return false;
+    FURI_LOG_W(tag, "Another job is still running");
+    return true;
+}
+
+static bool start_bg_job(AppState* app, const BgJobSpec* spec) {
+    if(!bg_job_start(app->bg_job, spec)) return false;
+    app->previous_view = app->current_view;
+    view_dispatcher_switch_to_view(app->view_dispatcher, 9);
+    app->current_view = 9;
+    return true;
+}
+
+static void clear_files_start(AppState* app, const char* title, const char* dir, const char* tag, bool reopen_log) {
+    clear_files_job.app = app;
+    clear_files_job.dir = dir;
+    clear_files_job.tag = tag;
+    clear_files_job.reopen_log = reopen_log;
+
+    BgJobSpec spec = {
+        .title = title,
+        .item_label = "files deleted",
+        .bytes_label = "freed",
+        .worker = clear_files_worker,
+        .on_done = clear_files_done,
+        .context = &clear_files_job,
+    };
+
+    if(!start_bg_job(app, &spec) && reopen_log) {
+        create_new_log(app);
+    }
+}
+
+void clear_log_files(void* context) {
+    AppState* app = (AppState*)context;
+    if(!app || bg_job_busy(app, "ClearLogs")) return;
+
+    // Close current log file
+    close_current_log(app);
+
+    clear_files_start(app, "Clearing Logs", GHOST_ESP_APP_FOLDER_LOGS, "ClearLogs", true);
 }
 
 void clear_pcap_files(void* context) {
     AppState* app = (AppState*)context;
-    if(!app) return;
+    if(!app || bg_job_busy(app, "ClearPCAPs")) return;
 
     // Close current file if open
-    if(app->uart_context && app->uart_context->storageContext &&
-       app->uart_context->storageContext->current_file) {
-        storage_file_close(app->uart_context->storageContext->current_file);
+    if(app->uart_context && app->uart_context->storageContext) {
+        uart_storage_close_capture(app->uart_context->storageContext);
     }
 
-    // Stack allocation for better performance
-    char filename[MAX_FILENAME_LEN];
-    char full_path[MAX_PATH_LEN];
-    FileInfo file_info;
-    int deleted_count = 0;
+    clear_files_start(app, "Clearing PCAPs", GHOST_ESP_APP_FOLDER_PCAPS, "ClearPCAPs", false);
+}
 
-    // Open storage once
-    Storage* storage = furi_record_open(RECORD_STORAGE);
-    File* dir = storage_file_alloc(storage);
+void clear_wardrive_files(void* context) {
+    AppState* app = (AppState*)context;
+    if(!app || bg_job_busy(app, "ClearWardrive")) return;
 
-    if(!storage_dir_open(dir, GHOST_ESP_APP_FOLDER_PCAPS)) {
-        FURI_LOG_E("ClearPCAPs", "Failed to open pcaps directory");
-        goto cleanup;
+    // Close current file if open
+    if(app->uart_context && app->uart_context->storageContext) {
+        uart_storage_close_capture(app->uart_context->storageContext);
     }
 
-    // Batch process files
-    while(storage_dir_read(dir, &file_info, filename, MAX_FILENAME_LEN)) {
-        if(file_info.flags & FSF_DIRECTORY) continue;
-
-        snprintf(full_path, MAX_PATH_LEN, "%s/%s", GHOST_ESP_APP_FOLDER_PCAPS, filename);
+    clear_files_start(app, "Clearing Wardrives", GHOST_ESP_APP_FOLDER_WARDRIVE, "ClearWardrive", false);
+}
 
-        if(storage_simply_remove(storage, full_path)) {
-            deleted_count++;
-        }
-    }
+void run_wardrive_merge(void* context) {
+    AppState* app = (AppState*)context;
+    if(!app || bg_job_busy(app, "WardriveMerge")) return;
+
+    BgJobSpec spec = {
+        .title = "Merging Wardrives",
+        .item_label = "files read",
+        .bytes_label = "read",
+        .worker = wardrive_merge_worker,
+        .on_done = NULL,
+        .context = NULL,
+    };
+    start_bg_job(app, &spec);
+}
 
-    FURI_LOG_I("ClearPCAPs", "Deleted %d files", deleted_count);
+void run_storage_bench(void* context) {
+    AppState* app = (AppState*)context;
+    if(!app || bg_job_busy(app, "StorageBench")) return;
+
+    BgJobSpec spec = {
+        .title = "Storage Benchmark",
+        .item_label = "tests",
+        .bytes_label = "written",
+        .worker = storage_bench_worker,
+        .on_done = NULL,
+        .context = NULL,
+    };
+    start_bg_job(app, &spec);
+}
 
-cleanup:
-    storage_dir_close(dir);
-    storage_file_free(dir);
-    furi_record_close(RECORD_STORAGE);
+static void show_action_error(AppState* app, const char* header, const char* error) {
+    static char text[96];
+    SettingsConfirmContext* confirm_ctx = malloc(sizeof(SettingsConfirmContext));
+    if(!confirm_ctx) return;
+    confirm_ctx->state = app;
+    // The view keeps the pointer until it is dismissed
+    snprintf(text, sizeof(text), "%s", error);
+
+    confirmation_view_set_header(app->confirmation_view, header);
+    confirmation_view_set_text(app->confirmation_view, text);
+    app->previous_view = app->current_view;
+    confirmation_view_set_ok_callback(app->confirmation_view, app_info_ok_callback, confirm_ctx);
+    confirmation_view_set_cancel_callback(
+        app->confirmation_view, app_info_cancel_callback, confirm_ctx);
+    view_dispatcher_switch_to_view(app->view_dispatcher, 7);
+    app->current_view = 7;
 }
 
-void clear_wardrive_files(void* context) {
+void run_script(void* context) {
     AppState* app = (AppState*)context;
-    if(!app) return;
+    if(!app || !app->script_runner || !app->uart_context) return;
 
-    // Stack allocation for better performance
-    char filename[MAX_FILENAME_LEN];
-    char full_path[MAX_PATH_LEN];
-    FileInfo file_info;
-    int deleted_count = 0;
+    // Probing, APP_EVENT_SCRIPT_PROBED comes back here once the ESP answered
+    if(!esp_health_check(app->uart_context->health, APP_EVENT_SCRIPT_PROBED)) return;
 
-    // Open storage once
     Storage* storage = furi_record_open(RECORD_STORAGE);
-    File* dir = storage_file_alloc(storage);
+    storage_simply_mkdir(storage, GHOST_ESP_APP_FOLDER);
+    storage_simply_mkdir(storage, SCRIPT_RUNNER_FOLDER);
+    furi_record_close(RECORD_STORAGE);
 
-    if(!storage_dir_open(dir, GHOST_ESP_APP_FOLDER_WARDRIVE)) {
-        FURI_LOG_E("ClearWardrive", "Failed to open wardrive directory");
-        goto cleanup;
+    DialogsFileBrowserOptions options;
+    dialog_file_browser_set_basic_options(&options, SCRIPT_RUNNER_EXTENSION, NULL);
+    options.base_path = SCRIPT_RUNNER_FOLDER;
+    FuriString* path = furi_string_alloc_set_str(SCRIPT_RUNNER_FOLDER);
+
+    DialogsApp* dialogs = furi_record_open(RECORD_DIALOGS);
+    bool picked = dialog_file_browser_show(dialogs, path, path, &options);
+    furi_record_close(RECORD_DIALOGS);
+
+    if(picked) {
+        char error[64] = "";
+        if(!script_runner_load(
+                      app->script_runner, furi_string_get_cstr(path), error, sizeof(error))) {
+            FURI_LOG_W("Script", "Not started: %s", error);
+            show_action_error(app, "Script Error", error);
+        } else {
+            // The log view clears the text box, the script's first lines come after it
+            uart_receive_data(app->uart_context, app->view_dispatcher, app, "", "", "");
+            script_runner_start(app->script_runner);
+        }
     }
+    furi_string_free(path);
+}
 
-    // Batch process files
-    while(storage_dir_read(dir, &file_info, filename, MAX_FILENAME_LEN)) {
-        if(file_info.flags & FSF_DIRECTORY) continue;
+void run_schedule(void* context) {
+    AppState* app = (AppState*)context;
+    if(!app || !app->uart_context) return;
 
-        snprintf(full_path, MAX_PATH_LEN, "%s/%s", GHOST_ESP_APP_FOLDER_WARDRIVE, filename);
+    // Probing, APP_EVENT_SCHEDULE_PROBED comes back here once the ESP answered
+    if(!esp_health_check(app->uart_context->health, APP_EVENT_SCHEDULE_PROBED)) return;
 
-        if(storage_simply_remove(storage, full_path)) {
-            deleted_count++;
-        }
+    char error[64] = "";
+    size_t jobs = cmd_scheduler_load(
+        app->uart_context->scheduler, CMD_SCHEDULER_FILE, error, sizeof(error));
+    if(!jobs) {
+        FURI_LOG_W("Schedule", "Nothing scheduled: %s", error);
+        show_action_error(app, "Schedule Error", error);
+        return;
     }
 
-    FURI_LOG_I("ClearWardrive", "Deleted %d files", deleted_count);
+    char line[48];
+    snprintf(line, sizeof(line), "[schedule] %u jobs, Back stops them\n", (unsigned)jobs);
+    uart_receive_data(app->uart_context, app->view_dispatcher, app, "", "", "");
+    uart_append_log(app->uart_context, line);
+}
 
-cleanup:
-    storage_dir_close(dir);
-    storage_file_free(dir);
-    furi_record_close(RECORD_STORAGE);
+void settings_bg_job_dismissed(BgJob* job, void* context) {
+    UNUSED(job);
+    AppState* app = context;
+
+    view_dispatcher_switch_to_view(app->view_dispatcher, app->previous_view);
+    app->current_view = app->previous_view;
+}
+
+void settings_apply(SettingKey key, uint8_t value, void* context) {
+    AppState* app = context;
+    if(!app || !app->uart_context) return;
+
+    switch(key) {
+    case SETTING_FLIPPER_GPS:
+        // Restarts the GPS UART, only once the value stopped changing
+        uart_gps_start(app->uart_context, gps_nmea_baud_for_index(value));
+        break;
+    default:
+        break;
+    }
 }
 
 bool settings_set(Settings* settings, SettingKey key, uint8_t value, void* context) {
@@ -249,6 +428,10 @@ bool settings_set(Settings* settings, SettingKey key, uint8_t value, void* conte
     case SETTING_CLEAR_NVS:
     case SETTING_CLEAR_PCAPS:
     case SETTING_CLEAR_WARDRIVE:
+    case SETTING_WARDRIVE_MERGE:
+    case SETTING_RUN_SCRIPT:
+    case SETTING_RUN_SCHEDULE:
+    case SETTING_STORAGE_BENCH:
         if(value == 0) { // Execute on press
             SettingsUIContext* settings_context = (SettingsUIContext*)context;
             if(settings_context && settings_context->context) {
@@ -273,14 +456,90 @@ bool settings_set(Settings* settings, SettingKey key, uint8_t value, void* conte
         }
         break;
 
+    case SETTING_COMPRESS_LOGS:
+        if(settings->compress_logs_index != value) {
+            settings->compress_logs_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_AUTO_CLEANUP:
+        if(settings->auto_cleanup_index != value) {
+            settings->auto_cleanup_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_CAPTURE_FORMAT:
+        if(settings->capture_format_index != value) {
+            settings->capture_format_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_PREALLOCATE:
+        if(settings->preallocate_index != value) {
+            settings->preallocate_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_CAPTURE_DEDUP:
+        if(settings->capture_dedup_index != value) {
+            settings->capture_dedup_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_WARDRIVE_DEDUP:
+        if(settings->wardrive_dedup_index != value) {
+            settings->wardrive_dedup_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_WARDRIVE_FORMAT:
+        if(settings->wardrive_format_index != value) {
+            settings->wardrive_format_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_FLIPPER_GPS:
+        if(settings->flipper_gps_index != value) {
+            settings->flipper_gps_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_GPX_SIMPLIFY:
+        if(settings->gpx_simplify_index != value) {
+            settings->gpx_simplify_index = value;
+            changed = true;
+        }
+        break;
+
+    case SETTING_MARK_NEW_DEVICES:
+        if(settings->mark_new_devices_index != value) {
+            settings->mark_new_devices_index = value;
+            changed = true;
+        }
+        break;
+
     default:
         return false;
     }
 
     if(changed) {
-        FURI_LOG_I("SettingsSet", "Setting changed, saving to storage");
-        // Save settings to storage
-        settings_storage_save(settings, GHOST_ESP_APP_SETTINGS_FILE);
+        // Sent to the ESP once the value settles, saved when leaving the settings view
+        SettingsUIContext* settings_context = (SettingsUIContext*)context;
+        AppState* app_state = settings_context ? (AppState*)settings_context->context : NULL;
+        if(app_state && app_state->settings_txn) {
+            settings_txn_changed(app_state->settings_txn, key);
+        } else {
+            FURI_LOG_I("SettingsSet", "Setting changed, saving to storage");
+            settings_storage_save(settings, GHOST_ESP_APP_SETTINGS_FILE);
+        }
     }
 
     return true;
@@ -314,6 +573,36 @@ uint8_t settings_get(const Settings* settings, SettingKey key) {
     case SETTING_DISABLE_ESP_CHECK:
         return settings->disable_esp_check_index;
 
+    case SETTING_COMPRESS_LOGS:
+        return settings->compress_logs_index;
+
+    case SETTING_AUTO_CLEANUP:
+        return settings->auto_cleanup_index;
+
+    case SETTING_CAPTURE_FORMAT:
+        return settings->capture_format_index;
+
+    case SETTING_PREALLOCATE:
+        return settings->preallocate_index;
+
+    case SETTING_CAPTURE_DEDUP:
+        return settings->capture_dedup_index;
+
+    case SETTING_WARDRIVE_DEDUP:
+        return settings->wardrive_dedup_index;
+
+    case SETTING_WARDRIVE_FORMAT:
+        return settings->wardrive_format_index;
+
+    case SETTING_FLIPPER_GPS:
+        return settings->flipper_gps_index;
+
+    case SETTING_GPX_SIMPLIFY:
+        return settings->gpx_simplify_index;
+
+    case SETTING_MARK_NEW_DEVICES:
+        return settings->mark_new_devices_index;
+
     case SETTING_REBOOT_ESP:
     case SETTING_CLEAR_LOGS:
     case SETTING_CLEAR_NVS:
@@ -375,7 +664,9 @@ static void settings_item_change_callback(VariableItem* item) {
 
     if(settings_set(context->settings, key, value, context)) {
         variable_item_set_current_value_text(item, metadata->data.setting.value_names[value]);
-        if(metadata->data.setting.uart_command && context->send_uart_command) {
+        AppState* app_state = (AppState*)context->context;
+        bool batched = app_state && app_state->settings_txn;
+        if(!batched && metadata->data.setting.uart_command && context->send_uart_command) {
             char command[64];
             snprintf(
                 command,
@@ -385,6 +676,8 @@ static void settings_item_change_callback(VariableItem* item) {
                 value + 1);
             FURI_LOG_D("SettingsChange", "Sending UART command: %s", command);
             context->send_uart_command(command, context->context);
+        } else if(!batched && !metadata->data.setting.uart_command) {
+            settings_apply(key, value, app_state);
         }
     }
 }
@@ -514,6 +807,72 @@ bool settings_custom_event_callback(void* context, uint32_t event_id) {
             nvs_clear_cancelled_callback);
         return true;
 
+    case SETTING_WARDRIVE_MERGE:
+        show_confirmation_dialog_ex(
+            app_state,
+            "Merge Wardrives",
+            "Merge all wardrive CSVs\n"
+            "into one file with one\n"
+            "row per network?\n"
+            "The originals are kept.",
+            wardrive_merge_confirmed_callback,
+            wardrive_merge_cancelled_callback);
+        return true;
+
+    case SETTING_RUN_SCRIPT:
+        run_script(app_state);
+        return true;
+
+    case SETTING_RUN_SCHEDULE:
+        run_schedule(app_state);
+        return true;
+
+    case SETTING_STORAGE_BENCH:
+        show_confirmation_dialog_ex(
+            app_state,
+            "Storage Benchmark",
+            "Write ~4MB of test data\n"
+            "to measure the SD card?\n"
+            "Results are appended to\n"
+            "ghost_esp/storage_bench.csv\n",
+            storage_bench_confirmed_callback,
+            storage_bench_cancelled_callback);
+        return true;
+
+    case APP_EVENT_BG_JOB_DONE:
+        bg_job_handle_done(app_state->bg_job);
+        return true;
+
+    case APP_EVENT_SETTINGS_TXN_FLUSH:
+        settings_txn_flush(app_state->settings_txn);
+        return true;
+
+    case APP_EVENT_SCRIPT_PROBED:
+        if(esp_health_is_connected(app_state->uart_context->health)) {
+            run_script(app_state);
+        } else {
+            show_action_error(app_state, "Script Error", "ESP not connected");
+        }
+        return true;
+
+    case APP_EVENT_SCHEDULE_PROBED:
+        if(esp_health_is_connected(app_state->uart_context->health)) {
+            run_schedule(app_state);
+        } else {
+            show_action_error(app_state, "Schedule Error", "ESP not connected");
+        }
+        return true;
+
+    case APP_EVENT_MENU_PROBED:
+        menu_probe_done(app_state);
+        return true;
+
+    case APP_EVENT_STOP_ALL_DONE:
+        if(app_state->uart_context) {
+            stop_all_handle_done(app_state->uart_context->stop_all);
+        }
+        return true;
+
     case SETTING_SHOW_INFO: {
         // Create a new context for the confirmation dialog
         SettingsConfirmContext* confirm_ctx = malloc(sizeof(SettingsConfirmContext));
@@ -2,6 +2,7 @@
 
 #include "app_types.h"
 #include "settings_def.h"
+#include "bg_job.h"
 #include <gui/modules/variable_item_list.h>
 
 // Function pointer types
@@ -21,5 +22,11 @@ typedef struct {
 void clear_log_files(void* context); 
 void settings_setup_gui(VariableItemList* list, SettingsUIContext* context);
 bool settings_set(Settings* settings, SettingKey key, uint8_t value, void* context);
+
+/**
+ * @brief Apply an app-side setting that restarts something, the SettingsTxnApplyCallback
+ */
+void settings_apply(SettingKey key, uint8_t value, void* context);
 uint8_t settings_get(const Settings* settings, SettingKey key);
 bool settings_custom_event_callback(void* context, uint32_t event);
+void settings_bg_job_dismissed(BgJob* job, void* context);
@@ -0,0 +1,294 @@
+#include "stop_all.h"
+#include "uart_utils.h"
+#include "app_state.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STOP_ALL_GENERAL "stop\n" // For anything without a dedicated stop command
+
+typedef struct {
+    const char* prefix; // Commands starting an operation of this kind
+    const char* stop;
+} StopAllOp;
+
+// First matching prefix wins, more specific ones come first
+static const StopAllOp stop_all_ops[] = {
+    {"capture -ble", "capture -blestop\n"},
+    {"capture -skimmer", "capture -blestop\n"},
+    {"capture -", "capture -stop\n"},
+    {"scan", "stopscan\n"},
+    {"beaconspam", "stopspam\n"},
+    {"attack -d", "stopdeauth\n"},
+    {"startportal", "stopportal\n"},
+    {"blescan", "blescan -s\n"},
+    {"gpsinfo", "gpsinfo -s\n"},
+    {"startwd", "startwd -s\n"},
+    {"blewardriving", "blewardriving -s\n"},
+    {"rgbmode", "rgbmode off\n"},
+};
+
+// Probes and heartbeats, they start nothing
+static const char* const stop_all_passive[] = {
+    "AT\n",
+    "chipinfo\n",
+    "help\n",
+};
+
+// Settings and target selection, they start nothing either
+static const char* const stop_all_passive_prefixes[] = {
+    "setsetting ",
+    "select ",
+};
+
+#define STOP_ALL_OP_CAPTURE 2 // "capture -"
+#define STOP_ALL_OP_OTHER   COUNT_OF(stop_all_ops)
+
+struct StopAll {
+    UartContext* uart;
+    FuriMutex* mutex; // Guards ops and the transaction, touched from the GUI, TX, RX and timer threads
+    FuriTimer* timer;
+    uint32_t ops; // Bit per stop_all_ops entry, plus STOP_ALL_OP_OTHER
+
+    // Current transaction
+    bool pending;
+    bool posted; // APP_EVENT_STOP_ALL_DONE is on its way
+    bool timed_out;
+    bool wait_capture; // A capture stream was open when the stop started
+    bool rx_after; // ESP output after the last stop command went out
+    uint32_t last_id; // TX id of the last stop command, 0 if it was dropped
+    uint32_t sent_id; // Set by the TX thread, may arrive before last_id is known
+    uint32_t start_tick;
+    uint8_t commands;
+};
+
+// data without its line ending, table commands end in '\n'
+static bool stop_all_command_is(const uint8_t* data, size_t len, const char* command) {
+    return len == strlen(command) - 1 && memcmp(data, command, len) == 0;
+}
+
+static bool stop_all_command_starts(const uint8_t* data, size_t len, const char* prefix) {
+    size_t prefix_len = strlen(prefix);
+    return len >= prefix_len && memcmp(data, prefix, prefix_len) == 0;
+}
+
+static void stop_all_sent(const UartTxResult* result, void* context) {
+    StopAll* stop = context;
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    stop->sent_id = result->id;
+    furi_mutex_release(stop->mutex);
+}
+
+// Called with the mutex held
+static bool stop_all_sent_all(const StopAll* stop) {
+    return !stop->last_id || stop->sent_id == stop->last_id;
+}
+
+// The ESP closed the stream and the RX worker wrote every byte before the close
+static bool stop_all_capture_flushed(UartContext* uart) {
+    if(uart->pcap) return false;
+    if(furi_stream_buffer_bytes_available(uart->pcap_stream)) return false;
+    if(!uart->storageContext) return true;
+
+    // The RX worker holds it from taking bytes off the stream until they are written
+    FuriMutex* storage_mutex = uart->storageContext->mutex;
+    if(furi_mutex_acquire(storage_mutex, 0) != FuriStatusOk) return false;
+    bool flushed = !furi_stream_buffer_bytes_available(uart->pcap_stream);
+    furi_mutex_release(storage_mutex);
+    return flushed;
+}
+
+// Timer thread, the GUI thread finishes the transaction
+static void stop_all_poll(void* context) {
+    StopAll* stop = context;
+    bool post = false;
+
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    if(stop->pending && !stop->posted) {
+        bool acked = stop_all_sent_all(stop) &&
+                     (stop->wait_capture ? stop_all_capture_flushed(stop->uart) : stop->rx_after);
+        bool expired = furi_get_tick() - stop->start_tick >= STOP_ALL_TIMEOUT_MS;
+        if(acked || expired) {
+            stop->timed_out = !acked;
+            stop->posted = true;
+            post = true;
+        }
+    }
+    furi_mutex_release(stop->mutex);
+
+    if(post) {
+        view_dispatcher_send_custom_event(stop->uart->state->view_dispatcher, APP_EVENT_STOP_ALL_DONE);
+    }
+}
+
+StopAll* stop_all_alloc(struct UartContext* uart) {
+    StopAll* stop = malloc(sizeof(StopAll));
+    if(!stop) return NULL;
+    memset(stop, 0, sizeof(StopAll));
+    stop->uart = uart;
+
+    stop->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    stop->timer = furi_timer_alloc(stop_all_poll, FuriTimerTypePeriodic, stop);
+    if(!stop->mutex || !stop->timer) {
+        stop_all_free(stop);
+        return NULL;
+    }
+    return stop;
+}
+
+void stop_all_free(StopAll* stop) {
+    if(!stop) return;
+    if(stop->timer) {
+        furi_timer_stop(stop->timer);
+        furi_timer_free(stop->timer);
+    }
+    if(stop->mutex) furi_mutex_free(stop->mutex);
+    free(stop);
+}
+
+void stop_all_note_command(StopAll* stop, const uint8_t* data, size_t len) {
+    if(!stop || !data) return;
+    while(len && (data[len - 1] == '\n' || data[len - 1] == '\r')) len--;
+    if(!len) return;
+
+    for(size_t i = 0; i < COUNT_OF(stop_all_passive); i++) {
+        if(stop_all_command_is(data, len, stop_all_passive[i])) return;
+    }
+    for(size_t i = 0; i < COUNT_OF(stop_all_passive_prefixes); i++) {
+        if(stop_all_command_starts(data, len, stop_all_passive_prefixes[i])) return;
+    }
+
+    uint32_t set = 0, clear = 0;
+    for(size_t i = 0; i < COUNT_OF(stop_all_ops); i++) {
+        if(stop_all_command_is(data, len, stop_all_ops[i].stop)) clear |= 1UL << i;
+    }
+    if(stop_all_command_is(data, len, STOP_ALL_GENERAL)) clear |= 1UL << STOP_ALL_OP_OTHER;
+
+    if(!clear) {
+        set = 1UL << STOP_ALL_OP_OTHER;
+        for(size_t i = 0; i < COUNT_OF(stop_all_ops); i++) {
+            if(stop_all_command_starts(data, len, stop_all_ops[i].prefix)) {
+                set = 1UL << i;
+                break;
+            }
+        }
+    }
+
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    stop->ops = (stop->ops & ~clear) | set;
+    furi_mutex_release(stop->mutex);
+}
+
+bool stop_all_start(StopAll* stop) {
+    if(!stop) return false;
+
+    UartContext* uart = stop->uart;
+    bool capture = uart->pcap;
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    uint32_t ops = stop->ops;
+    stop->ops = 0;
+    if(capture) ops |= 1UL << STOP_ALL_OP_CAPTURE;
+    if(ops) {
+        stop->pending = false;
+        stop->posted = false;
+        stop->timed_out = false;
+        stop->wait_capture = capture;
+        stop->rx_after = false;
+        stop->last_id = 0;
+        stop->sent_id = 0;
+        stop->commands = 0;
+        stop->start_tick = furi_get_tick();
+    }
+    furi_mutex_release(stop->mutex);
+    if(!ops) return false;
+
+    // Entries can share a stop command, each one is sent once
+    const char* commands[COUNT_OF(stop_all_ops) + 1];
+    for(size_t i = 0; i <= STOP_ALL_OP_OTHER; i++) {
+        if(!(ops & (1UL << i))) continue;
+        const char* command = i == STOP_ALL_OP_OTHER ? STOP_ALL_GENERAL : stop_all_ops[i].stop;
+        bool seen = false;
+        for(uint8_t j = 0; j < stop->commands && !seen; j++) {
+            seen = strcmp(commands[j], command) == 0;
+        }
+        if(!seen) commands[stop->commands++] = command;
+    }
+
+    // uart_send_ex notes each command, which takes the mutex
+    uint32_t last_id = 0;
+    for(uint8_t i = 0; i < stop->commands; i++) {
+        bool last = i + 1 == stop->commands;
+        uint32_t id = uart_send_ex(
+            uart,
+            (const uint8_t*)commands[i],
+            strlen(commands[i]),
+            UartTxPriorityHigh,
+            last ? stop_all_sent : NULL,
+            last ? stop : NULL);
+        if(last) last_id = id;
+    }
+
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    stop->last_id = last_id;
+    stop->pending = true;
+    furi_mutex_release(stop->mutex);
+    furi_timer_start(stop->timer, furi_ms_to_ticks(STOP_ALL_POLL_MS));
+    FURI_LOG_D("StopAll", "Stopping with %u commands", stop->commands);
+    return true;
+}
+
+bool stop_all_is_pending(StopAll* stop) {
+    if(!stop) return false;
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    bool pending = stop->pending;
+    furi_mutex_release(stop->mutex);
+    return pending;
+}
+
+void stop_all_cancel(StopAll* stop) {
+    if(!stop) return;
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    bool pending = stop->pending;
+    stop->pending = false;
+    furi_mutex_release(stop->mutex);
+    if(!pending) return;
+
+    furi_timer_stop(stop->timer);
+    FURI_LOG_D("StopAll", "Cancelled after %lu ms", furi_get_tick() - stop->start_tick);
+}
+
+void stop_all_on_rx(StopAll* stop) {
+    if(!stop) return;
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    if(stop->pending && stop_all_sent_all(stop)) stop->rx_after = true;
+    furi_mutex_release(stop->mutex);
+}
+
+void stop_all_handle_done(StopAll* stop) {
+    if(!stop) return;
+    furi_mutex_acquire(stop->mutex, FuriWaitForever);
+    // Cancelled while the event was queued
+    bool done = stop->pending && stop->posted;
+    if(done) stop->pending = false;
+    furi_mutex_release(stop->mutex);
+    if(!done) return;
+
+    furi_timer_stop(stop->timer);
+
+    UartContext* uart = stop->uart;
+    if(stop->timed_out && uart->pcap) {
+        // The ESP never closed the stream, the rest is dropped
+        uart->pcap = false;
+        furi_stream_buffer_reset(uart->pcap_stream);
+    }
+    if(uart->storageContext) {
+        uart_storage_safe_cleanup(uart->storageContext);
+    }
+
+    FURI_LOG_I(
+        "StopAll",
+        "%u stop commands, %s after %lu ms",
+        stop->commands,
+        stop->timed_out ? "timed out" : "acknowledged",
+        furi_get_tick() - stop->start_tick);
+}
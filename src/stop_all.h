@@ -0,0 +1,58 @@
+#pragma once
+
+#include "settings_def.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Stop-all transaction
+ *
+ * Remembers which kinds of ESP operations were started (captures, scans,
+ * spam, wardriving, ...) from the commands sent, so leaving the log view only
+ * sends the matching stop commands. They go out through the high-priority TX
+ * lane and the caller returns right away. The transaction finishes once
+ * every stop command was sent and then either an open capture stream was
+ * closed by the ESP and all of it written, or (without a capture) the ESP
+ * printed something after the last stop; at the latest after
+ * STOP_ALL_TIMEOUT_MS. The finish is posted as APP_EVENT_STOP_ALL_DONE and
+ * the GUI thread then closes the capture and log files, so the tail of a
+ * PCAP still lands in its file.
+ */
+
+#define STOP_ALL_TIMEOUT_MS 2000
+#define STOP_ALL_POLL_MS    50
+
+struct UartContext;
+typedef struct StopAll StopAll;
+
+StopAll* stop_all_alloc(struct UartContext* uart);
+void stop_all_free(StopAll* stop);
+
+/**
+ * @brief Note a command sent to the ESP, stop commands clear what they stop
+ */
+void stop_all_note_command(StopAll* stop, const uint8_t* data, size_t len);
+
+/**
+ * @brief Queue the stop commands for everything started since the last stop
+ * @return false if nothing needs stopping, the caller cleans up right away
+ */
+bool stop_all_start(StopAll* stop);
+
+bool stop_all_is_pending(StopAll* stop);
+
+/**
+ * @brief Drop a pending transaction without its cleanup, e.g. a new capture is starting
+ */
+void stop_all_cancel(StopAll* stop);
+
+/**
+ * @brief RX worker: the ESP printed text
+ */
+void stop_all_on_rx(StopAll* stop);
+
+/**
+ * @brief GUI side: handle APP_EVENT_STOP_ALL_DONE
+ */
+void stop_all_handle_done(StopAll* stop);
@@ -0,0 +1,290 @@
+#include "storage_bench.h"
+#include "settings_def.h"
+#include "sequential_file.h"
+#include "dir_catalog.h"
+#include "file_prealloc.h"
+#include <furi.h>
+#include <furi_hal.h>
+#include <storage/storage.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STORAGE_BENCH_DIR         GHOST_ESP_APP_FOLDER "/bench"
+#define STORAGE_BENCH_MAX_SAMPLES 1024
+#define STORAGE_BENCH_CASE_BYTES  (512 * 1024)
+#define STORAGE_BENCH_SYNC_BYTES  8192 // Same policy as uart_storage_rx_callback
+#define STORAGE_BENCH_MAX_CHUNK   8192
+#define STORAGE_BENCH_PREALLOC    (1024 * 1024)
+#define STORAGE_BENCH_OPENS       8 // Timed opens per directory size and variant
+
+static const uint32_t storage_bench_chunks[] = {64, 256, 1024, 4096, 8192};
+static const uint32_t storage_bench_dir_sizes[] = {16, 64, 256};
+
+#define STORAGE_BENCH_CASES                                                            \
+    (COUNT_OF(storage_bench_chunks) * 2 + 1 + COUNT_OF(storage_bench_dir_sizes) * 2)
+
+typedef struct {
+    BgJob* job;
+    Storage* storage;
+    File* results;
+    uint8_t* pattern;
+    uint32_t* samples;
+    uint32_t sample_count;
+    uint32_t cases_done;
+    uint64_t bytes_written;
+    uint32_t dir_files; // Files currently in STORAGE_BENCH_DIR
+} StorageBench;
+
+static inline uint32_t storage_bench_cycles(void) {
+    return furi_hal_cortex_timer_get(0).start;
+}
+
+static inline uint32_t storage_bench_us(uint32_t start) {
+    return (storage_bench_cycles() - start) / furi_hal_cortex_instructions_per_microsecond();
+}
+
+static int storage_bench_compare(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void storage_bench_record(StorageBench* bench, uint32_t us) {
+    if(bench->sample_count < STORAGE_BENCH_MAX_SAMPLES) {
+        bench->samples[bench->sample_count++] = us;
+    }
+}
+
+static void storage_bench_report(
+    StorageBench* bench,
+    const char* test,
+    uint32_t size,
+    const char* variant,
+    uint64_t bytes,
+    uint32_t elapsed_ms) {
+    uint32_t ops = bench->sample_count;
+    uint32_t p50 = 0, p99 = 0, max = 0;
+    if(ops) {
+        qsort(bench->samples, ops, sizeof(uint32_t), storage_bench_compare);
+        p50 = bench->samples[(ops - 1) / 2];
+        p99 = bench->samples[((ops - 1) * 99) / 100];
+        max = bench->samples[ops - 1];
+    }
+    uint32_t kb_s = elapsed_ms ? (uint32_t)((bytes * 1000) / 1024 / elapsed_ms) : 0;
+
+    char line[128];
+    int len = snprintf(
+        line,
+        sizeof(line),
+        "%s,%lu,%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+        test,
+        size,
+        variant,
+        ops,
+        (uint32_t)bytes,
+        elapsed_ms,
+        kb_s,
+        p50,
+        p99,
+        max);
+    if(len > 0) storage_file_write(bench->results, line, MIN((size_t)len, sizeof(line) - 1));
+
+    FURI_LOG_I(
+        "StorageBench",
+        "%s %lu %s: %lu KB/s, p50 %lu us, p99 %lu us, max %lu us",
+        test,
+        size,
+        variant,
+        kb_s,
+        p50,
+        p99,
+        max);
+
+    bench->sample_count = 0;
+    bench->cases_done++;
+    bg_job_report(bench->job, bench->cases_done, STORAGE_BENCH_CASES, bench->bytes_written);
+}
+
+// One write case, latency of an op includes the sync it triggers
+static bool storage_bench_write_case(StorageBench* bench, uint32_t chunk, bool sync, bool prealloc) {
+    char path[64];
+    snprintf(path, sizeof(path), "%s/write_%lu.bin", STORAGE_BENCH_DIR, chunk);
+
+    File* file = storage_file_alloc(bench->storage);
+    if(!storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        FURI_LOG_E("StorageBench", "Failed to create %s", path);
+        storage_file_free(file);
+        return false;
+    }
+
+    FilePrealloc* reserve = prealloc ? file_prealloc_alloc() : NULL;
+    if(reserve) file_prealloc_begin(reserve, file, STORAGE_BENCH_PREALLOC);
+
+    uint32_t ops = MIN(STORAGE_BENCH_MAX_SAMPLES, STORAGE_BENCH_CASE_BYTES / chunk);
+    uint64_t bytes = 0;
+    size_t since_sync = 0;
+    bool ok = true;
+    uint32_t start_tick = furi_get_tick();
+    for(uint32_t i = 0; i < ops && ok; i++) {
+        if(reserve) file_prealloc_reserve(reserve, chunk);
+        uint32_t start = storage_bench_cycles();
+        ok = storage_file_write(file, bench->pattern, chunk) == chunk;
+        since_sync += chunk;
+        if(sync && since_sync >= STORAGE_BENCH_SYNC_BYTES) {
+            storage_file_sync(file);
+            since_sync = 0;
+        }
+        storage_bench_record(bench, storage_bench_us(start));
+        bytes += chunk;
+
+        // Cancel mid-case too, the 64 B cases take a while
+        if((i & 63) == 63 && bg_job_is_cancelled(bench->job)) ok = false;
+    }
+    if(sync) storage_file_sync(file);
+    uint32_t elapsed = furi_get_tick() - start_tick;
+
+    if(reserve) {
+        file_prealloc_finish(reserve);
+        file_prealloc_free(reserve);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    storage_simply_remove(bench->storage, path);
+
+    bench->bytes_written += bytes;
+    if(!ok) {
+        bench->sample_count = 0;
+        return false;
+    }
+
+    storage_bench_report(
+        bench,
+        prealloc ? "prealloc" : "write",
+        chunk,
+        sync ? "sync8k" : "nosync",
+        bytes,
+        elapsed);
+    return true;
+}
+
+// Grow the bench directory to count files with empty placeholders
+static bool storage_bench_fill_dir(StorageBench* bench, uint32_t count) {
+    char path[64];
+    File* file = storage_file_alloc(bench->storage);
+    bool ok = true;
+    while(bench->dir_files < count && ok) {
+        snprintf(path, sizeof(path), "%s/fill_%lu.pcap", STORAGE_BENCH_DIR, bench->dir_files);
+        ok = storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS);
+        storage_file_close(file);
+        bench->dir_files++;
+        if(bg_job_is_cancelled(bench->job)) ok = false;
+    }
+    storage_file_free(file);
+    return ok;
+}
+
+static bool storage_bench_open_case(StorageBench* bench, uint32_t dir_size, bool cold) {
+    if(!storage_bench_fill_dir(bench, dir_size)) return false;
+
+    File* file = storage_file_alloc(bench->storage);
+    bool ok = true;
+    uint32_t start_tick = furi_get_tick();
+    for(uint32_t i = 0; i < STORAGE_BENCH_OPENS && ok; i++) {
+        if(cold) {
+            // What the first capture after launch pays
+            sequential_file_cache_invalidate(bench->storage, STORAGE_BENCH_DIR);
+            dir_catalog_invalidate(STORAGE_BENCH_DIR);
+        }
+        uint32_t start = storage_bench_cycles();
+        ok = sequential_file_open(bench->storage, file, STORAGE_BENCH_DIR, "bench", "pcap");
+        storage_file_close(file);
+        storage_bench_record(bench, storage_bench_us(start));
+        bench->dir_files++;
+    }
+    uint32_t elapsed = furi_get_tick() - start_tick;
+    storage_file_free(file);
+
+    if(!ok || bg_job_is_cancelled(bench->job)) {
+        bench->sample_count = 0;
+        return false;
+    }
+
+    storage_bench_report(bench, "seq_open", dir_size, cold ? "cold" : "warm", 0, elapsed);
+    return true;
+}
+
+static void storage_bench_write_header(StorageBench* bench) {
+    uint64_t total = 0;
+    uint64_t free_space = 0;
+    storage_common_fs_info(bench->storage, "/ext", &total, &free_space);
+
+    char line[128];
+    int len = snprintf(
+        line,
+        sizeof(line),
+        "# run %lu card_mb %lu free_mb %lu\n"
+        "test,size,variant,ops,bytes,ms,kb_s,p50_us,p99_us,max_us\n",
+        furi_hal_rtc_get_timestamp(),
+        (uint32_t)(total / (1024 * 1024)),
+        (uint32_t)(free_space / (1024 * 1024)));
+    if(len > 0) storage_file_write(bench->results, line, MIN((size_t)len, sizeof(line) - 1));
+}
+
+bool storage_bench_worker(BgJob* job, void* context) {
+    UNUSED(context);
+
+    StorageBench bench;
+    memset(&bench, 0, sizeof(StorageBench));
+    bench.job = job;
+    bench.pattern = malloc(STORAGE_BENCH_MAX_CHUNK);
+    bench.samples = malloc(STORAGE_BENCH_MAX_SAMPLES * sizeof(uint32_t));
+    if(!bench.pattern || !bench.samples) {
+        free(bench.pattern);
+        free(bench.samples);
+        return false;
+    }
+    for(size_t i = 0; i < STORAGE_BENCH_MAX_CHUNK; i++) {
+        bench.pattern[i] = (uint8_t)(i * 31 + 7);
+    }
+
+    bench.storage = furi_record_open(RECORD_STORAGE);
+    bench.results = storage_file_alloc(bench.storage);
+
+    // Start from an empty directory so the open cost only depends on our files
+    storage_simply_remove_recursive(bench.storage, STORAGE_BENCH_DIR);
+    bool ok = storage_simply_mkdir(bench.storage, STORAGE_BENCH_DIR) &&
+              storage_file_open(bench.results, STORAGE_BENCH_RESULTS, FSAM_WRITE, FSOM_OPEN_APPEND);
+    if(ok) {
+        storage_bench_write_header(&bench);
+        bg_job_report(job, 0, STORAGE_BENCH_CASES, 0);
+    } else {
+        FURI_LOG_E("StorageBench", "Failed to prepare %s", STORAGE_BENCH_DIR);
+    }
+
+    for(size_t i = 0; i < COUNT_OF(storage_bench_chunks) && ok; i++) {
+        ok = storage_bench_write_case(&bench, storage_bench_chunks[i], false, false) &&
+             storage_bench_write_case(&bench, storage_bench_chunks[i], true, false);
+    }
+    if(ok) ok = storage_bench_write_case(&bench, 1024, true, true);
+    for(size_t i = 0; i < COUNT_OF(storage_bench_dir_sizes) && ok; i++) {
+        ok = storage_bench_open_case(&bench, storage_bench_dir_sizes[i], true) &&
+             storage_bench_open_case(&bench, storage_bench_dir_sizes[i], false);
+    }
+
+    if(bg_job_is_cancelled(job)) {
+        const char* note = "# cancelled\n";
+        storage_file_write(bench.results, note, strlen(note));
+    }
+
+    storage_file_close(bench.results);
+    storage_file_free(bench.results);
+    storage_simply_remove_recursive(bench.storage, STORAGE_BENCH_DIR);
+    sequential_file_cache_invalidate(bench.storage, STORAGE_BENCH_DIR);
+    dir_catalog_invalidate(STORAGE_BENCH_DIR);
+    furi_record_close(RECORD_STORAGE);
+
+    free(bench.pattern);
+    free(bench.samples);
+    return ok;
+}
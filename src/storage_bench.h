@@ -0,0 +1,29 @@
+#pragma once
+
+#include "bg_job.h"
+#include "settings_def.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Storage benchmark
+ *
+ * Measures the app's own write paths on the inserted SD card:
+ *   write     storage_file_write at 64 B - 8 KB chunks, without syncing and
+ *             with the capture sync policy (sync every 8 KB)
+ *   prealloc  1 KB chunks with the capture sync policy on a preallocated file
+ *   seq_open  sequential_file_open against a growing directory, with the
+ *             counter cache cold and warm
+ *
+ * Every case records per-operation latency and appends one CSV row
+ * (test,size,variant,ops,bytes,ms,kb_s,p50_us,p99_us,max_us) to
+ * STORAGE_BENCH_RESULTS. tools/storage_bench.py runs the same suite on a host
+ * and reads/compares the results file.
+ */
+
+#define STORAGE_BENCH_RESULTS GHOST_ESP_APP_FOLDER "/storage_bench.csv"
+
+/**
+ * @brief BgJobWorker running the whole suite, context is unused
+ */
+bool storage_bench_worker(BgJob* job, void* context);
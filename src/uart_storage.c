@@ -1,13 +1,18 @@
 #include "uart_utils.h"
 #include "log_manager.h"
 #include <furi.h>
+#include <furi_hal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <storage/storage.h>
 #include "sequential_file.h"
+#include "dir_catalog.h"
+#include "wardrive_row.h"
+#include <stdio.h>
 
 #define COMMAND_BUFFER_SIZE 128
 #define PCAP_WRITE_CHUNK_SIZE 1024u
+#define CAPTURE_SYNC_BYTES    8192u
 
 // Define directories in an array for loop-based creation
 static const char* GHOST_DIRECTORIES[] = {
@@ -29,23 +34,25 @@ static const char* GHOST_DIRECTORIES[] = {
 
 void uart_storage_safe_cleanup(UartStorageContext* ctx) {
     if(!ctx) return;
+    if(ctx->mutex) furi_mutex_acquire(ctx->mutex, FuriWaitForever);
 
     // Safely close current file if open
     if(ctx->current_file) {
-        if(storage_file_is_open(ctx->current_file)) {
-            storage_file_sync(ctx->current_file);
-            storage_file_close(ctx->current_file);
-        }
-        ctx->HasOpenedFile = false;
+        uart_storage_close_capture(ctx);
     }
 
     // Safely close log file if open
     if(ctx->log_file) {
         if(storage_file_is_open(ctx->log_file)) {
+            if(ctx->log_compressor) {
+                log_compressor_flush(ctx->log_compressor);
+            }
             storage_file_sync(ctx->log_file);
             storage_file_close(ctx->log_file);
         }
     }
+
+    if(ctx->mutex) furi_mutex_release(ctx->mutex);
 }
 
 UartStorageContext* uart_storage_init(UartContext* parentContext) {
@@ -80,12 +87,21 @@ UartStorageContext* uart_storage_init(UartContext* parentContext) {
     }
     FURI_LOG_I("Storage", "Opened RECORD_STORAGE (Time taken: %lu ms)", elapsed_step);
 
+    // Sequence counters are loaded lazily on the first resolve
+    sequential_file_cache_init();
+    dir_catalog_init();
+
     // Allocate file handles
     step_start = furi_get_tick();
+    ctx->mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
     ctx->current_file = storage_file_alloc(ctx->storage_api);
     ctx->log_file = storage_file_alloc(ctx->storage_api);
     elapsed_step = furi_get_tick() - step_start;
-    if(!ctx->current_file || !ctx->log_file) {
+    ctx->capture_stream = capture_stream_alloc();
+    ctx->capture_journal = capture_journal_alloc(ctx->storage_api);
+    ctx->capture_prealloc = file_prealloc_alloc();
+    if(!ctx->mutex || !ctx->current_file || !ctx->log_file || !ctx->capture_stream || !ctx->capture_journal ||
+       !ctx->capture_prealloc) {
         FURI_LOG_E("Storage", "Failed to allocate file handles (Time taken: %lu ms)", elapsed_step);
         uart_storage_free(ctx);
         return NULL;
@@ -138,28 +154,25 @@ UartStorageContext* uart_storage_init(UartContext* parentContext) {
         FURI_LOG_I("Storage", "Retry directory creation completed (Time taken: %lu ms)", elapsed_step);
     }
 
+    // Repair a capture cut short by a crash or power loss last session
+    step_start = furi_get_tick();
+    if(capture_journal_recover(ctx->capture_journal)) {
+        dir_catalog_invalidate(GHOST_ESP_APP_FOLDER_PCAPS);
+        dir_catalog_invalidate(GHOST_ESP_APP_FOLDER_WARDRIVE);
+    }
+    elapsed_step = furi_get_tick() - step_start;
+    FURI_LOG_I("Storage", "Checked capture journal (Time taken: %lu ms)", elapsed_step);
+
     // Initialize log file
     step_start = furi_get_tick();
-    ctx->HasOpenedFile = sequential_file_open(
-        ctx->storage_api,
-        ctx->log_file,
-        GHOST_ESP_APP_FOLDER_LOGS,
-        "ghost_logs",
-        "txt"
-    );
+    ctx->HasOpenedFile = uart_storage_open_log(ctx);
     elapsed_step = furi_get_tick() - step_start;
     if(!ctx->HasOpenedFile) {
         FURI_LOG_W("Storage", "Failed to open log file, attempting cleanup (Time taken: %lu ms)", elapsed_step);
         uart_storage_safe_cleanup(ctx);
         // Retry log file creation
         step_start = furi_get_tick();
-        ctx->HasOpenedFile = sequential_file_open(
-            ctx->storage_api,
-            ctx->log_file,
-            GHOST_ESP_APP_FOLDER_LOGS,
-            "ghost_logs",
-            "txt"
-        );
+        ctx->HasOpenedFile = uart_storage_open_log(ctx);
         elapsed_step = furi_get_tick() - step_start;
         if(!ctx->HasOpenedFile) {
             FURI_LOG_W("Storage", "Log init failed after cleanup, continuing without logging (Time taken: %lu ms)", elapsed_step);
@@ -181,16 +194,86 @@ UartStorageContext* uart_storage_init(UartContext* parentContext) {
 }
 
 
-void uart_storage_rx_callback(uint8_t *buf, size_t len, void *context) {
-    UartContext *app = (UartContext *)context;
-    
-    // Basic sanity checks with detailed logging
-    if(!app || !app->storageContext || !buf || len == 0) {
-        FURI_LOG_E("Storage", "Invalid parameters in storage callback: app=%p, storageContext=%p, buf=%p, len=%zu",
-                  (void*)app, (void*)app->storageContext, (void*)buf, len);
+// Tag PCAPNG packets with the Flipper GPS position while it is fresh
+static void uart_storage_update_gps_annotation(UartContext* app) {
+    UartStorageContext* ctx = app->storageContext;
+    if(!app->gps || !capture_stream_is_active(ctx->capture_stream)) return;
+
+    GpsFix fix;
+    uint32_t sequence = gps_nmea_get_fix(app->gps, &fix);
+    bool fresh = gps_nmea_fix_is_fresh(&fix);
+    if(sequence == ctx->gps_sequence && (fresh || !ctx->gps_annotated)) return;
+    ctx->gps_sequence = sequence;
+
+    if(!fresh) {
+        capture_stream_set_annotation(ctx->capture_stream, NULL);
+        ctx->gps_annotated = false;
+        return;
+    }
+
+    char lat[16], lon[16], alt[16];
+    wardrive_format_fixed(lat, sizeof(lat), fix.lat_e7, WARDRIVE_COORD_DIGITS);
+    wardrive_format_fixed(lon, sizeof(lon), fix.lon_e7, WARDRIVE_COORD_DIGITS);
+    wardrive_format_fixed(alt, sizeof(alt), fix.alt_dm, WARDRIVE_METER_DIGITS);
+    char annotation[64];
+    snprintf(
+        annotation,
+        sizeof(annotation),
+        "gps %s,%s alt %s hdop %u.%02u sats %u",
+        lat,
+        lon,
+        alt,
+        fix.hdop_c / 100,
+        fix.hdop_c % 100,
+        fix.satellites);
+    capture_stream_set_annotation(ctx->capture_stream, annotation);
+    ctx->gps_annotated = true;
+}
+
+static WardriveStats* uart_storage_wardrive_stats(UartStorageContext* ctx) {
+    if(!ctx->parentContext || !ctx->parentContext->state) return NULL;
+    return ctx->parentContext->state->wardrive_stats;
+}
+
+// Offset written so far and end of the last complete record of the open capture
+static void uart_storage_capture_progress(
+    UartStorageContext* ctx,
+    uint64_t* offset,
+    uint64_t* record_end) {
+    if(ctx->gpx_writer && gpx_writer_is_active(ctx->gpx_writer)) {
+        *offset = *record_end = gpx_writer_get_record_end(ctx->gpx_writer);
+    } else if(ctx->wardrive_bin && wardrive_bin_is_active(ctx->wardrive_bin)) {
+        *offset = *record_end = wardrive_bin_get_record_end(ctx->wardrive_bin);
+    } else if(ctx->wardrive_stage && wardrive_stage_is_active(ctx->wardrive_stage)) {
+        // Only the last flush is known to be whole rows
+        *offset = *record_end = wardrive_stage_get_record_end(ctx->wardrive_stage);
+    } else if(capture_stream_is_active(ctx->capture_stream)) {
+        *offset = capture_stream_get_offset(ctx->capture_stream);
+        *record_end = capture_stream_get_record_end(ctx->capture_stream);
+    } else {
+        // Raw bytes have no records, everything synced counts
+        *offset = *record_end = storage_file_tell(ctx->current_file);
+    }
+}
+
+// Sync every ~8KB, and as soon as the file header is complete so recovery never sees an empty record end
+static void uart_storage_journal_capture(UartStorageContext* ctx, size_t written) {
+    uint64_t offset, record_end;
+    uart_storage_capture_progress(ctx, &offset, &record_end);
+    ctx->capture_unsynced += written;
+    FURI_LOG_D("Storage", "Accumulated %zu bytes since last sync", ctx->capture_unsynced);
+    if(ctx->capture_unsynced < CAPTURE_SYNC_BYTES && (ctx->capture_journaled || !record_end)) {
         return;
     }
 
+    storage_file_sync(ctx->current_file);
+    FURI_LOG_D("Storage", "PCAP file synced to storage");
+    capture_journal_update(ctx->capture_journal, offset, record_end);
+    ctx->capture_unsynced = 0;
+    ctx->capture_journaled = record_end > 0;
+}
+
+static void uart_storage_write_capture(UartContext* app, uint8_t* buf, size_t len) {
     // **Ensure PCAP File is Open**
     if(!app->storageContext->current_file || !app->storageContext->HasOpenedFile) {
         FURI_LOG_E("Storage", "PCAP file is not open. Data cannot be written.");
@@ -209,15 +292,40 @@ void uart_storage_rx_callback(uint8_t *buf, size_t len, void *context) {
         FURI_LOG_D("Storage", "... (%zu more bytes)", len - bytes_to_log);
     }
 
+    uart_storage_update_gps_annotation(app);
+
     // Write data and verify with detailed logging
-    size_t written = storage_file_write(app->storageContext->current_file, buf, len);
-    if(written != len) {
-        FURI_LOG_E("Storage", "Failed to write PCAP data: Expected %zu, Written %zu", len, written);
+    FilePrealloc* prealloc = app->storageContext->capture_prealloc;
+    file_prealloc_reserve(prealloc, len);
+    uint32_t write_start = furi_hal_cortex_timer_get(0).start;
+    bool written;
+    WardriveStage* stage = app->storageContext->wardrive_stage;
+    WardriveBin* bin = app->storageContext->wardrive_bin;
+    GpxWriter* gpx = app->storageContext->gpx_writer;
+    if(gpx && gpx_writer_is_active(gpx)) {
+        written = gpx_writer_write(gpx, buf, len);
+    } else if(bin && wardrive_bin_is_active(bin)) {
+        written = wardrive_bin_write(bin, buf, len);
+    } else if(stage && wardrive_stage_is_active(stage)) {
+        written = wardrive_stage_write(stage, buf, len);
+    } else if(capture_stream_is_active(app->storageContext->capture_stream)) {
+        written = capture_stream_write(app->storageContext->capture_stream, buf, len);
+    } else {
+        written = storage_file_write(app->storageContext->current_file, buf, len) == len;
+    }
+    file_prealloc_note_write(
+        prealloc,
+        len,
+        (furi_hal_cortex_timer_get(0).start - write_start) /
+            furi_hal_cortex_instructions_per_microsecond());
+    if(!written) {
+        FURI_LOG_E("Storage", "Failed to write PCAP data (%zu bytes)", len);
         app->pcap = false;  // Reset PCAP state on write failure
         return;
     }
+    wardrive_stats_feed(uart_storage_wardrive_stats(app->storageContext), buf, len);
 
-    FURI_LOG_D("Storage", "Successfully wrote %zu bytes to PCAP file", written);
+    FURI_LOG_D("Storage", "Successfully wrote %zu bytes to PCAP file", len);
     
     // Optionally, calculate and log a checksum for data integrity
     uint8_t checksum = 0;
@@ -226,15 +334,23 @@ void uart_storage_rx_callback(uint8_t *buf, size_t len, void *context) {
     }
     FURI_LOG_D("Storage", "Data Checksum (XOR): 0x%02X", checksum);
     
-    // Periodic sync every ~8KB to balance between safety and performance with detailed logging
-    static size_t bytes_since_sync = 0;
-    bytes_since_sync += len;
-    FURI_LOG_D("Storage", "Accumulated %zu bytes since last sync", bytes_since_sync);
-    if(bytes_since_sync >= 8192) {
-        storage_file_sync(app->storageContext->current_file);
-        FURI_LOG_D("Storage", "PCAP file synced to storage");
-        bytes_since_sync = 0;
+    uart_storage_journal_capture(app->storageContext, len);
+}
+
+void uart_storage_rx_callback(uint8_t *buf, size_t len, void *context) {
+    UartContext *app = (UartContext *)context;
+    
+    // Basic sanity checks with detailed logging
+    if(!app || !app->storageContext || !buf || len == 0) {
+        FURI_LOG_E("Storage", "Invalid parameters in storage callback: app=%p, storageContext=%p, buf=%p, len=%zu",
+                  (void*)app, (void*)app->storageContext, (void*)buf, len);
+        return;
     }
+
+    // The GUI thread may be closing the capture, the writers must not be freed mid-write
+    furi_mutex_acquire(app->storageContext->mutex, FuriWaitForever);
+    uart_storage_write_capture(app, buf, len);
+    furi_mutex_release(app->storageContext->mutex);
 }
 
 
@@ -248,17 +364,200 @@ void uart_storage_reset_logs(UartStorageContext *ctx) {
         ctx->log_file = storage_file_alloc(ctx->storage_api);
     }
 
-    ctx->HasOpenedFile = sequential_file_open(
+    ctx->HasOpenedFile = uart_storage_open_log(ctx);
+        
+    if(!ctx->HasOpenedFile) {
+        FURI_LOG_E("Storage", "Failed to reset log file");
+    }
+}
+
+bool uart_storage_open_log(UartStorageContext* ctx) {
+    if(!ctx || !ctx->storage_api || !ctx->log_file) return false;
+
+    bool compress = ctx->parentContext && ctx->parentContext->state &&
+                    ctx->parentContext->state->settings.compress_logs_index;
+
+    if(compress && !ctx->log_compressor) {
+        ctx->log_compressor = log_compressor_alloc();
+        if(!ctx->log_compressor) {
+            FURI_LOG_W("Storage", "Log compressor unavailable, using plain text log");
+            compress = false;
+        }
+    } else if(!compress && ctx->log_compressor) {
+        log_compressor_free(ctx->log_compressor);
+        ctx->log_compressor = NULL;
+    }
+
+    bool opened = sequential_file_open(
         ctx->storage_api,
         ctx->log_file,
         GHOST_ESP_APP_FOLDER_LOGS,
         "ghost_logs",
-        "txt"
-    );
-        
-    if(!ctx->HasOpenedFile) {
-        FURI_LOG_E("Storage", "Failed to reset log file");
+        compress ? LOG_COMPRESS_EXTENSION : "txt");
+
+    if(opened && compress && !log_compressor_begin(ctx->log_compressor, ctx->log_file)) {
+        FURI_LOG_E("Storage", "Failed to start compressed log");
+        storage_file_close(ctx->log_file);
+        opened = false;
     }
+
+    return opened;
+}
+
+static bool uart_storage_begin_capture(
+    UartStorageContext* ctx,
+    const char* folder,
+    const char* prefix,
+    const char* extension) {
+    // Only PCAP captures can be transcoded and wardrive CSVs stored binary, GPX is rewritten
+    CaptureFormat format = CaptureFormatPcap;
+    bool gpx = strcmp(extension, "gpx") == 0;
+    uint32_t gpx_tolerance = 0;
+    bool wardrive_csv = strcmp(extension, "csv") == 0 &&
+                        strcmp(folder, GHOST_ESP_APP_FOLDER_WARDRIVE) == 0;
+    bool wardrive_binary = false;
+    bool wardrive_dedup = false;
+    uint32_t extent = 0;
+    uint32_t dedup_window = 0;
+    if(ctx->parentContext && ctx->parentContext->state) {
+        const Settings* settings = &ctx->parentContext->state->settings;
+        if(strcmp(extension, "pcap") == 0 && settings->capture_format_index) {
+            format = CaptureFormatPcapng;
+            extension = "pcapng";
+        }
+        wardrive_binary = wardrive_csv && settings->wardrive_format_index;
+        wardrive_dedup = wardrive_csv && !wardrive_binary && settings->wardrive_dedup_index;
+        gpx_tolerance = gpx_writer_tolerance_for_index(settings->gpx_simplify_index);
+        extent = file_prealloc_extent_for_index(settings->preallocate_index);
+        dedup_window = frame_dedup_window_for_index(settings->capture_dedup_index);
+    }
+
+    if(wardrive_binary) {
+        if(!ctx->wardrive_bin) ctx->wardrive_bin = wardrive_bin_alloc();
+        if(ctx->wardrive_bin) {
+            extension = "gwd";
+        } else {
+            FURI_LOG_W("Storage", "Binary wardrive log unavailable, writing CSV");
+            wardrive_binary = false;
+        }
+    }
+
+    if(gpx) {
+        if(!ctx->gpx_writer) ctx->gpx_writer = gpx_writer_alloc();
+        if(!ctx->gpx_writer) {
+            FURI_LOG_W("Storage", "GPX writer unavailable, storing the track as sent");
+            gpx = false;
+        }
+    }
+
+    char path[CAPTURE_JOURNAL_PATH_LEN];
+    if(!sequential_file_open_ex(
+           ctx->storage_api, ctx->current_file, folder, prefix, extension, path, sizeof(path))) {
+        return false;
+    }
+
+    if(wardrive_binary &&
+       !wardrive_bin_begin(ctx->wardrive_bin, ctx->current_file, furi_hal_rtc_get_timestamp())) {
+        FURI_LOG_E("Storage", "Failed to write wardrive log header");
+        storage_file_close(ctx->current_file);
+        return false;
+    }
+    if(gpx && !gpx_writer_begin(ctx->gpx_writer, ctx->current_file, gpx_tolerance)) {
+        FURI_LOG_E("Storage", "Failed to write GPX header");
+        storage_file_close(ctx->current_file);
+        return false;
+    }
+    GpsNmea* gps = ctx->parentContext ? ctx->parentContext->gps : NULL;
+    if(wardrive_binary) wardrive_bin_set_gps(ctx->wardrive_bin, gps);
+    if(wardrive_dedup) {
+        if(!ctx->wardrive_stage) ctx->wardrive_stage = wardrive_stage_alloc();
+        if(ctx->wardrive_stage) {
+            wardrive_stage_begin(ctx->wardrive_stage, ctx->current_file);
+            wardrive_stage_set_gps(ctx->wardrive_stage, gps);
+            extent = 0; // The stage rewrites its tail, reserved space would be clobbered
+        } else {
+            FURI_LOG_W("Storage", "Wardrive dedup unavailable, writing every sighting");
+        }
+    }
+
+    if(wardrive_csv) wardrive_stats_begin(uart_storage_wardrive_stats(ctx), gps);
+
+    capture_stream_begin(ctx->capture_stream, ctx->current_file, format);
+    ctx->gps_sequence = 0;
+    ctx->gps_annotated = false;
+    if(dedup_window) {
+        if(!ctx->capture_dedup) ctx->capture_dedup = frame_dedup_alloc();
+        if(ctx->capture_dedup) {
+            frame_dedup_reset(ctx->capture_dedup, dedup_window);
+            capture_stream_set_dedup(ctx->capture_stream, ctx->capture_dedup);
+        } else {
+            FURI_LOG_W("Storage", "Frame dedup unavailable, writing every frame");
+        }
+    }
+    file_prealloc_begin(ctx->capture_prealloc, ctx->current_file, extent);
+    capture_journal_begin(ctx->capture_journal, path, format);
+    if(gpx) capture_journal_set_trailer(ctx->capture_journal, CaptureJournalTrailerGpx);
+    ctx->capture_unsynced = 0;
+    ctx->capture_journaled = false;
+    // GPX and binary wardrive headers are already written
+    uart_storage_journal_capture(ctx, 0);
+    return true;
+}
+
+bool uart_storage_open_capture(
+    UartStorageContext* ctx,
+    const char* folder,
+    const char* prefix,
+    const char* extension) {
+    if(!ctx || !ctx->storage_api || !ctx->current_file) return false;
+
+    furi_mutex_acquire(ctx->mutex, FuriWaitForever);
+    bool opened = uart_storage_begin_capture(ctx, folder, prefix, extension);
+    furi_mutex_release(ctx->mutex);
+    return opened;
+}
+
+void uart_storage_close_capture(UartStorageContext* ctx) {
+    if(!ctx || !ctx->current_file) return;
+
+    // Waits for a write in progress on the RX worker
+    furi_mutex_acquire(ctx->mutex, FuriWaitForever);
+    if(storage_file_is_open(ctx->current_file)) {
+        bool deduped = capture_stream_get_dropped_count(ctx->capture_stream) > 0;
+        if(ctx->wardrive_stage) {
+            // Only worth its RAM while a capture is open
+            wardrive_stage_finish(ctx->wardrive_stage);
+            wardrive_stage_free(ctx->wardrive_stage);
+            ctx->wardrive_stage = NULL;
+        }
+        if(ctx->wardrive_bin) wardrive_bin_finish(ctx->wardrive_bin);
+        if(ctx->gpx_writer) gpx_writer_finish(ctx->gpx_writer);
+        wardrive_stats_finish(uart_storage_wardrive_stats(ctx));
+        capture_stream_finish(ctx->capture_stream);
+        file_prealloc_finish(ctx->capture_prealloc);
+        if(deduped) {
+            FrameDedupStats stats;
+            frame_dedup_get_stats(ctx->capture_dedup, &stats);
+            FURI_LOG_I(
+                "Storage",
+                "Dedup: %lu beacons/probes, %lu written, %lu dropped, %lu keys, %lu evictions",
+                stats.frames,
+                stats.written,
+                stats.dropped,
+                stats.keys,
+                stats.evictions);
+        }
+        storage_file_sync(ctx->current_file);
+        storage_file_close(ctx->current_file);
+        capture_journal_end(ctx->capture_journal);
+    }
+    ctx->HasOpenedFile = false;
+    furi_mutex_release(ctx->mutex);
+}
+
+void uart_storage_set_capture_info(UartStorageContext* ctx, const char* command) {
+    if(!ctx || !ctx->capture_stream) return;
+    capture_stream_set_comment(ctx->capture_stream, command);
 }
 
 void uart_storage_free(UartStorageContext *ctx) {
@@ -276,7 +575,45 @@ void uart_storage_free(UartStorageContext *ctx) {
         storage_file_free(ctx->log_file);
     }
 
+    if(ctx->log_compressor) {
+        log_compressor_free(ctx->log_compressor);
+    }
+
+    if(ctx->capture_stream) {
+        capture_stream_free(ctx->capture_stream);
+    }
+
+    if(ctx->capture_journal) {
+        capture_journal_free(ctx->capture_journal);
+    }
+
+    if(ctx->capture_prealloc) {
+        file_prealloc_free(ctx->capture_prealloc);
+    }
+
+    if(ctx->capture_dedup) {
+        frame_dedup_free(ctx->capture_dedup);
+    }
+
+    if(ctx->wardrive_stage) {
+        wardrive_stage_free(ctx->wardrive_stage);
+    }
+
+    if(ctx->wardrive_bin) {
+        wardrive_bin_free(ctx->wardrive_bin);
+    }
+
+    if(ctx->gpx_writer) {
+        gpx_writer_free(ctx->gpx_writer);
+    }
+
+    if(ctx->mutex) {
+        furi_mutex_free(ctx->mutex);
+    }
+
     if(ctx->storage_api) {
+        sequential_file_cache_deinit();
+        dir_catalog_deinit();
         furi_record_close(RECORD_STORAGE);
     }
 
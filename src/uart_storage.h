@@ -1,20 +1,61 @@
 #pragma once
 
 #include "app_types.h"
+#include "log_compress.h"
+#include "capture_stream.h"
+#include "capture_journal.h"
+#include "file_prealloc.h"
+#include "wardrive_stage.h"
+#include "wardrive_bin.h"
+#include "gpx_writer.h"
 #include <furi.h>
 #include <storage/storage.h>
 
 struct UartStorageContext {
     Storage* storage_api;
+    FuriMutex* mutex; // Recursive, held by the RX worker while writing and by whoever opens or closes files
     File* current_file;
     File* log_file;
     File* settings_file;
+    LogCompressor* log_compressor; // Non-NULL while the session log is .glz
+    CaptureStream* capture_stream; // Frames/transcodes data written to current_file
+    CaptureJournal* capture_journal; // Lets the next launch repair an interrupted capture
+    FilePrealloc* capture_prealloc; // Reserves capture file space ahead of the writes
+    FrameDedup* capture_dedup; // Allocated the first time dedup is enabled
+    WardriveStage* wardrive_stage; // Allocated while a deduplicated wardrive capture is open
+    WardriveBin* wardrive_bin; // Allocated the first time a binary wardrive log is opened
+    GpxWriter* gpx_writer; // Allocated the first time a GPX track is recorded
+    size_t capture_unsynced; // Capture bytes written since the last sync and journal update
+    bool capture_journaled; // The journal holds a record end for the open capture
+    uint32_t gps_sequence; // Fix last turned into a capture annotation
+    bool gps_annotated;
     UartContext* parentContext;
     bool HasOpenedFile;
+    bool log_paused; // Log file closed while Clear Logs empties its folder, the RX worker skips it
     bool IsWritingToFile;
     bool view_logs_from_start;
 };
 
 UartStorageContext* uart_storage_init(UartContext* parentContext);
 void uart_storage_free(UartStorageContext* ctx);
+bool uart_storage_open_log(UartStorageContext* ctx);
+
+/**
+ * @brief Open the next capture file in folder, as .pcapng/.gwd when that format is selected
+ */
+bool uart_storage_open_capture(
+    UartStorageContext* ctx,
+    const char* folder,
+    const char* prefix,
+    const char* extension);
+
+/**
+ * @brief Finish and close the capture file if one is open
+ */
+void uart_storage_close_capture(UartStorageContext* ctx);
+
+/**
+ * @brief Record the command that started the current capture (PCAPNG section comment)
+ */
+void uart_storage_set_capture_info(UartStorageContext* ctx, const char* command);
 void uart_storage_rx_callback(uint8_t* buf, size_t len, void* context);
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "uart_tx.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UART_TX_LANES 2
+
+typedef enum {
+    UartTxEvtStop = (1 << 0),
+    UartTxEvtQueued = (1 << 1),
+} UartTxEvtFlags;
+
+typedef struct {
+    uint32_t id;
+    uint32_t queued_tick;
+    UartTxCallback callback;
+    void* context;
+    uint16_t len;
+    bool more; // The next chunk of the same command follows in this lane
+    uint8_t data[UART_TX_DATA_MAX];
+} UartTxItem;
+
+struct UartTx {
+    FuriHalSerialHandle* serial;
+    FuriThread* thread;
+    FuriMessageQueue* lanes[UART_TX_LANES];
+    size_t slots[UART_TX_LANES];
+    FuriMutex* producer_mutex; // Held while the chunks of one command are queued
+    FuriMutex* stats_mutex;
+    uint32_t next_id;
+
+    // TX thread only
+    UartTxItem item;
+    uint32_t last_tx_tick;
+    uint32_t command_tick; // First byte of the command being sent
+    bool sent_any;
+
+    uint64_t total_wait_ms;
+    UartTxStats stats;
+};
+
+static void uart_tx_transmit(UartTx* tx, UartTxPriority lane, bool first_chunk) {
+    const UartTxItem* item = &tx->item;
+
+    // Spacing only between commands, chunks of one command go back to back
+    if(first_chunk) {
+        uint32_t since = furi_get_tick() - tx->last_tx_tick;
+        if(tx->sent_any && since < UART_TX_SPACING_MS) {
+            furi_delay_ms(UART_TX_SPACING_MS - since);
+        }
+        tx->command_tick = furi_get_tick();
+    }
+
+    furi_hal_serial_tx(tx->serial, item->data, item->len);
+    furi_hal_serial_tx_wait_complete(tx->serial);
+    tx->last_tx_tick = furi_get_tick();
+    tx->sent_any = true;
+    if(item->more) return;
+
+    UartTxResult result = {
+        .id = item->id,
+        .wait_ms = tx->command_tick - item->queued_tick,
+        .latency_ms = tx->last_tx_tick - item->queued_tick,
+    };
+
+    furi_mutex_acquire(tx->stats_mutex, FuriWaitForever);
+    tx->stats.sent++;
+    if(lane == UartTxPriorityHigh) tx->stats.sent_high++;
+    tx->total_wait_ms += result.wait_ms;
+    tx->stats.max_wait_ms = MAX(tx->stats.max_wait_ms, result.wait_ms);
+    furi_mutex_release(tx->stats_mutex);
+
+    if(item->callback) {
+        item->callback(&result, item->context);
+    }
+}
+
+static int32_t uart_tx_worker(void* context) {
+    UartTx* tx = context;
+    bool stopping = false;
+    bool continuing = false; // Rest of a chunked command comes from the same lane
+    UartTxPriority lane = UartTxPriorityNormal;
+
+    while(true) {
+        bool got = false;
+        if(continuing) {
+            // Commands are queued whole, the rest is already in the lane
+            got = furi_message_queue_get(tx->lanes[lane], &tx->item, 0) == FuriStatusOk;
+            if(!got) {
+                FURI_LOG_E("UartTx", "Command %lu is missing chunks", tx->item.id);
+                continuing = false;
+                continue;
+            }
+        } else {
+            for(int8_t i = UART_TX_LANES - 1; i >= 0 && !got; i--) {
+                lane = (UartTxPriority)i;
+                got = furi_message_queue_get(tx->lanes[lane], &tx->item, 0) == FuriStatusOk;
+            }
+        }
+
+        if(!got) {
+            // Everything queued before the stop request has been sent
+            if(stopping) break;
+            uint32_t flags = furi_thread_flags_wait(
+                UartTxEvtStop | UartTxEvtQueued, FuriFlagWaitAny, FuriWaitForever);
+            if(!(flags & FuriFlagError) && (flags & UartTxEvtStop)) stopping = true;
+            continue;
+        }
+
+        if(!continuing && tx->item.more) {
+            // The producer holds its mutex until the last chunk is queued
+            furi_mutex_acquire(tx->producer_mutex, FuriWaitForever);
+            furi_mutex_release(tx->producer_mutex);
+        }
+
+        uart_tx_transmit(tx, lane, !continuing);
+        continuing = tx->item.more;
+    }
+    return 0;
+}
+
+UartTx* uart_tx_alloc(FuriHalSerialHandle* serial) {
+    if(!serial) return NULL;
+
+    UartTx* tx = malloc(sizeof(UartTx));
+    if(!tx) return NULL;
+    memset(tx, 0, sizeof(UartTx));
+    tx->serial = serial;
+
+    tx->lanes[UartTxPriorityNormal] = furi_message_queue_alloc(UART_TX_NORMAL_SLOTS, sizeof(UartTxItem));
+    tx->lanes[UartTxPriorityHigh] = furi_message_queue_alloc(UART_TX_HIGH_SLOTS, sizeof(UartTxItem));
+    tx->slots[UartTxPriorityNormal] = UART_TX_NORMAL_SLOTS;
+    tx->slots[UartTxPriorityHigh] = UART_TX_HIGH_SLOTS;
+    tx->producer_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    tx->stats_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    tx->thread = furi_thread_alloc_ex("UartTx", 1024, uart_tx_worker, tx);
+    if(!tx->lanes[UartTxPriorityNormal] || !tx->lanes[UartTxPriorityHigh] || !tx->producer_mutex ||
+       !tx->stats_mutex || !tx->thread) {
+        FURI_LOG_E("UartTx", "Failed to allocate the TX queue");
+        if(tx->thread) furi_thread_free(tx->thread);
+        tx->thread = NULL;
+        uart_tx_free(tx);
+        return NULL;
+    }
+
+    furi_thread_start(tx->thread);
+    return tx;
+}
+
+void uart_tx_free(UartTx* tx) {
+    if(!tx) return;
+
+    if(tx->thread) {
+        furi_thread_flags_set(furi_thread_get_id(tx->thread), UartTxEvtStop);
+        furi_thread_join(tx->thread);
+        furi_thread_free(tx->thread);
+
+        UartTxStats stats;
+        uart_tx_get_stats(tx, &stats);
+        FURI_LOG_I(
+            "UartTx",
+            "%lu commands (%lu high priority), %lu dropped, wait avg %lu ms max %lu ms",
+            stats.sent,
+            stats.sent_high,
+            stats.dropped,
+            stats.avg_wait_ms,
+            stats.max_wait_ms);
+    }
+
+    for(size_t i = 0; i < UART_TX_LANES; i++) {
+        if(tx->lanes[i]) furi_message_queue_free(tx->lanes[i]);
+    }
+    if(tx->producer_mutex) furi_mutex_free(tx->producer_mutex);
+    if(tx->stats_mutex) furi_mutex_free(tx->stats_mutex);
+    free(tx);
+}
+
+uint32_t uart_tx_send(
+    UartTx* tx,
+    const uint8_t* data,
+    size_t len,
+    UartTxPriority priority,
+    UartTxCallback callback,
+    void* context) {
+    if(!tx || !data || !len) return 0;
+
+    // A completion callback queueing the next command must not wait on itself
+    bool on_tx_thread = furi_thread_get_current_id() == furi_thread_get_id(tx->thread);
+    uint32_t timeout = on_tx_thread ? 0 : UART_TX_ENQUEUE_TIMEOUT_MS;
+    FuriMessageQueue* queue = tx->lanes[priority];
+    size_t chunks = (len + UART_TX_DATA_MAX - 1) / UART_TX_DATA_MAX;
+
+    UartTxItem item;
+    item.id = 0;
+    item.queued_tick = furi_get_tick();
+
+    // A command is queued whole or not at all, never a prefix of it
+    bool reserved = false;
+    while(chunks <= tx->slots[priority]) {
+        furi_mutex_acquire(tx->producer_mutex, FuriWaitForever);
+        reserved = furi_message_queue_get_space(queue) >= chunks;
+        if(reserved) break;
+        furi_mutex_release(tx->producer_mutex);
+        if(furi_get_tick() - item.queued_tick >= furi_ms_to_ticks(timeout)) break;
+        furi_delay_tick(1);
+    }
+
+    if(reserved) {
+        item.id = ++tx->next_id;
+        if(!item.id) item.id = ++tx->next_id;
+
+        // Only producers fill the lane and they hold the mutex, the space is still there
+        size_t offset = 0;
+        while(offset < len) {
+            item.len = MIN(len - offset, (size_t)UART_TX_DATA_MAX);
+            memcpy(item.data, data + offset, item.len);
+            offset += item.len;
+            item.more = offset < len;
+            item.callback = item.more ? NULL : callback;
+            item.context = context;
+            furi_message_queue_put(queue, &item, 0);
+        }
+        furi_mutex_release(tx->producer_mutex);
+        furi_thread_flags_set(furi_thread_get_id(tx->thread), UartTxEvtQueued);
+        return item.id;
+    }
+
+    furi_mutex_acquire(tx->stats_mutex, FuriWaitForever);
+    tx->stats.dropped++;
+    furi_mutex_release(tx->stats_mutex);
+    FURI_LOG_W("UartTx", "Queue full, dropped %u bytes", (unsigned)len);
+    return 0;
+}
+
+void uart_tx_get_stats(UartTx* tx, UartTxStats* stats) {
+    if(!tx || !stats) return;
+
+    furi_mutex_acquire(tx->stats_mutex, FuriWaitForever);
+    *stats = tx->stats;
+    stats->avg_wait_ms = tx->stats.sent ? (uint32_t)(tx->total_wait_ms / tx->stats.sent) : 0;
+    furi_mutex_release(tx->stats_mutex);
+
+    stats->pending = 0;
+    for(size_t i = 0; i < UART_TX_LANES; i++) {
+        stats->pending += furi_message_queue_get_count(tx->lanes[i]);
+    }
+}
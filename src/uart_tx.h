@@ -0,0 +1,74 @@
+#pragma once
+
+#include <furi_hal_serial.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * UART transmit queue
+ *
+ * Commands for the ESP are queued and written by a dedicated thread, so the
+ * GUI never waits on the serial port. The thread keeps UART_TX_SPACING_MS
+ * between commands, which the ESP needs to take them one at a time. The high
+ * lane (stop commands) is drained before the normal one; data longer than
+ * UART_TX_DATA_MAX is split into chunks that are always sent back to back.
+ * A command is queued whole or refused, the ESP never gets part of one.
+ *
+ * A completion callback, called on the TX thread once the bytes left the
+ * UART, gets how long the command waited in the queue. Commands still queued
+ * when the queue is freed are sent before the thread exits.
+ */
+
+#define UART_TX_DATA_MAX           256
+#define UART_TX_NORMAL_SLOTS       16
+#define UART_TX_HIGH_SLOTS         8
+#define UART_TX_SPACING_MS         5
+#define UART_TX_ENQUEUE_TIMEOUT_MS 100 // Longest a producer waits for a free slot
+
+typedef struct UartTx UartTx;
+
+typedef enum {
+    UartTxPriorityNormal,
+    UartTxPriorityHigh, // Jumps ahead of everything queued in the normal lane
+} UartTxPriority;
+
+typedef struct {
+    uint32_t id;
+    uint32_t wait_ms; // Queued until the first byte went out
+    uint32_t latency_ms; // Queued until the last byte went out
+} UartTxResult;
+
+typedef void (*UartTxCallback)(const UartTxResult* result, void* context);
+
+typedef struct {
+    uint32_t sent;
+    uint32_t sent_high;
+    uint32_t dropped; // No room for the whole command within UART_TX_ENQUEUE_TIMEOUT_MS
+    uint32_t pending;
+    uint32_t avg_wait_ms;
+    uint32_t max_wait_ms;
+} UartTxStats;
+
+UartTx* uart_tx_alloc(FuriHalSerialHandle* serial);
+
+/**
+ * @brief Send what is still queued, then stop the thread and free everything
+ */
+void uart_tx_free(UartTx* tx);
+
+/**
+ * @brief Queue data for the ESP, the data is copied
+ * @param callback Optional, called on the TX thread
+ * @return Command id, 0 if nothing was queued (no room for all of it, or
+ *         longer than the lane holds); the callback is then never called
+ */
+uint32_t uart_tx_send(
+    UartTx* tx,
+    const uint8_t* data,
+    size_t len,
+    UartTxPriority priority,
+    UartTxCallback callback,
+    void* context);
+
+void uart_tx_get_stats(UartTx* tx, UartTxStats* stats);
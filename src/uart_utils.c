@@ -7,6 +7,7 @@
 #include <furi_hal_serial.h>
 
 #define WORKER_ALL_RX_EVENTS (WorkerEvtStop | WorkerEvtRxDone | WorkerEvtPcapDone)
+#define GPS_WORKER_EVENTS (WorkerEvtStop | WorkerEvtGps)
 #define PCAP_WRITE_CHUNK_SIZE 1024
 #define AP_LIST_TIMEOUT_MS 5000
 #define INITIAL_BUFFER_SIZE 2048
@@ -221,6 +222,22 @@ static void uart_rx_callback(FuriHalSerialHandle* handle, FuriHalSerialRxEvent e
     furi_mutex_release(uart->text_manager->mutex);
 }
 
+// Settings can change at any time, the filter is only replaced here on the rx worker
+static SeenDevices* uart_seen_devices_sync(AppState* state) {
+    UartContext* uart = state->uart_context;
+    uint8_t index = state->settings.mark_new_devices_index;
+    if(uart->seen_devices_index != index) {
+        uart->seen_devices_index = index;
+        seen_devices_free(uart->seen_devices);
+        uart->seen_devices = seen_devices_alloc(index);
+        if(index && !uart->seen_devices) {
+            // Keep going unmarked, retrying every chunk would only fragment the heap
+            FURI_LOG_W("UART", "No memory to mark new devices, off until the setting changes");
+        }
+    }
+    return uart->seen_devices;
+}
+
 void handle_uart_rx_data(uint8_t *buf, size_t len, void *context) {
     AppState *state = (AppState *)context;
     if(!state || !state->uart_context || !state->uart_context->is_serial_active || 
@@ -229,33 +246,57 @@ void handle_uart_rx_data(uint8_t *buf, size_t len, void *context) {
         return;
     }
 
-    // Only log data if NOT in PCAP mode
+    // Only log data if NOT in PCAP mode, Clear Logs closes the file under the storage mutex
+    UartStorageContext* storage = state->uart_context->storageContext;
+    if(storage) furi_mutex_acquire(storage->mutex, FuriWaitForever);
     if(!state->uart_context->pcap && 
        state->uart_context->storageContext && 
+       !state->uart_context->storageContext->log_paused &&
        state->uart_context->storageContext->log_file && 
        state->uart_context->storageContext->HasOpenedFile) {
         static size_t bytes_since_sync = 0;
         
-        size_t written = storage_file_write(
-            state->uart_context->storageContext->log_file, 
-            buf, 
-            len
-        );
-        
-        if(written != len) {
-            FURI_LOG_E("UART", "Failed to write log data: expected %zu, wrote %zu", len, written);
+        if(state->uart_context->storageContext->log_compressor) {
+            // Compressor emits and syncs whole frames on the same 1KB cadence
+            size_t written = log_compressor_write(
+                state->uart_context->storageContext->log_compressor, buf, len);
+            if(written != len) {
+                FURI_LOG_E("UART", "Failed to write compressed log: expected %zu, wrote %zu", len, written);
+            }
         } else {
-            bytes_since_sync += written;
-            if(bytes_since_sync >= 1024) {  // Sync every 1KB
-                storage_file_sync(state->uart_context->storageContext->log_file);
-                bytes_since_sync = 0;
-                FURI_LOG_D("UART", "Synced log file to storage");
+            size_t written = storage_file_write(
+                state->uart_context->storageContext->log_file, 
+                buf, 
+                len
+            );
+            
+            if(written != len) {
+                FURI_LOG_E("UART", "Failed to write log data: expected %zu, wrote %zu", len, written);
+            } else {
+                bytes_since_sync += written;
+                if(bytes_since_sync >= 1024) {  // Sync every 1KB
+                    storage_file_sync(state->uart_context->storageContext->log_file);
+                    bytes_since_sync = 0;
+                    FURI_LOG_D("UART", "Synced log file to storage");
+                }
             }
         }
     }
+    if(storage) furi_mutex_release(storage->mutex);
 
-    // Update text display
-    text_buffer_add(state->uart_context->text_manager, (char*)buf, len);
+    stop_all_on_rx(state->uart_context->stop_all);
+    esp_response_feed(state->uart_context->responses, buf, len);
+
+    // Update text display, lines with a device not seen before get marked
+    SeenDevices* seen = uart_seen_devices_sync(state);
+    for(size_t pos = 0; pos < len;) {
+        size_t end = pos + seen_devices_scan(seen, buf + pos, len - pos);
+        text_buffer_add(state->uart_context->text_manager, (char*)buf + pos, end - pos);
+        if(end == len) break;
+        text_buffer_add(
+            state->uart_context->text_manager, SEEN_DEVICES_MARK, strlen(SEEN_DEVICES_MARK));
+        pos = end;
+    }
     text_buffer_update_view(state->uart_context->text_manager,
                            state->settings.view_logs_from_start_index);
     
@@ -291,6 +332,7 @@ static int32_t uart_worker(void* context) {
                 0);
 
             FURI_LOG_D("Worker", "Processing rx_stream data: %zu bytes", len);
+            if(len > 0) esp_health_on_rx(uart->health);
 
             if(len > 0 && uart->handle_rx_data_cb) {
                 FURI_LOG_D("Worker", "Invoking handle_rx_data_cb with %zu bytes", len);
@@ -307,26 +349,32 @@ static int32_t uart_worker(void* context) {
         }
 
         if(events & WorkerEvtPcapDone) {
-            size_t len = furi_stream_buffer_receive(
-                uart->pcap_stream,
-                uart->rx_buf,
-                RX_BUF_SIZE,
-                0);
-
-            FURI_LOG_D("Worker", "Processing pcap_stream data: %zu bytes", len);
-
-            if(len > 0 && uart->handle_rx_pcap_cb) {
-                FURI_LOG_D("Worker", "Invoking handle_rx_pcap_cb with %zu bytes", len);
-                uart->handle_rx_pcap_cb(uart->rx_buf, len, uart);  // Corrected context
-                FURI_LOG_D("Worker", "pcap_stream callback invoked successfully");
-            } else {
-                if(len == 0) {
-                    FURI_LOG_W("Worker", "Received zero bytes from pcap_stream");
-                }
-                if(!uart->handle_rx_pcap_cb) {
+            // Everything queued so far is written under the storage mutex, so an
+            // empty stream and a free mutex mean the capture has all its bytes
+            FuriMutex* storage_mutex = uart->storageContext ? uart->storageContext->mutex : NULL;
+            if(storage_mutex) furi_mutex_acquire(storage_mutex, FuriWaitForever);
+
+            // One flag can stand for more than RX_BUF_SIZE bytes
+            size_t queued = furi_stream_buffer_bytes_available(uart->pcap_stream);
+            do {
+                size_t len = furi_stream_buffer_receive(
+                    uart->pcap_stream,
+                    uart->rx_buf,
+                    RX_BUF_SIZE,
+                    0);
+                FURI_LOG_D("Worker", "Processing pcap_stream data: %zu bytes", len);
+                if(len == 0) break;
+                queued -= MIN(queued, len);
+
+                esp_health_on_rx(uart->health);
+                if(uart->handle_rx_pcap_cb) {
+                    uart->handle_rx_pcap_cb(uart->rx_buf, len, uart);
+                } else {
                     FURI_LOG_E("Worker", "handle_rx_pcap_cb is NULL");
                 }
-            }
+            } while(queued > 0);
+
+            if(storage_mutex) furi_mutex_release(storage_mutex);
         }
     }
 
@@ -339,6 +387,97 @@ static int32_t uart_worker(void* context) {
     return 0;
 }
 
+static void uart_gps_rx_callback(FuriHalSerialHandle* handle, FuriHalSerialRxEvent event, void* context) {
+    UartContext* uart = (UartContext*)context;
+    if(!uart || event != FuriHalSerialRxEventData) return;
+
+    uint8_t data = furi_hal_serial_async_rx(handle);
+    if(uart->gps_thread && furi_stream_buffer_send(uart->gps_stream, &data, 1, 0) == 1) {
+        furi_thread_flags_set(furi_thread_get_id(uart->gps_thread), WorkerEvtGps);
+    }
+}
+
+// Separate from uart_worker so SD writes never hold up NMEA parsing
+static int32_t uart_gps_worker(void* context) {
+    UartContext* uart = (UartContext*)context;
+    uint8_t buf[64];
+
+    while(1) {
+        uint32_t events = furi_thread_flags_wait(GPS_WORKER_EVENTS, FuriFlagWaitAny, FuriWaitForever);
+        if(events & WorkerEvtStop) break;
+
+        if(events & WorkerEvtGps) {
+            size_t len;
+            while((len = furi_stream_buffer_receive(uart->gps_stream, buf, sizeof(buf), 0)) > 0) {
+                gps_nmea_feed(uart->gps, buf, len);
+            }
+        }
+    }
+    return 0;
+}
+
+bool uart_gps_start(UartContext* uart, uint32_t baud) {
+    if(!uart) return false;
+    uart_gps_stop(uart);
+    if(!baud) return true;
+
+    FuriHalSerialId esp_channel = has_momentum_features() ? UART_CH_ESP : FuriHalSerialIdUsart;
+    FuriHalSerialId gps_channel = has_momentum_features() ? UART_CH_GPS : FuriHalSerialIdLpuart;
+    if(gps_channel == esp_channel) {
+        FURI_LOG_W("GPS", "GPS and ESP share a UART, not starting GPS");
+        return false;
+    }
+
+    if(!uart->gps) uart->gps = gps_nmea_alloc();
+    uart->gps_stream = furi_stream_buffer_alloc(GPS_BUF_SIZE, 1);
+    uart->gps_handle = furi_hal_serial_control_acquire(gps_channel);
+    if(!uart->gps || !uart->gps_stream || !uart->gps_handle) {
+        FURI_LOG_E("GPS", "Failed to acquire GPS UART");
+        uart_gps_stop(uart);
+        return false;
+    }
+    gps_nmea_reset(uart->gps);
+
+    uart->gps_thread = furi_thread_alloc_ex("UART_Gps", 1024, uart_gps_worker, uart);
+    furi_thread_start(uart->gps_thread);
+
+    furi_hal_serial_init(uart->gps_handle, baud);
+    furi_hal_serial_async_rx_start(uart->gps_handle, uart_gps_rx_callback, uart, false);
+    FURI_LOG_I("GPS", "Reading NMEA at %lu baud", baud);
+    return true;
+}
+
+void uart_gps_stop(UartContext* uart) {
+    if(!uart) return;
+
+    if(uart->gps_handle) {
+        furi_hal_serial_async_rx_stop(uart->gps_handle);
+        furi_hal_serial_deinit(uart->gps_handle);
+        furi_hal_serial_control_release(uart->gps_handle);
+        uart->gps_handle = NULL;
+    }
+
+    if(uart->gps_thread) {
+        furi_thread_flags_set(furi_thread_get_id(uart->gps_thread), WorkerEvtStop);
+        furi_thread_join(uart->gps_thread);
+        furi_thread_free(uart->gps_thread);
+        uart->gps_thread = NULL;
+
+        GpsNmeaStats stats;
+        gps_nmea_get_stats(uart->gps, &stats);
+        FURI_LOG_I(
+            "GPS",
+            "Stopped: %lu sentences, %lu checksum errors, %lu overlong",
+            stats.sentences,
+            stats.checksum_errors,
+            stats.overflows);
+    }
+
+    if(uart->gps_stream) {
+        furi_stream_buffer_free(uart->gps_stream);
+        uart->gps_stream = NULL;
+    }
+}
 
 void update_text_box_view(AppState* state) {
     if(!state || !state->text_box || !state->uart_context || !state->uart_context->text_manager) return;
@@ -351,6 +490,12 @@ void update_text_box_view(AppState* state) {
     text_box_set_focus(state->text_box, 
                       view_from_start ? TextBoxFocusStart : TextBoxFocusEnd);
 }
+
+void uart_append_log(UartContext* uart, const char* text) {
+    if(!uart || !uart->text_manager || !text) return;
+    text_buffer_add(uart->text_manager, text, strlen(text));
+    update_text_box_view(uart->state);
+}
 UartContext* uart_init(AppState* state) {
     uint32_t start_time = furi_get_tick();
     FURI_LOG_I("UART", "Starting UART initialization");
@@ -423,6 +568,18 @@ UartContext* uart_init(AppState* state) {
         return NULL;
     }
 
+    uart->tx = uart_tx_alloc(uart->serial_handle);
+    uart->stop_all = stop_all_alloc(uart);
+    uart->responses = esp_response_alloc(uart);
+    uart->health = esp_health_alloc(uart);
+    uart->caps = esp_caps_alloc(uart);
+    uart->scheduler = cmd_scheduler_alloc(uart);
+    if(!uart->tx || !uart->stop_all || !uart->responses || !uart->health || !uart->caps ||
+       !uart->scheduler) {
+        uart_free(uart);
+        return NULL;
+    }
+
     // Initialize text manager
     uart->text_manager = text_buffer_alloc();
     if(!uart->text_manager) {
@@ -431,6 +588,11 @@ UartContext* uart_init(AppState* state) {
         return NULL;
     }
 
+    // A GPS module on the Flipper itself is optional, the ESP works without it
+    if(state && state->settings.flipper_gps_index) {
+        uart_gps_start(uart, gps_nmea_baud_for_index(state->settings.flipper_gps_index));
+    }
+
     uint32_t duration = furi_get_tick() - start_time;
     FURI_LOG_I("UART", "UART initialization complete (Time taken: %lu ms)", duration);
 
@@ -440,6 +602,12 @@ UartContext* uart_init(AppState* state) {
 void uart_free(UartContext *uart) {
     if(!uart) return;
 
+    uart_gps_stop(uart);
+    if(uart->gps) {
+        gps_nmea_free(uart->gps);
+        uart->gps = NULL;
+    }
+
     // Stop the worker thread
     if(uart->rx_thread) {
         furi_thread_flags_set(furi_thread_get_id(uart->rx_thread), WorkerEvtStop);
@@ -448,6 +616,38 @@ void uart_free(UartContext *uart) {
         uart->rx_thread = NULL;
     }
 
+    // The scheduler, the discovery worker and the heartbeat timer send through the TX
+    // queue, they stop before the queue goes
+    cmd_scheduler_stop(uart->scheduler);
+    if(uart->caps) {
+        esp_caps_free(uart->caps);
+        uart->caps = NULL;
+    }
+    if(uart->health) {
+        esp_health_free(uart->health);
+        uart->health = NULL;
+    }
+
+    // Flush queued commands while the port is still up
+    if(uart->tx) {
+        uart_tx_free(uart->tx);
+        uart->tx = NULL;
+    }
+
+    // After the TX queue, its last completion callback may still point here
+    if(uart->stop_all) {
+        stop_all_free(uart->stop_all);
+        uart->stop_all = NULL;
+    }
+    if(uart->scheduler) {
+        cmd_scheduler_free(uart->scheduler);
+        uart->scheduler = NULL;
+    }
+    if(uart->responses) {
+        esp_response_free(uart->responses);
+        uart->responses = NULL;
+    }
+
     // Clean up serial
     if(uart->serial_handle) {
         furi_hal_serial_async_rx_stop(uart->serial_handle);
@@ -472,6 +672,12 @@ void uart_free(UartContext *uart) {
         uart->storageContext = NULL;
     }
 
+    // The worker is gone, nothing scans for devices anymore
+    if(uart->seen_devices) {
+        seen_devices_free(uart->seen_devices);
+        uart->seen_devices = NULL;
+    }
+
     // Free text manager
     if(uart->text_manager) {
         text_buffer_free(uart->text_manager);
@@ -491,91 +697,26 @@ void uart_stop_thread(UartContext *uart)
     }
 }
 
-// Send data over UART
-void uart_send(UartContext *uart, const uint8_t *data, size_t len) {
-    if(!uart || !uart->serial_handle || !uart->is_serial_active || !data || len == 0) {
-        return;
-    }
-    
-    // Send data directly without mutex lock for basic commands
-    furi_hal_serial_tx(uart->serial_handle, data, len);
-    
-    // Small delay to ensure transmission
-    furi_delay_ms(5);
+// Send data over UART, queued so the caller never waits on the port
+bool uart_send(UartContext *uart, const uint8_t *data, size_t len) {
+    return uart_send_ex(uart, data, len, UartTxPriorityNormal, NULL, NULL) != 0;
 }
 
-
-bool uart_is_esp_connected(UartContext* uart) {
-    FURI_LOG_D("UART", "Checking ESP connection...");
-    
-    if(!uart || !uart->serial_handle || !uart->text_manager) {
-        FURI_LOG_E("UART", "Invalid UART context");
-        return false;
-    }
-
-    // Check if ESP check is disabled
-    if(uart->state && uart->state->settings.disable_esp_check_index) {
-        FURI_LOG_D("UART", "ESP connection check disabled by setting");
-        return true;
-    }
-
-    // Temporarily disable callbacks
-    furi_hal_serial_async_rx_stop(uart->serial_handle);
-    
-    // Clear and reset buffers atomically
-    furi_mutex_acquire(uart->text_manager->mutex, FuriWaitForever);
-    memset(uart->text_manager->ring_buffer, 0, RING_BUFFER_SIZE);
-    memset(uart->text_manager->view_buffer, 0, VIEW_BUFFER_SIZE);
-    uart->text_manager->ring_read_index = 0;
-    uart->text_manager->ring_write_index = 0;
-    uart->text_manager->buffer_full = false;
-    uart->text_manager->view_buffer_len = 0;
-    furi_mutex_release(uart->text_manager->mutex);
-
-    // Re-enable callbacks with clean state
-    furi_hal_serial_async_rx_start(uart->serial_handle, uart_rx_callback, uart, false);
-    
-    // Quick flush
-    furi_hal_serial_tx(uart->serial_handle, (uint8_t*)"\r\n", 2);
-    furi_delay_ms(50);
-    
-    const char* test_commands[] = {
-        "stop\n",    // Try stop command first
-        "AT\r\n",    // AT command as backup
-    };
-    bool connected = false;
-    const uint32_t CMD_TIMEOUT_MS = 250; // Shorter timeout per command
-
-    for(uint8_t cmd_idx = 0; cmd_idx < sizeof(test_commands)/sizeof(test_commands[0]) && !connected; cmd_idx++) {
-        // Send test command
-        uart_send(uart, (uint8_t*)test_commands[cmd_idx], strlen(test_commands[cmd_idx]));
-        FURI_LOG_D("UART", "Sent command: %s", test_commands[cmd_idx]);
-
-        uint32_t start_time = furi_get_tick();
-        while(furi_get_tick() - start_time < CMD_TIMEOUT_MS) {
-            furi_mutex_acquire(uart->text_manager->mutex, FuriWaitForever);
-            
-            size_t available = uart->text_manager->buffer_full ? RING_BUFFER_SIZE :
-                (uart->text_manager->ring_write_index >= uart->text_manager->ring_read_index) ?
-                uart->text_manager->ring_write_index - uart->text_manager->ring_read_index :
-                RING_BUFFER_SIZE - uart->text_manager->ring_read_index + uart->text_manager->ring_write_index;
-            
-            if(available > 0) {
-                connected = true;
-                FURI_LOG_D("UART", "Received %d bytes response", available);
-            }
-            
-            furi_mutex_release(uart->text_manager->mutex);
-            
-            if(connected) break;
-            furi_delay_ms(5);  // Shorter sleep interval
-        }
-    }
-
-    FURI_LOG_I("UART", "ESP connection check: %s", connected ? "Success" : "Failed");
-    return connected;
+uint32_t uart_send_ex(
+    UartContext* uart,
+    const uint8_t* data,
+    size_t len,
+    UartTxPriority priority,
+    UartTxCallback callback,
+    void* context) {
+    if(!uart || !uart->tx || !uart->is_serial_active || !data || len == 0) {
+        return 0;
+    }
+    stop_all_note_command(uart->stop_all, data, len);
+    return uart_tx_send(uart->tx, data, len, priority, callback, context);
 }
 
+
 bool uart_receive_data(
     UartContext* uart,
     ViewDispatcher* view_dispatcher,
@@ -589,11 +730,12 @@ bool uart_receive_data(
         return false;
     }
 
+    // A stop still waiting for the ESP must not close what starts now
+    stop_all_cancel(uart->stop_all);
+
     // Close any existing file
     if(uart->storageContext->HasOpenedFile) {
-        storage_file_sync(uart->storageContext->current_file);
-        storage_file_close(uart->storageContext->current_file);
-        uart->storageContext->HasOpenedFile = false;
+        uart_storage_close_capture(uart->storageContext);
     }
    
     uart->pcap = false;  // Reset capture state
@@ -605,12 +747,8 @@ bool uart_receive_data(
 
     // Open new file if needed
     if(prefix && extension && TargetFolder && strlen(prefix) > 1) {
-        uart->storageContext->HasOpenedFile = sequential_file_open(
-            uart->storageContext->storage_api,
-            uart->storageContext->current_file,
-            TargetFolder,
-            prefix,
-            extension);
+        uart->storageContext->HasOpenedFile = uart_storage_open_capture(
+            uart->storageContext, TargetFolder, prefix, extension);
        
         if(!uart->storageContext->HasOpenedFile) {
             FURI_LOG_E("UART", "Failed to open file");
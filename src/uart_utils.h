@@ -10,6 +10,14 @@
 #include <gui/modules/text_box.h>
 #include "menu.h"
 #include "uart_storage.h"
+#include "gps_nmea.h"
+#include "seen_devices.h"
+#include "uart_tx.h"
+#include "stop_all.h"
+#include "esp_response.h"
+#include "esp_health.h"
+#include "esp_caps.h"
+#include "cmd_scheduler.h"
 #include <stdbool.h> 
 #include "firmware_api.h"
 
@@ -32,12 +40,12 @@
 #define GHOST_ESP_APP_FOLDER_WARDRIVE "/ext/apps_data/ghost_esp/wardrive"
 #define GHOST_ESP_APP_FOLDER_LOGS     "/ext/apps_data/ghost_esp/logs"
 #define GHOST_ESP_APP_SETTINGS_FILE   "/ext/apps_data/ghost_esp/settings.ini"
-#define ESP_CHECK_TIMEOUT_MS 100
 #define VIEW_BUFFER_SIZE (16 * 1024)  // 16KB for view
 #define RING_BUFFER_SIZE (8 * 1024)   // 8KB for incoming data
 #define PCAP_GLOBAL_HEADER_SIZE 24
 #define PCAP_PACKET_HEADER_SIZE 16
 #define PCAP_TEMP_BUFFER_SIZE 4096
+#define GPS_BUF_SIZE 512
 
 
 void update_text_box_view(AppState* state);
@@ -58,6 +66,7 @@ typedef enum {
     WorkerEvtRxDone = (1 << 1),
     WorkerEvtPcapDone = (1 << 2),
     WorkerEvtStorage = (1 << 3),
+    WorkerEvtGps = (1 << 4),
 } WorkerEvtFlags;
 
 typedef struct {
@@ -73,8 +82,18 @@ typedef struct {
 
 typedef struct UartContext {
     FuriHalSerialHandle* serial_handle;
+    UartTx* tx; // Everything sent to the ESP goes through this queue
+    StopAll* stop_all; // Knows what was started, stops it when leaving the log view
+    EspResponse* responses; // Commands waiting for an answer, fed by the rx worker
+    EspHealth* health; // Cached link state, commands skip the probe while it is connected
+    EspCaps* caps; // Commands the attached firmware supports, menus hide the rest
+    CmdScheduler* scheduler; // Recurring and delayed commands, cleared when leaving the log view
     FuriHalSerialHandle* gps_handle;
     FuriStreamBuffer* gps_stream;
+    FuriThread* gps_thread;
+    GpsNmea* gps; // Latest fix from a GPS module on the Flipper, allocated with the first start
+    SeenDevices* seen_devices; // Owned by the rx worker, follows SETTING_MARK_NEW_DEVICES
+    uint8_t seen_devices_index; // Setting seen_devices was set up for, a failed allocation waits for a change
     FuriThread* rx_thread;
     FuriStreamBuffer* rx_stream;
     FuriStreamBuffer* pcap_stream;
@@ -98,7 +117,24 @@ typedef struct UartContext {
 UartContext* uart_init(AppState* state);
 void uart_free(UartContext* uart);
 void uart_stop_thread(UartContext* uart);
-void uart_send(UartContext* uart, const uint8_t* data, size_t len);
+
+/**
+ * @brief Queue a command for the ESP
+ * @return false if nothing was queued
+ */
+bool uart_send(UartContext* uart, const uint8_t* data, size_t len);
+
+/**
+ * @brief uart_send with a queue lane and a completion callback
+ * @return Command id, 0 if nothing was queued
+ */
+uint32_t uart_send_ex(
+    UartContext* uart,
+    const uint8_t* data,
+    size_t len,
+    UartTxPriority priority,
+    UartTxCallback callback,
+    void* context);
 bool uart_is_marauder_firmware(UartContext* uart);
 bool uart_receive_data(
     UartContext* uart,
@@ -107,7 +143,18 @@ bool uart_receive_data(
     const char* prefix,
     const char* extension,
     const char* TargetFolder);
-bool uart_is_esp_connected(UartContext* uart);
+
+/**
+ * @brief Add app text to the log view, between ESP output
+ */
+void uart_append_log(UartContext* uart, const char* text);
+
+/**
+ * @brief (Re)start reading NMEA from the GPS UART at baud, 0 stops it
+ * @return false if the channel is busy or shared with the ESP
+ */
+bool uart_gps_start(UartContext* uart, uint32_t baud);
+void uart_gps_stop(UartContext* uart);
 void uart_storage_reset_logs(UartStorageContext *ctx);
 void uart_storage_safe_cleanup(UartStorageContext* ctx);
 
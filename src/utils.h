@@ -15,3 +15,7 @@ void show_confirmation_view_wrapper(void* context, ConfirmationView* view);  //
 
 void clear_pcap_files(void* context);
 void clear_wardrive_files(void* context);
+void run_wardrive_merge(void* context);
+void run_script(void* context);
+void run_schedule(void* context);
+void run_storage_bench(void* context);
@@ -0,0 +1,446 @@
+#include "wardrive_bin.h"
+#include "wardrive_row.h"
+#include <furi.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WARDRIVE_BIN_LINE_MAX 256
+#define WARDRIVE_BIN_BUFFER   512 // Records are batched so every write is at least this big
+#define WARDRIVE_BIN_SSIDS    512 // SSID ids remembered, power of two
+#define WARDRIVE_BIN_POOL     16 // Distinct auth/type strings per capture
+#define WARDRIVE_BIN_POOL_LEN 32
+#define WARDRIVE_BIN_SSID_POOL 6144 // SSID text a reader keeps until the ids start over
+
+_Static_assert(
+    WARDRIVE_BIN_SSID_IDS == WARDRIVE_BIN_SSIDS - WARDRIVE_BIN_SSIDS / 8,
+    "SSID ids start over when the table is 7/8 full");
+
+typedef struct {
+    uint32_t hash; // 0 = empty
+    uint16_t id;
+} WardriveBinSsid;
+
+typedef struct {
+    char strings[WARDRIVE_BIN_POOL][WARDRIVE_BIN_POOL_LEN];
+    uint8_t count;
+} WardriveBinPool;
+
+struct WardriveBin {
+    File* file;
+    bool active;
+    const GpsNmea* gps;
+
+    // SSIDs are only known by hash, a collision (about 1 in 2^32 per pair) reuses the other name
+    WardriveBinSsid ssids[WARDRIVE_BIN_SSIDS];
+    uint32_t ssid_used;
+    uint16_t next_ssid_id;
+    WardriveBinPool auth;
+    WardriveBinPool type;
+
+    char line[WARDRIVE_BIN_LINE_MAX];
+    size_t line_len;
+    bool line_overflow;
+
+    uint8_t buffer[WARDRIVE_BIN_BUFFER];
+    size_t buffer_len;
+    uint64_t offset; // Bytes on disk
+
+    WardriveBinStats stats;
+};
+
+struct WardriveBinReader {
+    File* file;
+    uint8_t buffer[WARDRIVE_BIN_BUFFER];
+    size_t pos;
+    size_t len;
+
+    uint16_t ssid_offsets[WARDRIVE_BIN_SSID_IDS]; // Into ssids, UINT16_MAX while undefined
+    char ssids[WARDRIVE_BIN_SSID_POOL];
+    size_t ssids_len;
+    WardriveBinPool auth;
+    WardriveBinPool type;
+};
+
+static inline void wardrive_bin_put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static inline void wardrive_bin_put32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static inline uint16_t wardrive_bin_get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t wardrive_bin_get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool wardrive_bin_flush(WardriveBin* bin) {
+    if(!bin->buffer_len) return true;
+    bool ok = storage_file_write(bin->file, bin->buffer, bin->buffer_len) == bin->buffer_len;
+    if(ok) {
+        bin->offset += bin->buffer_len;
+        bin->stats.bytes_out += bin->buffer_len;
+    } else {
+        FURI_LOG_E("WardriveBin", "Failed to write %u bytes", (unsigned)bin->buffer_len);
+    }
+    bin->buffer_len = 0;
+    return ok;
+}
+
+static uint8_t* wardrive_bin_reserve(WardriveBin* bin, size_t len) {
+    if(bin->buffer_len + len > WARDRIVE_BIN_BUFFER && !wardrive_bin_flush(bin)) return NULL;
+    uint8_t* p = bin->buffer + bin->buffer_len;
+    bin->buffer_len += len;
+    return p;
+}
+
+static bool wardrive_bin_emit_string(
+    WardriveBin* bin,
+    WardriveBinStringKind kind,
+    uint16_t id,
+    const char* s,
+    size_t len) {
+    uint8_t* p = wardrive_bin_reserve(bin, 5 + len);
+    if(!p) return false;
+    p[0] = WARDRIVE_BIN_TAG_STRING;
+    p[1] = kind;
+    wardrive_bin_put16(p + 2, id);
+    p[4] = (uint8_t)len;
+    memcpy(p + 5, s, len);
+    bin->stats.strings++;
+    return true;
+}
+
+static uint32_t wardrive_bin_hash(const char* s, size_t len) {
+    uint32_t hash = 0x811C9DC5;
+    for(size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)s[i]) * 0x01000193;
+    }
+    return hash ? hash : 1;
+}
+
+static bool wardrive_bin_ssid_id(WardriveBin* bin, const char* ssid, uint16_t* id) {
+    size_t len = strlen(ssid);
+    if(!len) {
+        *id = WARDRIVE_BIN_NO_SSID;
+        return true;
+    }
+
+    // Start over once the table gets crowded, ids are simply defined again
+    if(bin->ssid_used >= WARDRIVE_BIN_SSID_IDS) {
+        memset(bin->ssids, 0, sizeof(bin->ssids));
+        bin->ssid_used = 0;
+        bin->next_ssid_id = 0;
+    }
+
+    uint32_t hash = wardrive_bin_hash(ssid, len);
+    uint32_t mask = WARDRIVE_BIN_SSIDS - 1;
+    for(uint32_t i = 0; i < WARDRIVE_BIN_SSIDS; i++) {
+        WardriveBinSsid* slot = &bin->ssids[(hash + i) & mask];
+        if(slot->hash == hash) {
+            *id = slot->id;
+            return true;
+        }
+        if(slot->hash == 0) {
+            slot->hash = hash;
+            slot->id = bin->next_ssid_id++;
+            bin->ssid_used++;
+            *id = slot->id;
+            return wardrive_bin_emit_string(bin, WardriveBinStringSsid, slot->id, ssid, len);
+        }
+    }
+    return false;
+}
+
+static bool wardrive_bin_pool_id(
+    WardriveBin* bin,
+    WardriveBinPool* pool,
+    WardriveBinStringKind kind,
+    const char* s,
+    uint8_t* id) {
+    if(!s[0]) {
+        *id = WARDRIVE_BIN_NO_STRING;
+        return true;
+    }
+    for(uint8_t i = 0; i < pool->count; i++) {
+        if(strcmp(pool->strings[i], s) == 0) {
+            *id = i;
+            return true;
+        }
+    }
+    if(pool->count == WARDRIVE_BIN_POOL) {
+        *id = WARDRIVE_BIN_NO_STRING;
+        return true;
+    }
+
+    size_t len = MIN(strlen(s), (size_t)WARDRIVE_BIN_POOL_LEN - 1);
+    memcpy(pool->strings[pool->count], s, len);
+    pool->strings[pool->count][len] = '\0';
+    *id = pool->count++;
+    return wardrive_bin_emit_string(bin, kind, *id, s, len);
+}
+
+static bool wardrive_bin_handle_line(WardriveBin* bin) {
+    size_t len = bin->line_len;
+    bin->line_len = 0;
+    while(len && (bin->line[len - 1] == '\n' || bin->line[len - 1] == '\r')) {
+        len--;
+    }
+
+    WardriveRow row;
+    if(!wardrive_row_parse(bin->line, len, &row)) {
+        // Header lines and ESP chatter, the converter writes its own headers
+        if(len) bin->stats.skipped++;
+        return true;
+    }
+    wardrive_row_fill_fix(&row, bin->gps);
+
+    uint16_t ssid;
+    uint8_t auth, type;
+    if(!wardrive_bin_ssid_id(bin, row.ssid, &ssid) ||
+       !wardrive_bin_pool_id(bin, &bin->auth, WardriveBinStringAuth, row.auth, &auth) ||
+       !wardrive_bin_pool_id(bin, &bin->type, WardriveBinStringType, row.type, &type)) {
+        return false;
+    }
+
+    uint8_t* p = wardrive_bin_reserve(bin, WARDRIVE_BIN_RECORD_SIZE);
+    if(!p) return false;
+    p[0] = WARDRIVE_BIN_TAG_NETWORK;
+    p[1] = (uint8_t)row.rssi;
+    p[2] = row.channel;
+    p[3] = auth;
+    memcpy(p + 4, row.bssid, 6);
+    wardrive_bin_put16(p + 10, ssid);
+    wardrive_bin_put32(p + 12, (uint32_t)row.lat_e7);
+    wardrive_bin_put32(p + 16, (uint32_t)row.lon_e7);
+    wardrive_bin_put32(p + 20, wardrive_row_timestamp(&row));
+    wardrive_bin_put32(p + 24, (uint32_t)row.alt_dm);
+    wardrive_bin_put16(p + 28, (uint16_t)CLAMP(row.acc_dm, UINT16_MAX, 0));
+    p[30] = type;
+    p[31] = wardrive_row_has_fix(&row) ? WARDRIVE_BIN_FLAG_FIX : 0;
+    bin->stats.rows++;
+    return true;
+}
+
+WardriveBin* wardrive_bin_alloc(void) {
+    WardriveBin* bin = malloc(sizeof(WardriveBin));
+    if(!bin) return NULL;
+    memset(bin, 0, sizeof(WardriveBin));
+    return bin;
+}
+
+void wardrive_bin_free(WardriveBin* bin) {
+    if(!bin) return;
+    free(bin);
+}
+
+bool wardrive_bin_begin(WardriveBin* bin, File* file, uint32_t created) {
+    if(!bin) return false;
+    memset(bin, 0, sizeof(WardriveBin));
+    bin->file = file;
+
+    uint8_t* p = wardrive_bin_reserve(bin, WARDRIVE_BIN_HEADER_SIZE);
+    wardrive_bin_put32(p, WARDRIVE_BIN_MAGIC);
+    wardrive_bin_put16(p + 4, WARDRIVE_BIN_VERSION);
+    wardrive_bin_put16(p + 6, WARDRIVE_BIN_RECORD_SIZE);
+    wardrive_bin_put32(p + 8, created);
+    wardrive_bin_put32(p + 12, 0);
+
+    // The header goes out right away so even an empty capture is a valid log
+    bin->active = file != NULL && wardrive_bin_flush(bin);
+    return bin->active;
+}
+
+void wardrive_bin_set_gps(WardriveBin* bin, const GpsNmea* gps) {
+    if(!bin) return;
+    bin->gps = gps;
+}
+
+bool wardrive_bin_write(WardriveBin* bin, const uint8_t* data, size_t len) {
+    if(!bin || !bin->active) return false;
+
+    bin->stats.bytes_in += len;
+    bool ok = true;
+    for(size_t pos = 0; pos < len && ok;) {
+        const uint8_t* newline = memchr(data + pos, '\n', len - pos);
+        size_t take = newline ? (size_t)(newline - (data + pos)) + 1 : len - pos;
+
+        if(bin->line_overflow) {
+            // Rest of a line too long to be a row
+            if(newline) bin->line_overflow = false;
+        } else if(bin->line_len + take > WARDRIVE_BIN_LINE_MAX) {
+            bin->stats.skipped++;
+            bin->line_len = 0;
+            bin->line_overflow = !newline;
+        } else {
+            memcpy(bin->line + bin->line_len, data + pos, take);
+            bin->line_len += take;
+            if(newline) ok = wardrive_bin_handle_line(bin);
+        }
+        pos += take;
+    }
+    return ok;
+}
+
+void wardrive_bin_finish(WardriveBin* bin) {
+    if(!bin || !bin->active) return;
+
+    if(bin->line_len && !wardrive_bin_handle_line(bin)) {
+        FURI_LOG_W("WardriveBin", "Failed to write last row");
+    }
+    wardrive_bin_flush(bin);
+
+    FURI_LOG_I(
+        "WardriveBin",
+        "%lu rows, %lu strings, %lu skipped lines: %lu CSV bytes -> %lu",
+        bin->stats.rows,
+        bin->stats.strings,
+        bin->stats.skipped,
+        bin->stats.bytes_in,
+        (uint32_t)bin->stats.bytes_out);
+    bin->active = false;
+    bin->file = NULL;
+}
+
+bool wardrive_bin_is_active(const WardriveBin* bin) {
+    return bin && bin->active;
+}
+
+uint64_t wardrive_bin_get_record_end(const WardriveBin* bin) {
+    return bin ? bin->offset : 0;
+}
+
+void wardrive_bin_get_stats(const WardriveBin* bin, WardriveBinStats* stats) {
+    if(!bin || !stats) return;
+    *stats = bin->stats;
+}
+
+WardriveBinReader* wardrive_bin_reader_alloc(void) {
+    WardriveBinReader* reader = malloc(sizeof(WardriveBinReader));
+    if(!reader) return NULL;
+    memset(reader, 0, sizeof(WardriveBinReader));
+    return reader;
+}
+
+void wardrive_bin_reader_free(WardriveBinReader* reader) {
+    if(!reader) return;
+    free(reader);
+}
+
+// Next len bytes of the log, false at its end
+static bool wardrive_bin_read(WardriveBinReader* reader, uint8_t* out, size_t len) {
+    while(len) {
+        if(reader->pos == reader->len) {
+            reader->len = storage_file_read(reader->file, reader->buffer, sizeof(reader->buffer));
+            reader->pos = 0;
+            if(!reader->len) return false;
+        }
+        size_t take = MIN(len, reader->len - reader->pos);
+        memcpy(out, reader->buffer + reader->pos, take);
+        reader->pos += take;
+        out += take;
+        len -= take;
+    }
+    return true;
+}
+
+static void wardrive_bin_reader_reset_ssids(WardriveBinReader* reader) {
+    memset(reader->ssid_offsets, 0xFF, sizeof(reader->ssid_offsets));
+    reader->ssids_len = 0;
+}
+
+static void wardrive_bin_reader_define(
+    WardriveBinReader* reader,
+    uint8_t kind,
+    uint16_t id,
+    const char* s,
+    size_t len) {
+    if(kind == WardriveBinStringSsid) {
+        if(id >= WARDRIVE_BIN_SSID_IDS) return;
+        // The writer starts over at id 0 when its table fills, so can the reader
+        if(id == 0) wardrive_bin_reader_reset_ssids(reader);
+        len = MIN(len, sizeof(((WardriveRow*)NULL)->ssid) - 1);
+        if(reader->ssids_len + len + 1 > WARDRIVE_BIN_SSID_POOL) {
+            FURI_LOG_W("WardriveBin", "SSID pool full, id %u stays empty", id);
+            return;
+        }
+        reader->ssid_offsets[id] = reader->ssids_len;
+        memcpy(reader->ssids + reader->ssids_len, s, len);
+        reader->ssids[reader->ssids_len + len] = '\0';
+        reader->ssids_len += len + 1;
+        return;
+    }
+
+    WardriveBinPool* pool = kind == WardriveBinStringAuth ? &reader->auth :
+                            kind == WardriveBinStringType ? &reader->type :
+                                                            NULL;
+    if(!pool || id >= WARDRIVE_BIN_POOL) return;
+    len = MIN(len, (size_t)WARDRIVE_BIN_POOL_LEN - 1);
+    memcpy(pool->strings[id], s, len);
+    pool->strings[id][len] = '\0';
+}
+
+static void wardrive_bin_reader_copy(char* out, size_t size, const WardriveBinPool* pool, uint8_t id) {
+    if(id < WARDRIVE_BIN_POOL) {
+        strncpy(out, pool->strings[id], size - 1);
+    }
+}
+
+bool wardrive_bin_reader_begin(WardriveBinReader* reader, File* file) {
+    if(!reader || !file) return false;
+    memset(reader, 0, sizeof(WardriveBinReader));
+    reader->file = file;
+    wardrive_bin_reader_reset_ssids(reader);
+
+    uint8_t header[WARDRIVE_BIN_HEADER_SIZE];
+    return wardrive_bin_read(reader, header, sizeof(header)) &&
+           wardrive_bin_get32(header) == WARDRIVE_BIN_MAGIC &&
+           wardrive_bin_get16(header + 4) == WARDRIVE_BIN_VERSION &&
+           wardrive_bin_get16(header + 6) == WARDRIVE_BIN_RECORD_SIZE;
+}
+
+bool wardrive_bin_reader_next(WardriveBinReader* reader, WardriveRow* row) {
+    if(!reader || !row) return false;
+
+    uint8_t p[WARDRIVE_BIN_RECORD_SIZE];
+    while(wardrive_bin_read(reader, p, 1)) {
+        if(p[0] == WARDRIVE_BIN_TAG_STRING) {
+            char s[UINT8_MAX];
+            if(!wardrive_bin_read(reader, p + 1, 4) || !wardrive_bin_read(reader, (uint8_t*)s, p[4])) {
+                return false;
+            }
+            wardrive_bin_reader_define(reader, p[1], wardrive_bin_get16(p + 2), s, p[4]);
+            continue;
+        }
+        if(p[0] != WARDRIVE_BIN_TAG_NETWORK) {
+            FURI_LOG_W("WardriveBin", "Unknown record 0x%02X, stopped reading", p[0]);
+            return false;
+        }
+        if(!wardrive_bin_read(reader, p + 1, WARDRIVE_BIN_RECORD_SIZE - 1)) return false;
+
+        memset(row, 0, sizeof(WardriveRow));
+        row->rssi = (int8_t)p[1];
+        row->channel = p[2];
+        wardrive_bin_reader_copy(row->auth, sizeof(row->auth), &reader->auth, p[3]);
+        memcpy(row->bssid, p + 4, 6);
+        uint16_t ssid = wardrive_bin_get16(p + 10);
+        if(ssid < WARDRIVE_BIN_SSID_IDS && reader->ssid_offsets[ssid] != UINT16_MAX) {
+            strncpy(row->ssid, reader->ssids + reader->ssid_offsets[ssid], sizeof(row->ssid) - 1);
+        }
+        row->lat_e7 = (int32_t)wardrive_bin_get32(p + 12);
+        row->lon_e7 = (int32_t)wardrive_bin_get32(p + 16);
+        wardrive_row_set_timestamp(row, wardrive_bin_get32(p + 20));
+        row->alt_dm = (int32_t)wardrive_bin_get32(p + 24);
+        row->acc_dm = wardrive_bin_get16(p + 28);
+        wardrive_bin_reader_copy(row->type, sizeof(row->type), &reader->type, p[30]);
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "gps_nmea.h"
+#include "wardrive_row.h"
+#include <storage/storage.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Binary wardrive log (.gwd)
+ *
+ * Stores the ESP's WiGLE rows as fixed-size records, about a third of the
+ * CSV size. All values are little endian.
+ *
+ * Header, 16 bytes:
+ *   u32 magic "GWDB", u16 version, u16 network record size, u32 created
+ *   (Unix time), u32 reserved
+ *
+ * Records, told apart by their first byte:
+ *   0x01 network, 32 bytes:
+ *     u8 tag, i8 rssi, u8 channel, u8 auth id, u8 bssid[6], u16 ssid id,
+ *     i32 lat (1e-7 deg), i32 lon (1e-7 deg), u32 first seen (Unix time),
+ *     i32 altitude (dm), u16 accuracy (dm), u8 type id, u8 flags
+ *   0x02 string, 5 + len bytes:
+ *     u8 tag, u8 kind (0 SSID, 1 auth mode, 2 type), u16 id, u8 len, chars
+ *
+ * A string record always comes before the first network that uses its id.
+ * Ids may be redefined later in the file, a reader keeps the latest
+ * definition. SSID ids start over at 0 once WARDRIVE_BIN_SSID_IDS were
+ * handed out. WARDRIVE_BIN_NO_SSID / WARDRIVE_BIN_NO_STRING mean empty.
+ * WardriveBinReader reads a log back on the device (Merge Wardrives),
+ * tools/wardrive_convert.py turns one into CSV, WiGLE or KML.
+ */
+
+#define WARDRIVE_BIN_MAGIC       0x42445747 // "GWDB"
+#define WARDRIVE_BIN_VERSION     1
+#define WARDRIVE_BIN_HEADER_SIZE 16
+#define WARDRIVE_BIN_RECORD_SIZE 32
+#define WARDRIVE_BIN_SSID_IDS    448
+#define WARDRIVE_BIN_NO_SSID     0xFFFF
+#define WARDRIVE_BIN_NO_STRING   0xFF
+
+#define WARDRIVE_BIN_TAG_NETWORK 0x01
+#define WARDRIVE_BIN_TAG_STRING  0x02
+
+#define WARDRIVE_BIN_FLAG_FIX 0x01
+
+typedef enum {
+    WardriveBinStringSsid,
+    WardriveBinStringAuth,
+    WardriveBinStringType,
+} WardriveBinStringKind;
+
+typedef struct WardriveBin WardriveBin;
+typedef struct WardriveBinReader WardriveBinReader;
+
+typedef struct {
+    uint32_t rows; // Network records written
+    uint32_t strings; // String records written
+    uint32_t skipped; // Lines that were not WiGLE rows
+    uint32_t bytes_in; // CSV bytes consumed
+    uint64_t bytes_out;
+} WardriveBinStats;
+
+WardriveBin* wardrive_bin_alloc(void);
+void wardrive_bin_free(WardriveBin* bin);
+
+/**
+ * @brief Attach a freshly opened file and write the header
+ */
+bool wardrive_bin_begin(WardriveBin* bin, File* file, uint32_t created);
+
+/**
+ * @brief Fill rows the ESP sent without a fix from this GPS, NULL disables
+ */
+void wardrive_bin_set_gps(WardriveBin* bin, const GpsNmea* gps);
+
+/**
+ * @brief Consume CSV bytes from the ESP
+ * @return false if a file write failed
+ */
+bool wardrive_bin_write(WardriveBin* bin, const uint8_t* data, size_t len);
+
+/**
+ * @brief Convert a trailing unterminated row, write out buffered records and detach
+ */
+void wardrive_bin_finish(WardriveBin* bin);
+
+bool wardrive_bin_is_active(const WardriveBin* bin);
+
+/**
+ * @brief Bytes on disk, always a whole number of records
+ */
+uint64_t wardrive_bin_get_record_end(const WardriveBin* bin);
+
+void wardrive_bin_get_stats(const WardriveBin* bin, WardriveBinStats* stats);
+
+WardriveBinReader* wardrive_bin_reader_alloc(void);
+void wardrive_bin_reader_free(WardriveBinReader* reader);
+
+/**
+ * @brief Check the header of a log opened for reading
+ * @return false if it is not a log this version can read
+ */
+bool wardrive_bin_reader_begin(WardriveBinReader* reader, File* file);
+
+/**
+ * @brief Next network record as a WiGLE row
+ * @return false at the end of the log, a torn last record or a damaged one
+ */
+bool wardrive_bin_reader_next(WardriveBinReader* reader, WardriveRow* row);
@@ -0,0 +1,433 @@
+#include "wardrive_merge.h"
+#include "wardrive_bin.h"
+#include "sequential_file.h"
+#include "dir_catalog.h"
+#include <furi.h>
+#include <storage/storage.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WARDRIVE_MERGE_READ_SIZE 512
+#define WARDRIVE_MERGE_LINE_MAX  256
+#define WARDRIVE_MERGE_NAME_LEN  128
+#define WARDRIVE_MERGE_PATH_LEN  256
+
+#define WARDRIVE_MERGE_HEADER                                                                       \
+    "WigleWifi-1.4,appRelease=1.0,model=GhostESP,release=1.0,device=Flipper,display=,board=,brand=Ghost\n" \
+    "MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,AltitudeMeters,AccuracyMeters,Type\n"
+
+typedef struct {
+    File* file;
+    char buf[WARDRIVE_MERGE_READ_SIZE];
+    size_t pos;
+    size_t len;
+    char line[WARDRIVE_MERGE_LINE_MAX];
+    WardriveRow row; // Head of a run while merging
+    bool has_row;
+} WardriveMergeReader;
+
+typedef struct {
+    BgJob* job;
+    Storage* storage;
+    File* out;
+    char path[WARDRIVE_MERGE_PATH_LEN];
+
+    WardriveRow* rows; // Run being collected
+    WardriveBinReader* bin; // Allocated for the first .gwd log
+    uint32_t row_count;
+    uint32_t run_count; // Run files written, named run_0 .. run_(count-1)
+
+    WardriveRow pending; // Last row written, held back until the next BSSID shows up
+    bool has_pending;
+    char line[WARDRIVE_ROW_MAX];
+
+    uint32_t files_done;
+    uint32_t files_total;
+    uint64_t bytes_read;
+    uint32_t rows_in;
+    uint32_t rows_out;
+} WardriveMerge;
+
+void wardrive_merge_combine(WardriveRow* kept, const WardriveRow* row) {
+    // "YYYY-MM-DD HH:MM:SS" sorts as text, empty means unknown
+    char first_seen[sizeof(kept->first_seen)];
+    const char* earliest = kept->first_seen;
+    if(row->first_seen[0] && (!earliest[0] || strcmp(row->first_seen, earliest) < 0)) {
+        earliest = row->first_seen;
+    }
+    memcpy(first_seen, earliest, sizeof(first_seen));
+    char ssid[sizeof(kept->ssid)];
+    memcpy(ssid, kept->ssid[0] ? kept->ssid : row->ssid, sizeof(ssid));
+
+    if(wardrive_row_better(
+           wardrive_row_has_fix(row), row->rssi, wardrive_row_has_fix(kept), kept->rssi)) {
+        *kept = *row;
+    }
+
+    memcpy(kept->first_seen, first_seen, sizeof(first_seen));
+    if(!kept->ssid[0]) {
+        memcpy(kept->ssid, ssid, sizeof(ssid));
+    }
+}
+
+static int wardrive_merge_compare(const void* a, const void* b) {
+    return memcmp(((const WardriveRow*)a)->bssid, ((const WardriveRow*)b)->bssid, 6);
+}
+
+static bool wardrive_merge_reader_open(WardriveMergeReader* reader, const char* path) {
+    reader->pos = 0;
+    reader->len = 0;
+    reader->has_row = false;
+    if(!storage_file_open(reader->file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        FURI_LOG_E("WardriveMerge", "Failed to open %s", path);
+        storage_file_close(reader->file);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Next line without its ending, overlong lines are cut (and then fail to parse)
+ * @return false at the end of the file
+ */
+static bool wardrive_merge_read_line(WardriveMerge* merge, WardriveMergeReader* reader, size_t* len) {
+    size_t line_len = 0;
+    bool any = false;
+    while(true) {
+        if(reader->pos == reader->len) {
+            reader->len = storage_file_read(reader->file, reader->buf, sizeof(reader->buf));
+            reader->pos = 0;
+            merge->bytes_read += reader->len;
+            if(!reader->len) break;
+        }
+        any = true;
+        char c = reader->buf[reader->pos++];
+        if(c == '\n') break;
+        if(c != '\r' && line_len < sizeof(reader->line) - 1) {
+            reader->line[line_len++] = c;
+        }
+    }
+    reader->line[line_len] = '\0';
+    *len = line_len;
+    return any;
+}
+
+// Skips headers and anything else that is not a row
+static bool wardrive_merge_read_row(WardriveMerge* merge, WardriveMergeReader* reader) {
+    size_t len;
+    while(wardrive_merge_read_line(merge, reader, &len)) {
+        if(wardrive_row_parse(reader->line, len, &reader->row)) {
+            reader->has_row = true;
+            return true;
+        }
+    }
+    reader->has_row = false;
+    return false;
+}
+
+static void wardrive_merge_run_path(char* path, size_t size, uint32_t run) {
+    snprintf(path, size, "%s/run_%lu.csv", WARDRIVE_MERGE_TMP, run);
+}
+
+static bool wardrive_merge_emit(WardriveMerge* merge, const WardriveRow* row) {
+    size_t len = wardrive_row_format(row, merge->line);
+    if(storage_file_write(merge->out, merge->line, len) != len) {
+        FURI_LOG_E("WardriveMerge", "Failed to write %s", merge->path);
+        return false;
+    }
+    merge->rows_out++;
+    return true;
+}
+
+// Rows arrive sorted by BSSID, equal ones are folded into the pending row
+static bool wardrive_merge_put(WardriveMerge* merge, const WardriveRow* row) {
+    if(merge->has_pending && memcmp(merge->pending.bssid, row->bssid, 6) == 0) {
+        wardrive_merge_combine(&merge->pending, row);
+        return true;
+    }
+    bool ok = !merge->has_pending || wardrive_merge_emit(merge, &merge->pending);
+    merge->pending = *row;
+    merge->has_pending = true;
+    return ok;
+}
+
+static bool wardrive_merge_put_end(WardriveMerge* merge) {
+    bool ok = !merge->has_pending || wardrive_merge_emit(merge, &merge->pending);
+    merge->has_pending = false;
+    return ok;
+}
+
+static bool wardrive_merge_open_out(WardriveMerge* merge, const char* path) {
+    strncpy(merge->path, path, sizeof(merge->path) - 1);
+    if(!storage_file_open(merge->out, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        FURI_LOG_E("WardriveMerge", "Failed to create %s", path);
+        storage_file_close(merge->out);
+        return false;
+    }
+    return true;
+}
+
+static bool wardrive_merge_flush_run(WardriveMerge* merge) {
+    if(!merge->row_count) return true;
+
+    qsort(merge->rows, merge->row_count, sizeof(WardriveRow), wardrive_merge_compare);
+
+    char path[WARDRIVE_MERGE_PATH_LEN];
+    wardrive_merge_run_path(path, sizeof(path), merge->run_count);
+    if(!wardrive_merge_open_out(merge, path)) return false;
+
+    bool ok = true;
+    for(uint32_t i = 0; i < merge->row_count && ok; i++) {
+        ok = wardrive_merge_put(merge, &merge->rows[i]);
+    }
+    ok = wardrive_merge_put_end(merge) && ok;
+    storage_file_close(merge->out);
+
+    merge->run_count++;
+    merge->row_count = 0;
+    return ok;
+}
+
+static bool wardrive_merge_add(WardriveMerge* merge, const WardriveRow* row, uint32_t* rows) {
+    bool ok = true;
+    merge->rows[merge->row_count++] = *row;
+    merge->rows_in++;
+    if(merge->row_count == WARDRIVE_MERGE_RUN_ROWS) {
+        ok = wardrive_merge_flush_run(merge);
+    }
+    if(++*rows % 64 == 0) {
+        if(bg_job_is_cancelled(merge->job)) ok = false;
+        bg_job_report(merge->job, merge->files_done, merge->files_total, merge->bytes_read);
+        furi_thread_yield();
+    }
+    return ok;
+}
+
+static bool wardrive_merge_collect_file(
+    WardriveMerge* merge,
+    WardriveMergeReader* reader,
+    const char* path) {
+    if(!wardrive_merge_reader_open(reader, path)) return true; // Skip it, merge the rest
+
+    bool ok = true;
+    uint32_t rows = 0;
+    while(ok && wardrive_merge_read_row(merge, reader)) {
+        ok = wardrive_merge_add(merge, &reader->row, &rows);
+    }
+    storage_file_close(reader->file);
+    return ok;
+}
+
+// Binary logs only count towards the bytes once they are read
+static bool wardrive_merge_collect_log(
+    WardriveMerge* merge,
+    WardriveMergeReader* reader,
+    const char* path,
+    uint64_t size) {
+    if(!merge->bin) merge->bin = wardrive_bin_reader_alloc();
+    if(!merge->bin) {
+        FURI_LOG_W("WardriveMerge", "No memory to read %s", path);
+        return true;
+    }
+    if(!wardrive_merge_reader_open(reader, path)) return true;
+
+    bool ok = true;
+    uint32_t rows = 0;
+    if(!wardrive_bin_reader_begin(merge->bin, reader->file)) {
+        FURI_LOG_W("WardriveMerge", "Skipped %s, not a wardrive log", path);
+    }
+    while(ok && wardrive_bin_reader_next(merge->bin, &reader->row)) {
+        ok = wardrive_merge_add(merge, &reader->row, &rows);
+    }
+    storage_file_close(reader->file);
+    merge->bytes_read += size;
+    return ok;
+}
+
+static bool wardrive_merge_has_extension(const char* name, const char* extension) {
+    size_t len = strlen(name);
+    size_t extension_len = strlen(extension);
+    return len > extension_len && strcmp(name + len - extension_len, extension) == 0;
+}
+
+static bool wardrive_merge_collect(WardriveMerge* merge, WardriveMergeReader* reader) {
+    File* dir = storage_file_alloc(merge->storage);
+    char name[WARDRIVE_MERGE_NAME_LEN];
+    char path[WARDRIVE_MERGE_PATH_LEN];
+    FileInfo info;
+
+    bool ok = storage_dir_open(dir, GHOST_ESP_APP_FOLDER_WARDRIVE);
+    if(!ok) {
+        FURI_LOG_E("WardriveMerge", "Failed to open %s", GHOST_ESP_APP_FOLDER_WARDRIVE);
+    }
+    while(ok && storage_dir_read(dir, &info, name, sizeof(name))) {
+        if(info.flags & FSF_DIRECTORY) continue;
+
+        // Other files (GPX) only count towards the progress
+        snprintf(path, sizeof(path), "%s/%s", GHOST_ESP_APP_FOLDER_WARDRIVE, name);
+        if(wardrive_merge_has_extension(name, ".csv")) {
+            ok = wardrive_merge_collect_file(merge, reader, path);
+        } else if(wardrive_merge_has_extension(name, ".gwd")) {
+            ok = wardrive_merge_collect_log(merge, reader, path, info.size);
+        }
+        merge->files_done++;
+        bg_job_report(merge->job, merge->files_done, merge->files_total, merge->bytes_read);
+    }
+    storage_dir_close(dir);
+    storage_file_free(dir);
+
+    return ok && wardrive_merge_flush_run(merge);
+}
+
+// Merge runs [first, first + count) into the open output
+static bool wardrive_merge_runs(
+    WardriveMerge* merge,
+    WardriveMergeReader* readers,
+    uint32_t first,
+    uint32_t count) {
+    char path[WARDRIVE_MERGE_PATH_LEN];
+    bool ok = true;
+    uint32_t open = 0;
+    for(; open < count && ok; open++) {
+        wardrive_merge_run_path(path, sizeof(path), first + open);
+        ok = wardrive_merge_reader_open(&readers[open], path);
+        if(ok) wardrive_merge_read_row(merge, &readers[open]);
+    }
+    if(!ok) open--;
+
+    // Few runs at a time, a linear scan for the smallest head is enough
+    uint32_t rows = 0;
+    while(ok) {
+        WardriveMergeReader* next = NULL;
+        for(uint32_t i = 0; i < count; i++) {
+            if(readers[i].has_row &&
+               (!next || wardrive_merge_compare(&readers[i].row, &next->row) < 0)) {
+                next = &readers[i];
+            }
+        }
+        if(!next) break;
+
+        ok = wardrive_merge_put(merge, &next->row);
+        wardrive_merge_read_row(merge, next);
+        if(++rows % 64 == 0) {
+            if(bg_job_is_cancelled(merge->job)) ok = false;
+            furi_thread_yield();
+        }
+    }
+    ok = ok && wardrive_merge_put_end(merge);
+    merge->has_pending = false;
+
+    for(uint32_t i = 0; i < open; i++) {
+        storage_file_close(readers[i].file);
+        wardrive_merge_run_path(path, sizeof(path), first + i);
+        storage_simply_remove(merge->storage, path);
+    }
+    return ok;
+}
+
+static bool wardrive_merge_all(WardriveMerge* merge, WardriveMergeReader* readers) {
+    char path[WARDRIVE_MERGE_PATH_LEN];
+    char status[32];
+    uint32_t first = 0;
+
+    // Earlier passes merge groups into new runs until one pass can finish
+    while(merge->run_count - first > WARDRIVE_MERGE_FAN_IN) {
+        snprintf(status, sizeof(status), "%lu runs left", merge->run_count - first);
+        bg_job_set_status(merge->job, "Merging runs", status, -1.0f);
+
+        wardrive_merge_run_path(path, sizeof(path), merge->run_count);
+        if(!wardrive_merge_open_out(merge, path)) return false;
+        bool ok = wardrive_merge_runs(merge, readers, first, WARDRIVE_MERGE_FAN_IN);
+        storage_file_close(merge->out);
+        if(!ok) return false;
+        first += WARDRIVE_MERGE_FAN_IN;
+        merge->run_count++;
+    }
+
+    bg_job_set_status(merge->job, "Writing merged file", NULL, -1.0f);
+    if(!sequential_file_open_ex(
+           merge->storage,
+           merge->out,
+           GHOST_ESP_APP_FOLDER_WARDRIVE,
+           WARDRIVE_MERGE_PREFIX,
+           "csv",
+           merge->path,
+           sizeof(merge->path))) {
+        FURI_LOG_E("WardriveMerge", "Failed to create the merged file");
+        return false;
+    }
+
+    merge->rows_out = 0;
+    size_t header_len = strlen(WARDRIVE_MERGE_HEADER);
+    bool ok = storage_file_write(merge->out, WARDRIVE_MERGE_HEADER, header_len) == header_len &&
+              wardrive_merge_runs(merge, readers, first, merge->run_count - first);
+    storage_file_close(merge->out);
+    if(!ok) storage_simply_remove(merge->storage, merge->path);
+    return ok;
+}
+
+bool wardrive_merge_worker(BgJob* job, void* context) {
+    UNUSED(context);
+
+    WardriveMerge* merge = malloc(sizeof(WardriveMerge));
+    WardriveMergeReader* readers = malloc(WARDRIVE_MERGE_FAN_IN * sizeof(WardriveMergeReader));
+    if(!merge || !readers) {
+        free(merge);
+        free(readers);
+        return false;
+    }
+    memset(merge, 0, sizeof(WardriveMerge));
+    merge->job = job;
+    merge->storage = furi_record_open(RECORD_STORAGE);
+    merge->out = storage_file_alloc(merge->storage);
+    for(size_t i = 0; i < WARDRIVE_MERGE_FAN_IN; i++) {
+        readers[i].file = storage_file_alloc(merge->storage);
+    }
+
+    DirCatalogStats stats;
+    if(dir_catalog_get(merge->storage, GHOST_ESP_APP_FOLDER_WARDRIVE, NULL, NULL, &stats)) {
+        merge->files_total = stats.file_count;
+    }
+    bg_job_report(job, 0, merge->files_total, 0);
+
+    // Runs are only needed while collecting, the merge passes need the RAM for readers
+    merge->rows = malloc(WARDRIVE_MERGE_RUN_ROWS * sizeof(WardriveRow));
+    storage_simply_remove_recursive(merge->storage, WARDRIVE_MERGE_TMP);
+    bool ok = merge->rows && storage_simply_mkdir(merge->storage, WARDRIVE_MERGE_TMP) &&
+              wardrive_merge_collect(merge, &readers[0]);
+    free(merge->rows);
+    merge->rows = NULL;
+    wardrive_bin_reader_free(merge->bin);
+    merge->bin = NULL;
+
+    if(ok && !merge->run_count) {
+        FURI_LOG_W("WardriveMerge", "No wardrive rows found");
+        ok = false;
+    } else if(ok) {
+        ok = wardrive_merge_all(merge, readers);
+    }
+
+    if(ok) {
+        FURI_LOG_I(
+            "WardriveMerge",
+            "%lu rows from %lu files -> %lu networks in %s",
+            merge->rows_in,
+            merge->files_done,
+            merge->rows_out,
+            merge->path);
+    }
+
+    storage_simply_remove_recursive(merge->storage, WARDRIVE_MERGE_TMP);
+    sequential_file_cache_invalidate(merge->storage, GHOST_ESP_APP_FOLDER_WARDRIVE);
+    dir_catalog_invalidate(GHOST_ESP_APP_FOLDER_WARDRIVE);
+
+    for(size_t i = 0; i < WARDRIVE_MERGE_FAN_IN; i++) {
+        storage_file_free(readers[i].file);
+    }
+    storage_file_free(merge->out);
+    furi_record_close(RECORD_STORAGE);
+    free(readers);
+    free(merge);
+    return ok;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "bg_job.h"
+#include "settings_def.h"
+#include "wardrive_row.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Wardrive merge
+ *
+ * Combines every CSV and binary .gwd log in GHOST_ESP_APP_FOLDER_WARDRIVE into one
+ * WARDRIVE_MERGE_PREFIX_N.csv with a single row per BSSID, in bounded memory:
+ *
+ *   runs   rows are collected WARDRIVE_MERGE_RUN_ROWS at a time, sorted by
+ *          BSSID with duplicates collapsed and written to WARDRIVE_MERGE_TMP
+ *   merge  up to WARDRIVE_MERGE_FAN_IN runs are merged at once, earlier
+ *          passes produce longer runs until the last pass writes the output
+ *
+ * Duplicates keep the best sighting by wardrive_row_better with the earliest
+ * FirstSeen and the first non-empty SSID. tools/wardrive_convert.py merge
+ * does the same on a PC.
+ */
+
+#define WARDRIVE_MERGE_PREFIX   "wardrive_merged"
+#define WARDRIVE_MERGE_TMP      GHOST_ESP_APP_FOLDER_WARDRIVE "/.merge"
+#define WARDRIVE_MERGE_RUN_ROWS 128
+#define WARDRIVE_MERGE_FAN_IN   8
+
+/**
+ * @brief Fold a sighting of the same BSSID into the row kept for it
+ */
+void wardrive_merge_combine(WardriveRow* kept, const WardriveRow* row);
+
+/**
+ * @brief BgJobWorker merging the wardrive folder, context is unused
+ */
+bool wardrive_merge_worker(BgJob* job, void* context);
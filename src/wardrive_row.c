@@ -0,0 +1,244 @@
+#include "wardrive_row.h"
+#include <furi.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WARDRIVE_TAIL_FIELDS 9 // AuthMode..Type after the SSID
+
+static bool wardrive_parse_bssid(const char* s, size_t len, uint8_t* out) {
+    if(len != 17) return false;
+    for(size_t i = 0; i < 6; i++) {
+        uint8_t value = 0;
+        for(size_t j = 0; j < 2; j++) {
+            char c = s[i * 3 + j];
+            value <<= 4;
+            if(c >= '0' && c <= '9') {
+                value |= c - '0';
+            } else if(c >= 'a' && c <= 'f') {
+                value |= c - 'a' + 10;
+            } else if(c >= 'A' && c <= 'F') {
+                value |= c - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        if(i < 5 && s[i * 3 + 2] != ':') return false;
+        out[i] = value;
+    }
+    return true;
+}
+
+static bool wardrive_parse_int(const char* s, size_t len, int32_t* out) {
+    bool negative = len && s[0] == '-';
+    size_t i = negative ? 1 : 0;
+    if(i == len) return false;
+
+    int32_t value = 0;
+    for(; i < len; i++) {
+        if(s[i] < '0' || s[i] > '9' || value > 100000000) return false;
+        value = value * 10 + (s[i] - '0');
+    }
+    *out = negative ? -value : value;
+    return true;
+}
+
+bool wardrive_parse_fixed(const char* s, size_t len, uint8_t digits, int32_t* out) {
+    bool negative = len && s[0] == '-';
+    size_t i = negative ? 1 : 0;
+    if(i == len) return false;
+
+    int64_t value = 0;
+    uint8_t fraction = 0;
+    bool dot = false;
+    for(; i < len; i++) {
+        if(s[i] == '.' && !dot) {
+            dot = true;
+            continue;
+        }
+        if(s[i] < '0' || s[i] > '9') return false;
+        if(dot) {
+            if(fraction == digits) continue;
+            fraction++;
+        }
+        value = value * 10 + (s[i] - '0');
+        if(value > INT32_MAX) return false;
+    }
+    for(; fraction < digits; fraction++) {
+        value *= 10;
+        if(value > INT32_MAX) return false;
+    }
+    *out = (int32_t)(negative ? -value : value);
+    return true;
+}
+
+static void wardrive_copy_field(char* out, size_t size, const char* s, size_t len) {
+    len = MIN(len, size - 1);
+    memcpy(out, s, len);
+    out[len] = '\0';
+}
+
+int wardrive_format_fixed(char* out, size_t size, int32_t value, uint8_t digits) {
+    uint32_t scale = 1;
+    for(uint8_t i = 0; i < digits; i++) scale *= 10;
+    uint32_t magnitude = value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    return snprintf(
+        out,
+        size,
+        "%s%lu.%0*lu",
+        value < 0 ? "-" : "",
+        magnitude / scale,
+        (int)digits,
+        magnitude % scale);
+}
+
+// The SSID may contain commas, so the fixed fields are taken from the right
+bool wardrive_row_parse(const char* line, size_t len, WardriveRow* row) {
+    const char* first = memchr(line, ',', len);
+    if(!first) return false;
+
+    const char* fields[WARDRIVE_TAIL_FIELDS + 1]; // Start of each tail field, plus the end
+    size_t found = 0;
+    fields[WARDRIVE_TAIL_FIELDS] = line + len + 1;
+    for(const char* p = line + len; p > first + 1 && found < WARDRIVE_TAIL_FIELDS; p--) {
+        if(p[-1] == ',') {
+            found++;
+            fields[WARDRIVE_TAIL_FIELDS - found] = p;
+        }
+    }
+    if(found < WARDRIVE_TAIL_FIELDS) return false;
+
+#define FIELD(i)     fields[i]
+#define FIELD_LEN(i) ((size_t)(fields[(i) + 1] - fields[i] - 1))
+
+    memset(row, 0, sizeof(WardriveRow));
+    if(!wardrive_parse_bssid(line, first - line, row->bssid)) return false;
+
+    int32_t channel, rssi;
+    if(!wardrive_parse_int(FIELD(2), FIELD_LEN(2), &channel) ||
+       !wardrive_parse_int(FIELD(3), FIELD_LEN(3), &rssi) ||
+       !wardrive_parse_fixed(FIELD(4), FIELD_LEN(4), WARDRIVE_COORD_DIGITS, &row->lat_e7) ||
+       !wardrive_parse_fixed(FIELD(5), FIELD_LEN(5), WARDRIVE_COORD_DIGITS, &row->lon_e7)) {
+        return false;
+    }
+    // Altitude/accuracy are often blank without a fix
+    if(!wardrive_parse_fixed(FIELD(6), FIELD_LEN(6), WARDRIVE_METER_DIGITS, &row->alt_dm)) {
+        row->alt_dm = 0;
+    }
+    if(!wardrive_parse_fixed(FIELD(7), FIELD_LEN(7), WARDRIVE_METER_DIGITS, &row->acc_dm)) {
+        row->acc_dm = 0;
+    }
+    row->rssi = (int8_t)CLAMP(rssi, 0, -128);
+    row->channel = (uint8_t)CLAMP(channel, 255, 0);
+
+    wardrive_copy_field(row->ssid, sizeof(row->ssid), first + 1, fields[0] - 1 - (first + 1));
+    wardrive_copy_field(row->auth, sizeof(row->auth), FIELD(0), FIELD_LEN(0));
+    wardrive_copy_field(row->first_seen, sizeof(row->first_seen), FIELD(1), FIELD_LEN(1));
+    wardrive_copy_field(row->type, sizeof(row->type), FIELD(8), FIELD_LEN(8));
+
+#undef FIELD
+#undef FIELD_LEN
+    return true;
+}
+
+size_t wardrive_row_format(const WardriveRow* row, char* out) {
+    char lat[16], lon[16], alt[16], acc[16];
+    wardrive_format_fixed(lat, sizeof(lat), row->lat_e7, WARDRIVE_COORD_DIGITS);
+    wardrive_format_fixed(lon, sizeof(lon), row->lon_e7, WARDRIVE_COORD_DIGITS);
+    wardrive_format_fixed(alt, sizeof(alt), row->alt_dm, WARDRIVE_METER_DIGITS);
+    wardrive_format_fixed(acc, sizeof(acc), row->acc_dm, WARDRIVE_METER_DIGITS);
+
+    const uint8_t* b = row->bssid;
+    int len = snprintf(
+        out,
+        WARDRIVE_ROW_MAX,
+        "%02x:%02x:%02x:%02x:%02x:%02x,%s,%s,%s,%u,%d,%s,%s,%s,%s,%s\n",
+        b[0],
+        b[1],
+        b[2],
+        b[3],
+        b[4],
+        b[5],
+        row->ssid,
+        row->auth,
+        row->first_seen,
+        row->channel,
+        row->rssi,
+        lat,
+        lon,
+        alt,
+        acc,
+        row->type);
+    if(len < 0) return 0;
+    if(len >= WARDRIVE_ROW_MAX) {
+        out[WARDRIVE_ROW_MAX - 2] = '\n';
+        return WARDRIVE_ROW_MAX - 1;
+    }
+    return len;
+}
+
+bool wardrive_row_fill_fix(WardriveRow* row, const GpsNmea* gps) {
+    if(!gps || wardrive_row_has_fix(row)) return false;
+
+    GpsFix fix;
+    gps_nmea_get_fix(gps, &fix);
+    if(!gps_nmea_fix_is_fresh(&fix)) return false;
+
+    row->lat_e7 = fix.lat_e7;
+    row->lon_e7 = fix.lon_e7;
+    row->alt_dm = fix.alt_dm;
+    // HDOP times a typical 5 m receiver error
+    row->acc_dm = fix.hdop_c / 2;
+    return true;
+}
+
+uint32_t wardrive_row_timestamp(const WardriveRow* row) {
+    int32_t year, month, day, hour, minute, second;
+    const char* s = row->first_seen;
+    if(strlen(s) != 19 || s[4] != '-' || s[7] != '-' || s[10] != ' ' || s[13] != ':' ||
+       s[16] != ':' || !wardrive_parse_int(s, 4, &year) || !wardrive_parse_int(s + 5, 2, &month) ||
+       !wardrive_parse_int(s + 8, 2, &day) || !wardrive_parse_int(s + 11, 2, &hour) ||
+       !wardrive_parse_int(s + 14, 2, &minute) || !wardrive_parse_int(s + 17, 2, &second)) {
+        return 0;
+    }
+    if(year < 1970 || month < 1 || month > 12 || day < 1 || day > 31) return 0;
+
+    // Days since 1970-01-01 in the proleptic Gregorian calendar
+    int32_t y = year - (month <= 2);
+    int32_t era = y / 400;
+    int32_t yoe = y - era * 400;
+    int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + doe - 719468;
+
+    return (uint32_t)days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+void wardrive_row_set_timestamp(WardriveRow* row, uint32_t timestamp) {
+    if(!timestamp) {
+        row->first_seen[0] = '\0';
+        return;
+    }
+
+    // Inverse of the day count in wardrive_row_timestamp
+    int32_t z = (int32_t)(timestamp / 86400) + 719468;
+    uint32_t time = timestamp % 86400;
+    int32_t era = z / 146097;
+    int32_t doe = z - era * 146097;
+    int32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int32_t mp = (5 * doy + 2) / 153;
+    int32_t day = doy - (153 * mp + 2) / 5 + 1;
+    int32_t month = mp < 10 ? mp + 3 : mp - 9;
+    int32_t year = yoe + era * 400 + (month <= 2);
+
+    snprintf(
+        row->first_seen,
+        sizeof(row->first_seen),
+        "%04d-%02d-%02d %02d:%02d:%02d",
+        (int)year,
+        (int)month,
+        (int)day,
+        (int)(time / 3600),
+        (int)(time / 60 % 60),
+        (int)(time % 60));
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "gps_nmea.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * WiGLE CSV rows as written by the ESP:
+ *
+ *   MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,
+ *   AltitudeMeters,AccuracyMeters,Type
+ *
+ * Coordinates are kept as fixed point (1e-7 degrees), altitude and accuracy
+ * in decimeters, so rows can be merged and rewritten without floats.
+ */
+
+#define WARDRIVE_ROW_MAX      192 // Longest row wardrive_row_format produces, newline included
+#define WARDRIVE_ROW_AUTH_LEN 32
+#define WARDRIVE_ROW_TYPE_LEN 8
+#define WARDRIVE_COORD_DIGITS 7
+#define WARDRIVE_METER_DIGITS 1
+
+typedef struct {
+    uint8_t bssid[6];
+    int8_t rssi;
+    uint8_t channel;
+    char ssid[33];
+    char auth[WARDRIVE_ROW_AUTH_LEN];
+    char first_seen[20];
+    char type[WARDRIVE_ROW_TYPE_LEN];
+    int32_t lat_e7;
+    int32_t lon_e7;
+    int32_t alt_dm;
+    int32_t acc_dm;
+} WardriveRow;
+
+/**
+ * @brief Parse one row without its line ending
+ * @return false for the header lines and anything else that is not a row
+ */
+bool wardrive_row_parse(const char* line, size_t len, WardriveRow* row);
+
+/**
+ * @brief Format a row with a trailing newline, at most WARDRIVE_ROW_MAX bytes
+ * @return Bytes written to out
+ */
+size_t wardrive_row_format(const WardriveRow* row, char* out);
+
+/**
+ * @brief Decimal text to fixed point with the given number of fraction digits, extra digits are cut
+ */
+bool wardrive_parse_fixed(const char* s, size_t len, uint8_t digits, int32_t* out);
+
+/**
+ * @brief Fixed point to decimal text, e.g. 471234567 with 7 digits -> "47.1234567"
+ */
+int wardrive_format_fixed(char* out, size_t size, int32_t value, uint8_t digits);
+
+/**
+ * @brief FirstSeen ("YYYY-MM-DD HH:MM:SS") as Unix time, 0 if it does not parse
+ */
+uint32_t wardrive_row_timestamp(const WardriveRow* row);
+
+/**
+ * @brief Set FirstSeen from Unix time, 0 leaves it empty
+ */
+void wardrive_row_set_timestamp(WardriveRow* row, uint32_t timestamp);
+
+/**
+ * @brief Give a row without a fix the Flipper GPS position, if that one is fresh
+ * @return true if the row was changed
+ */
+bool wardrive_row_fill_fix(WardriveRow* row, const GpsNmea* gps);
+
+static inline bool wardrive_row_has_fix(const WardriveRow* row) {
+    return row->lat_e7 != 0 || row->lon_e7 != 0;
+}
+
+/**
+ * @brief Which sighting of a network to keep (Wardrive Dedup, Merge Wardrives and
+ *        tools/wardrive_convert.py): a GPS fix beats no fix, then the stronger signal
+ * @return true if the new sighting replaces the kept one
+ */
+static inline bool wardrive_row_better(bool fix, int8_t rssi, bool kept_fix, int8_t kept_rssi) {
+    return (fix && !kept_fix) || (fix == kept_fix && rssi > kept_rssi);
+}
@@ -0,0 +1,402 @@
+#include "wardrive_stage.h"
+#include "wardrive_row.h"
+#include <furi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WARDRIVE_LINE_MAX  256
+#define WARDRIVE_TEXT_MAX  256 // Non-row lines held back until the live rows are rewritten
+#define WARDRIVE_AUTH_MAX  16 // Distinct AuthMode/Type strings kept per capture
+#define WARDRIVE_NO_STRING 0xFF
+
+typedef struct {
+    uint8_t bssid[6];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t auth; // Index into the string pool
+    uint8_t type;
+    bool used;
+    bool fix;
+    char ssid[33];
+    char first_seen[20];
+    int32_t lat_e7;
+    int32_t lon_e7;
+    int32_t alt_dm;
+    int32_t acc_dm;
+    uint32_t last_seen;
+} WardriveEntry;
+
+struct WardriveStage {
+    File* file;
+    bool active;
+    const GpsNmea* gps;
+
+    WardriveEntry entries[WARDRIVE_STAGE_SLOTS];
+    uint32_t used;
+    uint32_t seen[WARDRIVE_STAGE_SEEN]; // BSSID hashes of spilled networks, 0 = empty
+    uint32_t seen_used;
+
+    char strings[WARDRIVE_AUTH_MAX][WARDRIVE_ROW_AUTH_LEN];
+    uint8_t string_count;
+
+    char line[WARDRIVE_LINE_MAX];
+    size_t line_len;
+    bool line_overflow; // Rest of an overlong line goes straight through
+
+    char text[WARDRIVE_TEXT_MAX];
+    size_t text_len;
+
+    uint64_t spill_end; // End of header + finalized rows
+    uint64_t live_end; // End of the live rows after the last flush
+    uint32_t last_flush;
+    uint32_t sequence; // Logical clock for last_seen
+    bool dirty;
+
+    WardriveStageStats stats;
+};
+
+static uint32_t wardrive_bssid_hash(const uint8_t* bssid) {
+    uint32_t hash = 0x811C9DC5;
+    for(size_t i = 0; i < 6; i++) {
+        hash = (hash ^ bssid[i]) * 0x01000193;
+    }
+    return hash ? hash : 1;
+}
+
+static uint8_t wardrive_intern(WardriveStage* stage, const char* s) {
+    for(uint8_t i = 0; i < stage->string_count; i++) {
+        if(strcmp(stage->strings[i], s) == 0) return i;
+    }
+    if(stage->string_count == WARDRIVE_AUTH_MAX) return WARDRIVE_NO_STRING;
+    strncpy(stage->strings[stage->string_count], s, WARDRIVE_ROW_AUTH_LEN - 1);
+    stage->strings[stage->string_count][WARDRIVE_ROW_AUTH_LEN - 1] = '\0';
+    return stage->string_count++;
+}
+
+static const char* wardrive_string(const WardriveStage* stage, uint8_t index) {
+    return index < stage->string_count ? stage->strings[index] : "";
+}
+
+static bool wardrive_seen_contains(const WardriveStage* stage, uint32_t hash) {
+    uint32_t mask = WARDRIVE_STAGE_SEEN - 1;
+    for(uint32_t i = 0; i < WARDRIVE_STAGE_SEEN; i++) {
+        uint32_t slot = stage->seen[(hash + i) & mask];
+        if(slot == hash) return true;
+        if(slot == 0) return false;
+    }
+    return false;
+}
+
+static void wardrive_seen_add(WardriveStage* stage, uint32_t hash) {
+    // Past 7/8 the set stops growing, a network seen again then just gets a second row
+    if(stage->seen_used >= WARDRIVE_STAGE_SEEN - WARDRIVE_STAGE_SEEN / 8) return;
+    uint32_t mask = WARDRIVE_STAGE_SEEN - 1;
+    for(uint32_t i = 0; i < WARDRIVE_STAGE_SEEN; i++) {
+        uint32_t* slot = &stage->seen[(hash + i) & mask];
+        if(*slot == hash) return;
+        if(*slot == 0) {
+            *slot = hash;
+            stage->seen_used++;
+            return;
+        }
+    }
+}
+
+static WardriveEntry* wardrive_find(WardriveStage* stage, const uint8_t* bssid, bool* found) {
+    uint32_t mask = WARDRIVE_STAGE_SLOTS - 1;
+    uint32_t index = wardrive_bssid_hash(bssid) & mask;
+    for(uint32_t i = 0; i < WARDRIVE_STAGE_SLOTS; i++) {
+        WardriveEntry* entry = &stage->entries[(index + i) & mask];
+        if(!entry->used) {
+            *found = false;
+            return entry;
+        }
+        if(memcmp(entry->bssid, bssid, 6) == 0) {
+            *found = true;
+            return entry;
+        }
+    }
+    *found = false;
+    return NULL;
+}
+
+// Linear probing delete, shifts later members of the cluster back so lookups stay correct
+static void wardrive_remove(WardriveStage* stage, uint32_t index) {
+    uint32_t mask = WARDRIVE_STAGE_SLOTS - 1;
+    uint32_t hole = index;
+    uint32_t next = (index + 1) & mask;
+    while(stage->entries[next].used) {
+        uint32_t home = wardrive_bssid_hash(stage->entries[next].bssid) & mask;
+        // Move it if its home is not cyclically within (hole, next]
+        bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if(!stays) {
+            stage->entries[hole] = stage->entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    stage->entries[hole].used = false;
+    stage->used--;
+}
+
+static size_t wardrive_format_entry(const WardriveStage* stage, const WardriveEntry* entry, char* out) {
+    WardriveRow row;
+    memset(&row, 0, sizeof(WardriveRow));
+    memcpy(row.bssid, entry->bssid, sizeof(row.bssid));
+    row.rssi = entry->rssi;
+    row.channel = entry->channel;
+    memcpy(row.ssid, entry->ssid, sizeof(row.ssid));
+    strncpy(row.auth, wardrive_string(stage, entry->auth), sizeof(row.auth) - 1);
+    memcpy(row.first_seen, entry->first_seen, sizeof(row.first_seen));
+    strncpy(row.type, wardrive_string(stage, entry->type), sizeof(row.type) - 1);
+    row.lat_e7 = entry->lat_e7;
+    row.lon_e7 = entry->lon_e7;
+    row.alt_dm = entry->alt_dm;
+    row.acc_dm = entry->acc_dm;
+    return wardrive_row_format(&row, out);
+}
+
+// Finalized text at spill_end, overwrites the start of the live rows if there are any
+static bool wardrive_write_text(WardriveStage* stage, const char* data, size_t len) {
+    if(!len) return true;
+    bool ok = storage_file_seek(stage->file, stage->spill_end, true) &&
+              storage_file_write(stage->file, data, len) == len;
+    stage->spill_end += len;
+    if(stage->live_end < stage->spill_end) stage->live_end = stage->spill_end;
+    return ok;
+}
+
+// Write the held back lines, then rewrite the live rows after spill_end and cut the file there
+static bool wardrive_flush(WardriveStage* stage) {
+    char row[WARDRIVE_ROW_MAX];
+    bool ok = wardrive_write_text(stage, stage->text, stage->text_len);
+    stage->text_len = 0;
+    ok = storage_file_seek(stage->file, stage->spill_end, true) && ok;
+    for(uint32_t i = 0; i < WARDRIVE_STAGE_SLOTS && ok; i++) {
+        if(!stage->entries[i].used) continue;
+        size_t len = wardrive_format_entry(stage, &stage->entries[i], row);
+        ok = storage_file_write(stage->file, row, len) == len;
+    }
+    if(ok) {
+        uint64_t end = storage_file_tell(stage->file);
+        if(end < stage->live_end) ok = storage_file_truncate(stage->file);
+        stage->live_end = end;
+    }
+
+    stage->dirty = false;
+    stage->last_flush = furi_get_tick();
+    stage->stats.flushes++;
+    if(!ok) FURI_LOG_E("Wardrive", "Failed to write live rows");
+    return ok;
+}
+
+// Finalize the networks not seen for the longest time until the table is half empty
+static bool wardrive_spill(WardriveStage* stage) {
+    char row[WARDRIVE_ROW_MAX];
+    bool ok = storage_file_seek(stage->file, stage->spill_end, true);
+
+    while(stage->used > WARDRIVE_STAGE_SLOTS / 2 && ok) {
+        uint32_t oldest = 0;
+        bool have = false;
+        for(uint32_t i = 0; i < WARDRIVE_STAGE_SLOTS; i++) {
+            const WardriveEntry* entry = &stage->entries[i];
+            if(entry->used && (!have || entry->last_seen < stage->entries[oldest].last_seen)) {
+                oldest = i;
+                have = true;
+            }
+        }
+        if(!have) break;
+
+        size_t len = wardrive_format_entry(stage, &stage->entries[oldest], row);
+        ok = storage_file_write(stage->file, row, len) == len;
+        wardrive_seen_add(stage, wardrive_bssid_hash(stage->entries[oldest].bssid));
+        wardrive_remove(stage, oldest);
+        stage->stats.spilled++;
+    }
+
+    stage->spill_end = storage_file_tell(stage->file);
+    FURI_LOG_D("Wardrive", "Spilled to %lu bytes", (uint32_t)stage->spill_end);
+    // The live rows were partly overwritten
+    return wardrive_flush(stage) && ok;
+}
+
+// Anything that is not a row goes out as is, in front of the live rows. Writing it there
+// clobbers them, so it waits for the next flush unless the buffer is full.
+static bool wardrive_passthrough(WardriveStage* stage, const char* data, size_t len) {
+    if(stage->live_end == stage->spill_end && !stage->text_len) {
+        // No live rows yet, e.g. the ESP header lines
+        return wardrive_write_text(stage, data, len);
+    }
+    if(stage->text_len + len <= WARDRIVE_TEXT_MAX) {
+        memcpy(stage->text + stage->text_len, data, len);
+        stage->text_len += len;
+        return true;
+    }
+
+    bool ok = wardrive_write_text(stage, stage->text, stage->text_len) &&
+              wardrive_write_text(stage, data, len);
+    stage->text_len = 0;
+    return wardrive_flush(stage) && ok;
+}
+
+static bool wardrive_handle_line(WardriveStage* stage) {
+    size_t len = stage->line_len;
+    stage->line_len = 0;
+
+    // Keep the newline out of the parser, tolerate CRLF
+    size_t content = len;
+    while(content && (stage->line[content - 1] == '\n' || stage->line[content - 1] == '\r')) {
+        content--;
+    }
+
+    WardriveRow row;
+    if(!wardrive_row_parse(stage->line, content, &row)) {
+        stage->stats.passthrough++;
+        return wardrive_passthrough(stage, stage->line, len);
+    }
+    wardrive_row_fill_fix(&row, stage->gps);
+
+    stage->stats.rows++;
+    stage->sequence++;
+
+    bool found;
+    WardriveEntry* entry = wardrive_find(stage, row.bssid, &found);
+    if(!found && wardrive_seen_contains(stage, wardrive_bssid_hash(row.bssid))) {
+        stage->stats.late++;
+        return true;
+    }
+
+    bool ok = true;
+    if(!found && stage->used + 1 > WARDRIVE_STAGE_SLOTS - WARDRIVE_STAGE_SLOTS / 4) {
+        ok = wardrive_spill(stage);
+        entry = wardrive_find(stage, row.bssid, &found);
+    }
+    if(!entry) return false;
+
+    bool fix = wardrive_row_has_fix(&row);
+    if(!found) {
+        memset(entry, 0, sizeof(WardriveEntry));
+        memcpy(entry->bssid, row.bssid, 6);
+        strncpy(entry->first_seen, row.first_seen, sizeof(entry->first_seen) - 1);
+        entry->used = true;
+        entry->rssi = INT8_MIN;
+        stage->used++;
+        stage->stats.networks++;
+        stage->dirty = true;
+    }
+    entry->last_seen = stage->sequence;
+
+    // Hidden networks sometimes reveal their name later
+    if(!entry->ssid[0] && row.ssid[0]) {
+        strncpy(entry->ssid, row.ssid, sizeof(entry->ssid) - 1);
+        stage->dirty = true;
+    }
+
+    // Best position
+    if(wardrive_row_better(fix, row.rssi, entry->fix, entry->rssi)) {
+        entry->rssi = row.rssi;
+        entry->channel = row.channel;
+        entry->auth = wardrive_intern(stage, row.auth);
+        entry->type = wardrive_intern(stage, row.type);
+        entry->fix = fix;
+        entry->lat_e7 = row.lat_e7;
+        entry->lon_e7 = row.lon_e7;
+        entry->alt_dm = row.alt_dm;
+        entry->acc_dm = row.acc_dm;
+        stage->dirty = true;
+    }
+    return ok;
+}
+
+WardriveStage* wardrive_stage_alloc(void) {
+    WardriveStage* stage = malloc(sizeof(WardriveStage));
+    if(!stage) return NULL;
+    memset(stage, 0, sizeof(WardriveStage));
+    return stage;
+}
+
+void wardrive_stage_free(WardriveStage* stage) {
+    if(!stage) return;
+    free(stage);
+}
+
+void wardrive_stage_begin(WardriveStage* stage, File* file) {
+    if(!stage) return;
+    memset(stage, 0, sizeof(WardriveStage));
+    stage->file = file;
+    stage->active = file != NULL;
+    stage->last_flush = furi_get_tick();
+}
+
+void wardrive_stage_set_gps(WardriveStage* stage, const GpsNmea* gps) {
+    if(!stage) return;
+    stage->gps = gps;
+}
+
+bool wardrive_stage_write(WardriveStage* stage, const uint8_t* data, size_t len) {
+    if(!stage || !stage->active) return false;
+
+    bool ok = true;
+    for(size_t pos = 0; pos < len && ok;) {
+        const uint8_t* newline = memchr(data + pos, '\n', len - pos);
+        size_t take = newline ? (size_t)(newline - (data + pos)) + 1 : len - pos;
+
+        if(stage->line_overflow) {
+            ok = wardrive_passthrough(stage, (const char*)data + pos, take);
+            if(newline) stage->line_overflow = false;
+        } else if(stage->line_len + take > WARDRIVE_LINE_MAX) {
+            // Too long to be a row, send what we have and the rest of the line through
+            ok = wardrive_passthrough(stage, stage->line, stage->line_len) &&
+                 wardrive_passthrough(stage, (const char*)data + pos, take);
+            stage->stats.passthrough++;
+            stage->line_len = 0;
+            stage->line_overflow = !newline;
+        } else {
+            memcpy(stage->line + stage->line_len, data + pos, take);
+            stage->line_len += take;
+            if(newline) ok = wardrive_handle_line(stage);
+        }
+        pos += take;
+    }
+
+    if(ok && (stage->dirty || stage->text_len) &&
+       furi_get_tick() - stage->last_flush >= furi_ms_to_ticks(WARDRIVE_STAGE_FLUSH_MS)) {
+        ok = wardrive_flush(stage);
+    }
+    return ok;
+}
+
+void wardrive_stage_finish(WardriveStage* stage) {
+    if(!stage || !stage->active) return;
+
+    // A last line without newline is handled like any other
+    if(stage->line_len && !wardrive_handle_line(stage)) {
+        FURI_LOG_W("Wardrive", "Failed to write last line");
+    }
+    wardrive_flush(stage);
+
+    FURI_LOG_I(
+        "Wardrive",
+        "%lu sightings -> %lu networks (%lu spilled, %lu late, %lu other lines)",
+        stage->stats.rows,
+        stage->stats.networks,
+        stage->stats.spilled,
+        stage->stats.late,
+        stage->stats.passthrough);
+    stage->active = false;
+    stage->file = NULL;
+}
+
+bool wardrive_stage_is_active(const WardriveStage* stage) {
+    return stage && stage->active;
+}
+
+uint64_t wardrive_stage_get_record_end(const WardriveStage* stage) {
+    return stage ? stage->live_end : 0;
+}
+
+void wardrive_stage_get_stats(const WardriveStage* stage, WardriveStageStats* stats) {
+    if(!stage || !stats) return;
+    *stats = stage->stats;
+}
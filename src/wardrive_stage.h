@@ -0,0 +1,78 @@
+#pragma once
+
+#include "gps_nmea.h"
+#include <storage/storage.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Wardrive stage
+ *
+ * Turns the ESP's wardrive CSV (one WiGLE row per sighting) into a WiGLE file
+ * with one row per network. Rows are parsed (wardrive_row.h) and merged
+ * into an open addressing table keyed by BSSID that keeps the sighting with
+ * the best RSSI (a GPS fix always beats no fix).
+ *
+ * File layout while capturing:
+ *   [ESP header lines][spilled rows][live rows]
+ *
+ * The live rows are the table contents, rewritten in place every
+ * WARDRIVE_STAGE_FLUSH_MS while they changed and on finish. When the table is
+ * 3/4 full the networks not seen for the longest time are spilled: appended
+ * for good in front of the live rows and remembered in a BSSID set so later
+ * sightings of them are dropped. Lines that are not WiGLE rows are written
+ * through unchanged; once live rows exist they are held back and go out with
+ * the next flush.
+ *
+ * RAM use is fixed regardless of drive length, about 16 KB for the table and
+ * BSSID set. The stage is only allocated while a capture is open.
+ */
+
+#define WARDRIVE_STAGE_SLOTS    128 // Power of two, 88 bytes each
+#define WARDRIVE_STAGE_SEEN     1024 // Spilled BSSIDs remembered, power of two
+#define WARDRIVE_STAGE_FLUSH_MS 30000
+
+typedef struct WardriveStage WardriveStage;
+
+typedef struct {
+    uint32_t rows; // Sightings parsed
+    uint32_t networks; // Unique networks written or live
+    uint32_t spilled;
+    uint32_t late; // Sightings of already spilled networks
+    uint32_t passthrough; // Lines that were not WiGLE rows
+    uint32_t flushes;
+} WardriveStageStats;
+
+WardriveStage* wardrive_stage_alloc(void);
+void wardrive_stage_free(WardriveStage* stage);
+
+/**
+ * @brief Attach a freshly opened wardrive file
+ */
+void wardrive_stage_begin(WardriveStage* stage, File* file);
+
+/**
+ * @brief Fill rows the ESP sent without a fix from this GPS, NULL disables
+ */
+void wardrive_stage_set_gps(WardriveStage* stage, const GpsNmea* gps);
+
+/**
+ * @brief Consume CSV bytes from the ESP
+ * @return false if a file write failed
+ */
+bool wardrive_stage_write(WardriveStage* stage, const uint8_t* data, size_t len);
+
+/**
+ * @brief Write the live rows one last time and detach
+ */
+void wardrive_stage_finish(WardriveStage* stage);
+
+bool wardrive_stage_is_active(const WardriveStage* stage);
+
+/**
+ * @brief File size after the last flush, everything before it is complete rows
+ */
+uint64_t wardrive_stage_get_record_end(const WardriveStage* stage);
+
+void wardrive_stage_get_stats(const WardriveStage* stage, WardriveStageStats* stats);
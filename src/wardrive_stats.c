@@ -0,0 +1,254 @@
+#include "wardrive_stats.h"
+#include "wardrive_row.h"
+#include <furi.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WARDRIVE_STATS_LINE_MAX   256
+#define WARDRIVE_STATS_BUCKET_MS  10000
+#define WARDRIVE_STATS_MIN_HOP_M  5.0f // GPS noise while standing still
+#define WARDRIVE_STATS_MAX_HOP_M  2000.0f // Bigger jumps between rows are glitches
+#define WARDRIVE_STATS_EARTH_M    6371000.0f
+#define WARDRIVE_STATS_E7_TO_RAD  1.745329252e-9f
+
+typedef struct {
+    uint32_t id; // Bucket number, tick / WARDRIVE_STATS_BUCKET_MS
+    uint32_t count;
+} WardriveStatsBucket;
+
+struct WardriveStats {
+    FuriMutex* mutex; // Guards everything below the line state
+    const GpsNmea* gps;
+
+    // Line assembly, only touched by the feeding thread
+    char line[WARDRIVE_STATS_LINE_MAX];
+    size_t line_len;
+    bool line_overflow;
+
+    uint32_t* set; // BSSID hashes, 0 = empty, allocated on the first begin
+    uint32_t set_used;
+    WardriveStatsBucket buckets[WARDRIVE_STATS_BUCKETS];
+    int32_t anchor_lat_e7; // Last position counted towards the distance
+    int32_t anchor_lon_e7;
+    bool anchored;
+    float distance_m;
+    WardriveStatsSnapshot counts; // per_minute and distance_m are filled in on read
+};
+
+static const char* const wardrive_stats_auth_names[WardriveStatsAuthCount] = {
+    "Open",
+    "WEP",
+    "WPA",
+    "WPA2",
+    "WPA3",
+    "Other",
+};
+
+static uint32_t wardrive_stats_hash(const uint8_t* bssid, bool ble) {
+    uint32_t hash = ble ? 0x050C5D1F : 0x811C9DC5;
+    for(size_t i = 0; i < 6; i++) {
+        hash = (hash ^ bssid[i]) * 0x01000193;
+    }
+    return hash ? hash : 1;
+}
+
+// true the first time a BSSID is seen, probing is bounded by the 7/8 fill limit
+static bool wardrive_stats_remember(WardriveStats* stats, uint32_t hash) {
+    if(!stats->set) return false;
+
+    uint32_t mask = WARDRIVE_STATS_SLOTS - 1;
+    for(uint32_t i = 0; i < WARDRIVE_STATS_SLOTS; i++) {
+        uint32_t* slot = &stats->set[(hash + i) & mask];
+        if(*slot == hash) return false;
+        if(*slot == 0) {
+            if(stats->set_used >= WARDRIVE_STATS_SLOTS - WARDRIVE_STATS_SLOTS / 8) {
+                stats->counts.saturated = true;
+                return false;
+            }
+            *slot = hash;
+            stats->set_used++;
+            return true;
+        }
+    }
+    return false;
+}
+
+static WardriveStatsAuth wardrive_stats_classify(const char* auth) {
+    if(strstr(auth, "WPA3") || strstr(auth, "SAE")) return WardriveStatsAuthWpa3;
+    if(strstr(auth, "WPA2")) return WardriveStatsAuthWpa2;
+    if(strstr(auth, "WPA")) return WardriveStatsAuthWpa;
+    if(strstr(auth, "WEP")) return WardriveStatsAuthWep;
+    if(!auth[0] || strstr(auth, "OPEN") || strcmp(auth, "[ESS]") == 0) {
+        return WardriveStatsAuthOpen;
+    }
+    return WardriveStatsAuthOther;
+}
+
+static void wardrive_stats_count_new(WardriveStats* stats) {
+    uint32_t id = furi_get_tick() / furi_ms_to_ticks(WARDRIVE_STATS_BUCKET_MS);
+    WardriveStatsBucket* bucket = &stats->buckets[id % WARDRIVE_STATS_BUCKETS];
+    if(bucket->id != id) {
+        bucket->id = id;
+        bucket->count = 0;
+    }
+    bucket->count++;
+}
+
+// Equirectangular distance, plenty accurate for the few meters between rows
+static void wardrive_stats_move(WardriveStats* stats, int32_t lat_e7, int32_t lon_e7) {
+    if(!stats->anchored) {
+        stats->anchor_lat_e7 = lat_e7;
+        stats->anchor_lon_e7 = lon_e7;
+        stats->anchored = true;
+        return;
+    }
+
+    float lat = (float)lat_e7 * WARDRIVE_STATS_E7_TO_RAD;
+    float dx = (float)(lon_e7 - stats->anchor_lon_e7) * WARDRIVE_STATS_E7_TO_RAD * cosf(lat);
+    float dy = (float)(lat_e7 - stats->anchor_lat_e7) * WARDRIVE_STATS_E7_TO_RAD;
+    float hop = sqrtf(dx * dx + dy * dy) * WARDRIVE_STATS_EARTH_M;
+    if(hop < WARDRIVE_STATS_MIN_HOP_M) return;
+
+    if(hop <= WARDRIVE_STATS_MAX_HOP_M) stats->distance_m += hop;
+    stats->anchor_lat_e7 = lat_e7;
+    stats->anchor_lon_e7 = lon_e7;
+}
+
+static void wardrive_stats_handle_line(WardriveStats* stats) {
+    size_t len = stats->line_len;
+    stats->line_len = 0;
+    while(len && (stats->line[len - 1] == '\n' || stats->line[len - 1] == '\r')) {
+        len--;
+    }
+
+    WardriveRow row;
+    if(!wardrive_row_parse(stats->line, len, &row)) return;
+    wardrive_row_fill_fix(&row, stats->gps);
+
+    bool ble = row.type[0] == 'B'; // WiGLE "BLE"/"BT", everything else is WiFi
+    uint32_t hash = wardrive_stats_hash(row.bssid, ble);
+
+    furi_mutex_acquire(stats->mutex, FuriWaitForever);
+    WardriveStatsSnapshot* counts = &stats->counts;
+    counts->rows++;
+    if(wardrive_stats_remember(stats, hash)) {
+        wardrive_stats_count_new(stats);
+        if(ble) {
+            counts->ble++;
+        } else {
+            counts->wifi++;
+            if(row.channel >= 1) {
+                counts->channels[MIN(row.channel, WARDRIVE_STATS_CHANNELS) - 1]++;
+            }
+            counts->auth[wardrive_stats_classify(row.auth)]++;
+        }
+    }
+    counts->fix = wardrive_row_has_fix(&row);
+    if(counts->fix) wardrive_stats_move(stats, row.lat_e7, row.lon_e7);
+    furi_mutex_release(stats->mutex);
+}
+
+WardriveStats* wardrive_stats_alloc(void) {
+    WardriveStats* stats = malloc(sizeof(WardriveStats));
+    if(!stats) return NULL;
+    memset(stats, 0, sizeof(WardriveStats));
+
+    stats->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    if(!stats->mutex) {
+        free(stats);
+        return NULL;
+    }
+    return stats;
+}
+
+void wardrive_stats_free(WardriveStats* stats) {
+    if(!stats) return;
+    if(stats->set) free(stats->set);
+    furi_mutex_free(stats->mutex);
+    free(stats);
+}
+
+void wardrive_stats_begin(WardriveStats* stats, const GpsNmea* gps) {
+    if(!stats) return;
+
+    if(!stats->set) {
+        stats->set = malloc(WARDRIVE_STATS_SLOTS * sizeof(uint32_t));
+        if(!stats->set) FURI_LOG_W("WardriveStats", "No memory for the BSSID set");
+    }
+
+    furi_mutex_acquire(stats->mutex, FuriWaitForever);
+    if(stats->set) memset(stats->set, 0, WARDRIVE_STATS_SLOTS * sizeof(uint32_t));
+    stats->set_used = 0;
+    memset(stats->buckets, 0, sizeof(stats->buckets));
+    stats->anchored = false;
+    stats->distance_m = 0.0f;
+    memset(&stats->counts, 0, sizeof(stats->counts));
+    stats->counts.saturated = !stats->set;
+    stats->counts.active = true;
+    furi_mutex_release(stats->mutex);
+
+    stats->gps = gps;
+    stats->line_len = 0;
+    stats->line_overflow = false;
+}
+
+void wardrive_stats_feed(WardriveStats* stats, const uint8_t* data, size_t len) {
+    if(!stats || !stats->counts.active) return;
+
+    for(size_t pos = 0; pos < len;) {
+        const uint8_t* newline = memchr(data + pos, '\n', len - pos);
+        size_t take = newline ? (size_t)(newline - (data + pos)) + 1 : len - pos;
+
+        if(stats->line_overflow) {
+            // Rest of a line too long to be a row
+            if(newline) stats->line_overflow = false;
+        } else if(stats->line_len + take > WARDRIVE_STATS_LINE_MAX) {
+            stats->line_len = 0;
+            stats->line_overflow = !newline;
+        } else {
+            memcpy(stats->line + stats->line_len, data + pos, take);
+            stats->line_len += take;
+            if(newline) wardrive_stats_handle_line(stats);
+        }
+        pos += take;
+    }
+}
+
+void wardrive_stats_finish(WardriveStats* stats) {
+    if(!stats || !stats->counts.active) return;
+
+    if(stats->line_len && !stats->line_overflow) wardrive_stats_handle_line(stats);
+    stats->line_len = 0;
+
+    furi_mutex_acquire(stats->mutex, FuriWaitForever);
+    stats->counts.active = false;
+    FURI_LOG_I(
+        "WardriveStats",
+        "%lu rows, %lu APs, %lu BLE, %lu m",
+        stats->counts.rows,
+        stats->counts.wifi,
+        stats->counts.ble,
+        (uint32_t)stats->distance_m);
+    furi_mutex_release(stats->mutex);
+}
+
+void wardrive_stats_get_snapshot(WardriveStats* stats, WardriveStatsSnapshot* snapshot) {
+    if(!stats || !snapshot) return;
+
+    uint32_t now = furi_get_tick() / furi_ms_to_ticks(WARDRIVE_STATS_BUCKET_MS);
+    furi_mutex_acquire(stats->mutex, FuriWaitForever);
+    *snapshot = stats->counts;
+    snapshot->per_minute = 0;
+    for(size_t i = 0; i < WARDRIVE_STATS_BUCKETS; i++) {
+        if(now - stats->buckets[i].id < WARDRIVE_STATS_BUCKETS) {
+            snapshot->per_minute += stats->buckets[i].count;
+        }
+    }
+    snapshot->distance_m = (uint32_t)stats->distance_m;
+    furi_mutex_release(stats->mutex);
+}
+
+const char* wardrive_stats_auth_name(WardriveStatsAuth auth) {
+    return auth < WardriveStatsAuthCount ? wardrive_stats_auth_names[auth] : "";
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "gps_nmea.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Live wardrive statistics
+ *
+ * Fed the same CSV bytes as the wardrive file and updated row by row on the
+ * storage worker, every update is O(1): a BSSID hash set for the unique
+ * counts, a ring of 10 s buckets for the discovery rate, fixed histograms
+ * for channels and encryption and a running distance between row fixes.
+ * Only the first sighting of a network counts towards the rate and the
+ * histograms. Once the set is 7/8 full new networks can no longer be told
+ * apart from repeats and the counts are shown as lower bounds.
+ */
+
+#define WARDRIVE_STATS_SLOTS    2048 // BSSIDs remembered, power of two
+#define WARDRIVE_STATS_CHANNELS 15 // 2.4 GHz channels 1-14, then all of 5 GHz
+#define WARDRIVE_STATS_BUCKETS  6 // 10 s buckets, one minute of rate history
+
+typedef enum {
+    WardriveStatsAuthOpen,
+    WardriveStatsAuthWep,
+    WardriveStatsAuthWpa,
+    WardriveStatsAuthWpa2,
+    WardriveStatsAuthWpa3,
+    WardriveStatsAuthOther,
+    WardriveStatsAuthCount,
+} WardriveStatsAuth;
+
+typedef struct WardriveStats WardriveStats;
+
+typedef struct {
+    bool active; // A wardrive capture is being fed
+    bool saturated; // Unique counts are lower bounds
+    bool fix; // The last row had a position
+    uint32_t rows; // Sightings parsed
+    uint32_t wifi; // Unique access points
+    uint32_t ble; // Unique BLE devices
+    uint32_t per_minute; // New networks in the last minute
+    uint32_t distance_m;
+    uint32_t channels[WARDRIVE_STATS_CHANNELS];
+    uint32_t auth[WardriveStatsAuthCount];
+} WardriveStatsSnapshot;
+
+WardriveStats* wardrive_stats_alloc(void);
+void wardrive_stats_free(WardriveStats* stats);
+
+/**
+ * @brief Start counting a new wardrive capture, clears the previous one
+ * @param gps Fills rows the ESP sent without a fix, NULL disables
+ */
+void wardrive_stats_begin(WardriveStats* stats, const GpsNmea* gps);
+
+/**
+ * @brief Consume CSV bytes from the ESP, ignored unless begun
+ */
+void wardrive_stats_feed(WardriveStats* stats, const uint8_t* data, size_t len);
+
+/**
+ * @brief Count a trailing unterminated row and stop, the numbers stay readable
+ */
+void wardrive_stats_finish(WardriveStats* stats);
+
+void wardrive_stats_get_snapshot(WardriveStats* stats, WardriveStatsSnapshot* snapshot);
+
+const char* wardrive_stats_auth_name(WardriveStatsAuth auth);
@@ -0,0 +1,219 @@
+#include "wardrive_stats_view.h"
+#include <gui/elements.h>
+#include <furi.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WARDRIVE_STATS_VIEW_REFRESH_MS 500
+#define WARDRIVE_STATS_VIEW_PAGES      2
+#define WARDRIVE_STATS_VIEW_BAR_TOP    14
+#define WARDRIVE_STATS_VIEW_BAR_BOTTOM 53
+
+struct WardriveStatsView {
+    View* view;
+    WardriveStats* stats;
+    FuriTimer* timer;
+};
+
+typedef struct {
+    WardriveStatsSnapshot snapshot;
+    uint8_t page; // 0 summary, 1 channel histogram
+} WardriveStatsViewModel;
+
+// "123" or "1792+" once the BSSID set is full
+static void wardrive_stats_view_format_count(
+    char* out,
+    size_t size,
+    uint32_t count,
+    bool saturated) {
+    snprintf(out, size, "%lu%s", count, saturated ? "+" : "");
+}
+
+static void wardrive_stats_view_draw_summary(Canvas* canvas, const WardriveStatsSnapshot* s) {
+    char line[40];
+    char wifi[12], ble[12];
+
+    canvas_set_font(canvas, FontPrimary);
+    canvas_draw_str(canvas, 2, 10, s->active ? "Wardriving" : "Wardrive idle");
+
+    canvas_set_font(canvas, FontSecondary);
+    wardrive_stats_view_format_count(wifi, sizeof(wifi), s->wifi, s->saturated);
+    wardrive_stats_view_format_count(ble, sizeof(ble), s->ble, s->saturated);
+    snprintf(line, sizeof(line), "APs %s  BLE %s", wifi, ble);
+    canvas_draw_str(canvas, 2, 21, line);
+
+    snprintf(line, sizeof(line), "New/min %lu  Rows %lu", s->per_minute, s->rows);
+    canvas_draw_str(canvas, 2, 31, line);
+
+    snprintf(
+        line,
+        sizeof(line),
+        "Dist %lu.%02lu km%s",
+        s->distance_m / 1000,
+        (s->distance_m % 1000) / 10,
+        s->fix ? "" : "  (no fix)");
+    canvas_draw_str(canvas, 2, 41, line);
+
+    snprintf(
+        line,
+        sizeof(line),
+        "Open %lu WEP %lu WPA %lu",
+        s->auth[WardriveStatsAuthOpen],
+        s->auth[WardriveStatsAuthWep],
+        s->auth[WardriveStatsAuthWpa]);
+    canvas_draw_str(canvas, 2, 51, line);
+
+    snprintf(
+        line,
+        sizeof(line),
+        "WPA2 %lu WPA3 %lu Other %lu",
+        s->auth[WardriveStatsAuthWpa2],
+        s->auth[WardriveStatsAuthWpa3],
+        s->auth[WardriveStatsAuthOther]);
+    canvas_draw_str(canvas, 2, 61, line);
+}
+
+static void wardrive_stats_view_draw_channels(Canvas* canvas, const WardriveStatsSnapshot* s) {
+    uint32_t peak = 0;
+    uint8_t busiest = 0;
+    for(uint8_t i = 0; i < WARDRIVE_STATS_CHANNELS; i++) {
+        if(s->channels[i] > peak) {
+            peak = s->channels[i];
+            busiest = i;
+        }
+    }
+
+    char line[32];
+    canvas_set_font(canvas, FontSecondary);
+    if(peak) {
+        if(busiest == WARDRIVE_STATS_CHANNELS - 1) {
+            snprintf(line, sizeof(line), "Channels, 5G: %lu", peak);
+        } else {
+            snprintf(line, sizeof(line), "Channels, ch%u: %lu", busiest + 1, peak);
+        }
+    } else {
+        snprintf(line, sizeof(line), "Channels, no APs yet");
+    }
+    canvas_draw_str(canvas, 2, 9, line);
+
+    // 15 bars of 6 px with a 2 px gap, the 5 GHz bar set apart
+    const uint8_t height = WARDRIVE_STATS_VIEW_BAR_BOTTOM - WARDRIVE_STATS_VIEW_BAR_TOP;
+    for(uint8_t i = 0; i < WARDRIVE_STATS_CHANNELS; i++) {
+        uint8_t x = 4 + i * 8 + (i == WARDRIVE_STATS_CHANNELS - 1 ? 4 : 0);
+        uint8_t bar = peak ? (uint8_t)((uint64_t)s->channels[i] * height / peak) : 0;
+        if(s->channels[i] && !bar) bar = 1;
+        if(bar) canvas_draw_box(canvas, x, WARDRIVE_STATS_VIEW_BAR_BOTTOM - bar, 6, bar);
+    }
+    canvas_draw_line(
+        canvas, 2, WARDRIVE_STATS_VIEW_BAR_BOTTOM, 125, WARDRIVE_STATS_VIEW_BAR_BOTTOM);
+
+    canvas_draw_str(canvas, 5, 63, "1");
+    canvas_draw_str(canvas, 45, 63, "6");
+    canvas_draw_str(canvas, 83, 63, "11");
+    canvas_draw_str(canvas, 117, 63, "5G");
+}
+
+static void wardrive_stats_view_draw_callback(Canvas* canvas, void* _model) {
+    if(!canvas || !_model) return;
+
+    WardriveStatsViewModel* model = (WardriveStatsViewModel*)_model;
+    canvas_clear(canvas);
+    if(model->page == 0) {
+        wardrive_stats_view_draw_summary(canvas, &model->snapshot);
+    } else {
+        wardrive_stats_view_draw_channels(canvas, &model->snapshot);
+    }
+}
+
+static bool wardrive_stats_view_input_callback(InputEvent* event, void* context) {
+    if(!event || !context) return false;
+
+    WardriveStatsView* instance = (WardriveStatsView*)context;
+
+    if(event->type == InputTypeShort &&
+       (event->key == InputKeyLeft || event->key == InputKeyRight)) {
+        with_view_model(
+            instance->view,
+            WardriveStatsViewModel* model,
+            {
+                model->page = (model->page + 1) % WARDRIVE_STATS_VIEW_PAGES;
+            },
+            true);
+        return true;
+    }
+
+    // Back goes to the navigation callback
+    return false;
+}
+
+static void wardrive_stats_view_refresh(void* context) {
+    WardriveStatsView* instance = (WardriveStatsView*)context;
+    with_view_model(
+        instance->view,
+        WardriveStatsViewModel* model,
+        {
+            wardrive_stats_get_snapshot(instance->stats, &model->snapshot);
+        },
+        true);
+}
+
+static void wardrive_stats_view_enter_callback(void* context) {
+    WardriveStatsView* instance = (WardriveStatsView*)context;
+    wardrive_stats_view_refresh(instance);
+    furi_timer_start(instance->timer, furi_ms_to_ticks(WARDRIVE_STATS_VIEW_REFRESH_MS));
+}
+
+static void wardrive_stats_view_exit_callback(void* context) {
+    WardriveStatsView* instance = (WardriveStatsView*)context;
+    furi_timer_stop(instance->timer);
+}
+
+WardriveStatsView* wardrive_stats_view_alloc(WardriveStats* stats) {
+    if(!stats) return NULL;
+
+    WardriveStatsView* instance = malloc(sizeof(WardriveStatsView));
+    if(!instance) return NULL;
+    memset(instance, 0, sizeof(WardriveStatsView));
+    instance->stats = stats;
+
+    instance->view = view_alloc();
+    if(!instance->view) {
+        free(instance);
+        return NULL;
+    }
+    instance->timer =
+        furi_timer_alloc(wardrive_stats_view_refresh, FuriTimerTypePeriodic, instance);
+
+    view_set_context(instance->view, instance);
+    view_set_draw_callback(instance->view, wardrive_stats_view_draw_callback);
+    view_set_input_callback(instance->view, wardrive_stats_view_input_callback);
+    view_set_enter_callback(instance->view, wardrive_stats_view_enter_callback);
+    view_set_exit_callback(instance->view, wardrive_stats_view_exit_callback);
+
+    view_allocate_model(instance->view, ViewModelTypeLocking, sizeof(WardriveStatsViewModel));
+
+    with_view_model(
+        instance->view,
+        WardriveStatsViewModel* model,
+        {
+            memset(&model->snapshot, 0, sizeof(model->snapshot));
+            model->page = 0;
+        },
+        true);
+
+    return instance;
+}
+
+void wardrive_stats_view_free(WardriveStatsView* instance) {
+    if(!instance) return;
+    if(instance->timer) {
+        furi_timer_stop(instance->timer);
+        furi_timer_free(instance->timer);
+    }
+    if(instance->view) view_free(instance->view);
+    free(instance);
+}
+
+View* wardrive_stats_view_get_view(WardriveStatsView* instance) {
+    return instance ? instance->view : NULL;
+}
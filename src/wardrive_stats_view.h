@@ -0,0 +1,13 @@
+#pragma once
+
+#include "wardrive_stats.h"
+#include <gui/view.h>
+
+typedef struct WardriveStatsView WardriveStatsView;
+
+/**
+ * @brief Live view of the given stats, refreshed twice a second while shown
+ */
+WardriveStatsView* wardrive_stats_view_alloc(WardriveStats* stats);
+void wardrive_stats_view_free(WardriveStatsView* instance);
+View* wardrive_stats_view_get_view(WardriveStatsView* instance);
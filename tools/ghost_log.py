@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""Host-side companion for Ghost ESP compressed session logs (.glz).
+
+  ghost_log.py decompress ghost_logs_3.glz [out.txt]
+  ghost_log.py compress ghost_logs_3.txt [out.glz]
+  ghost_log.py bench ghost_logs_*.txt
+
+The codec mirrors src/log_compress.c byte for byte. The app only writes .glz
+files, reading them back is done here on a PC.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+MAGIC = b"GLZ1"
+FILE_HEADER = 8
+FRAME_HEADER = 4
+FRAME_SIZE = 1024
+STORED_FLAG = 0x8000
+MIN_MATCH = 3
+MAX_MATCH = MIN_MATCH + 63
+MAX_CHAIN = 8
+NIL = 0xFFFF
+
+
+def _hash(data, pos):
+    p0, p1, p2 = data[pos], data[pos + 1], data[pos + 2]
+    return ((p0 << 4) ^ (p1 << 2) ^ p2 ^ (p0 >> 4)) & 0xFF
+
+
+def compress_frame(data):
+    """Return the LZSS payload for one frame, or None if it does not shrink."""
+    length = len(data)
+    head = [NIL] * 256
+    chain = [NIL] * length
+    out = bytearray()
+    ip = 0
+    flag_pos = 0
+    flag_bit = 8
+
+    def insert(pos):
+        if pos + MIN_MATCH > length:
+            return
+        h = _hash(data, pos)
+        chain[pos] = head[h]
+        head[h] = pos
+
+    while ip < length:
+        if flag_bit == 8:
+            flag_pos = len(out)
+            out.append(0)
+            flag_bit = 0
+
+        best_len = 0
+        best_off = 0
+        if ip + MIN_MATCH <= length:
+            max_len = min(length - ip, MAX_MATCH)
+            candidate = head[_hash(data, ip)]
+            depth = 0
+            while candidate != NIL and depth < MAX_CHAIN:
+                match = 0
+                while match < max_len and data[candidate + match] == data[ip + match]:
+                    match += 1
+                if match > best_len:
+                    best_len = match
+                    best_off = ip - candidate
+                    if match == max_len:
+                        break
+                candidate = chain[candidate]
+                depth += 1
+
+        if best_len >= MIN_MATCH:
+            out[flag_pos] |= 1 << flag_bit
+            out += struct.pack("<H", ((best_off - 1) << 6) | (best_len - MIN_MATCH))
+            for i in range(best_len):
+                insert(ip + i)
+            ip += best_len
+        else:
+            out.append(data[ip])
+            insert(ip)
+            ip += 1
+        flag_bit += 1
+
+        if len(out) >= length:
+            return None
+
+    return bytes(out)
+
+
+def decode_frame(payload, raw_len):
+    out = bytearray()
+    ip = 0
+    while len(out) < raw_len:
+        flags = payload[ip]
+        ip += 1
+        for bit in range(8):
+            if len(out) >= raw_len:
+                break
+            if flags & (1 << bit):
+                (token,) = struct.unpack_from("<H", payload, ip)
+                ip += 2
+                offset = (token >> 6) + 1
+                length = (token & 0x3F) + MIN_MATCH
+                if offset > len(out):
+                    raise ValueError("match offset before frame start")
+                for _ in range(length):
+                    out.append(out[-offset])
+            else:
+                out.append(payload[ip])
+                ip += 1
+    return bytes(out)
+
+
+def compress(data):
+    out = bytearray(MAGIC + struct.pack("<HH", FRAME_SIZE, 0))
+    for start in range(0, len(data), FRAME_SIZE):
+        frame = data[start:start + FRAME_SIZE]
+        payload = compress_frame(frame)
+        if payload is None:
+            out += struct.pack("<HH", len(frame), len(frame) | STORED_FLAG) + frame
+        else:
+            out += struct.pack("<HH", len(frame), len(payload)) + payload
+    return bytes(out)
+
+
+def decompress(blob):
+    if blob[:4] != MAGIC:
+        raise ValueError("not a Ghost ESP compressed log")
+    out = bytearray()
+    pos = FILE_HEADER
+    while pos + FRAME_HEADER <= len(blob):
+        raw_len, comp_field = struct.unpack_from("<HH", blob, pos)
+        pos += FRAME_HEADER
+        comp_len = comp_field & ~STORED_FLAG
+        payload = blob[pos:pos + comp_len]
+        if len(payload) < comp_len:
+            print("warning: torn final frame ignored", file=sys.stderr)
+            break
+        pos += comp_len
+        if comp_field & STORED_FLAG:
+            out += payload
+        else:
+            out += decode_frame(payload, raw_len)
+    return bytes(out)
+
+
+def cmd_compress(args):
+    with open(args.input, "rb") as f:
+        data = f.read()
+    target = args.output or args.input.rsplit(".", 1)[0] + ".glz"
+    with open(target, "wb") as f:
+        f.write(compress(data))
+
+
+def cmd_decompress(args):
+    with open(args.input, "rb") as f:
+        blob = f.read()
+    data = decompress(blob)
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(data)
+    else:
+        sys.stdout.buffer.write(data)
+
+
+def cmd_bench(args):
+    total_raw = 0
+    total_comp = 0
+    print(f"{'file':<32} {'raw':>10} {'glz':>10} {'ratio':>7} {'enc us/KB':>10} {'dec us/KB':>10}")
+    for path in args.inputs:
+        with open(path, "rb") as f:
+            data = f.read()
+        if not data:
+            continue
+        start = time.perf_counter()
+        blob = compress(data)
+        enc = time.perf_counter() - start
+        start = time.perf_counter()
+        if decompress(blob) != data:
+            raise SystemExit(f"{path}: round trip mismatch")
+        dec = time.perf_counter() - start
+        kb = len(data) / 1024
+        total_raw += len(data)
+        total_comp += len(blob)
+        print(f"{path[-32:]:<32} {len(data):>10} {len(blob):>10} {len(data) / len(blob):>6.2f}x "
+              f"{enc * 1e6 / kb:>10.0f} {dec * 1e6 / kb:>10.0f}")
+    if total_comp:
+        print(f"{'total':<32} {total_raw:>10} {total_comp:>10} {total_raw / total_comp:>6.2f}x")
+    print("CPU columns are host Python timings; the app logs on-device cycles per session.")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("compress", help="encode a text log as .glz")
+    p.add_argument("input")
+    p.add_argument("output", nargs="?")
+    p.set_defaults(func=cmd_compress)
+
+    p = sub.add_parser("decompress", help="decode a .glz log (stdout if no output given)")
+    p.add_argument("input")
+    p.add_argument("output", nargs="?")
+    p.set_defaults(func=cmd_decompress)
+
+    p = sub.add_parser("bench", help="report ratio and codec cost on recorded sessions")
+    p.add_argument("inputs", nargs="+")
+    p.set_defaults(func=cmd_bench)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Host-side companion for the on-device storage benchmark.
+
+  storage_bench.py run /media/sdcard [--results host_bench.csv]
+  storage_bench.py show storage_bench.csv
+  storage_bench.py compare before.csv after.csv
+
+`run` executes the same suite as src/storage_bench.c against a mounted card
+(or any directory) and appends rows in the same CSV format:
+write/prealloc cases use the same chunk sizes, op counts and 8 KB sync
+policy, seq_open resolves the next bench_N.pcap like sequential_file_open,
+"cold" rescanning the directory every time and "warm" using a cached counter.
+
+`show` prints every run in a results file, `compare` lines up the last run of
+two files (e.g. two cards, or before/after a change).
+"""
+
+import argparse
+import os
+import re
+import shutil
+import sys
+import time
+
+COLUMNS = ["test", "size", "variant", "ops", "bytes", "ms", "kb_s", "p50_us", "p99_us", "max_us"]
+CHUNKS = [64, 256, 1024, 4096, 8192]
+DIR_SIZES = [16, 64, 256]
+MAX_SAMPLES = 1024
+CASE_BYTES = 512 * 1024
+SYNC_BYTES = 8192
+PREALLOC = 1024 * 1024
+OPENS = 8
+
+
+def percentiles(samples):
+    if not samples:
+        return 0, 0, 0
+    samples = sorted(samples)
+    n = len(samples)
+    return samples[(n - 1) // 2], samples[((n - 1) * 99) // 100], samples[-1]
+
+
+def make_row(test, size, variant, samples, nbytes, elapsed):
+    ms = int(elapsed * 1000)
+    p50, p99, worst = percentiles(samples)
+    kb_s = int(nbytes * 1000 / 1024 / ms) if ms else 0
+    return [test, size, variant, len(samples), nbytes, ms, kb_s, p50, p99, worst]
+
+
+def write_case(bench_dir, chunk, sync, prealloc):
+    path = os.path.join(bench_dir, f"write_{chunk}.bin")
+    pattern = bytes((i * 31 + 7) & 0xFF for i in range(chunk))
+    ops = min(MAX_SAMPLES, CASE_BYTES // chunk)
+    samples = []
+    fd = os.open(path, os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o644)
+    if prealloc and hasattr(os, "posix_fallocate"):
+        os.posix_fallocate(fd, 0, PREALLOC)
+    since_sync = 0
+    start = time.perf_counter()
+    for _ in range(ops):
+        op = time.perf_counter()
+        os.write(fd, pattern)
+        since_sync += chunk
+        if sync and since_sync >= SYNC_BYTES:
+            os.fsync(fd)
+            since_sync = 0
+        samples.append(int((time.perf_counter() - op) * 1e6))
+    if sync:
+        os.fsync(fd)
+    elapsed = time.perf_counter() - start
+    if prealloc:
+        os.ftruncate(fd, ops * chunk)
+    os.close(fd)
+    os.remove(path)
+    return make_row("prealloc" if prealloc else "write", chunk, "sync8k" if sync else "nosync",
+                    samples, ops * chunk, elapsed)
+
+
+def next_index(bench_dir):
+    pattern = re.compile(r"^bench_(\d+)\.pcap$")
+    best = -1
+    for name in os.listdir(bench_dir):
+        m = pattern.match(name)
+        if m:
+            best = max(best, int(m.group(1)))
+    return best + 1
+
+
+def open_case(bench_dir, state, dir_size, cold):
+    while state["files"] < dir_size:
+        open(os.path.join(bench_dir, f"fill_{state['files']}.pcap"), "wb").close()
+        state["files"] += 1
+
+    samples = []
+    start = time.perf_counter()
+    for _ in range(OPENS):
+        op = time.perf_counter()
+        if cold or state["next"] is None:
+            state["next"] = next_index(bench_dir)
+        index = state["next"]
+        # The app's fast path confirms the cached slot is still free
+        while os.path.exists(os.path.join(bench_dir, f"bench_{index}.pcap")):
+            index = next_index(bench_dir)
+        open(os.path.join(bench_dir, f"bench_{index}.pcap"), "wb").close()
+        state["next"] = index + 1
+        samples.append(int((time.perf_counter() - op) * 1e6))
+        state["files"] += 1
+    elapsed = time.perf_counter() - start
+    return make_row("seq_open", dir_size, "cold" if cold else "warm", samples, 0, elapsed)
+
+
+def cmd_run(args):
+    bench_dir = os.path.join(args.target, "ghost_bench")
+    shutil.rmtree(bench_dir, ignore_errors=True)
+    os.makedirs(bench_dir)
+    usage = shutil.disk_usage(args.target)
+
+    rows = []
+    try:
+        for chunk in CHUNKS:
+            rows.append(write_case(bench_dir, chunk, False, False))
+            rows.append(write_case(bench_dir, chunk, True, False))
+        rows.append(write_case(bench_dir, 1024, True, True))
+        state = {"files": 0, "next": None}
+        for size in DIR_SIZES:
+            rows.append(open_case(bench_dir, state, size, True))
+            rows.append(open_case(bench_dir, state, size, False))
+    finally:
+        shutil.rmtree(bench_dir, ignore_errors=True)
+
+    with open(args.results, "a") as f:
+        f.write(f"# run {int(time.time())} card_mb {usage.total >> 20} free_mb {usage.free >> 20} host\n")
+        f.write(",".join(COLUMNS) + "\n")
+        for row in rows:
+            f.write(",".join(str(v) for v in row) + "\n")
+    print_rows(rows)
+    print(f"appended to {args.results}")
+
+
+def load_runs(path):
+    runs = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            if line.startswith("# run"):
+                runs.append({"title": line[2:], "rows": []})
+            elif line.startswith("#") or line.startswith("test,"):
+                continue
+            elif runs:
+                fields = line.split(",")
+                if len(fields) == len(COLUMNS):
+                    runs[-1]["rows"].append(fields)
+    return runs
+
+
+def print_rows(rows):
+    print(f"{'test':<9} {'size':>6} {'variant':<7} {'ops':>5} {'KB/s':>7} {'p50 us':>8} {'p99 us':>8} {'max us':>8}")
+    for r in rows:
+        test, size, variant, ops, _, _, kb_s, p50, p99, worst = r
+        print(f"{test:<9} {size:>6} {variant:<7} {ops:>5} {kb_s:>7} {p50:>8} {p99:>8} {worst:>8}")
+
+
+def cmd_show(args):
+    runs = load_runs(args.results)
+    if not runs:
+        raise SystemExit(f"{args.results}: no runs")
+    for run in runs:
+        print(run["title"])
+        print_rows(run["rows"])
+        print()
+
+
+def cmd_compare(args):
+    a = load_runs(args.before)
+    b = load_runs(args.after)
+    if not a or not b:
+        raise SystemExit("both files need at least one run")
+    before = {tuple(r[:3]): r for r in a[-1]["rows"]}
+    print(f"before: {a[-1]['title']}\nafter:  {b[-1]['title']}")
+    print(f"{'test':<9} {'size':>6} {'variant':<7} {'KB/s':>15} {'p99 us':>17} {'max us':>17}")
+    for r in b[-1]["rows"]:
+        old = before.get(tuple(r[:3]))
+        if not old:
+            continue
+        print(f"{r[0]:<9} {r[1]:>6} {r[2]:<7} {old[6]:>7}->{r[6]:<7} {old[8]:>8}->{r[8]:<8} {old[9]:>8}->{r[9]:<8}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("run", help="run the suite against a mounted card or directory")
+    p.add_argument("target")
+    p.add_argument("--results", default="storage_bench.csv")
+    p.set_defaults(func=cmd_run)
+
+    p = sub.add_parser("show", help="print every run in a results file")
+    p.add_argument("results")
+    p.set_defaults(func=cmd_show)
+
+    p = sub.add_parser("compare", help="compare the last run of two results files")
+    p.add_argument("before")
+    p.add_argument("after")
+    p.set_defaults(func=cmd_compare)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,351 @@
+#!/usr/bin/env python3
+"""Convert binary wardrive logs (.gwd) written by the app.
+
+  wardrive_convert.py info wardrive_scan_3.gwd
+  wardrive_convert.py convert wardrive_scan_3.gwd [-f csv|wigle|kml] [-o out] [--dedup]
+  wardrive_convert.py merge wardrive_scan_*.csv [-o out] [--run-rows N]
+
+`convert` writes plain CSV, a WiGLE upload file (the same format the app
+writes when Wardrive Format is CSV) or KML placemarks. Without -o the output
+goes next to the input with the matching extension. --dedup keeps one row per
+BSSID: the strongest sighting, sightings with a GPS fix first.
+
+`merge` combines CSV sessions (and .gwd logs) into one WiGLE file with one
+row per BSSID, like Merge Wardrives on the device: rows are sorted in runs
+of --run-rows, written to temporary files and k-way merged, so memory stays
+bounded however many sessions go in. Duplicates keep the best sighting with
+the earliest FirstSeen and the first non-empty SSID.
+
+The record layout is documented in src/wardrive_bin.h.
+"""
+
+import argparse
+import calendar
+import datetime
+import heapq
+import os
+import struct
+import sys
+import tempfile
+from xml.sax.saxutils import escape
+
+MAGIC = b"GWDB"
+HEADER = struct.Struct("<4sHHII")
+NETWORK = struct.Struct("<BbBB6sHiiIiHBB")
+STRING_HEAD = struct.Struct("<BBHB")
+TAG_NETWORK = 0x01
+TAG_STRING = 0x02
+NO_SSID = 0xFFFF
+NO_STRING = 0xFF
+FLAG_FIX = 0x01
+
+WIGLE_PRE = "WigleWifi-1.4,appRelease=1.0,model=GhostESP,release=1.0,device=Flipper,display=,board=,brand=Ghost\n"
+COLUMNS = "MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,AltitudeMeters,AccuracyMeters,Type\n"
+EXTENSIONS = {"csv": ".csv", "wigle": ".wigle.csv", "kml": ".kml"}
+
+
+class Sighting:
+    __slots__ = ("bssid", "ssid", "auth", "seen", "channel", "rssi", "lat", "lon", "alt", "acc", "type", "fix")
+
+
+def read_log(path):
+    """Yields Sightings, raises ValueError on a bad header. A torn last record is ignored."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        raise ValueError(f"{path}: too short")
+    magic, version, record_size, created, _ = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ValueError(f"{path}: not a wardrive log")
+    if version != 1 or record_size != NETWORK.size:
+        raise ValueError(f"{path}: unsupported version {version} (record size {record_size})")
+
+    strings = ({}, {}, {})
+    pos = HEADER.size
+    end = len(data)
+    while pos < end:
+        tag = data[pos]
+        if tag == TAG_NETWORK:
+            if pos + NETWORK.size > end:
+                break
+            (_, rssi, channel, auth, bssid, ssid, lat, lon, seen, alt, acc, kind, flags) = NETWORK.unpack_from(data, pos)
+            pos += NETWORK.size
+            s = Sighting()
+            s.bssid = ":".join(f"{b:02x}" for b in bssid)
+            s.ssid = "" if ssid == NO_SSID else strings[0].get(ssid, "")
+            s.auth = "" if auth == NO_STRING else strings[1].get(auth, "")
+            s.type = "" if kind == NO_STRING else strings[2].get(kind, "")
+            s.seen = seen
+            s.channel = channel
+            s.rssi = rssi
+            s.lat = lat
+            s.lon = lon
+            s.alt = alt
+            s.acc = acc
+            s.fix = bool(flags & FLAG_FIX)
+            yield s
+        elif tag == TAG_STRING:
+            if pos + STRING_HEAD.size > end:
+                break
+            _, table, ident, length = STRING_HEAD.unpack_from(data, pos)
+            pos += STRING_HEAD.size
+            if pos + length > end or table > 2:
+                break
+            strings[table][ident] = data[pos:pos + length].decode("utf-8", "replace")
+            pos += length
+        else:
+            raise ValueError(f"{path}: unknown record 0x{tag:02x} at offset {pos}")
+
+
+def read_header(path):
+    with open(path, "rb") as f:
+        head = f.read(HEADER.size)
+    if len(head) < HEADER.size or head[:4] != MAGIC:
+        raise ValueError(f"{path}: not a wardrive log")
+    return HEADER.unpack(head)
+
+
+def dedup(sightings):
+    best = {}
+    for s in sightings:
+        old = best.get(s.bssid)
+        best[s.bssid] = s if old is None else combine(old, s)
+    return best.values()
+
+
+def better(s, old):
+    """wardrive_row_better: a fix beats no fix, then the strongest signal."""
+    return (s.fix and not old.fix) or (s.fix == old.fix and s.rssi > old.rssi)
+
+
+def combine(kept, s):
+    """Fold a sighting of the same BSSID into the kept one, as wardrive_merge_combine does."""
+    best = s if better(s, kept) else kept
+    if kept.seen and (not best.seen or kept.seen < best.seen):
+        best.seen = kept.seen
+    if s.seen and s.seen < best.seen:
+        best.seen = s.seen
+    best.ssid = best.ssid or kept.ssid or s.ssid
+    return best
+
+
+def parse_fixed(text, digits):
+    sign = -1 if text.startswith("-") else 1
+    whole, _, frac = text.lstrip("+-").partition(".")
+    if not whole.isdigit() or (frac and not frac.isdigit()):
+        raise ValueError(text)
+    return sign * (int(whole) * 10 ** digits + int((frac + "0" * digits)[:digits]))
+
+
+def parse_seen(text):
+    try:
+        return calendar.timegm(datetime.datetime.strptime(text, "%Y-%m-%d %H:%M:%S").timetuple())
+    except ValueError:
+        return 0
+
+
+def parse_csv_row(line):
+    """A Sighting, or None for headers and broken rows. The SSID may contain commas."""
+    mac, _, rest = line.rstrip("\r\n").partition(",")
+    fields = rest.rsplit(",", 9)
+    if len(fields) != 10:
+        return None
+    ssid, auth, seen, channel, rssi, lat, lon, alt, acc, kind = fields
+    try:
+        bssid = bytes.fromhex(mac.replace(":", ""))
+        s = Sighting()
+        s.channel = int(channel)
+        s.rssi = max(-128, min(0, int(rssi)))
+        s.lat = parse_fixed(lat, 7)
+        s.lon = parse_fixed(lon, 7)
+    except ValueError:
+        return None
+    if len(bssid) != 6:
+        return None
+    # Altitude/accuracy are often blank without a fix
+    try:
+        s.alt = parse_fixed(alt, 1)
+    except ValueError:
+        s.alt = 0
+    try:
+        s.acc = parse_fixed(acc, 1)
+    except ValueError:
+        s.acc = 0
+    s.bssid = bssid.hex(":")
+    s.ssid = ssid[:32]
+    s.auth = auth
+    s.seen = parse_seen(seen)
+    s.type = kind
+    s.fix = s.lat != 0 or s.lon != 0
+    return s
+
+
+def read_csv(path):
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            s = parse_csv_row(line)
+            if s is not None:
+                yield s
+
+
+def collapse(sightings):
+    """Fold runs of equal BSSIDs in BSSID order."""
+    kept = None
+    for s in sightings:
+        if kept is not None and s.bssid == kept.bssid:
+            kept = combine(kept, s)
+            continue
+        if kept is not None:
+            yield kept
+        kept = s
+    if kept is not None:
+        yield kept
+
+
+def merge_sessions(paths, run_rows, tmp):
+    """Yields one Sighting per BSSID in BSSID order, at most run_rows sightings in memory."""
+    runs = []
+
+    def flush(rows):
+        run = os.path.join(tmp, f"run_{len(runs)}.csv")
+        with open(run, "w", newline="", encoding="utf-8") as out:
+            for s in collapse(sorted(rows, key=lambda r: r.bssid)):
+                out.write(csv_row(s))
+        runs.append(run)
+
+    rows = []
+    for path in paths:
+        for s in read_log(path) if path.endswith(".gwd") else read_csv(path):
+            rows.append(s)
+            if len(rows) == run_rows:
+                flush(rows)
+                rows = []
+    if rows:
+        flush(rows)
+
+    merged = heapq.merge(*(read_csv(run) for run in runs), key=lambda r: r.bssid)
+    return collapse(merged)
+
+
+def fixed(value, digits):
+    sign = "-" if value < 0 else ""
+    value = abs(value)
+    scale = 10 ** digits
+    return f"{sign}{value // scale}.{value % scale:0{digits}d}"
+
+
+def seen_text(seen):
+    if not seen:
+        return ""
+    return datetime.datetime.fromtimestamp(seen, datetime.timezone.utc).strftime("%Y-%m-%d %H:%M:%S")
+
+
+def csv_row(s):
+    return (f"{s.bssid},{s.ssid},{s.auth},{seen_text(s.seen)},{s.channel},{s.rssi},"
+            f"{fixed(s.lat, 7)},{fixed(s.lon, 7)},{fixed(s.alt, 1)},{fixed(s.acc, 1)},{s.type}\n")
+
+
+def write_csv(out, sightings, wigle):
+    if wigle:
+        out.write(WIGLE_PRE)
+    out.write(COLUMNS)
+    count = 0
+    for s in sightings:
+        out.write(csv_row(s))
+        count += 1
+    return count
+
+
+def write_kml(out, sightings, name):
+    out.write('<?xml version="1.0" encoding="UTF-8"?>\n')
+    out.write('<kml xmlns="http://www.opengis.net/kml/2.2">\n<Document>\n')
+    out.write(f"<name>{escape(name)}</name>\n")
+    count = 0
+    for s in sightings:
+        if not s.fix:
+            continue
+        label = escape(s.ssid or s.bssid)
+        out.write(
+            f"<Placemark><name>{label}</name>"
+            f"<description>{escape(s.bssid)} ch {s.channel} {s.rssi} dBm {escape(s.auth)} {escape(s.type)}</description>"
+            f"<Point><coordinates>{fixed(s.lon, 7)},{fixed(s.lat, 7)},{fixed(s.alt, 1)}</coordinates></Point>"
+            f"</Placemark>\n")
+        count += 1
+    out.write("</Document>\n</kml>\n")
+    return count
+
+
+def cmd_convert(args):
+    sightings = read_log(args.log)
+    if args.dedup:
+        sightings = dedup(sightings)
+    output = args.output or os.path.splitext(args.log)[0] + EXTENSIONS[args.format]
+    with open(output, "w", newline="", encoding="utf-8") as out:
+        if args.format == "kml":
+            count = write_kml(out, sightings, os.path.basename(args.log))
+        else:
+            count = write_csv(out, sightings, args.format == "wigle")
+    print(f"{output}: {count} rows")
+
+
+def cmd_merge(args):
+    output = args.output or "wardrive_merged.csv"
+    with tempfile.TemporaryDirectory() as tmp:
+        sightings = merge_sessions(args.sessions, args.run_rows, tmp)
+        with open(output, "w", newline="", encoding="utf-8") as out:
+            count = write_csv(out, sightings, True)
+    print(f"{output}: {count} networks from {len(args.sessions)} sessions")
+
+
+def cmd_info(args):
+    _, version, record_size, created, _ = read_header(args.log)
+    rows = 0
+    fixes = 0
+    bssids = set()
+    first = last = 0
+    for s in read_log(args.log):
+        rows += 1
+        fixes += s.fix
+        bssids.add(s.bssid)
+        if s.seen:
+            first = min(first, s.seen) if first else s.seen
+            last = max(last, s.seen)
+    size = os.path.getsize(args.log)
+    print(f"{args.log}: version {version}, {size} bytes, created {seen_text(created) or 'unknown'}")
+    print(f"  {rows} sightings ({fixes} with fix), {len(bssids)} networks")
+    if first:
+        print(f"  first seen {seen_text(first)}, last {seen_text(last)}")
+    if rows:
+        print(f"  {size / rows:.1f} bytes per sighting")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("convert", help="convert a log to CSV, WiGLE or KML")
+    p.add_argument("log")
+    p.add_argument("-f", "--format", choices=sorted(EXTENSIONS), default="wigle")
+    p.add_argument("-o", "--output")
+    p.add_argument("--dedup", action="store_true", help="one row per BSSID")
+    p.set_defaults(func=cmd_convert)
+
+    p = sub.add_parser("merge", help="merge sessions into one WiGLE CSV, one row per BSSID")
+    p.add_argument("sessions", nargs="+", help="wardrive CSVs or .gwd logs")
+    p.add_argument("-o", "--output")
+    p.add_argument("--run-rows", type=int, default=100000, help="rows sorted in memory at a time")
+    p.set_defaults(func=cmd_merge)
+
+    p = sub.add_parser("info", help="summarize a log")
+    p.add_argument("log")
+    p.set_defaults(func=cmd_info)
+
+    args = parser.parse_args()
+    try:
+        args.func(args)
+    except ValueError as e:
+        raise SystemExit(str(e))
+
+
+if __name__ == "__main__":
+    sys.exit(main())